@@ -0,0 +1,986 @@
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CameraPath.h"
+#include "CompactVertex.h"
+#include "LargeChunk.h"
+#include "Options.h"
+#include "Sampler.h"
+#include "THierarchy.h"
+#include "Timer.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define BENCHMARK_SAMPLER(f) { #f, (BenchmarkSamplerFn)&f }
+
+static struct BenchmarkSampler benchmark_samplers[] =
+{
+	BENCHMARK_SAMPLER(SurfaceFn_sphere),
+	BENCHMARK_SAMPLER(SurfaceFn_sphere_sliced),
+	BENCHMARK_SAMPLER(SurfaceD_sphere),
+	BENCHMARK_SAMPLER(SurfaceD_torus_z),
+	BENCHMARK_SAMPLER(SurfaceD_plane),
+	BENCHMARK_SAMPLER(SurfaceFn_Klein_bottle),
+	BENCHMARK_SAMPLER(SurfaceFn_2d_terrain),
+	BENCHMARK_SAMPLER(SurfaceFn_3d_terrain),
+	BENCHMARK_SAMPLER(SurfaceFn_sphere_r),
+	BENCHMARK_SAMPLER(SurfaceFn_torus_r),
+	BENCHMARK_SAMPLER(SurfaceFn_windy),
+};
+
+// Steps small enough that most of the lattice keeps its sign from frame to frame
+static struct BenchmarkAnimation benchmark_animations[] =
+{
+	{ BENCHMARK_SAMPLER(SurfaceFn_sphere), 0.5f },
+	{ BENCHMARK_SAMPLER(SurfaceFn_2d_terrain), 0.002f },
+	{ BENCHMARK_SAMPLER(SurfaceFn_3d_terrain), 0.003f },
+	{ BENCHMARK_SAMPLER(SurfaceFn_sphere_r), 0.0005f },
+	{ BENCHMARK_SAMPLER(SurfaceFn_torus_r), 0.01f },
+};
+
+int Benchmark_run(const char* out_path, const char* trace_path, int quick)
+{
+	FILE* out = fopen(out_path, "w");
+	if (!out)
+	{
+		printf("Failed to open benchmark output %s.\n", out_path);
+		return 1;
+	}
+
+	uint32_t chunk_dims[] = { 15, 31, 63 };
+	int sub_resolutions[] = { 1, 3, 7 };
+	int max_depths[] = { 12, 16, MAX_TREE_DEPTH };
+	int sampler_count = sizeof(benchmark_samplers) / sizeof(benchmark_samplers[0]);
+	int animation_count = sizeof(benchmark_animations) / sizeof(benchmark_animations[0]);
+	int repeats = quick ? 1 : BENCHMARK_REPEATS;
+	BenchmarkSamplerFn default_sampler = sampler_fn;
+	double start_ms = Timer_ms();
+	int failures = 0;
+	Trace_thread_name("Benchmark");
+
+	printf("Running %s benchmark, writing to %s.\n", quick ? "quick" : "full", out_path);
+	fprintf(out, "{\n  \"version\": 1,\n  \"quick\": %s,\n  \"repeats\": %i,\n", quick ? "true" : "false", repeats);
+	fprintf(out, "  \"options\": { \"USE_REGULAR_MC\": %i, \"SNAP_THRESHOLD\": %g, \"DELETE_AFTER_EXTRACT\": %i, \"COMPACT_VERTICES\": %i, \"VERTEX_CACHE_OPTIMIZE\": %i, \"HOT_PATH_COUNTERS\": %i, \"FLOAT_NOISE\": %i, \"BOUNDS_PRUNING\": %i },\n",
+		USE_REGULAR_MC, SNAP_THRESHOLD, DELETE_AFTER_EXTRACT, COMPACT_VERTICES, VERTEX_CACHE_OPTIMIZE, HOT_PATH_COUNTERS, FLOAT_NOISE, BOUNDS_PRUNING);
+
+	struct osn_context* osn;
+	open_simplex_noise(77374, &osn);
+	int first = 1;
+	fprintf(out, "  \"noise\": [");
+	for (int dims = 2; dims <= 3; dims++)
+	{
+		// Sampler-sized coordinates, then far from the origin where double rounding starts to matter
+		_Benchmark_noise_case(out, dims, 2.56f, quick, osn, &first);
+		_Benchmark_noise_case(out, dims, 4096.0f, quick, osn, &first);
+	}
+	_Benchmark_fused_noise_case(out, quick, osn, &first);
+	fprintf(out, "\n  ],\n");
+
+	first = 1;
+	fprintf(out, "  \"bounds\": [");
+	for (int s = 0; s < sampler_count; s++)
+		_Benchmark_bounds_case(out, benchmark_samplers + s, quick, osn, &first);
+	fprintf(out, "\n  ],\n");
+
+	first = 1;
+	fprintf(out, "  \"compact_vertices\": [");
+	failures += _Benchmark_compact_case(out, quick, &first);
+	fprintf(out, "\n  ],\n");
+
+	first = 1;
+	fprintf(out, "  \"chunks\": [");
+	for (int s = 0; s < sampler_count; s++)
+	{
+		for (int d = quick ? 1 : 0; d < (quick ? 2 : 3); d++)
+		{
+			for (int pem = 0; pem < 2; pem++)
+				_Benchmark_chunk_case(out, benchmark_samplers + s, chunk_dims[d], pem, UMC_LAYOUT_LINEAR, repeats, osn, &first);
+		}
+	}
+	fprintf(out, "\n  ],\n");
+
+	first = 1;
+	fprintf(out, "  \"parallel\": [");
+	for (int s = 0; s < sampler_count; s++)
+	{
+		for (int d = quick ? 1 : 0; d < (quick ? 2 : 3); d++)
+		{
+			for (int pem = 0; pem < 2; pem++)
+			{
+				for (int layout = UMC_LAYOUT_LINEAR; layout <= UMC_LAYOUT_TILED; layout++)
+					failures += _Benchmark_parallel_case(out, benchmark_samplers + s, chunk_dims[d] * 2 + 1, pem, layout, osn, &first);
+			}
+		}
+	}
+	fprintf(out, "\n  ],\n");
+
+	first = 1;
+	fprintf(out, "  \"animation\": [");
+	for (int a = 0; a < animation_count; a++)
+	{
+		for (int d = quick ? 1 : 0; d < (quick ? 2 : 3); d++)
+		{
+			for (int pem = 0; pem < 2; pem++)
+				failures += _Benchmark_animation_case(out, benchmark_animations + a, chunk_dims[d], pem, osn, &first);
+		}
+	}
+	fprintf(out, "\n  ],\n");
+
+	// One cheap sampler, so lattice traffic rather than sampling decides between the layouts
+	struct BenchmarkSampler layout_sampler = BENCHMARK_SAMPLER(SurfaceD_sphere);
+	uint32_t layout_dims[] = { 63, 127, 255, 511, 1023 };
+	first = 1;
+	fprintf(out, "  \"layouts\": [");
+	for (int d = 0; d < (quick ? 2 : 5); d++)
+	{
+		for (int pem = 0; pem < 2; pem++)
+		{
+			for (int layout = UMC_LAYOUT_LINEAR; layout <= UMC_LAYOUT_TILED; layout++)
+				_Benchmark_chunk_case(out, &layout_sampler, layout_dims[d], pem, layout, layout_dims[d] >= 255 ? 1 : repeats, osn, &first);
+		}
+	}
+	fprintf(out, "\n  ],\n");
+
+	// Lattices past what one chunk's grids can hold, meshed block by block into submeshes
+	uint32_t large_dims[] = { 511, 1023 };
+	first = 1;
+	fprintf(out, "  \"large_chunks\": [");
+	for (int d = 0; d < (quick ? 1 : 2); d++)
+	{
+		for (int pem = 0; pem < 2; pem++)
+			_Benchmark_large_case(out, &layout_sampler, large_dims[d], pem, osn, &first);
+	}
+	fprintf(out, "\n  ],\n");
+	open_simplex_noise_free(osn);
+
+	first = 1;
+	fprintf(out, "  \"hierarchies\": [");
+	for (int s = 0; s < sampler_count; s++)
+	{
+		// Hierarchies are far slower than single chunks; the quick run only covers the default scene
+		if (quick && benchmark_samplers[s].fn != default_sampler)
+			continue;
+		for (int r = quick ? 1 : 0; r < (quick ? 2 : 3); r++)
+		{
+			for (int d = quick ? 2 : 0; d < 3; d++)
+			{
+				for (int pem = 0; pem < 2; pem++)
+					_Benchmark_hierarchy_case(out, benchmark_samplers + s, pem, sub_resolutions[r], max_depths[d], &first);
+			}
+		}
+	}
+	fprintf(out, "\n  ],\n");
+
+	sampler_fn = default_sampler;
+	fprintf(out, "  \"failed_checks\": %i,\n  \"total_ms\": %.3f,\n  \"peak_memory_bytes\": %llu\n}\n", failures, Timer_ms() - start_ms, (unsigned long long)_Benchmark_peak_memory());
+	fclose(out);
+	printf("Benchmark done in %.1f s.\n", (Timer_ms() - start_ms) / 1000.0);
+	if (failures)
+	{
+		printf("%i benchmark checks failed, see %s.\n", failures, out_path);
+		return 1;
+	}
+
+	// Rings keep the most recent events, so this covers the tail of the sweep
+	if (trace_path)
+	{
+		if (!TRACE_EVENTS)
+			printf("Tracing is compiled out, set TRACE_EVENTS to record %s.\n", trace_path);
+		else if (Trace_dump(trace_path))
+			return 1;
+	}
+	return 0;
+}
+
+int Benchmark_replay(const char* path_file, const char* out_path, int stride)
+{
+	static struct THierarchy hierarchy;
+	struct CameraPath path;
+	if (CameraPath_init(&path))
+		return 1;
+	if (CameraPath_load(&path, path_file) || !path.count)
+	{
+		printf("No camera path to replay in %s.\n", path_file);
+		CameraPath_destroy(&path);
+		return 1;
+	}
+	FILE* out = fopen(out_path, "w");
+	if (!out)
+	{
+		printf("Failed to open replay output %s.\n", out_path);
+		CameraPath_destroy(&path);
+		return 1;
+	}
+
+	if (stride < 1)
+		stride = 1;
+	uint32_t step_count = (path.count + stride - 1) / stride;
+	float* latencies = malloc(step_count * sizeof(float));
+	struct ReplayLeaf* leaves[2] = { 0, 0 };
+	uint32_t leaf_sizes[2] = { 0, 0 };
+	uint32_t leaf_counts[2] = { 0, 0 };
+	if (!latencies)
+	{
+		printf("Failed to alloc replay latencies.\n");
+		fclose(out);
+		CameraPath_destroy(&path);
+		return 1;
+	}
+
+	printf("Replaying %u camera ticks from %s every %i ticks, writing to %s.\n", path.count, path_file, stride, out_path);
+	THierarchy_init_empty(&hierarchy, BENCHMARK_T_RESOLUTION, 0);
+	double start_ms = Timer_ms();
+	uint64_t total_splits = 0, total_merges = 0;
+
+	fprintf(out, "{\n  \"version\": 1,\n  \"path\": \"%s\",\n  \"ticks\": %u,\n  \"stride\": %i,\n", path_file, path.count, stride);
+	fprintf(out, "  \"settings\": { \"pem\": %s, \"sub_resolution\": %i, \"max_depth\": %i },\n  \"steps\": [",
+		hierarchy.pem ? "true" : "false", hierarchy.sub_resolution, hierarchy.max_depth);
+	for (uint32_t step = 0; step < step_count; step++)
+	{
+		struct CameraPathKey* key = path.keys + step * stride;
+		vec3_copy(key->position, hierarchy.focus_point);
+
+		// Same sequence as THierarchy_extract_tree, minus the GL outline
+		double step_start_ms = Timer_ms();
+		MeshArena_reset(&hierarchy.arena);
+		THierarchy_refine(&hierarchy);
+		double refine_ms = Timer_ms() - step_start_ms;
+		THierarchy_extract_all_leaves(&hierarchy);
+		double latency_ms = Timer_ms() - step_start_ms;
+		latencies[step] = (float)latency_ms;
+
+		// Leaves are rebuilt every refine, so changes are found by comparing this step's leaves against the last
+		int cur = step & 1;
+		_Benchmark_gather_leaves(&hierarchy, &leaves[cur], &leaf_sizes[cur], &leaf_counts[cur]);
+		uint32_t splits = 0, merges = 0;
+		if (step > 0)
+		{
+			splits = _Benchmark_count_refined(leaves[!cur], leaf_counts[!cur], leaves[cur], leaf_counts[cur]);
+			merges = _Benchmark_count_refined(leaves[cur], leaf_counts[cur], leaves[!cur], leaf_counts[!cur]);
+		}
+		total_splits += splits;
+		total_merges += merges;
+
+		fprintf(out, "%s\n    { \"step\": %u, \"tick\": %u, \"position\": [%.3f, %.3f, %.3f], \"leaves\": %i, \"splits\": %u, \"merges\": %u, \"refine_ms\": %.3f, \"latency_ms\": %.3f, \"vertices\": %u, \"triangles\": %u, \"memory_bytes\": %llu }",
+			step ? "," : "", step, step * stride, key->position[0], key->position[1], key->position[2], hierarchy.leaf_count, splits, merges,
+			refine_ms, latency_ms, hierarchy.v_count, hierarchy.p_count / 3, (unsigned long long)_Benchmark_peak_memory());
+		fflush(out);
+	}
+
+	qsort(latencies, step_count, sizeof(float), _Benchmark_compare_floats);
+	fprintf(out, "\n  ],\n  \"latency_ms\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+		latencies[step_count * 50 / 100], latencies[step_count * 90 / 100], latencies[step_count * 99 / 100], latencies[step_count - 1]);
+	fprintf(out, "  \"splits\": %llu,\n  \"merges\": %llu,\n  \"total_ms\": %.3f,\n  \"peak_memory_bytes\": %llu\n}\n",
+		(unsigned long long)total_splits, (unsigned long long)total_merges, Timer_ms() - start_ms, (unsigned long long)_Benchmark_peak_memory());
+	fclose(out);
+	printf("Replay done in %.1f s, p50 %.1f ms, p99 %.1f ms.\n", (Timer_ms() - start_ms) / 1000.0, latencies[step_count * 50 / 100], latencies[step_count * 99 / 100]);
+
+	THierarchy_destroy(&hierarchy);
+	free(latencies);
+	free(leaves[0]);
+	free(leaves[1]);
+	CameraPath_destroy(&path);
+	return 0;
+}
+
+void _Benchmark_chunk_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, enum UMC_Layout layout, int repeats, struct osn_context* osn, int* first)
+{
+	sampler_fn = sampler->fn;
+
+	// One cube spanning the whole sampler world, same corner order as Hexahedron
+	const float h = 128.0f;
+	vec3 corners[8] =
+	{
+		{ -h, -h, -h }, { h, -h, -h }, { h, -h, h }, { -h, -h, h },
+		{ -h, h, -h }, { h, h, -h }, { h, h, h }, { -h, h, h },
+	};
+
+	uint32_t vn_size = 4096, vn_next = 0, i_size = 4096, i_next = 0;
+	vec3* vertices = malloc(vn_size * sizeof(vec3));
+	vec3* normals = malloc(vn_size * sizeof(vec3));
+	uint32_t* indexes = malloc(i_size * sizeof(uint32_t));
+	if (!vertices || !normals || !indexes)
+	{
+		printf("Failed to alloc benchmark chunk output.\n");
+		free(vertices);
+		free(normals);
+		free(indexes);
+		return;
+	}
+
+	struct UMC_Chunk chunk;
+	UMC_Chunk_init(&chunk, dim, 1, pem, SNAP_THRESHOLD);
+	UMC_Chunk_set_layout(&chunk, layout);
+	chunk.v_out = &vertices;
+	chunk.n_out = &normals;
+	chunk.vn_size = &vn_size;
+	chunk.vn_next = &vn_next;
+	chunk.i_out = &indexes;
+	chunk.i_size = &i_size;
+	chunk.i_next = &i_next;
+
+	// Keep the fastest repeat; later repeats also exercise the reset path
+	struct UMC_Timings best;
+	float best_total = -1;
+	UMC_Timings_zero(&best);
+	for (int r = 0; r < repeats; r++)
+	{
+		vn_next = 0;
+		i_next = 0;
+		UMC_Chunk_run(&chunk, corners, 1, osn);
+		float total = UMC_Timings_total(&chunk.timings);
+		if (best_total < 0 || total < best_total)
+		{
+			best = chunk.timings;
+			best_total = total;
+		}
+	}
+
+	const char* layout_name = layout == UMC_LAYOUT_TILED ? "tiled" : "linear";
+	if (!chunk.grid_signs && chunk.lattice_count)
+	{
+		// The chunk sized its grids but couldn't allocate them, big dims can outgrow the machine. Chunks pruned by
+		// bounds never size them.
+		fprintf(out, "%s\n    { \"sampler\": \"%s\", \"dim\": %u, \"pem\": %s, \"layout\": \"%s\", \"skipped\": \"allocation failed\" }",
+			*first ? "" : ",", sampler->name, dim, pem ? "true" : "false", layout_name);
+		*first = 0;
+		UMC_Chunk_destroy(&chunk);
+		free(vertices);
+		free(normals);
+		free(indexes);
+		return;
+	}
+
+	double seconds = best_total > 0 ? best_total / 1000.0 : 1e-9;
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"dim\": %u, \"pem\": %s, \"layout\": \"%s\", \"threads\": %u, ", *first ? "" : ",", sampler->name, dim, pem ? "true" : "false", layout_name,
+		chunk.threads);
+	_Benchmark_write_stages(out, &best, 0);
+	fprintf(out, ", \"total_ms\": %.3f, \"samples\": %llu, \"samples_per_s\": %.0f, \"vertices\": %u, \"triangles\": %u, \"triangles_per_s\": %.0f, \"peak_memory_bytes\": %llu",
+		best_total, (unsigned long long)best.samples, best.samples / seconds, chunk.v_count, chunk.p_count / 3, chunk.p_count / 3 / seconds, (unsigned long long)_Benchmark_peak_memory());
+	// Per-cell stage costs, comparable across dims and between the pem and non-pem kernels
+	double cells = (double)dim * dim * dim;
+	fprintf(out, ", \"ns_per_cell\": { \"label_grid\": %.2f, \"label_edges\": %.2f, \"polygonize\": %.2f }",
+		best.label_grid_ms * 1e6 / cells, best.label_edges_ms * 1e6 / cells, best.polygonize_ms * 1e6 / cells);
+	_Benchmark_write_counters(out, &chunk.counters);
+	fflush(out);
+	*first = 0;
+
+	UMC_Chunk_destroy(&chunk);
+	free(vertices);
+	free(normals);
+	free(indexes);
+}
+
+void _Benchmark_large_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, struct osn_context* osn, int* first)
+{
+	sampler_fn = sampler->fn;
+	const float h = 128.0f;
+	vec3 corners[8] =
+	{
+		{ -h, -h, -h }, { h, -h, -h }, { h, -h, h }, { -h, -h, h },
+		{ -h, h, -h }, { h, h, -h }, { h, h, h }, { -h, h, h },
+	};
+
+	struct LargeChunk chunk;
+	if (LargeChunk_init(&chunk, dim, pem, SNAP_THRESHOLD))
+		return;
+
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"dim\": %u, \"lattice_dim\": %u, \"blocks\": %u, \"block_dim\": %u, \"pem\": %s, ",
+		*first ? "" : ",", sampler->name, dim, chunk.dim, chunk.blocks, chunk.block_dim, pem ? "true" : "false");
+	*first = 0;
+	if (LargeChunk_run(&chunk, corners, 1, osn))
+	{
+		fprintf(out, "\"skipped\": \"allocation failed\" }");
+		LargeChunk_destroy(&chunk);
+		return;
+	}
+
+	// The largest submesh shows how much headroom its 32-bit indexes have left
+	uint32_t max_vertices = 0;
+	for (uint32_t i = 0; i < chunk.submesh_count; i++)
+		max_vertices = chunk.submeshes[i].v_count > max_vertices ? chunk.submeshes[i].v_count : max_vertices;
+
+	float total_ms = UMC_Timings_total(&chunk.timings);
+	double seconds = total_ms > 0 ? total_ms / 1000.0 : 1e-9;
+	_Benchmark_write_stages(out, &chunk.timings, 0);
+	fprintf(out, ", \"total_ms\": %.3f, \"samples\": %llu, \"samples_per_s\": %.0f, \"vertices\": %llu, \"triangles\": %llu, \"triangles_per_s\": %.0f, \"submeshes\": %u, \"max_submesh_vertices\": %u, \"peak_memory_bytes\": %llu",
+		total_ms, (unsigned long long)chunk.timings.samples, chunk.timings.samples / seconds, (unsigned long long)chunk.v_count, (unsigned long long)chunk.p_count / 3,
+		chunk.p_count / 3 / seconds, chunk.submesh_count, max_vertices, (unsigned long long)_Benchmark_peak_memory());
+	_Benchmark_write_counters(out, &chunk.counters);
+	fflush(out);
+	LargeChunk_destroy(&chunk);
+}
+
+void _Benchmark_noise_case(FILE* out, int dims, float extent, int quick, struct osn_context* osn, int* first)
+{
+	uint32_t count = quick ? BENCHMARK_NOISE_SAMPLES / 8 : BENCHMARK_NOISE_SAMPLES;
+	float* points = malloc(count * 3 * sizeof(float));
+	double* reference = malloc(count * sizeof(double));
+	float* values = malloc(count * sizeof(float));
+	if (!points || !reference || !values)
+	{
+		printf("Failed to alloc benchmark noise samples.\n");
+		free(points);
+		free(reference);
+		free(values);
+		return;
+	}
+
+	// Fixed LCG so every run compares the same points
+	uint32_t seed = 12345;
+	for (uint32_t i = 0; i < count * 3; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		points[i] = ((float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f) * extent;
+	}
+
+	double start_ms = Timer_ms();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float* p = points + i * 3;
+		reference[i] = dims == 2 ? open_simplex_noise2(osn, p[0], p[1]) : open_simplex_noise3(osn, p[0], p[1], p[2]);
+	}
+	double double_ms = Timer_ms() - start_ms;
+
+	start_ms = Timer_ms();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float* p = points + i * 3;
+		values[i] = dims == 2 ? open_simplex_noise2f(osn, p[0], p[1]) : open_simplex_noise3f(osn, p[0], p[1], p[2]);
+	}
+	double float_ms = Timer_ms() - start_ms;
+
+	double max_error = 0, sum_error = 0, sum_squared = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		double error = fabs(values[i] - reference[i]);
+		if (error > max_error)
+			max_error = error;
+		sum_error += error;
+		sum_squared += error * error;
+	}
+
+	fprintf(out, "%s\n    { \"dims\": %i, \"extent\": %g, \"samples\": %u, \"double_ns\": %.2f, \"float_ns\": %.2f, \"speedup\": %.3f, \"max_abs_error\": %.3g, \"mean_abs_error\": %.3g, \"rms_error\": %.3g }",
+		*first ? "" : ",", dims, extent, count, double_ms * 1e6 / count, float_ms * 1e6 / count, float_ms > 0 ? double_ms / float_ms : 0,
+		max_error, sum_error / count, sqrt(sum_squared / count));
+	fflush(out);
+	*first = 0;
+
+	free(points);
+	free(reference);
+	free(values);
+}
+
+void _Benchmark_fused_noise_case(FILE* out, int quick, struct osn_context* osn, int* first)
+{
+	uint32_t count = quick ? BENCHMARK_NOISE_SAMPLES / 8 : BENCHMARK_NOISE_SAMPLES;
+	float* points = malloc(count * 3 * sizeof(float));
+	if (!points)
+	{
+		printf("Failed to alloc benchmark noise samples.\n");
+		return;
+	}
+
+	uint32_t seed = 12345;
+	for (uint32_t i = 0; i < count * 3; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		points[i] = ((float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f) * 2.56f;
+	}
+
+	// Three 4-octave warp channels, as SurfaceFn_windy evaluates them, separately and fused; the sums keep the loops alive
+	float separate_sum = 0, fused_sum = 0;
+	double start_ms = Timer_ms();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float* p = points + i * 3;
+		separate_sum += open_simplex_noise3f_oct(osn, p[0] + 1.186f, p[1] + 1.186f, p[2] + 1.186f, 4, 0.5f);
+		separate_sum += open_simplex_noise3f_oct(osn, p[0] + 0.842f, p[1] + 0.842f, p[2] + 0.842f, 4, 0.5f);
+		separate_sum += open_simplex_noise3f_oct(osn, p[0] + 0.357f, p[1] + 0.357f, p[2] + 0.357f, 4, 0.5f);
+	}
+	double separate_ms = Timer_ms() - start_ms;
+
+	start_ms = Timer_ms();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float* p = points + i * 3;
+		float warp[3];
+		open_simplex_noise3f_multi_oct(osn, p[0] + 1.186f, p[1] + 1.186f, p[2] + 1.186f, 4, 0.5f, 3, warp);
+		fused_sum += warp[0] + warp[1] + warp[2];
+	}
+	double fused_ms = Timer_ms() - start_ms;
+
+	fprintf(out, "%s\n    { \"dims\": 3, \"channels\": 3, \"octaves\": 4, \"samples\": %u, \"separate_ns\": %.2f, \"fused_ns\": %.2f, \"speedup\": %.3f, \"checksum\": %g }",
+		*first ? "" : ",", count, separate_ms * 1e6 / count, fused_ms * 1e6 / count, fused_ms > 0 ? separate_ms / fused_ms : 0, separate_sum + fused_sum);
+	fflush(out);
+	*first = 0;
+
+	free(points);
+}
+
+void _Benchmark_bounds_case(FILE* out, struct BenchmarkSampler* sampler, int quick, struct osn_context* osn, int* first)
+{
+	SamplerBoundsFn bounds_fn = Sampler_bounds((const void*)sampler->fn);
+	if (!bounds_fn)
+		return;
+
+	uint32_t boxes = quick ? BENCHMARK_BOUNDS_BOXES / 8 : BENCHMARK_BOUNDS_BOXES;
+	uint32_t violations = 0, excluded = 0;
+	double max_violation = 0, sum_tightness = 0, bounds_ms = 0;
+	uint32_t seed = 12345;
+	for (uint32_t b = 0; b < boxes; b++)
+	{
+		// Boxes from a quarter unit to a couple of hundred units across, anywhere in the sampler world
+		vec3 box_min, box_max;
+		float r[4];
+		for (int i = 0; i < 4; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			r[i] = (float)(seed >> 8) / (float)(1 << 24);
+		}
+		float size = powf(2.0f, r[3] * 9.5f - 2.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			box_min[i] = r[i] * 400.0f - 200.0f;
+			box_max[i] = box_min[i] + size;
+		}
+		float spacing = size / (float)(BENCHMARK_BOUNDS_LATTICE - 1);
+
+		float lo, hi;
+		double start_ms = Timer_ms();
+		bounds_fn(box_min, box_max, 0, spacing, osn, &lo, &hi);
+		bounds_ms += Timer_ms() - start_ms;
+
+		float sampled_lo = INFINITY, sampled_hi = -INFINITY;
+		for (int x = 0; x < BENCHMARK_BOUNDS_LATTICE; x++)
+		{
+			for (int y = 0; y < BENCHMARK_BOUNDS_LATTICE; y++)
+			{
+				for (int z = 0; z < BENCHMARK_BOUNDS_LATTICE; z++)
+				{
+					float v = sampler->fn(box_min[0] + x * spacing, box_min[1] + y * spacing, box_min[2] + z * spacing, 0, spacing, osn);
+					double violation = max(lo - v, v - hi);
+					if (violation > 0)
+					{
+						violations++;
+						max_violation = max(max_violation, violation);
+					}
+					sampled_lo = min(sampled_lo, v);
+					sampled_hi = max(sampled_hi, v);
+				}
+			}
+		}
+		if (lo > 0 || hi < 0)
+			excluded++;
+		if (hi > lo)
+			sum_tightness += (sampled_hi - sampled_lo) / (hi - lo);
+	}
+
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"boxes\": %u, \"lattice\": %i, \"violations\": %u, \"max_violation\": %.3g, \"excluded_boxes\": %u, \"mean_tightness\": %.3f, \"bounds_ns\": %.1f }",
+		*first ? "" : ",", sampler->name, boxes, BENCHMARK_BOUNDS_LATTICE, violations, max_violation, excluded, sum_tightness / boxes, bounds_ms * 1e6 / boxes);
+	fflush(out);
+	*first = 0;
+}
+
+int _Benchmark_parallel_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, enum UMC_Layout layout, struct osn_context* osn, int* first)
+{
+	sampler_fn = sampler->fn;
+	const float h = 128.0f;
+	vec3 corners[8] =
+	{
+		{ -h, -h, -h }, { h, -h, -h }, { h, -h, h }, { -h, -h, h },
+		{ -h, h, -h }, { h, h, -h }, { h, h, h }, { -h, h, h },
+	};
+
+	// Serial first, then the same chunk split over x-slabs
+	struct BenchmarkOutput outputs[2];
+	uint32_t snapped[2];
+	float total_ms[2];
+	int failed = _BenchmarkOutput_init(&outputs[0]);
+	failed |= _BenchmarkOutput_init(&outputs[1]);
+	for (int i = 0; i < 2 && !failed; i++)
+	{
+		struct UMC_Chunk chunk;
+		UMC_Chunk_init(&chunk, dim, 1, pem, SNAP_THRESHOLD);
+		UMC_Chunk_set_layout(&chunk, layout);
+		UMC_Chunk_set_threads(&chunk, i ? BENCHMARK_PARALLEL_THREADS : 1);
+		_BenchmarkOutput_attach(&outputs[i], &chunk);
+		UMC_Chunk_run(&chunk, corners, 1, osn);
+		snapped[i] = chunk.snapped_count;
+		total_ms[i] = UMC_Timings_total(&chunk.timings);
+		failed = !chunk.grid_signs && chunk.lattice_count;
+		UMC_Chunk_destroy(&chunk);
+	}
+	if (failed)
+	{
+		printf("Failed to alloc benchmark parallel chunks.\n");
+		_BenchmarkOutput_destroy(&outputs[0]);
+		_BenchmarkOutput_destroy(&outputs[1]);
+		return 1;
+	}
+
+	int identical = _BenchmarkOutput_equal(&outputs[0], &outputs[1]) && snapped[0] == snapped[1];
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"dim\": %u, \"pem\": %s, \"layout\": \"%s\", \"threads\": %i, \"identical\": %s, \"vertices\": %u, \"snapped\": %u, \"serial_ms\": %.3f, \"parallel_ms\": %.3f, \"speedup\": %.3f }",
+		*first ? "" : ",", sampler->name, dim, pem ? "true" : "false", layout == UMC_LAYOUT_TILED ? "tiled" : "linear", BENCHMARK_PARALLEL_THREADS,
+		identical ? "true" : "false", outputs[0].vn_next, snapped[0], total_ms[0], total_ms[1], total_ms[1] > 0 ? total_ms[0] / total_ms[1] : 0);
+	fflush(out);
+	*first = 0;
+	if (!identical)
+		printf("%s at dim %u differs between the serial and parallel runs.\n", sampler->name, dim);
+
+	_BenchmarkOutput_destroy(&outputs[0]);
+	_BenchmarkOutput_destroy(&outputs[1]);
+	return identical ? 0 : 1;
+}
+
+int _Benchmark_animation_case(FILE* out, struct BenchmarkAnimation* animation, uint32_t dim, int pem, struct osn_context* osn, int* first)
+{
+	sampler_fn = animation->sampler.fn;
+	const float h = 128.0f;
+	vec3 corners[8] =
+	{
+		{ -h, -h, -h }, { h, -h, -h }, { h, -h, h }, { -h, -h, h },
+		{ -h, h, -h }, { h, h, -h }, { h, h, h }, { -h, h, h },
+	};
+
+	struct BenchmarkOutput outputs[2];
+	int failed = _BenchmarkOutput_init(&outputs[0]);
+	failed |= _BenchmarkOutput_init(&outputs[1]);
+	struct UMC_Chunk animated;
+	UMC_Chunk_init(&animated, dim, 1, pem, SNAP_THRESHOLD);
+	UMC_Chunk_set_animated(&animated, 1);
+	_BenchmarkOutput_attach(&outputs[0], &animated);
+
+	// The first frame is a full run for both chunks, so only the ones after it are timed
+	float animated_ms = 0, full_ms = 0;
+	uint64_t resampled = 0;
+	int identical = 1;
+	for (int frame = 0; frame < BENCHMARK_ANIMATION_FRAMES && identical && !failed; frame++)
+	{
+		// The animated chunk rewrites its last output in place, so only the fresh one's buffers start over
+		float w = frame * animation->w_step;
+		animated.timer = w;
+		UMC_Chunk_run(&animated, corners, 1, osn);
+
+		struct UMC_Chunk full;
+		UMC_Chunk_init(&full, dim, 1, pem, SNAP_THRESHOLD);
+		outputs[1].vn_next = 0;
+		outputs[1].i_next = 0;
+		_BenchmarkOutput_attach(&outputs[1], &full);
+		full.timer = w;
+		UMC_Chunk_run(&full, corners, 1, osn);
+
+		failed = (!animated.grid_signs && animated.lattice_count) || (!full.grid_signs && full.lattice_count);
+		identical = _BenchmarkOutput_equal_triangles(&outputs[0], &outputs[1]) && animated.snapped_count == full.snapped_count;
+		if (frame)
+		{
+			animated_ms += UMC_Timings_total(&animated.timings);
+			full_ms += UMC_Timings_total(&full.timings);
+			resampled += animated.timings.samples;
+		}
+		if (!identical)
+			printf("%s at dim %u differs from a full run at frame %i (w %.4f).\n", animation->sampler.name, dim, frame, w);
+		UMC_Chunk_destroy(&full);
+	}
+	UMC_Chunk_destroy(&animated);
+	_BenchmarkOutput_destroy(&outputs[0]);
+	_BenchmarkOutput_destroy(&outputs[1]);
+	if (failed)
+	{
+		printf("Failed to alloc benchmark animation chunks.\n");
+		return 1;
+	}
+
+	int frames = BENCHMARK_ANIMATION_FRAMES - 1;
+	double lattice_points = (double)(dim + 1) * (dim + 1) * (dim + 1);
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"dim\": %u, \"pem\": %s, \"frames\": %i, \"w_step\": %g, \"identical\": %s, \"animated_ms\": %.3f, \"full_ms\": %.3f, \"speedup\": %.3f, \"resampled_share\": %.4f }",
+		*first ? "" : ",", animation->sampler.name, dim, pem ? "true" : "false", frames, animation->w_step, identical ? "true" : "false",
+		animated_ms / frames, full_ms / frames, animated_ms > 0 ? full_ms / animated_ms : 0, resampled / (frames * lattice_points));
+	fflush(out);
+	*first = 0;
+	return identical ? 0 : 1;
+}
+
+int _BenchmarkOutput_init(struct BenchmarkOutput* output)
+{
+	output->vn_size = 4096;
+	output->vn_next = 0;
+	output->i_size = 4096;
+	output->i_next = 0;
+	output->vertices = malloc(output->vn_size * sizeof(vec3));
+	output->normals = malloc(output->vn_size * sizeof(vec3));
+	output->indexes = malloc(output->i_size * sizeof(uint32_t));
+	if (!output->vertices || !output->normals || !output->indexes)
+	{
+		printf("Failed to alloc benchmark chunk output.\n");
+		_BenchmarkOutput_destroy(output);
+		return 1;
+	}
+	return 0;
+}
+
+void _BenchmarkOutput_destroy(struct BenchmarkOutput* output)
+{
+	free(output->vertices);
+	free(output->normals);
+	free(output->indexes);
+	output->vertices = 0;
+	output->normals = 0;
+	output->indexes = 0;
+}
+
+void _BenchmarkOutput_attach(struct BenchmarkOutput* output, struct UMC_Chunk* chunk)
+{
+	chunk->v_out = &output->vertices;
+	chunk->n_out = &output->normals;
+	chunk->vn_size = &output->vn_size;
+	chunk->vn_next = &output->vn_next;
+	chunk->i_out = &output->indexes;
+	chunk->i_size = &output->i_size;
+	chunk->i_next = &output->i_next;
+}
+
+int _BenchmarkOutput_equal(struct BenchmarkOutput* a, struct BenchmarkOutput* b)
+{
+	return a->vn_next == b->vn_next && a->i_next == b->i_next &&
+		!memcmp(a->vertices, b->vertices, a->vn_next * sizeof(vec3)) &&
+		!memcmp(a->normals, b->normals, a->vn_next * sizeof(vec3)) &&
+		!memcmp(a->indexes, b->indexes, a->i_next * sizeof(uint32_t));
+}
+
+// Animated chunks keep a vertex's slot while its edge stays crossed, so their triangles are compared rather than the buffers
+int _BenchmarkOutput_equal_triangles(struct BenchmarkOutput* a, struct BenchmarkOutput* b)
+{
+	if (a->i_next != b->i_next)
+		return 0;
+	for (uint32_t i = 0; i < a->i_next; i++)
+	{
+		uint32_t va = a->indexes[i], vb = b->indexes[i];
+		if (memcmp(a->vertices[va], b->vertices[vb], sizeof(vec3)) || memcmp(a->normals[va], b->normals[vb], sizeof(vec3)))
+			return 0;
+	}
+	return 1;
+}
+
+int _Benchmark_compact_case(FILE* out, int quick, int* first)
+{
+	uint32_t sets = quick ? BENCHMARK_COMPACT_SETS / 8 : BENCHMARK_COMPACT_SETS;
+	vec3* vertices = malloc(BENCHMARK_COMPACT_VERTICES * sizeof(vec3));
+	vec3* normals = malloc(BENCHMARK_COMPACT_VERTICES * sizeof(vec3));
+	struct CompactVertex* packed = malloc(BENCHMARK_COMPACT_VERTICES * sizeof(struct CompactVertex));
+	if (!vertices || !normals || !packed)
+	{
+		printf("Failed to alloc benchmark compact vertices.\n");
+		free(vertices);
+		free(normals);
+		free(packed);
+		return 1;
+	}
+
+	uint32_t violations = 0;
+	double max_position_ratio = 0, max_normal_error = 0;
+	uint32_t seed = 12345;
+	for (uint32_t s = 0; s < sets; s++)
+	{
+		// Leaf-like sets: a few hundredths to a few thousand units across, up to 8192 units from the origin
+		float r[4];
+		for (int i = 0; i < 4; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			r[i] = (float)(seed >> 8) / (float)(1 << 24);
+		}
+		float size = powf(2.0f, r[3] * 17.0f - 6.0f);
+		for (uint32_t v = 0; v < BENCHMARK_COMPACT_VERTICES; v++)
+		{
+			float n_len = 0;
+			while (n_len < 1e-3f)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					normals[v][k] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+				}
+				n_len = glm_vec_norm(normals[v]);
+			}
+			glm_vec_normalize(normals[v]);
+			for (int k = 0; k < 3; k++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				vertices[v][k] = (r[k] * 2.0f - 1.0f) * 8192.0f + (float)(seed >> 8) / (float)(1 << 24) * size;
+			}
+		}
+
+		struct CompactBounds bounds;
+		CompactVertex_pack(packed, vertices, normals, BENCHMARK_COMPACT_VERTICES, &bounds);
+		float bound = CompactBounds_max_error(&bounds);
+		for (uint32_t v = 0; v < BENCHMARK_COMPACT_VERTICES; v++)
+		{
+			vec3 p, n;
+			CompactVertex_decode_position(packed[v].position, &bounds, p);
+			CompactVertex_decode_normal(packed[v].normal, n);
+			float position_error = 0, normal_error = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				position_error = max(position_error, fabsf(p[k] - vertices[v][k]));
+				normal_error += (n[k] - normals[v][k]) * (n[k] - normals[v][k]);
+			}
+			normal_error = sqrtf(normal_error);
+			if (position_error > bound || normal_error > COMPACT_NORMAL_MAX_ERROR)
+				violations++;
+			max_position_ratio = max(max_position_ratio, position_error / bound);
+			max_normal_error = max(max_normal_error, normal_error);
+		}
+	}
+
+	fprintf(out, "%s\n    { \"sets\": %u, \"vertices\": %u, \"violations\": %u, \"max_position_error_ratio\": %.3f, \"max_normal_error\": %.3g, \"normal_bound\": %.3g }",
+		*first ? "" : ",", sets, sets * BENCHMARK_COMPACT_VERTICES, violations, max_position_ratio, max_normal_error, COMPACT_NORMAL_MAX_ERROR);
+	fflush(out);
+	*first = 0;
+	if (violations)
+		printf("Compact vertices exceeded their error bounds %u times.\n", violations);
+
+	free(vertices);
+	free(normals);
+	free(packed);
+	return violations ? 1 : 0;
+}
+
+void _Benchmark_hierarchy_case(FILE* out, struct BenchmarkSampler* sampler, int pem, int sub_resolution, int max_depth, int* first)
+{
+	static struct THierarchy hierarchy;
+	sampler_fn = sampler->fn;
+
+	THierarchy_init_empty(&hierarchy, BENCHMARK_T_RESOLUTION, 0);
+	hierarchy.pem = pem;
+	hierarchy.sub_resolution = sub_resolution;
+	hierarchy.max_depth = max_depth;
+
+	double start_ms = Timer_ms();
+	THierarchy_refine(&hierarchy);
+	double refine_ms = Timer_ms() - start_ms;
+	THierarchy_extract_all_leaves(&hierarchy);
+	double total_ms = Timer_ms() - start_ms;
+	double seconds = total_ms > 0 ? total_ms / 1000.0 : 1e-9;
+
+	fprintf(out, "%s\n    { \"sampler\": \"%s\", \"pem\": %s, \"sub_resolution\": %i, \"max_depth\": %i, \"leaves\": %i, \"refine_ms\": %.3f, ",
+		*first ? "" : ",", sampler->name, pem ? "true" : "false", sub_resolution, max_depth, hierarchy.leaf_count, refine_ms);
+	_Benchmark_write_stages(out, &hierarchy.timings, hierarchy.last_upload_ms);
+	fprintf(out, ", \"total_ms\": %.3f, \"samples\": %llu, \"samples_per_s\": %.0f, \"vertices\": %u, \"triangles\": %u, \"triangles_per_s\": %.0f, \"peak_memory_bytes\": %llu",
+		total_ms, (unsigned long long)hierarchy.timings.samples, hierarchy.timings.samples / seconds, hierarchy.v_count, hierarchy.p_count / 3, hierarchy.p_count / 3 / seconds, (unsigned long long)_Benchmark_peak_memory());
+	_Benchmark_write_counters(out, &hierarchy.counters);
+	fflush(out);
+	*first = 0;
+
+	THierarchy_destroy(&hierarchy);
+}
+
+void _Benchmark_write_stages(FILE* out, struct UMC_Timings* timings, float upload_ms)
+{
+	fprintf(out, "\"stages_ms\": { \"reset\": %.3f, \"label_grid\": %.3f, \"label_edges\": %.3f, \"snap\": %.3f, \"polygonize\": %.3f, \"upload\": %.3f }",
+		timings->reset_ms, timings->label_grid_ms, timings->label_edges_ms, timings->snap_ms, timings->polygonize_ms, upload_ms);
+}
+
+void _Benchmark_write_counters(FILE* out, struct HotCounters* counters)
+{
+	// Counters are deterministic, so any repeat's are as good as the fastest one's
+	if (HOT_PATH_COUNTERS)
+	{
+		fprintf(out, ", ");
+		HotCounters_write_json(out, counters);
+	}
+	fprintf(out, " }");
+}
+
+uint64_t _Benchmark_peak_memory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (uint64_t)counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+int _Benchmark_gather_leaves(struct THierarchy* hierarchy, struct ReplayLeaf** leaves, uint32_t* size, uint32_t* count)
+{
+	if (*size < (uint32_t)hierarchy->leaf_count)
+	{
+		free(*leaves);
+		*size = hierarchy->leaf_count;
+		*leaves = malloc(*size * sizeof(struct ReplayLeaf));
+		if (!*leaves)
+		{
+			printf("Failed to alloc replay leaves.\n");
+			*size = 0;
+			*count = 0;
+			return 1;
+		}
+	}
+
+	*count = 0;
+	for (struct TetrahedronNode* t = hierarchy->first_leaf; t && *count < *size; t = t->next)
+	{
+		(*leaves)[*count].key = _Benchmark_leaf_key(t);
+		(*leaves)[*count].level = t->level;
+		(*count)++;
+	}
+	qsort(*leaves, *count, sizeof(struct ReplayLeaf), _Benchmark_compare_leaves);
+	return 0;
+}
+
+uint32_t _Benchmark_count_refined(struct ReplayLeaf* from, uint32_t from_count, struct ReplayLeaf* to, uint32_t to_count)
+{
+	// Both leaf sets tile the same space, so the last "to" leaf starting at or before a "from" leaf covers it.
+	// A deeper one means the "from" leaf was split.
+	uint32_t refined = 0;
+	uint32_t j = 0;
+	for (uint32_t i = 0; i < from_count; i++)
+	{
+		while (j + 1 < to_count && to[j + 1].key <= from[i].key)
+			j++;
+		if (j < to_count && to[j].key <= from[i].key && to[j].level > from[i].level)
+			refined++;
+	}
+	return refined;
+}
+
+uint64_t _Benchmark_leaf_key(struct TetrahedronNode* t)
+{
+	int level = t->level < 61 ? t->level : 61;
+	uint64_t path = 0;
+	for (struct TetrahedronNode* n = t; n->parent; n = n->parent)
+	{
+		if (n->level <= level && n->parent->children[1] == n)
+			path |= 1ull << (level - n->level);
+	}
+	return ((uint64_t)t->branch << 61) | (path << (61 - level));
+}
+
+int _Benchmark_compare_leaves(const void* a, const void* b)
+{
+	const struct ReplayLeaf* la = (const struct ReplayLeaf*)a;
+	const struct ReplayLeaf* lb = (const struct ReplayLeaf*)b;
+	if (la->key != lb->key)
+		return la->key < lb->key ? -1 : 1;
+	return la->level - lb->level;
+}
+
+int _Benchmark_compare_floats(const void* a, const void* b)
+{
+	float fa = *(const float*)a;
+	float fb = *(const float*)b;
+	return fa < fb ? -1 : fa > fb;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "UniformMarchingCubes.h"
+#include "THierarchy.h"
+
+// Headless extraction benchmark, run with "GLIsosurface --benchmark [out.json] [--quick] [--trace trace.json]".
+// Sweeps every sampler over standalone chunks and full hierarchies without a window or GL context, and writes
+// wall-clock stage timings, throughput, peak memory and, with HOT_PATH_COUNTERS, the hot-path counters as JSON.
+// Seeds and focus points are fixed, so two runs of the same build extract identical meshes.
+// The noise section times the double and float OpenSimplex paths on the same points and reports how far they deviate,
+// and times the fused multi-channel warp against separate calls.
+// The bounds section checks every sampler's interval bounds against a dense lattice over random boxes; any violation
+// means pruning could drop real surface.
+// The layouts section runs one chunk in the linear and tiled lattice layouts at dims up to 1023; dims whose grids don't
+// fit in memory are reported as skipped.
+// The large chunks section meshes lattices past a single chunk's reach as blocks of submeshes, see LargeChunk.h.
+// The compact vertices section round-trips random positions and normals through CompactVertex and checks them against
+// CompactBounds_max_error and COMPACT_NORMAL_MAX_ERROR.
+// The parallel section runs every sampler's chunk serially and on BENCHMARK_PARALLEL_THREADS threads, in both layouts
+// and with and without pem, and checks the vertices, normals, indexes and snapped counts come out identical.
+// The animation section steps samplers that change with w through frames on a chunk set animated, checks every frame's
+// triangles against a fresh chunk's at the same w, and reports the speedup and how much of the lattice was resampled.
+// Check sections fail the run: the benchmark returns nonzero if any of them found a violation.
+
+// Camera path replay, run with "GLIsosurface --replay camera_path.txt [out.json] [--stride N]".
+// Refines and extracts the hierarchy at every Nth recorded tick and reports per-step leaf counts, how many leaves were
+// split and merged since the previous step, extraction latency percentiles and memory, so LOD changes can be compared
+// on the same flight.
+
+#define BENCHMARK_REPEATS 3
+#define BENCHMARK_T_RESOLUTION 8
+#define BENCHMARK_NOISE_SAMPLES (1 << 20)
+#define BENCHMARK_BOUNDS_BOXES 512
+#define BENCHMARK_BOUNDS_LATTICE 9
+#define BENCHMARK_COMPACT_SETS 256
+#define BENCHMARK_COMPACT_VERTICES 4096
+#define BENCHMARK_PARALLEL_THREADS 4
+#define BENCHMARK_ANIMATION_FRAMES 12
+#define REPLAY_DEFAULT_STRIDE 30
+
+typedef const float(*BenchmarkSamplerFn)(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+
+struct BenchmarkSampler
+{
+	const char* name;
+	BenchmarkSamplerFn fn;
+};
+
+// A sampler that changes with w, advanced by w_step every frame of the animation section
+struct BenchmarkAnimation
+{
+	struct BenchmarkSampler sampler;
+	float w_step;
+};
+
+// Output buffers for a standalone chunk
+struct BenchmarkOutput
+{
+	vec3* vertices;
+	vec3* normals;
+	uint32_t* indexes;
+	uint32_t vn_size;
+	uint32_t vn_next;
+	uint32_t i_size;
+	uint32_t i_next;
+};
+
+// A leaf's position in the tree: top-level branch, then the child path left-aligned, so sorted keys walk the leaves
+// in depth-first order and every node covers the key range [key, key + 2^(61 - level))
+struct ReplayLeaf
+{
+	uint64_t key;
+	int level;
+};
+
+int Benchmark_run(const char* out_path, const char* trace_path, int quick);
+int Benchmark_replay(const char* path_file, const char* out_path, int stride);
+
+void _Benchmark_chunk_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, enum UMC_Layout layout, int repeats, struct osn_context* osn, int* first);
+void _Benchmark_large_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, struct osn_context* osn, int* first);
+void _Benchmark_noise_case(FILE* out, int dims, float extent, int quick, struct osn_context* osn, int* first);
+void _Benchmark_fused_noise_case(FILE* out, int quick, struct osn_context* osn, int* first);
+void _Benchmark_bounds_case(FILE* out, struct BenchmarkSampler* sampler, int quick, struct osn_context* osn, int* first);
+int _Benchmark_compact_case(FILE* out, int quick, int* first);
+int _Benchmark_parallel_case(FILE* out, struct BenchmarkSampler* sampler, uint32_t dim, int pem, enum UMC_Layout layout, struct osn_context* osn, int* first);
+int _Benchmark_animation_case(FILE* out, struct BenchmarkAnimation* animation, uint32_t dim, int pem, struct osn_context* osn, int* first);
+int _BenchmarkOutput_init(struct BenchmarkOutput* output);
+void _BenchmarkOutput_destroy(struct BenchmarkOutput* output);
+void _BenchmarkOutput_attach(struct BenchmarkOutput* output, struct UMC_Chunk* chunk);
+int _BenchmarkOutput_equal(struct BenchmarkOutput* a, struct BenchmarkOutput* b);
+int _BenchmarkOutput_equal_triangles(struct BenchmarkOutput* a, struct BenchmarkOutput* b);
+void _Benchmark_hierarchy_case(FILE* out, struct BenchmarkSampler* sampler, int pem, int sub_resolution, int max_depth, int* first);
+void _Benchmark_write_stages(FILE* out, struct UMC_Timings* timings, float upload_ms);
+void _Benchmark_write_counters(FILE* out, struct HotCounters* counters);
+uint64_t _Benchmark_peak_memory();
+int _Benchmark_gather_leaves(struct THierarchy* hierarchy, struct ReplayLeaf** leaves, uint32_t* size, uint32_t* count);
+uint32_t _Benchmark_count_refined(struct ReplayLeaf* from, uint32_t from_count, struct ReplayLeaf* to, uint32_t to_count);
+uint64_t _Benchmark_leaf_key(struct TetrahedronNode* t);
+int _Benchmark_compare_leaves(const void* a, const void* b);
+int _Benchmark_compare_floats(const void* a, const void* b);
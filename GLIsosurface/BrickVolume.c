@@ -0,0 +1,430 @@
+#include "BrickVolume.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define INDEX3D(x,y,z,d) ((x) * (d) * (d) + (y) * (d) + (z))
+
+static volatile int32_t brick_volume_generation = 0;
+static THREAD_LOCAL struct BrickCache* brick_cache = 0;
+
+int BrickVolume_open(struct BrickVolume* volume, const char* path)
+{
+	memset(volume, 0, sizeof(struct BrickVolume));
+	volume->data = _BrickVolume_map(path, &volume->size, &volume->file, &volume->mapping);
+	if (!volume->data)
+	{
+		printf("Failed to map brick volume %s.\n", path);
+		return 1;
+	}
+
+	struct BrickVolumeHeader* header = &volume->header;
+	if (volume->size < sizeof(struct BrickVolumeHeader))
+	{
+		printf("Brick volume %s is truncated.\n", path);
+		BrickVolume_close(volume);
+		return 1;
+	}
+	memcpy(header, volume->data, sizeof(struct BrickVolumeHeader));
+	if (header->magic != BRICK_VOLUME_MAGIC || header->version != BRICK_VOLUME_VERSION || header->format > BRICK_FORMAT_UINT16)
+	{
+		printf("%s is not a version %i brick volume.\n", path, BRICK_VOLUME_VERSION);
+		BrickVolume_close(volume);
+		return 1;
+	}
+
+	// The brick grid has to be the one BrickVolume_convert writes for these dims, or lookups leave the table
+	int valid = header->brick_size > 0 && header->brick_size <= BRICK_VOLUME_MAX_BRICK_SIZE && header->table_offset % sizeof(uint32_t) == 0;
+	for (int i = 0; i < 3 && valid; i++)
+		valid = header->dims[i] >= 2 && header->bricks[i] == (header->dims[i] - 2) / header->brick_size + 1 && header->bricks[i] <= BRICK_VOLUME_MAX_BRICKS;
+	if (!valid)
+	{
+		printf("Brick volume %s has a malformed header.\n", path);
+		BrickVolume_close(volume);
+		return 1;
+	}
+
+	uint32_t brick_count = header->bricks[0] * header->bricks[1] * header->bricks[2];
+	uint32_t edge = header->brick_size + 1;
+	volume->brick_samples = edge * edge * edge;
+	volume->brick_bytes = volume->brick_samples * (header->format == BRICK_FORMAT_UINT16 ? 2 : 4);
+	if (header->table_offset > volume->size || (uint64_t)brick_count * sizeof(uint32_t) > volume->size - header->table_offset ||
+		header->data_offset > volume->size || (uint64_t)brick_count * volume->brick_bytes > volume->size - header->data_offset)
+	{
+		printf("Brick volume %s is truncated.\n", path);
+		BrickVolume_close(volume);
+		return 1;
+	}
+
+	volume->table = (const uint32_t*)(volume->data + header->table_offset);
+	for (uint32_t i = 0; i < brick_count; i++)
+	{
+		if (volume->table[i] >= brick_count)
+		{
+			printf("Brick volume %s has a malformed brick table.\n", path);
+			BrickVolume_close(volume);
+			return 1;
+		}
+	}
+
+	// Cached bricks from an earlier volume are told apart by generation
+	volume->generation = Atomic_add(&brick_volume_generation, 1);
+	printf("Opened brick volume %s: %ux%ux%u %s, %u bricks.\n", path, header->dims[0], header->dims[1], header->dims[2],
+		header->format == BRICK_FORMAT_UINT16 ? "uint16" : "float32", brick_count);
+	return 0;
+}
+
+void BrickVolume_close(struct BrickVolume* volume)
+{
+	if (volume->data)
+		_BrickVolume_unmap(volume->data, volume->size, volume->file, volume->mapping);
+	volume->data = 0;
+	volume->table = 0;
+	volume->size = 0;
+	volume->file = 0;
+	volume->mapping = 0;
+}
+
+float BrickVolume_sample(struct BrickVolume* volume, float x, float y, float z)
+{
+	struct BrickVolumeHeader* header = &volume->header;
+	uint32_t size = header->brick_size;
+	uint32_t edge = size + 1;
+	float p[3] = { x, y, z };
+	uint32_t cell[3], local[3], brick[3];
+	float t[3];
+
+	// Clamp to the volume and find the cell, the last sample plane belongs to the cell before it
+	for (int i = 0; i < 3; i++)
+	{
+		float max_p = (float)(header->dims[i] - 1);
+		p[i] = p[i] < 0 ? 0 : (p[i] > max_p ? max_p : p[i]);
+		cell[i] = (uint32_t)p[i];
+		if (cell[i] >= header->dims[i] - 1)
+			cell[i] = header->dims[i] - 2;
+		t[i] = p[i] - (float)cell[i];
+		brick[i] = cell[i] / size;
+		local[i] = cell[i] - brick[i] * size;
+	}
+
+	const float* samples = _BrickVolume_brick(volume, (brick[0] * header->bricks[1] + brick[1]) * header->bricks[2] + brick[2]);
+	if (!samples)
+		return header->isolevel;
+	const float* s = samples + INDEX3D(local[0], local[1], local[2], edge);
+	uint32_t dx = edge * edge, dy = edge;
+
+	float c00 = s[0] + (s[dx] - s[0]) * t[0];
+	float c01 = s[1] + (s[dx + 1] - s[1]) * t[0];
+	float c10 = s[dy] + (s[dx + dy] - s[dy]) * t[0];
+	float c11 = s[dy + 1] + (s[dx + dy + 1] - s[dy + 1]) * t[0];
+	float c0 = c00 + (c10 - c00) * t[1];
+	float c1 = c01 + (c11 - c01) * t[1];
+	return c0 + (c1 - c0) * t[2];
+}
+
+void BrickVolume_sample_batch(struct BrickVolume* volume, vec3* points, float* out, uint32_t count)
+{
+	// Neighbouring points nearly always share a brick, which the cache's last-hit check catches first
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = BrickVolume_sample(volume, points[i][0], points[i][1], points[i][2]);
+}
+
+int BrickVolume_convert(const char* raw_path, uint32_t nx, uint32_t ny, uint32_t nz, enum BrickFormat format, uint32_t brick_size, float isolevel, const char* out_path)
+{
+	uint32_t sample_bytes = format == BRICK_FORMAT_UINT16 ? 2 : 4;
+	uint64_t raw_size;
+	void *raw_file, *raw_mapping;
+	uint8_t* raw = _BrickVolume_map(raw_path, &raw_size, &raw_file, &raw_mapping);
+	if (!raw)
+	{
+		printf("Failed to map raw volume %s.\n", raw_path);
+		return 1;
+	}
+	if (brick_size < 1 || brick_size > BRICK_VOLUME_MAX_BRICK_SIZE)
+	{
+		printf("Brick size %u is outside 1..%i.\n", brick_size, BRICK_VOLUME_MAX_BRICK_SIZE);
+		_BrickVolume_unmap(raw, raw_size, raw_file, raw_mapping);
+		return 1;
+	}
+	if (nx < 2 || ny < 2 || nz < 2 || raw_size < (uint64_t)nx * ny * nz * sample_bytes)
+	{
+		printf("Raw volume %s is smaller than %ux%ux%u samples.\n", raw_path, nx, ny, nz);
+		_BrickVolume_unmap(raw, raw_size, raw_file, raw_mapping);
+		return 1;
+	}
+	if ((nx - 2) / brick_size >= BRICK_VOLUME_MAX_BRICKS || (ny - 2) / brick_size >= BRICK_VOLUME_MAX_BRICKS || (nz - 2) / brick_size >= BRICK_VOLUME_MAX_BRICKS)
+	{
+		printf("Raw volume %s needs more than %i bricks per side, use a larger brick size.\n", raw_path, BRICK_VOLUME_MAX_BRICKS);
+		_BrickVolume_unmap(raw, raw_size, raw_file, raw_mapping);
+		return 1;
+	}
+
+	struct BrickVolumeHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BRICK_VOLUME_MAGIC;
+	header.version = BRICK_VOLUME_VERSION;
+	header.format = format;
+	header.brick_size = brick_size;
+	header.dims[0] = nx;
+	header.dims[1] = ny;
+	header.dims[2] = nz;
+	header.bricks[0] = (nx - 2) / brick_size + 1;
+	header.bricks[1] = (ny - 2) / brick_size + 1;
+	header.bricks[2] = (nz - 2) / brick_size + 1;
+	header.value_scale = 1.0f;
+	header.value_offset = 0.0f;
+	header.isolevel = isolevel;
+
+	uint32_t brick_count = header.bricks[0] * header.bricks[1] * header.bricks[2];
+	uint32_t edge = brick_size + 1;
+	uint32_t brick_bytes = edge * edge * edge * sample_bytes;
+	header.table_offset = sizeof(header);
+	header.data_offset = (header.table_offset + brick_count * sizeof(uint32_t) + 63) & ~63ull;
+
+	// Bricks go to disk in Morton order, sorted on (code << 32 | brick); the table maps each brick back to its slot
+	uint64_t* order = malloc(brick_count * sizeof(uint64_t));
+	uint32_t* table = malloc(brick_count * sizeof(uint32_t));
+	uint8_t* brick = malloc(brick_bytes);
+	FILE* out = fopen(out_path, "wb");
+	if (!order || !table || !brick || !out)
+	{
+		printf("Failed to convert %s to %s.\n", raw_path, out_path);
+		free(order);
+		free(table);
+		free(brick);
+		if (out)
+			fclose(out);
+		_BrickVolume_unmap(raw, raw_size, raw_file, raw_mapping);
+		return 1;
+	}
+
+	uint32_t b = 0;
+	for (uint32_t bx = 0; bx < header.bricks[0]; bx++)
+	{
+		for (uint32_t by = 0; by < header.bricks[1]; by++)
+		{
+			for (uint32_t bz = 0; bz < header.bricks[2]; bz++, b++)
+				order[b] = (_BrickVolume_morton(bx, by, bz) << 32) | b;
+		}
+	}
+	qsort(order, brick_count, sizeof(uint64_t), _BrickVolume_compare_keys);
+	for (uint32_t i = 0; i < brick_count; i++)
+		table[(uint32_t)order[i]] = i;
+
+	int failed = fwrite(&header, sizeof(header), 1, out) != 1 || fwrite(table, sizeof(uint32_t), brick_count, out) != brick_count;
+	for (uint64_t pos = header.table_offset + brick_count * sizeof(uint32_t); pos < header.data_offset && !failed; pos++)
+		failed = fputc(0, out) == EOF;
+
+	for (uint32_t i = 0; i < brick_count && !failed; i++)
+	{
+		uint32_t index = (uint32_t)order[i];
+		uint32_t bz = index % header.bricks[2];
+		uint32_t by = index / header.bricks[2] % header.bricks[1];
+		uint32_t bx = index / header.bricks[2] / header.bricks[1];
+
+		// The apron past the volume's edge repeats the last sample
+		for (uint32_t x = 0; x < edge; x++)
+		{
+			uint32_t sx = bx * brick_size + x;
+			sx = sx < nx ? sx : nx - 1;
+			for (uint32_t y = 0; y < edge; y++)
+			{
+				uint32_t sy = by * brick_size + y;
+				sy = sy < ny ? sy : ny - 1;
+				for (uint32_t z = 0; z < edge; z++)
+				{
+					uint32_t sz = bz * brick_size + z;
+					sz = sz < nz ? sz : nz - 1;
+					uint64_t raw_index = ((uint64_t)sz * ny + sy) * nx + sx;
+					memcpy(brick + INDEX3D(x, y, z, edge) * sample_bytes, raw + raw_index * sample_bytes, sample_bytes);
+				}
+			}
+		}
+		failed = fwrite(brick, brick_bytes, 1, out) != 1;
+	}
+
+	if (fclose(out))
+		failed = 1;
+	if (failed)
+		printf("Failed to write brick volume %s.\n", out_path);
+	else
+		printf("Converted %s to %s: %u bricks of %u^3 cells.\n", raw_path, out_path, brick_count, brick_size);
+
+	free(order);
+	free(table);
+	free(brick);
+	_BrickVolume_unmap(raw, raw_size, raw_file, raw_mapping);
+	return failed;
+}
+
+const float* _BrickVolume_brick(struct BrickVolume* volume, uint32_t brick)
+{
+	struct BrickCache* cache = _BrickVolume_cache();
+	if (!cache)
+		return 0;
+
+	struct BrickCacheSlot* slot = cache->slots + cache->last_slot;
+	cache->clock++;
+	if (slot->brick == brick && slot->generation == volume->generation)
+	{
+		slot->last_use = cache->clock;
+		return slot->samples;
+	}
+
+	uint32_t lru = 0;
+	for (uint32_t i = 0; i < BRICK_CACHE_SLOTS; i++)
+	{
+		slot = cache->slots + i;
+		if (slot->brick == brick && slot->generation == volume->generation)
+		{
+			slot->last_use = cache->clock;
+			cache->last_slot = i;
+			return slot->samples;
+		}
+		if (slot->last_use < cache->slots[lru].last_use)
+			lru = i;
+	}
+
+	slot = cache->slots + lru;
+	const uint8_t* data = volume->data + volume->header.data_offset + (uint64_t)volume->table[brick] * volume->brick_bytes;
+	if (volume->header.format == BRICK_FORMAT_FLOAT32)
+		slot->samples = (const float*)data;
+	else
+	{
+		// Slots outlive volumes, and a later one can have bigger bricks
+		if (slot->decoded_size < volume->brick_samples)
+		{
+			float* decoded = realloc(slot->decoded, volume->brick_samples * sizeof(float));
+			if (!decoded)
+				return 0;
+			slot->decoded = decoded;
+			slot->decoded_size = volume->brick_samples;
+		}
+		const uint16_t* raw = (const uint16_t*)data;
+		float scale = volume->header.value_scale, offset = volume->header.value_offset;
+		for (uint32_t i = 0; i < volume->brick_samples; i++)
+			slot->decoded[i] = (float)raw[i] * scale + offset;
+		slot->samples = slot->decoded;
+	}
+	slot->brick = brick;
+	slot->generation = volume->generation;
+	slot->last_use = cache->clock;
+	cache->last_slot = lru;
+	return slot->samples;
+}
+
+void BrickVolume_release_thread()
+{
+	if (!brick_cache)
+		return;
+	for (int i = 0; i < BRICK_CACHE_SLOTS; i++)
+		free(brick_cache->slots[i].decoded);
+	free(brick_cache);
+	brick_cache = 0;
+}
+
+struct BrickCache* _BrickVolume_cache()
+{
+	if (brick_cache)
+		return brick_cache;
+
+	// Caches live until their thread calls BrickVolume_release_thread, or the process exits
+	brick_cache = calloc(1, sizeof(struct BrickCache));
+	if (!brick_cache)
+	{
+		printf("Failed to alloc brick cache.\n");
+		return 0;
+	}
+	for (int i = 0; i < BRICK_CACHE_SLOTS; i++)
+		brick_cache->slots[i].generation = -1;
+	return brick_cache;
+}
+
+uint64_t _BrickVolume_morton(uint32_t x, uint32_t y, uint32_t z)
+{
+	uint64_t code = 0;
+	for (int bit = 0; bit < 10; bit++)
+	{
+		code |= (uint64_t)((x >> bit) & 1) << (bit * 3 + 2);
+		code |= (uint64_t)((y >> bit) & 1) << (bit * 3 + 1);
+		code |= (uint64_t)((z >> bit) & 1) << (bit * 3);
+	}
+	return code;
+}
+
+int _BrickVolume_compare_keys(const void* a, const void* b)
+{
+	uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+	return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+uint8_t* _BrickVolume_map(const char* path, uint64_t* size, void** file, void** mapping)
+{
+	*file = 0;
+	*mapping = 0;
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (f == INVALID_HANDLE_VALUE)
+		return 0;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(f, &file_size) || !file_size.QuadPart)
+	{
+		CloseHandle(f);
+		return 0;
+	}
+	HANDLE m = CreateFileMappingA(f, 0, PAGE_READONLY, 0, 0, 0);
+	if (!m)
+	{
+		CloseHandle(f);
+		return 0;
+	}
+	uint8_t* data = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(m);
+		CloseHandle(f);
+		return 0;
+	}
+	*size = (uint64_t)file_size.QuadPart;
+	*file = f;
+	*mapping = m;
+	return data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) || !st.st_size)
+	{
+		close(fd);
+		return 0;
+	}
+	uint8_t* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return 0;
+	*size = (uint64_t)st.st_size;
+	return data;
+#endif
+}
+
+void _BrickVolume_unmap(uint8_t* data, uint64_t size, void* file, void* mapping)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	munmap(data, (size_t)size);
+#endif
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+#include "Threading.h"
+
+// Scalar volumes stored on disk as bricks, memory-mapped so datasets larger than RAM can be meshed.
+// A .bvol file is a header, a table giving each brick's position in the file, then the bricks themselves in Morton
+// order of their brick coordinates. Every brick holds (brick_size + 1)^3 samples, x-major, including a one-sample apron
+// shared with its +x/+y/+z neighbours, so a trilinear lookup never leaves its brick.
+// Samples are float32 or uint16; uint16 bricks are decoded into a small per-thread LRU cache on first use, float32
+// bricks are read straight out of the mapping.
+
+#define BRICK_VOLUME_MAGIC 0x4C4F5642 // "BVOL"
+#define BRICK_VOLUME_VERSION 1
+#define BRICK_VOLUME_DEFAULT_BRICK 16
+#define BRICK_CACHE_SLOTS 64
+// Keeps a brick's byte size in 32 bits
+#define BRICK_VOLUME_MAX_BRICK_SIZE 512
+// Morton codes cover 10 bits per axis
+#define BRICK_VOLUME_MAX_BRICKS 1024
+
+enum BrickFormat
+{
+	BRICK_FORMAT_FLOAT32 = 0,
+	BRICK_FORMAT_UINT16 = 1,
+};
+
+struct BrickVolumeHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t brick_size;
+	uint32_t dims[3];
+	uint32_t bricks[3];
+	float value_scale;
+	float value_offset;
+	float isolevel;
+	uint32_t padding;
+	uint64_t table_offset;
+	uint64_t data_offset;
+};
+
+struct BrickVolume
+{
+	// Win32 file and mapping handles, mmap needs neither once the view exists
+	void* file;
+	void* mapping;
+	uint8_t* data;
+	uint64_t size;
+	int32_t generation;
+	uint32_t brick_samples;
+	uint32_t brick_bytes;
+	const uint32_t* table;
+	struct BrickVolumeHeader header;
+};
+
+struct BrickCacheSlot
+{
+	int32_t generation;
+	uint32_t brick;
+	uint32_t last_use;
+	const float* samples;
+	float* decoded;
+	uint32_t decoded_size;
+};
+
+// One per sampling thread, the volume itself stays read-only
+struct BrickCache
+{
+	uint32_t clock;
+	uint32_t last_slot;
+	struct BrickCacheSlot slots[BRICK_CACHE_SLOTS];
+};
+
+int BrickVolume_open(struct BrickVolume* volume, const char* path);
+void BrickVolume_close(struct BrickVolume* volume);
+float BrickVolume_sample(struct BrickVolume* volume, float x, float y, float z);
+void BrickVolume_sample_batch(struct BrickVolume* volume, vec3* points, float* out, uint32_t count);
+// Frees the calling thread's cache, for threads that exit before the process does
+void BrickVolume_release_thread();
+int BrickVolume_convert(const char* raw_path, uint32_t nx, uint32_t ny, uint32_t nz, enum BrickFormat format, uint32_t brick_size, float isolevel, const char* out_path);
+
+const float* _BrickVolume_brick(struct BrickVolume* volume, uint32_t brick);
+struct BrickCache* _BrickVolume_cache();
+uint64_t _BrickVolume_morton(uint32_t x, uint32_t y, uint32_t z);
+int _BrickVolume_compare_keys(const void* a, const void* b);
+uint8_t* _BrickVolume_map(const char* path, uint64_t* size, void** file, void** mapping);
+void _BrickVolume_unmap(uint8_t* data, uint64_t size, void* file, void* mapping);
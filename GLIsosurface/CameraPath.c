@@ -0,0 +1,105 @@
+#include "CameraPath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Util.h"
+
+int CameraPath_init(struct CameraPath* path)
+{
+	path->count = 0;
+	path->size = 1024;
+	path->keys = malloc(path->size * sizeof(struct CameraPathKey));
+	if (!path->keys)
+	{
+		printf("Failed to alloc camera path.\n");
+		path->size = 0;
+		return 1;
+	}
+	return 0;
+}
+
+void CameraPath_destroy(struct CameraPath* path)
+{
+	free(path->keys);
+	path->keys = 0;
+	path->count = 0;
+	path->size = 0;
+}
+
+void CameraPath_clear(struct CameraPath* path)
+{
+	path->count = 0;
+}
+
+int CameraPath_record(struct CameraPath* path, vec3 position, vec3 rot)
+{
+	if (path->count == path->size)
+	{
+		uint32_t new_size = path->size ? path->size * 2 : 1024;
+		struct CameraPathKey* new_keys = realloc(path->keys, new_size * sizeof(struct CameraPathKey));
+		if (!new_keys)
+		{
+			printf("Failed to grow camera path.\n");
+			return 1;
+		}
+		path->keys = new_keys;
+		path->size = new_size;
+	}
+
+	struct CameraPathKey* key = path->keys + path->count++;
+	vec3_copy(position, key->position);
+	vec3_copy(rot, key->rot);
+	return 0;
+}
+
+int CameraPath_save(struct CameraPath* path, const char* file)
+{
+	FILE* out = fopen(file, "w");
+	if (!out)
+	{
+		printf("Failed to open camera path %s.\n", file);
+		return 1;
+	}
+
+	// %.9g round-trips floats, so a replay sees exactly the recorded positions
+	fprintf(out, "# camera path v1, %u ticks\n", path->count);
+	for (uint32_t i = 0; i < path->count; i++)
+	{
+		struct CameraPathKey* key = path->keys + i;
+		fprintf(out, "%.9g %.9g %.9g %.9g %.9g %.9g\n", key->position[0], key->position[1], key->position[2], key->rot[0], key->rot[1], key->rot[2]);
+	}
+
+	fclose(out);
+	printf("Saved %u camera path ticks to %s.\n", path->count, file);
+	return 0;
+}
+
+int CameraPath_load(struct CameraPath* path, const char* file)
+{
+	FILE* in = fopen(file, "r");
+	if (!in)
+	{
+		printf("Failed to open camera path %s.\n", file);
+		return 1;
+	}
+
+	CameraPath_clear(path);
+	char line[256];
+	while (fgets(line, sizeof(line), in))
+	{
+		if (line[0] == '#')
+			continue;
+
+		vec3 position, rot;
+		if (sscanf(line, "%f %f %f %f %f %f", &position[0], &position[1], &position[2], &rot[0], &rot[1], &rot[2]) != 6)
+			continue;
+		if (CameraPath_record(path, position, rot))
+		{
+			fclose(in);
+			return 1;
+		}
+	}
+
+	fclose(in);
+	return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+
+// Camera position and rotation sampled once per update tick, so a flight through the scene can be replayed exactly.
+// Saved as text: a header line, then "x y z rx ry rz" per tick.
+
+#define CAMERA_PATH_FILE "camera_path.txt"
+
+struct CameraPathKey
+{
+	vec3 position;
+	vec3 rot;
+};
+
+struct CameraPath
+{
+	struct CameraPathKey* keys;
+	uint32_t count;
+	uint32_t size;
+};
+
+int CameraPath_init(struct CameraPath* path);
+void CameraPath_destroy(struct CameraPath* path);
+void CameraPath_clear(struct CameraPath* path);
+int CameraPath_record(struct CameraPath* path, vec3 position, vec3 rot);
+int CameraPath_save(struct CameraPath* path, const char* file);
+int CameraPath_load(struct CameraPath* path, const char* file);
@@ -0,0 +1,108 @@
+#include "CompactVertex.h"
+
+#include <float.h>
+#include <math.h>
+#include "Util.h"
+
+void CompactBounds_from_points(struct CompactBounds* dest, vec3* points, uint32_t count)
+{
+	if (!count)
+	{
+		vec3_zero(dest->origin);
+		vec3_zero(dest->extent);
+		return;
+	}
+
+	vec3 min_p, max_p;
+	glm_vec_copy(points[0], min_p);
+	glm_vec_copy(points[0], max_p);
+	for (uint32_t i = 1; i < count; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			min_p[k] = fminf(min_p[k], points[i][k]);
+			max_p[k] = fmaxf(max_p[k], points[i][k]);
+		}
+	}
+
+	glm_vec_copy(min_p, dest->origin);
+	glm_vec_sub(max_p, min_p, dest->extent);
+}
+
+float CompactBounds_max_error(struct CompactBounds* bounds)
+{
+	// Rounding to the nearest step is off by at most half a step, plus float rounding of the decoded sum
+	float extent = fmaxf(bounds->extent[0], fmaxf(bounds->extent[1], bounds->extent[2]));
+	float magnitude = fmaxf(fabsf(bounds->origin[0]), fmaxf(fabsf(bounds->origin[1]), fabsf(bounds->origin[2]))) + extent;
+	return extent / 65535.0f * 0.5f + magnitude * FLT_EPSILON * 2.0f;
+}
+
+void CompactVertex_encode_position(uint16_t* dest, vec3 p, struct CompactBounds* bounds)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		float t = bounds->extent[k] > 0 ? (p[k] - bounds->origin[k]) / bounds->extent[k] : 0;
+		t = fminf(fmaxf(t, 0.0f), 1.0f);
+		dest[k] = (uint16_t)(t * 65535.0f + 0.5f);
+	}
+	dest[3] = 0;
+}
+
+void CompactVertex_decode_position(uint16_t* q, struct CompactBounds* bounds, vec3 dest)
+{
+	for (int k = 0; k < 3; k++)
+		dest[k] = bounds->origin[k] + (float)q[k] / 65535.0f * bounds->extent[k];
+}
+
+int16_t _CompactVertex_snorm16(float v)
+{
+	v = fminf(fmaxf(v, -1.0f), 1.0f);
+	return (int16_t)(v >= 0 ? v * 32767.0f + 0.5f : v * 32767.0f - 0.5f);
+}
+
+uint32_t CompactVertex_encode_normal(vec3 n)
+{
+	float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	if (l1 <= 0)
+		return 0;
+
+	float u = n[0] / l1;
+	float v = n[1] / l1;
+	if (n[2] < 0)
+	{
+		// Fold the lower hemisphere over the diagonals
+		float fu = (1.0f - fabsf(v)) * (u >= 0 ? 1.0f : -1.0f);
+		float fv = (1.0f - fabsf(u)) * (v >= 0 ? 1.0f : -1.0f);
+		u = fu;
+		v = fv;
+	}
+
+	return (uint32_t)(uint16_t)_CompactVertex_snorm16(u) | ((uint32_t)(uint16_t)_CompactVertex_snorm16(v) << 16);
+}
+
+void CompactVertex_decode_normal(uint32_t e, vec3 dest)
+{
+	// Mirrors the vertex shader
+	float u = fmaxf((float)(int16_t)(e & 0xFFFF) / 32767.0f, -1.0f);
+	float v = fmaxf((float)(int16_t)(e >> 16) / 32767.0f, -1.0f);
+	dest[0] = u;
+	dest[1] = v;
+	dest[2] = 1.0f - fabsf(u) - fabsf(v);
+	if (dest[2] < 0)
+	{
+		dest[0] = (1.0f - fabsf(v)) * (u >= 0 ? 1.0f : -1.0f);
+		dest[1] = (1.0f - fabsf(u)) * (v >= 0 ? 1.0f : -1.0f);
+	}
+	glm_vec_normalize(dest);
+}
+
+int CompactVertex_pack(struct CompactVertex* dest, vec3* vertices, vec3* normals, uint32_t count, struct CompactBounds* bounds)
+{
+	CompactBounds_from_points(bounds, vertices, count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		CompactVertex_encode_position(dest[i].position, vertices[i], bounds);
+		dest[i].normal = CompactVertex_encode_normal(normals[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+
+// 12 byte interleaved vertex used when COMPACT_VERTICES is on.
+// Positions are 16-bit unorm relative to the leaf's bounds, normals are octahedral-encoded into two 16-bit snorms.
+// The bounds travel per draw (instanced attribute + base instance), so the shader can rebuild world positions.
+
+// Largest distance between a unit normal and its decoded value: half a snorm16 step in each component, stretched by up
+// to 3x where the octahedron is furthest from the sphere
+#define COMPACT_NORMAL_MAX_ERROR 7e-5f
+
+struct CompactVertex
+{
+	uint16_t position[4]; // xyz, w unused
+	uint32_t normal;
+};
+
+struct CompactBounds
+{
+	vec3 origin;
+	vec3 extent;
+};
+
+void CompactBounds_from_points(struct CompactBounds* dest, vec3* points, uint32_t count);
+// Largest per-axis distance between a position and its decoded value
+float CompactBounds_max_error(struct CompactBounds* bounds);
+
+void CompactVertex_encode_position(uint16_t* dest, vec3 p, struct CompactBounds* bounds);
+void CompactVertex_decode_position(uint16_t* q, struct CompactBounds* bounds, vec3 dest);
+uint32_t CompactVertex_encode_normal(vec3 n);
+void CompactVertex_decode_normal(uint32_t e, vec3 dest);
+
+int CompactVertex_pack(struct CompactVertex* dest, vec3* vertices, vec3* normals, uint32_t count, struct CompactBounds* bounds);
+
+int16_t _CompactVertex_snorm16(float v);
@@ -4,6 +4,7 @@
 #include "DebugScene.h"
 #include "Core.h"
 #include "Options.h"
+#include "Trace.h"
 
 #define NK_INCLUDE_FIXED_TYPES
 #define NK_INCLUDE_STANDARD_IO
@@ -23,17 +24,27 @@
 #define FILL_MODE_FILL 0
 #define FILL_MODE_BOTH 1
 #define FILL_MODE_WIRE 2
+// How far along the view the brush looks for the surface before settling in front of the camera
+#define BRUSH_REACH 512.0f
 
 void abbreviate_int(int d, int* i_out, char* c_out);
+void _DebugScene_brush_target(struct DebugScene* scene, struct THierarchy* hierarchy, vec3 out);
 
 int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 {
 	memset(out, 0, sizeof(struct DebugScene));
+	Trace_thread_name("Render");
 	out->last_space = 0;
+	out->last_r = 0;
+	out->recording = 0;
 	out->outline_visible = 0;
 	out->smooth_shading = SMOOTH_NORMALS;
 	out->fillmode = FILL_MODE_FILL;
 	out->line_width = 1.5f;
+	out->last_edit = 0;
+	out->brush_shape = EDIT_SPHERE;
+	out->brush_radius = 8.0f;
+	out->brush_blend = 0.0f;
 
 	out->fill_color[0] = 1.0f;
 	out->fill_color[1] = 1.0f;
@@ -107,6 +118,34 @@ int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 		"  gl_Position = projection * view * vec4(vertex_position, 1);"
 		"}";
 
+	// Same as above, but rebuilds positions from the per-draw bounds and unfolds octahedral normals
+	const char* compact_vertex_shader =
+		"#version 400\n"
+		"attribute vec3 vertex_position;"
+		"attribute vec2 vertex_normal;"
+		"attribute vec3 draw_origin;"
+		"attribute vec3 draw_extent;"
+		"uniform mat4 projection;"
+		"uniform mat4 view;"
+		"uniform vec3 eye_pos;"
+		"uniform vec3 mul_color;"
+		"uniform int smooth_shading;"
+		"out vec3 f_normal;"
+		"out vec3 f_mul_color;"
+		"out vec3 f_ec_pos;"
+		"out int f_smooth_shading;"
+		"void main() {"
+		"  vec3 n = vec3(vertex_normal, 1.0f - abs(vertex_normal.x) - abs(vertex_normal.y));"
+		"  if (n.z < 0.0f)"
+		"    n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);"
+		"  vec3 position = draw_origin + vertex_position * draw_extent;"
+		"  f_normal = normalize(n);"
+		"  f_mul_color = mul_color;"
+		"  f_smooth_shading = smooth_shading;"
+		"  f_ec_pos = (view * vec4(position, 1)).xyz;"
+		"  gl_Position = projection * view * vec4(position, 1);"
+		"}";
+
 	const char* fragment_shader =
 		"#version 400\n"
 		"in vec3 f_normal;"
@@ -151,7 +190,7 @@ int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 
 	GLuint success;
 	out->vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(out->vertex_shader, 1, &vertex_shader, NULL);
+	glShaderSource(out->vertex_shader, 1, COMPACT_VERTICES ? &compact_vertex_shader : &vertex_shader, NULL);
 	glCompileShader(out->vertex_shader);
 	glGetShaderiv(out->vertex_shader, GL_COMPILE_STATUS, &success);
 	if (success == GL_FALSE)
@@ -170,6 +209,8 @@ int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 
 	glBindAttribLocation(out->shader_program, 0, "vertex_position");
 	glBindAttribLocation(out->shader_program, 1, "vertex_normal");
+	glBindAttribLocation(out->shader_program, 2, "draw_origin");
+	glBindAttribLocation(out->shader_program, 3, "draw_extent");
 
 	glLinkProgram(out->shader_program);
 	out->shader_projection = glGetUniformLocation(out->shader_program, "projection");
@@ -207,8 +248,12 @@ int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 	FPSCamera_init(&out->camera, render_input->width, render_input->height, out->shader_projection, out->shader_view, render_input);
 	//FPSCamera_set_shader(&out->camera, out->outline_shader_projection, out->outline_shader_view);
 
-	THierarchy_init(&out->hierarchy, 8);
-	THierarchy_create_outline(&out->hierarchy);
+	int workers = ASYNC_EXTRACTION ? Thread_hardware_concurrency() - 1 : 0;
+	if (ASYNC_EXTRACTION && workers < 1)
+		workers = 1;
+	ExtractionService_init(&out->extraction, 8, workers);
+	CameraPath_init(&out->camera_path);
+	THierarchy_create_outline(ExtractionService_front(&out->extraction));
 
 	//UMC_Chunk_init(&out->test_chunk, 63, 1, 1);
 	//UMC_Chunk_run(&out->test_chunk, 0, 0);
@@ -219,7 +264,8 @@ int DebugScene_init(struct DebugScene* out, struct RenderInput* render_input)
 int DebugScene_cleanup(struct DebugScene* scene)
 {
 	//UMC_Chunk_destroy(&scene->test_chunk);
-	THierarchy_destroy(&scene->hierarchy);
+	ExtractionService_destroy(&scene->extraction);
+	CameraPath_destroy(&scene->camera_path);
 	nk_glfw3_shutdown();
 	return 0;
 }
@@ -228,28 +274,69 @@ int DebugScene_update(struct DebugScene* scene, struct RenderInput* input)
 {
 	glfwPollEvents();
 	FPSCamera_update(&scene->camera, input);
+
+	// R toggles recording the camera path for "--replay"; stopping writes it out
+	if (glfwGetKey(input->window, GLFW_KEY_R) && !scene->last_r)
+	{
+		scene->recording = !scene->recording;
+		if (scene->recording)
+			CameraPath_clear(&scene->camera_path);
+		else
+			CameraPath_save(&scene->camera_path, CAMERA_PATH_FILE);
+	}
+	scene->last_r = glfwGetKey(input->window, GLFW_KEY_R);
+
+	if (scene->recording)
+		CameraPath_record(&scene->camera_path, scene->camera.position, scene->camera.rot);
 }
 
 int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 {
+	// Upload whatever the workers finished since last frame; may swap in a new front hierarchy
+	ExtractionService_update(&scene->extraction);
+	struct THierarchy* hierarchy = ExtractionService_front(&scene->extraction);
+
 	if (glfwGetKey(input->window, GLFW_KEY_SPACE))
 	{
 		if (!scene->last_space)
-		{
-			vec3_copy(scene->camera.position, scene->hierarchy.focus_point);
-			THierarchy_extract_tree(&scene->hierarchy);
-		}
+			ExtractionService_request(&scene->extraction, scene->camera.position);
 		scene->last_space = 1;
 	}
 	else
 		scene->last_space = 0;
 
+	// F adds the brush where the view first meets the surface, G digs it out and H smooths there
+	int edit_op = glfwGetKey(input->window, GLFW_KEY_F) ? EDIT_ADD : (glfwGetKey(input->window, GLFW_KEY_G) ? EDIT_SUBTRACT : (glfwGetKey(input->window, GLFW_KEY_H) ? EDIT_SMOOTH : -1));
+	if (edit_op >= 0 && !scene->last_edit)
+	{
+		struct EditBrush brush;
+		vec3 center, size = { scene->brush_radius, scene->brush_radius, scene->brush_radius };
+		_DebugScene_brush_target(scene, hierarchy, center);
+		EditBrush_init(&brush, edit_op, scene->brush_shape, center, size, edit_op == EDIT_SMOOTH ? 0 : scene->brush_blend);
+		ExtractionService_edit(&scene->extraction, &brush);
+	}
+	scene->last_edit = edit_op >= 0;
+
 	glClearColor(scene->clear_color[0], scene->clear_color[1], scene->clear_color[2], scene->clear_color[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glUniform3fv(scene->shader_eye_pos, 3, scene->camera.position);
 
 	glUseProgram(scene->shader_program);
 	FPSCamera_set_shader(&scene->camera, scene->shader_projection, scene->shader_view);
+
+	// Gather every leaf into per-page draw lists once, then each pass is a single multi-draw per arena page
+	uint32_t safety_counter = 0;
+	struct TetrahedronNode* next_node = hierarchy->first_leaf;
+	MeshArena_begin_draws(&hierarchy->arena);
+	while (safety_counter++ < 1000000 && next_node)
+	{
+		if (next_node->p_count > 0 && MeshArena_add_draw(&hierarchy->arena, &next_node->mesh))
+		{
+			printf("Failed to grow draw list, leaves are missing from this frame.\n");
+			break;
+		}
+		next_node = next_node->next;
+	}
 	//glBindVertexArray(scene->test_chunk.vao);
 
 	if (scene->fillmode == FILL_MODE_FILL || scene->fillmode == FILL_MODE_BOTH)
@@ -262,18 +349,7 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 		glUniform3f(scene->shader_mul_clr, scene->fill_color[0], scene->fill_color[1], scene->fill_color[2]);
 		glUniform1i(scene->shader_smooth_shading, scene->smooth_shading);
 
-		uint32_t safety_counter = 0;
-		struct TetrahedronNode* next_node = scene->hierarchy.first_leaf;
-
-		while (safety_counter++ < 1000000 && next_node)
-		{
-			if (next_node->p_count > 0)
-			{
-				glBindVertexArray(next_node->vao);
-				glDrawElements(GL_TRIANGLES, next_node->p_count, GL_UNSIGNED_INT, 0);
-			}
-			next_node = next_node->next;
-		}
+		MeshArena_draw(&hierarchy->arena);
 
 		//glDrawElements(GL_TRIANGLES, scene->test_chunk.p_count, GL_UNSIGNED_INT, 0);
 
@@ -295,18 +371,7 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 		glUniform3f(scene->shader_mul_clr, scene->line_color[0], scene->line_color[1], scene->line_color[2]);
 		glUniform1i(scene->shader_smooth_shading, 1);
 
-		uint32_t safety_counter = 0;
-		struct TetrahedronNode* next_node = scene->hierarchy.first_leaf;
-
-		while (safety_counter++ < 50000 && next_node)
-		{
-			if (next_node->p_count > 0)
-			{
-				glBindVertexArray(next_node->vao);
-				glDrawElements(GL_TRIANGLES, next_node->p_count, GL_UNSIGNED_INT, 0);
-			}
-			next_node = next_node->next;
-		}
+		MeshArena_draw(&hierarchy->arena);
 	}
 
 	if (scene->outline_visible)
@@ -315,8 +380,14 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 		glPolygonOffset(0.0f, GL_POLYGON_OFFSET_LINE);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		glUniform3f(scene->shader_mul_clr, 1, 1, 1);
-		glBindVertexArray(scene->hierarchy.outline_vao);
-		glDrawElements(GL_LINES, scene->hierarchy.outline_p_count, GL_UNSIGNED_INT, 0);
+		glBindVertexArray(hierarchy->outline_vao);
+		// The outline has plain float positions, so the compact shader gets identity bounds instead of per-draw ones
+		if (COMPACT_VERTICES)
+		{
+			glVertexAttrib3f(2, 0, 0, 0);
+			glVertexAttrib3f(3, 1, 1, 1);
+		}
+		glDrawElements(GL_LINES, hierarchy->outline_p_count, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
 	}
 
@@ -325,37 +396,70 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 	glfwPollEvents();
 
 	nk_glfw3_new_frame();
-	if (nk_begin(scene->nkc, "Options", nk_rect(50, 50, 300, 535),
+	if (nk_begin(scene->nkc, "Options", nk_rect(50, 50, 300, 625 + (HOT_PATH_COUNTERS ? 72 : 0)),
 		NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE |
 		NK_WINDOW_MINIMIZABLE | NK_WINDOW_TITLE))
 	{
 		char lbl[64];
 
-		nk_layout_row_dynamic(scene->nkc, 90, 1);
+		nk_layout_row_dynamic(scene->nkc, 162 + (HOT_PATH_COUNTERS ? 72 : 0), 1);
 		if (nk_group_begin(scene->nkc, "Results", 0))
 		{
 			nk_layout_row_dynamic(scene->nkc, 14, 1);
 			char c_abbr = 0;
 			int i_abbr = 0;
-			abbreviate_int(scene->hierarchy.v_count * 24, &i_abbr, &c_abbr);
-			sprintf(lbl, "Vertices: %i (%i%cB)", scene->hierarchy.v_count, i_abbr, c_abbr);
+			uint32_t vertex_bytes, index_bytes;
+			MeshArena_usage(&hierarchy->arena, &vertex_bytes, &index_bytes);
+			abbreviate_int(vertex_bytes, &i_abbr, &c_abbr);
+			sprintf(lbl, "Vertices: %i (%i%cB)", hierarchy->v_count, i_abbr, c_abbr);
 			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
 
-			abbreviate_int(scene->hierarchy.p_count * 4, &i_abbr, &c_abbr);
-			sprintf(lbl, "Prims: %i (%i%cB)", scene->hierarchy.p_count / 3, i_abbr, c_abbr);
+			abbreviate_int(index_bytes, &i_abbr, &c_abbr);
+			sprintf(lbl, "Prims: %i (%i%cB)", hierarchy->p_count / 3, i_abbr, c_abbr);
 
 			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
-			sprintf(lbl, "Leaves: %i", scene->hierarchy.leaf_count);
+			sprintf(lbl, "Leaves: %i", hierarchy->leaf_count);
 
 			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
 
-			sprintf(lbl, "Time: %ims", scene->hierarchy.last_extract_time);
+			sprintf(lbl, "Time: %ims", hierarchy->last_extract_time);
 			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
 
+			sprintf(lbl, "Draw calls: %i (%i pages)", hierarchy->arena.draw_calls, hierarchy->arena.page_count);
+			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+
+			float triangles = hierarchy->p_count / 3.0f;
+			sprintf(lbl, "ACMR: %.2f -> %.2f", triangles ? hierarchy->cache_misses_before / triangles : 0, triangles ? hierarchy->cache_misses_after / triangles : 0);
+			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+
+			struct UploadQueue* uploads = &scene->extraction.uploads;
+			if (ExtractionService_busy(&scene->extraction))
+				sprintf(lbl, "Extracting: %i uploaded, %i queued", scene->extraction.uploaded_count, uploads->count);
+			else
+				sprintf(lbl, "Extraction idle (%i workers)", scene->extraction.worker_count);
+			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+
+			abbreviate_int(uploads->last_frame_bytes, &i_abbr, &c_abbr);
+			sprintf(lbl, "Upload: %i%cB/frame, %.0f MB/s", i_abbr, c_abbr, uploads->bandwidth);
+			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+
+			if (HOT_PATH_COUNTERS)
+			{
+				struct HotCounters* counters = &hierarchy->counters;
+				sprintf(lbl, "Samples: %llu label, %llu grad", (unsigned long long)counters->label_samples, (unsigned long long)counters->gradient_samples);
+				nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+				sprintf(lbl, "Crossings: %llu, snapped: %llu", (unsigned long long)counters->edge_crossings, (unsigned long long)counters->snapped_vertices);
+				nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+				sprintf(lbl, "Reallocs: %llu, pool blocks: %llu", (unsigned long long)counters->output_reallocs, (unsigned long long)counters->pool_blocks);
+				nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+				sprintf(lbl, "Hash probes: %llu, rehashes: %llu", (unsigned long long)counters->hash_probes, (unsigned long long)counters->hash_rehashes);
+				nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+			}
+
 			nk_group_end(scene->nkc);
 		}
 
-		nk_layout_row_dynamic(scene->nkc, 218, 1);
+		nk_layout_row_dynamic(scene->nkc, 236, 1);
 		if (nk_group_begin(scene->nkc, "View", 0))
 		{
 			nk_layout_row_dynamic(scene->nkc, 14, 1);
@@ -365,6 +469,12 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 			sprintf(lbl, "Pos: %.2f, %.2f, %.2f", scene->camera.position[0], scene->camera.position[1], scene->camera.position[2]);
 			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
 
+			if (scene->recording)
+				sprintf(lbl, "Path: recording (%i ticks)", scene->camera_path.count);
+			else
+				sprintf(lbl, "Path: R to record");
+			nk_label(scene->nkc, lbl, NK_TEXT_LEFT);
+
 
 			nk_layout_row_dynamic(scene->nkc, 20, 1);
 			scene->outline_visible = nk_option_label(scene->nkc, "Tree Outline", scene->outline_visible);
@@ -428,31 +538,53 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 		if (nk_group_begin(scene->nkc, "Snapping", 0))
 		{
 			nk_layout_row_dynamic(scene->nkc, 20, 1);
-			scene->hierarchy.pem = nk_option_label(scene->nkc, "Enable Snapping", scene->hierarchy.pem);
+			hierarchy->pem = nk_option_label(scene->nkc, "Enable Snapping", hierarchy->pem);
 
 			nk_layout_row_dynamic(scene->nkc, 20, 2);
-			nk_value_float(scene->nkc, "Threshold", scene->hierarchy.snap_threshold);
-			nk_slider_float(scene->nkc, 0.0f, &scene->hierarchy.snap_threshold, 0.707f, 0.025f);
+			nk_value_float(scene->nkc, "Threshold", hierarchy->snap_threshold);
+			nk_slider_float(scene->nkc, 0.0f, &hierarchy->snap_threshold, 0.707f, 0.025f);
 
 			nk_layout_row_dynamic(scene->nkc, 20, 2);
-			nk_value_int(scene->nkc, "Max Depth", scene->hierarchy.max_depth);
-			nk_slider_int(scene->nkc, 0, &scene->hierarchy.max_depth, 55, 1);
+			nk_value_int(scene->nkc, "Max Depth", hierarchy->max_depth);
+			nk_slider_int(scene->nkc, 0, &hierarchy->max_depth, 55, 1);
 
 			nk_layout_row_dynamic(scene->nkc, 20, 2);
-			int sub_r_2 = (int)log2f(scene->hierarchy.sub_resolution + 1);
-			nk_value_int(scene->nkc, "Sub Res.", scene->hierarchy.sub_resolution);
+			int sub_r_2 = (int)log2f(hierarchy->sub_resolution + 1);
+			nk_value_int(scene->nkc, "Sub Res.", hierarchy->sub_resolution);
 			nk_slider_int(scene->nkc, 1, &sub_r_2, 4, 1);
-			scene->hierarchy.sub_resolution = (int)powf(2, sub_r_2) - 1;
+			hierarchy->sub_resolution = (int)powf(2, sub_r_2) - 1;
 
 			nk_group_end(scene->nkc);
 		}
 
-		nk_layout_row_dynamic(scene->nkc, 30, 1);
+		nk_layout_row_dynamic(scene->nkc, 110, 1);
+		if (nk_group_begin(scene->nkc, "Editing", 0))
+		{
+			nk_layout_row_dynamic(scene->nkc, 14, 1);
+			nk_label(scene->nkc, "F add, G dig, H smooth", NK_TEXT_LEFT);
+
+			nk_layout_row_dynamic(scene->nkc, 20, 1);
+			scene->brush_shape = nk_option_label(scene->nkc, "Box Brush", scene->brush_shape == EDIT_BOX) ? EDIT_BOX : EDIT_SPHERE;
+
+			nk_layout_row_dynamic(scene->nkc, 20, 2);
+			nk_value_float(scene->nkc, "Radius", scene->brush_radius);
+			nk_slider_float(scene->nkc, 1.0f, &scene->brush_radius, 64.0f, 1.0f);
+
+			nk_layout_row_dynamic(scene->nkc, 20, 2);
+			nk_value_float(scene->nkc, "Blend", scene->brush_blend);
+			nk_slider_float(scene->nkc, 0.0f, &scene->brush_blend, 16.0f, 0.5f);
+
+			nk_group_end(scene->nkc);
+		}
+
+		nk_layout_row_dynamic(scene->nkc, 30, TRACE_EVENTS ? 2 : 1);
 		if (nk_button_text(scene->nkc, "Extract all", 11))
 		{
 			//THierarchy_extract_all_leaves(&scene->hierarchy);
-			THierarchy_extract_tree(&scene->hierarchy);
+			ExtractionService_request(&scene->extraction, hierarchy->focus_point);
 		}
+		if (TRACE_EVENTS && nk_button_text(scene->nkc, "Dump trace", 10))
+			Trace_dump("trace.json");
 	}
 	nk_end(scene->nkc);
 
@@ -469,6 +601,21 @@ int DebugScene_render(struct DebugScene* scene, struct RenderInput* input)
 	return 0;
 }
 
+// Steps along the view a brush radius at a time and stops at the first solid sample
+void _DebugScene_brush_target(struct DebugScene* scene, struct THierarchy* hierarchy, vec3 out)
+{
+	vec3 forward = { 0.0f, 0.0f, 1.0f };
+	glm_mat4_mulv3(scene->camera.m_rotation, forward, forward);
+	float step = scene->brush_radius;
+	for (float t = step; t < BRUSH_REACH; t += step)
+	{
+		vec3_add_coeff(out, forward, scene->camera.position, t);
+		if (sampler_fn(out[0], out[1], out[2], 0, step, hierarchy->osn) < 0)
+			return;
+	}
+	vec3_add_coeff(out, forward, scene->camera.position, scene->brush_radius * 4.0f);
+}
+
 void abbreviate_int(int d, int* i_out, char* c_out)
 {
 	if (d > 1024 * 1024)
@@ -8,13 +8,21 @@
 #include "Camera.h"
 #include "UniformMarchingCubes.h"
 #include "THierarchy.h"
+#include "ExtractionService.h"
+#include "CameraPath.h"
 
 struct DebugScene
 {
 	int last_space : 1;
+	int last_r : 1;
+	int recording : 1;
 	int outline_visible : 1;
 	int smooth_shading : 1;
+	int last_edit : 1;
 	int fillmode;
+	int brush_shape;
+	float brush_radius;
+	float brush_blend;
 	float line_width;
 	float line_color[4];
 	float fill_color[4];
@@ -44,7 +52,8 @@ struct DebugScene
 
 	struct FPSCamera camera;
 	struct UMC_Chunk test_chunk;
-	struct THierarchy hierarchy;
+	struct ExtractionService extraction;
+	struct CameraPath camera_path;
 
 	struct nk_context* nkc;
 };
@@ -0,0 +1,425 @@
+#include "EditLayer.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Sampler.h"
+#include "Util.h"
+
+#define EDITCELL_CMP(left, right) left->hash == right->hash ? !(left->key[0] == right->key[0] && left->key[1] == right->key[1] && left->key[2] == right->key[2]) : 1
+#define EDITCELL_HASH(entry) entry->hash
+DECLARE_HASHMAP(EditCellMap, EDITCELL_CMP, EDITCELL_HASH, free, realloc)
+
+#define EDIT_CELL_HASH(x, y, z) ((uint64_t)((uint32_t)(x) * 73856093u) ^ ((uint64_t)((uint32_t)(y) * 19349663u) << 21) ^ ((uint64_t)((uint32_t)(z) * 83492791u) << 42))
+
+void EditBrush_init(struct EditBrush* out, enum EditOp op, enum EditShape shape, vec3 center, vec3 size, float blend)
+{
+	out->op = (uint8_t)op;
+	out->shape = (uint8_t)shape;
+	vec3_copy(center, out->center);
+	if (shape == EDIT_SPHERE)
+		vec3_set(out->size, size[0], size[0], size[0]);
+	else
+		vec3_copy(size, out->size);
+
+	// Smoothing needs a sample spacing
+	if (op == EDIT_SMOOTH && blend <= 0)
+		blend = 0.25f * min(out->size[0], min(out->size[1], out->size[2]));
+	out->blend = blend > 0 ? blend : 0;
+
+	// Smoothing only changes the inside of its shape. Add and subtract also reach out to where the brush is within
+	// the blend of the field, but 5k/4 out the brush value is far enough from the field's that both agree on the sign.
+	float margin = EDIT_BOUNDS_PADDING;
+	if (op != EDIT_SMOOTH)
+		margin += out->blend * 1.25f;
+	for (int i = 0; i < 3; i++)
+	{
+		out->box_min[i] = center[i] - out->size[i] - margin;
+		out->box_max[i] = center[i] + out->size[i] + margin;
+	}
+}
+
+int EditLayer_init(struct EditLayer* layer, const float(*base)(float x, float y, float z, float w, float footprint, struct osn_context* osn))
+{
+	layer->base = base;
+	layer->count = 0;
+	layer->size = 64;
+	layer->edits = malloc(layer->size * sizeof(struct EditBrush));
+	EditCellMapNew(&layer->cells);
+	vec3_set(layer->box_min, FLT_MAX, FLT_MAX, FLT_MAX);
+	vec3_set(layer->box_max, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+	if (!layer->edits)
+	{
+		printf("Failed to alloc edit layer.\n");
+		layer->size = 0;
+		return 1;
+	}
+	return 0;
+}
+
+void EditLayer_destroy(struct EditLayer* layer)
+{
+	struct EditCell* cell;
+	HASHMAP_FOR_EACH(EditCellMap, cell, layer->cells)
+	{
+		free(cell->edits);
+	} HASHMAP_FOR_EACH_END
+	EditCellMapDestroy(&layer->cells);
+	free(layer->edits);
+	layer->edits = 0;
+	layer->count = 0;
+	layer->size = 0;
+}
+
+void EditLayer_clear(struct EditLayer* layer)
+{
+	struct EditCell* cell;
+	HASHMAP_FOR_EACH(EditCellMap, cell, layer->cells)
+	{
+		free(cell->edits);
+	} HASHMAP_FOR_EACH_END
+	EditCellMapDestroy(&layer->cells);
+	EditCellMapNew(&layer->cells);
+	layer->count = 0;
+	vec3_set(layer->box_min, FLT_MAX, FLT_MAX, FLT_MAX);
+	vec3_set(layer->box_max, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+int EditLayer_add(struct EditLayer* layer, struct EditBrush* brush)
+{
+	int32_t cell_min[3], cell_max[3];
+	uint64_t cell_count = _EditBrush_cells(brush, cell_min, cell_max);
+	if (cell_count > EDIT_MAX_BRUSH_CELLS)
+	{
+		printf("Edit brush covers too many cells (%llu).\n", (unsigned long long)cell_count);
+		return 1;
+	}
+
+	if (layer->count == layer->size)
+	{
+		uint32_t size = layer->size ? layer->size * 2 : 64;
+		struct EditBrush* edits = realloc(layer->edits, size * sizeof(struct EditBrush));
+		if (!edits)
+		{
+			printf("Failed to grow edit layer.\n");
+			return 1;
+		}
+		layer->edits = edits;
+		layer->size = size;
+	}
+
+	uint32_t edit = layer->count;
+	layer->edits[edit] = *brush;
+	for (int32_t x = cell_min[0]; x <= cell_max[0]; x++)
+	{
+		for (int32_t y = cell_min[1]; y <= cell_max[1]; y++)
+		{
+			for (int32_t z = cell_min[2]; z <= cell_max[2]; z++)
+			{
+				if (_EditLayer_insert(layer, x, y, z, edit))
+				{
+					printf("Failed to index edit brush.\n");
+					_EditLayer_unindex(layer, cell_min, cell_max, edit);
+					return 1;
+				}
+			}
+		}
+	}
+
+	layer->count++;
+	for (int i = 0; i < 3; i++)
+	{
+		layer->box_min[i] = min(layer->box_min[i], brush->box_min[i]);
+		layer->box_max[i] = max(layer->box_max[i], brush->box_max[i]);
+	}
+	return 0;
+}
+
+// Takes back the newest edit, for when the hierarchy couldn't be re-extracted under it
+void EditLayer_pop(struct EditLayer* layer)
+{
+	if (!layer->count)
+		return;
+
+	int32_t cell_min[3], cell_max[3];
+	uint32_t edit = --layer->count;
+	_EditBrush_cells(&layer->edits[edit], cell_min, cell_max);
+	_EditLayer_unindex(layer, cell_min, cell_max, edit);
+
+	vec3_set(layer->box_min, FLT_MAX, FLT_MAX, FLT_MAX);
+	vec3_set(layer->box_max, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint32_t i = 0; i < layer->count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			layer->box_min[axis] = min(layer->box_min[axis], layer->edits[i].box_min[axis]);
+			layer->box_max[axis] = max(layer->box_max[axis], layer->edits[i].box_max[axis]);
+		}
+	}
+}
+
+float EditLayer_sample(struct EditLayer* layer, float x, float y, float z, float w, float footprint, struct osn_context* osn)
+{
+	vec3 p = { x, y, z };
+	return _EditLayer_evaluate(layer, p, layer->count, 1, w, footprint, osn);
+}
+
+void EditLayer_bounds(struct EditLayer* layer, vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	_EditLayer_bounds(layer, box_min, box_max, layer->count, 1, w, footprint, osn, lo, hi);
+}
+
+// Edits don't depend on w and move no further than the field under them, which smoothing samples up to its blend out
+float EditLayer_drift(struct EditLayer* layer, vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	SamplerDriftFn drift_fn = Sampler_drift(layer->base);
+	if (!drift_fn)
+		return FLT_MAX;
+
+	float reach = 0;
+	for (uint32_t i = 0; i < layer->count; i++)
+	{
+		struct EditBrush* brush = &layer->edits[i];
+		if (brush->op == EDIT_SMOOTH && _Edit_box_overlaps(box_min, box_max, brush->box_min, brush->box_max))
+			reach = max(reach, brush->blend);
+	}
+	vec3 wide_min, wide_max;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		wide_min[axis] = box_min[axis] - reach;
+		wide_max[axis] = box_max[axis] + reach;
+	}
+	return drift_fn(wide_min, wide_max, w0, w1);
+}
+
+// The field after the edits before upto, leaving out smoothing unless smooth is set
+float _EditLayer_evaluate(struct EditLayer* layer, vec3 p, uint32_t upto, int smooth, float w, float footprint, struct osn_context* osn)
+{
+	float value = layer->base(p[0], p[1], p[2], w, footprint, osn);
+	if (!_Edit_box_overlaps(p, p, layer->box_min, layer->box_max))
+		return value;
+	struct EditCell* cell = _EditLayer_find(layer, p);
+	if (!cell)
+		return value;
+
+	// Cells list their edits in order
+	for (uint32_t i = 0; i < cell->count && cell->edits[i] < upto; i++)
+	{
+		struct EditBrush* brush = &layer->edits[cell->edits[i]];
+		if (!_Edit_box_overlaps(p, p, brush->box_min, brush->box_max))
+			continue;
+
+		float d = _EditBrush_distance(brush, p);
+		switch (brush->op)
+		{
+		case EDIT_ADD:
+			value = brush->blend > 0 ? _Edit_smin(value, d, brush->blend) : min(value, d);
+			break;
+		case EDIT_SUBTRACT:
+			value = brush->blend > 0 ? -_Edit_smin(-value, d, brush->blend) : max(value, -d);
+			break;
+		case EDIT_SMOOTH:
+		{
+			if (!smooth || d >= 0)
+				break;
+			float sum = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				vec3 q;
+				vec3_copy(p, q);
+				q[axis] = p[axis] - brush->blend;
+				sum += _EditLayer_evaluate(layer, q, cell->edits[i], 0, w, footprint, osn);
+				q[axis] = p[axis] + brush->blend;
+				sum += _EditLayer_evaluate(layer, q, cell->edits[i], 0, w, footprint, osn);
+			}
+			float weight = EDIT_SMOOTH_STRENGTH * min(-d / brush->blend, 1.0f);
+			value += weight * (sum * (1.0f / 6.0f) - value);
+			break;
+		}
+		}
+	}
+	return value;
+}
+
+// Bounds of _EditLayer_evaluate over the box. Edits are few next to samples, so they're scanned rather than looked up.
+void _EditLayer_bounds(struct EditLayer* layer, vec3 box_min, vec3 box_max, uint32_t upto, int smooth, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	SamplerBoundsFn bounds_fn = Sampler_bounds(layer->base);
+	if (bounds_fn)
+		bounds_fn(box_min, box_max, w, footprint, osn, lo, hi);
+	else
+	{
+		*lo = -FLT_MAX;
+		*hi = FLT_MAX;
+	}
+	if (!_Edit_box_overlaps(box_min, box_max, layer->box_min, layer->box_max))
+		return;
+
+	for (uint32_t i = 0; i < upto && i < layer->count; i++)
+	{
+		struct EditBrush* brush = &layer->edits[i];
+		if (!_Edit_box_overlaps(box_min, box_max, brush->box_min, brush->box_max))
+			continue;
+
+		float new_lo, new_hi, d_lo, d_hi;
+		float slack = brush->blend * 0.25f;
+		switch (brush->op)
+		{
+		case EDIT_ADD:
+			_EditBrush_distance_range(brush, box_min, box_max, &d_lo, &d_hi);
+			new_lo = min(*lo, d_lo) - slack;
+			new_hi = min(*hi, d_hi);
+			break;
+		case EDIT_SUBTRACT:
+			_EditBrush_distance_range(brush, box_min, box_max, &d_lo, &d_hi);
+			new_lo = max(*lo, -d_hi);
+			new_hi = max(*hi, -d_lo) + slack;
+			break;
+		default:
+		{
+			// Smoothed values are blends of the value under them and samples up to blend units out of the box
+			if (!smooth)
+				continue;
+			vec3 wide_min, wide_max;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				wide_min[axis] = box_min[axis] - brush->blend;
+				wide_max[axis] = box_max[axis] + brush->blend;
+			}
+			_EditLayer_bounds(layer, wide_min, wide_max, i, 0, w, footprint, osn, &d_lo, &d_hi);
+			new_lo = min(*lo, d_lo);
+			new_hi = max(*hi, d_hi);
+			break;
+		}
+		}
+
+		// Parts of the box outside the brush's bounds keep the value from before it
+		int inside = 1;
+		for (int axis = 0; axis < 3; axis++)
+			inside &= box_min[axis] >= brush->box_min[axis] && box_max[axis] <= brush->box_max[axis];
+		if (!inside)
+		{
+			new_lo = min(new_lo, *lo);
+			new_hi = max(new_hi, *hi);
+		}
+		*lo = new_lo;
+		*hi = new_hi;
+	}
+}
+
+struct EditCell* _EditLayer_find(struct EditLayer* layer, vec3 p)
+{
+	struct EditCell query, *result = &query;
+	query.key[0] = (int32_t)floorf(p[0] / EDIT_CELL_SIZE);
+	query.key[1] = (int32_t)floorf(p[1] / EDIT_CELL_SIZE);
+	query.key[2] = (int32_t)floorf(p[2] / EDIT_CELL_SIZE);
+	query.hash = EDIT_CELL_HASH(query.key[0], query.key[1], query.key[2]);
+	if (!EditCellMapFind(&layer->cells, &result))
+		return 0;
+	return result;
+}
+
+int _EditLayer_insert(struct EditLayer* layer, int32_t x, int32_t y, int32_t z, uint32_t edit)
+{
+	struct EditCell query, *result = &query;
+	query.key[0] = x;
+	query.key[1] = y;
+	query.key[2] = z;
+	query.hash = EDIT_CELL_HASH(x, y, z);
+	query.edits = 0;
+	query.count = 0;
+	query.size = 0;
+	if (EditCellMapPut(&layer->cells, &result, HMDR_FIND) == HMPR_FAILED)
+		return 1;
+
+	if (result->count == result->size)
+	{
+		uint32_t size = result->size ? result->size * 2 : 4;
+		uint32_t* edits = realloc(result->edits, size * sizeof(uint32_t));
+		if (!edits)
+			return 1;
+		result->edits = edits;
+		result->size = size;
+	}
+	result->edits[result->count++] = edit;
+	return 0;
+}
+
+// Removes edit from the cells in the range, being the newest it's last in any cell listing it. Emptied cells stay in
+// the map, they cost the same as a missing one to sample
+void _EditLayer_unindex(struct EditLayer* layer, int32_t cell_min[3], int32_t cell_max[3], uint32_t edit)
+{
+	struct EditCell query, *result;
+	for (int32_t x = cell_min[0]; x <= cell_max[0]; x++)
+	{
+		for (int32_t y = cell_min[1]; y <= cell_max[1]; y++)
+		{
+			for (int32_t z = cell_min[2]; z <= cell_max[2]; z++)
+			{
+				query.key[0] = x;
+				query.key[1] = y;
+				query.key[2] = z;
+				query.hash = EDIT_CELL_HASH(x, y, z);
+				result = &query;
+				if (EditCellMapFind(&layer->cells, &result) && result->count && result->edits[result->count - 1] == edit)
+					result->count--;
+			}
+		}
+	}
+}
+
+// The EDIT_CELL_SIZE cells the brush's bounds touch, returns how many
+uint64_t _EditBrush_cells(struct EditBrush* brush, int32_t cell_min[3], int32_t cell_max[3])
+{
+	uint64_t cell_count = 1;
+	for (int i = 0; i < 3; i++)
+	{
+		cell_min[i] = (int32_t)floorf(brush->box_min[i] / EDIT_CELL_SIZE);
+		cell_max[i] = (int32_t)floorf(brush->box_max[i] / EDIT_CELL_SIZE);
+		cell_count *= (uint64_t)(cell_max[i] - cell_min[i] + 1);
+	}
+	return cell_count;
+}
+
+// Signed distance to the brush's shape, negative inside
+__forceinline float _EditBrush_distance(struct EditBrush* brush, vec3 p)
+{
+	float dx = fabsf(p[0] - brush->center[0]);
+	float dy = fabsf(p[1] - brush->center[1]);
+	float dz = fabsf(p[2] - brush->center[2]);
+	if (brush->shape == EDIT_SPHERE)
+		return sqrtf(dx * dx + dy * dy + dz * dz) - brush->size[0];
+
+	float qx = dx - brush->size[0], qy = dy - brush->size[1], qz = dz - brush->size[2];
+	float ox = max(qx, 0), oy = max(qy, 0), oz = max(qz, 0);
+	return sqrtf(ox * ox + oy * oy + oz * oz) + min(max(qx, max(qy, qz)), 0);
+}
+
+// Both distances only grow with each axis' distance from the center, so the box's nearest and farthest offsets bound them
+void _EditBrush_distance_range(struct EditBrush* brush, vec3 box_min, vec3 box_max, float* lo, float* hi)
+{
+	vec3 near_p, far_p;
+	for (int i = 0; i < 3; i++)
+	{
+		float n, f;
+		_Sampler_axis_range(box_min[i] - brush->center[i], box_max[i] - brush->center[i], &n, &f);
+		near_p[i] = brush->center[i] + n;
+		far_p[i] = brush->center[i] + f;
+	}
+	*lo = _EditBrush_distance(brush, near_p);
+	*hi = _EditBrush_distance(brush, far_p);
+}
+
+// Polynomial smooth minimum, within k/4 below the hard one
+__forceinline float _Edit_smin(float a, float b, float k)
+{
+	float h = 0.5f + 0.5f * (b - a) / k;
+	h = h < 0 ? 0 : (h > 1 ? 1 : h);
+	return b + (a - b) * h - k * h * (1.0f - h);
+}
+
+__forceinline int _Edit_box_overlaps(vec3 a_min, vec3 a_max, vec3 b_min, vec3 b_max)
+{
+	return a_min[0] <= b_max[0] && a_max[0] >= b_min[0] && a_min[1] <= b_max[1] && a_max[1] >= b_min[1] && a_min[2] <= b_max[2] && a_max[2] >= b_min[2];
+}
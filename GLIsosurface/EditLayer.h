@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+#include "Hashmap.h"
+#include "OpenSimplexNoise.h"
+
+// Realtime modification: CSG brushes composed on top of a procedural sampler, evaluated through SurfaceFn_edited.
+// Edits apply in the order they were made, negative is solid as with every sampler. An edit only changes the field
+// inside its bounds, the brush's box grown by enough margin that a blend can't flip a sign at the edge, so it only
+// invalidates the hierarchy leaves whose tetrahedra touch those bounds.
+// Edits are indexed by a sparse hash of EDIT_CELL_SIZE cubes, each listing the edits whose bounds touch it in order, so
+// a sample only looks at the brushes around it and samples away from every edit cost one bounds check.
+//
+// Add and subtract take a sphere or a box and are hard for blend 0, otherwise blended over blend field units with the
+// polynomial smooth min/max the sampler graphs use. Smooth pulls the field inside its shape towards the average of six
+// samples blend units away, fading in over blend units from the shape's surface. Those six samples see the base and
+// the earlier add/subtract edits but not earlier smoothing, so overlapping smooth brushes cost 7 samples rather than 7^n.
+
+#define EDIT_CELL_SIZE 16.0f
+// Brushes whose bounds would cover more cells than this are refused
+#define EDIT_MAX_BRUSH_CELLS (1 << 16)
+// Keeps the gradient samples around vertices on the edge of a brush inside its bounds
+#define EDIT_BOUNDS_PADDING 0.01f
+#define EDIT_SMOOTH_STRENGTH 0.5f
+
+enum EditOp
+{
+	EDIT_ADD = 0,
+	EDIT_SUBTRACT,
+	EDIT_SMOOTH,
+};
+
+enum EditShape
+{
+	EDIT_SPHERE = 0,
+	EDIT_BOX,
+};
+
+struct EditBrush
+{
+	uint8_t op;
+	uint8_t shape;
+	vec3 center;
+	// Radius in every component for spheres, half extents for boxes
+	vec3 size;
+	float blend;
+	vec3 box_min;
+	vec3 box_max;
+};
+
+struct EditCell
+{
+	uint64_t hash;
+	int32_t key[3];
+	uint32_t* edits;
+	uint32_t count;
+	uint32_t size;
+};
+
+DEFINE_HASHMAP(EditCellMap, struct EditCell)
+
+struct EditLayer
+{
+	const float(*base)(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+	struct EditBrush* edits;
+	uint32_t count;
+	uint32_t size;
+	EditCellMap cells;
+	// Union of every edit's bounds
+	vec3 box_min;
+	vec3 box_max;
+};
+
+void EditBrush_init(struct EditBrush* out, enum EditOp op, enum EditShape shape, vec3 center, vec3 size, float blend);
+
+int EditLayer_init(struct EditLayer* layer, const float(*base)(float x, float y, float z, float w, float footprint, struct osn_context* osn));
+void EditLayer_destroy(struct EditLayer* layer);
+void EditLayer_clear(struct EditLayer* layer);
+int EditLayer_add(struct EditLayer* layer, struct EditBrush* brush);
+void EditLayer_pop(struct EditLayer* layer);
+float EditLayer_sample(struct EditLayer* layer, float x, float y, float z, float w, float footprint, struct osn_context* osn);
+void EditLayer_bounds(struct EditLayer* layer, vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+float EditLayer_drift(struct EditLayer* layer, vec3 box_min, vec3 box_max, float w0, float w1);
+
+float _EditLayer_evaluate(struct EditLayer* layer, vec3 p, uint32_t upto, int smooth, float w, float footprint, struct osn_context* osn);
+void _EditLayer_bounds(struct EditLayer* layer, vec3 box_min, vec3 box_max, uint32_t upto, int smooth, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+struct EditCell* _EditLayer_find(struct EditLayer* layer, vec3 p);
+int _EditLayer_insert(struct EditLayer* layer, int32_t x, int32_t y, int32_t z, uint32_t edit);
+void _EditLayer_unindex(struct EditLayer* layer, int32_t cell_min[3], int32_t cell_max[3], uint32_t edit);
+uint64_t _EditBrush_cells(struct EditBrush* brush, int32_t cell_min[3], int32_t cell_max[3]);
+extern __forceinline float _EditBrush_distance(struct EditBrush* brush, vec3 p);
+void _EditBrush_distance_range(struct EditBrush* brush, vec3 box_min, vec3 box_max, float* lo, float* hi);
+extern __forceinline float _Edit_smin(float a, float b, float k);
+extern __forceinline int _Edit_box_overlaps(vec3 a_min, vec3 a_max, vec3 b_min, vec3 b_max);
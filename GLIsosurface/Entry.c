@@ -2,8 +2,13 @@
 #define GLFW_DLL
 #include <GLFW/glfw3.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 
 #include "Core.h"
+#include "Benchmark.h"
+#include "BrickVolume.h"
+#include "Sampler.h"
 
 #if defined(_DEBUG) && defined(_WIN32)
 #define DWIN32
@@ -12,9 +17,97 @@
 #include <crtdbg.h>
 #endif
 
-int main(void)
+int main(int argc, char** argv)
 {
 	struct RenderInput render_input;
+	static struct BrickVolume volume;
+	static struct SamplerProgram graph_program;
+
+	// Offline conversion: --convert-volume in.raw nx ny nz float|uint16 out.bvol [--brick N] [--iso V]
+	if (argc > 7 && !strcmp(argv[1], "--convert-volume"))
+	{
+		uint32_t brick_size = BRICK_VOLUME_DEFAULT_BRICK;
+		float isolevel = 0;
+		for (int i = 8; i < argc; i++)
+		{
+			if (!strcmp(argv[i], "--brick") && i + 1 < argc)
+				brick_size = (uint32_t)atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--iso") && i + 1 < argc)
+				isolevel = (float)atof(argv[++i]);
+		}
+		enum BrickFormat format = !strcmp(argv[6], "uint16") ? BRICK_FORMAT_UINT16 : BRICK_FORMAT_FLOAT32;
+		return BrickVolume_convert(argv[2], (uint32_t)atoi(argv[3]), (uint32_t)atoi(argv[4]), (uint32_t)atoi(argv[5]), format, brick_size, isolevel, argv[7]);
+	}
+
+	// --volume file.bvol meshes a brick volume instead of the default sampler, in any mode
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--volume"))
+			continue;
+		if (BrickVolume_open(&volume, argv[i + 1]))
+			return 1;
+		Sampler_volume = &volume;
+		sampler_fn = &SurfaceFn_volume;
+		for (int j = i; j + 2 < argc; j++)
+			argv[j] = argv[j + 2];
+		argc -= 2;
+		break;
+	}
+
+	// --graph file.txt meshes a sampler graph instead of the default sampler, in any mode
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--graph"))
+			continue;
+		struct SamplerGraph graph;
+		if (SamplerGraph_init(&graph))
+			return 1;
+		if (SamplerGraph_load(&graph, argv[i + 1]) || SamplerGraph_compile(&graph, &graph_program))
+		{
+			SamplerGraph_destroy(&graph);
+			return 1;
+		}
+		SamplerGraph_destroy(&graph);
+		Sampler_graph = &graph_program;
+		sampler_fn = &SurfaceFn_graph;
+		for (int j = i; j + 2 < argc; j++)
+			argv[j] = argv[j + 2];
+		argc -= 2;
+		break;
+	}
+
+	// Headless benchmark: --benchmark [out.json] [--quick] [--trace trace.json]
+	if (argc > 1 && !strcmp(argv[1], "--benchmark"))
+	{
+		const char* out_path = "benchmark.json";
+		const char* trace_path = 0;
+		int quick = 0;
+		for (int i = 2; i < argc; i++)
+		{
+			if (!strcmp(argv[i], "--quick"))
+				quick = 1;
+			else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+				trace_path = argv[++i];
+			else
+				out_path = argv[i];
+		}
+		return Benchmark_run(out_path, trace_path, quick);
+	}
+
+	// Headless camera path replay: --replay camera_path.txt [out.json] [--stride N]
+	if (argc > 2 && !strcmp(argv[1], "--replay"))
+	{
+		const char* out_path = "replay.json";
+		int stride = REPLAY_DEFAULT_STRIDE;
+		for (int i = 3; i < argc; i++)
+		{
+			if (!strcmp(argv[i], "--stride") && i + 1 < argc)
+				stride = atoi(argv[++i]);
+			else
+				out_path = argv[i];
+		}
+		return Benchmark_replay(argv[2], out_path, stride);
+	}
 
 	if (Core_init(&render_input))
 	{
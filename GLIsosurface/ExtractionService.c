@@ -0,0 +1,545 @@
+#include "ExtractionService.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Options.h"
+#include "Sampler.h"
+#include "Timer.h"
+#include "Trace.h"
+
+int ExtractionService_init(struct ExtractionService* service, int t_resolution, int worker_count)
+{
+	service->worker_count = worker_count > THREADS_MAX ? THREADS_MAX : worker_count;
+	service->front = 0;
+	service->has_pending = 0;
+	service->running = 1;
+	service->cancel = 0;
+	service->state = EXTRACTION_IDLE;
+	service->next_leaf = 0;
+	service->region_complete = 0;
+	service->failed = 0;
+	service->editing = 0;
+	service->leaf_count = 0;
+	service->leaf_size = 0;
+	service->leaves = 0;
+	service->uploaded_count = 0;
+	service->job_start_ms = 0;
+	service->region_leaves = 0;
+	service->region_size = 0;
+	service->pending_edits = 0;
+	service->pending_edit_count = 0;
+	service->pending_edit_size = 0;
+	EditLayer_init(&service->edits, 0);
+
+	// The front hierarchy is extracted synchronously so there's something to show on the first frame
+	THierarchy_init(&service->hierarchies[0], t_resolution);
+	if (service->worker_count <= 0)
+	{
+		service->worker_count = 0;
+		return 0;
+	}
+
+	THierarchy_init_empty(&service->hierarchies[1], t_resolution, 1);
+
+	if (LockFreeQueue_init(&service->meshes, EXTRACTION_QUEUE_SIZE))
+	{
+		printf("Failed to alloc extraction queue.\n");
+		THierarchy_destroy(&service->hierarchies[1]);
+		service->worker_count = 0;
+		return 1;
+	}
+	if (UploadQueue_init(&service->uploads, UPLOAD_BUDGET_BYTES))
+	{
+		LockFreeQueue_destroy(&service->meshes);
+		THierarchy_destroy(&service->hierarchies[1]);
+		service->worker_count = 0;
+		return 1;
+	}
+
+	Semaphore_init(&service->job_ready, 0);
+	Semaphore_init(&service->work_ready, 0);
+	Semaphore_init(&service->work_done, 0);
+
+	Thread_start(&service->coordinator, _ExtractionService_coordinator, service);
+	for (int i = 0; i < service->worker_count; i++)
+		Thread_start(&service->workers[i], _ExtractionService_worker, service);
+
+	printf("Started extraction service with %i workers.\n\n", service->worker_count);
+	return 0;
+}
+
+void ExtractionService_destroy(struct ExtractionService* service)
+{
+	if (service->worker_count)
+	{
+		// Any job in flight runs out of leaves immediately once cancel is set
+		Atomic_store(&service->cancel, 1);
+		Atomic_store(&service->running, 0);
+		Semaphore_post(&service->job_ready, 1);
+		Thread_join(&service->coordinator);
+		for (int i = 0; i < service->worker_count; i++)
+			Thread_join(&service->workers[i]);
+
+		void* mesh;
+		while (!LockFreeQueue_pop(&service->meshes, &mesh))
+		{
+			LeafMesh_destroy((struct LeafMesh*)mesh);
+			free(mesh);
+		}
+
+		LockFreeQueue_destroy(&service->meshes);
+		UploadQueue_destroy(&service->uploads);
+		Semaphore_destroy(&service->job_ready);
+		Semaphore_destroy(&service->work_ready);
+		Semaphore_destroy(&service->work_done);
+		THierarchy_destroy(&service->hierarchies[1]);
+	}
+
+	THierarchy_destroy(&service->hierarchies[0]);
+	free(service->leaves);
+	service->leaves = 0;
+
+	if (Sampler_edits == &service->edits)
+	{
+		sampler_fn = service->edits.base;
+		Sampler_edits = 0;
+	}
+	EditLayer_destroy(&service->edits);
+	free(service->region_leaves);
+	service->region_leaves = 0;
+	free(service->pending_edits);
+	service->pending_edits = 0;
+	service->pending_edit_count = 0;
+}
+
+struct THierarchy* ExtractionService_front(struct ExtractionService* service)
+{
+	return &service->hierarchies[service->front];
+}
+
+int ExtractionService_busy(struct ExtractionService* service)
+{
+	return service->state != EXTRACTION_IDLE;
+}
+
+void ExtractionService_request(struct ExtractionService* service, vec3 focus_point)
+{
+	struct THierarchy* front = ExtractionService_front(service);
+	if (!service->worker_count)
+	{
+		vec3_copy(focus_point, front->focus_point);
+		THierarchy_extract_tree(front);
+		return;
+	}
+
+	// Snapshot everything the workers need, the UI is free to keep editing the front hierarchy
+	struct ExtractionJob job;
+	vec3_copy(focus_point, job.focus_point);
+	job.pem = front->pem;
+	job.snap_threshold = front->snap_threshold;
+	job.max_depth = front->max_depth;
+	job.sub_resolution = front->sub_resolution;
+	job.target = !service->front;
+
+	if (service->state != EXTRACTION_IDLE)
+	{
+		// Only the latest request matters
+		service->pending = job;
+		service->has_pending = 1;
+		return;
+	}
+
+	_ExtractionService_dispatch(service, &job);
+}
+
+int ExtractionService_update(struct ExtractionService* service)
+{
+	if (!service->worker_count || service->state == EXTRACTION_IDLE)
+		return 0;
+
+	struct THierarchy* back = &service->hierarchies[service->job.target];
+
+	// Read the completion flag before draining: if it's set, every mesh has already been pushed
+	int complete = Atomic_load(&service->region_complete);
+	void* data;
+	while (!LockFreeQueue_pop(&service->meshes, &data))
+	{
+		// A leaf that can't be queued or uploaded would leave a hole, so the job fails and the rest is only drained
+		if (Atomic_load(&service->failed) || UploadQueue_push(&service->uploads, (struct LeafMesh*)data))
+		{
+			Atomic_store(&service->failed, 1);
+			LeafMesh_destroy((struct LeafMesh*)data);
+			free(data);
+		}
+	}
+
+	if (!Atomic_load(&service->failed))
+	{
+		service->uploaded_count += UploadQueue_flush(&service->uploads, &back->arena);
+		back->last_upload_ms += (float)service->uploads.last_frame_ms;
+		if (service->uploads.failed_meshes)
+		{
+			printf("Failed to upload %u leaf meshes.\n", service->uploads.failed_meshes);
+			Atomic_store(&service->failed, 1);
+		}
+	}
+	if (Atomic_load(&service->failed))
+		UploadQueue_clear(&service->uploads);
+	if (!complete || service->uploads.count)
+		return 0;
+
+	service->state = EXTRACTION_IDLE;
+	if (Atomic_load(&service->failed))
+		printf("Extraction failed, keeping the previous hierarchy.\n");
+	else
+	{
+		service->front = service->job.target;
+		back->last_extract_time = (uint32_t)(Timer_ms() - service->job_start_ms);
+		THierarchy_create_outline(back);
+	}
+
+	for (uint32_t i = 0; i < service->pending_edit_count; i++)
+		_ExtractionService_apply_edit(service, &service->pending_edits[i]);
+	service->pending_edit_count = 0;
+
+	if (service->has_pending)
+	{
+		struct ExtractionJob pending = service->pending;
+		service->has_pending = 0;
+		pending.target = !service->front;
+		_ExtractionService_dispatch(service, &pending);
+	}
+	return 1;
+}
+
+int ExtractionService_edit(struct ExtractionService* service, struct EditBrush* brush)
+{
+	if (service->state == EXTRACTION_IDLE)
+		return _ExtractionService_apply_edit(service, brush);
+
+	if (service->pending_edit_count == service->pending_edit_size)
+	{
+		uint32_t size = service->pending_edit_size ? service->pending_edit_size * 2 : 16;
+		struct EditBrush* pending = realloc(service->pending_edits, size * sizeof(struct EditBrush));
+		if (!pending)
+		{
+			printf("Failed to queue edit.\n");
+			return 1;
+		}
+		service->pending_edits = pending;
+		service->pending_edit_size = size;
+	}
+	service->pending_edits[service->pending_edit_count++] = *brush;
+	return 0;
+}
+
+void _ExtractionService_dispatch(struct ExtractionService* service, struct ExtractionJob* job)
+{
+	struct THierarchy* back = &service->hierarchies[job->target];
+
+	// The back arena is only ever touched from the render thread
+	MeshArena_reset(&back->arena);
+
+	// The old leaves survive until the coordinator refines, and their ranges are gone with the reset
+	for (struct TetrahedronNode* t = back->first_leaf; t; t = t->next)
+		MeshAllocation_init(&t->mesh);
+	vec3_copy(job->focus_point, back->focus_point);
+	back->pem = job->pem;
+	back->snap_threshold = job->snap_threshold;
+	back->max_depth = job->max_depth;
+	back->sub_resolution = job->sub_resolution;
+	back->last_upload_ms = 0;
+
+	service->job = *job;
+	service->uploaded_count = 0;
+	service->job_start_ms = Timer_ms();
+	service->state = EXTRACTION_RUNNING;
+	Atomic_store(&service->region_complete, 0);
+	Atomic_store(&service->failed, 0);
+	Semaphore_post(&service->job_ready, 1);
+}
+
+int _ExtractionService_coordinator(void* arg)
+{
+	struct ExtractionService* service = (struct ExtractionService*)arg;
+	Trace_thread_name("Extraction coordinator");
+
+	for (;;)
+	{
+		Semaphore_wait(&service->job_ready);
+		if (!Atomic_load(&service->running))
+			break;
+
+		TRACE_BEGIN("Extraction job");
+		struct THierarchy* back = &service->hierarchies[service->job.target];
+		THierarchy_refine(back);
+
+		// Flatten the leaf list so workers can grab leaves with a single atomic increment
+		if (service->leaf_size < (uint32_t)back->leaf_count)
+		{
+			free(service->leaves);
+			service->leaf_size = back->leaf_count;
+			service->leaves = malloc(service->leaf_size * sizeof(struct TetrahedronNode*));
+			if (!service->leaves)
+			{
+				printf("Failed to alloc extraction leaf list.\n");
+				service->leaf_size = 0;
+				Atomic_store(&service->failed, 1);
+			}
+		}
+		service->leaf_count = 0;
+		struct TetrahedronNode* next_node = back->first_leaf;
+		while (next_node && service->leaf_count < service->leaf_size)
+		{
+			service->leaves[service->leaf_count++] = next_node;
+			next_node = next_node->next;
+		}
+
+		Atomic_store(&service->next_leaf, 0);
+		Semaphore_post(&service->work_ready, service->worker_count);
+		for (int i = 0; i < service->worker_count; i++)
+			Semaphore_wait(&service->work_done);
+
+		uint32_t v_count = 0, p_count = 0;
+		uint32_t misses_before = 0, misses_after = 0;
+		struct UMC_Timings timings;
+		UMC_Timings_zero(&timings);
+		struct HotCounters counters = back->diamonds.counters;
+		for (uint32_t i = 0; i < service->leaf_count; i++)
+		{
+			v_count += service->leaves[i]->v_count;
+			p_count += service->leaves[i]->p_count;
+			misses_before += service->leaves[i]->cache_misses_before;
+			misses_after += service->leaves[i]->cache_misses_after;
+			UMC_Timings_add(&timings, &service->leaves[i]->timings);
+			HotCounters_add(&counters, &service->leaves[i]->counters);
+		}
+		back->v_count = v_count;
+		back->p_count = p_count;
+		back->cache_misses_before = misses_before;
+		back->cache_misses_after = misses_after;
+		back->timings = timings;
+		back->counters = counters;
+
+		TRACE_END("Extraction job");
+		Atomic_store(&service->region_complete, 1);
+	}
+
+	// Workers only exit once no job can be in flight
+	Atomic_store(&service->next_leaf, -1);
+	Semaphore_post(&service->work_ready, service->worker_count);
+	return 0;
+}
+
+int _ExtractionService_worker(void* arg)
+{
+	struct ExtractionService* service = (struct ExtractionService*)arg;
+	Trace_thread_name("Extraction worker");
+
+	for (;;)
+	{
+		Semaphore_wait(&service->work_ready);
+		if (Atomic_load(&service->next_leaf) < 0)
+			break;
+
+		if (Atomic_load(&service->editing))
+		{
+			_ExtractionService_polygonize_region(service);
+			Semaphore_post(&service->work_done, 1);
+			continue;
+		}
+
+		struct THierarchy* back = &service->hierarchies[service->job.target];
+		for (;;)
+		{
+			int32_t i = Atomic_add(&service->next_leaf, 1) - 1;
+			if (i >= (int32_t)service->leaf_count || Atomic_load(&service->cancel) || Atomic_load(&service->failed))
+				break;
+
+			struct TetrahedronNode* t = service->leaves[i];
+			struct LeafMesh* mesh = malloc(sizeof(struct LeafMesh));
+			if (!mesh)
+			{
+				// The region would have a hole, so the whole job is dropped
+				printf("Failed to alloc leaf mesh.\n");
+				Atomic_store(&service->failed, 1);
+				break;
+			}
+			if (TetrahedronNode_polygonize(t, mesh, back->pem, back->snap_threshold, back->osn, back->sub_resolution))
+			{
+				printf("Failed to polygonize leaf.\n");
+				Atomic_store(&service->failed, 1);
+				free(mesh);
+				break;
+			}
+			if (!mesh->v_count)
+			{
+				free(mesh);
+				continue;
+			}
+
+			// The render thread drains the queue every frame, so a full queue only ever means waiting a frame
+			if (LockFreeQueue_push(&service->meshes, mesh))
+			{
+				TRACE_BEGIN("Extraction queue full");
+				while (LockFreeQueue_push(&service->meshes, mesh))
+				{
+					if (Atomic_load(&service->cancel))
+					{
+						LeafMesh_destroy(mesh);
+						free(mesh);
+						break;
+					}
+					Thread_yield();
+				}
+				TRACE_END("Extraction queue full");
+			}
+		}
+
+		Semaphore_post(&service->work_done, 1);
+	}
+
+	return 0;
+}
+
+// Only called while no job is in flight, so nothing else is sampling
+int _ExtractionService_apply_edit(struct ExtractionService* service, struct EditBrush* brush)
+{
+	if (sampler_fn != &SurfaceFn_edited)
+	{
+		service->edits.base = sampler_fn;
+		Sampler_edits = &service->edits;
+		sampler_fn = &SurfaceFn_edited;
+	}
+	if (EditLayer_add(&service->edits, brush))
+		return 1;
+
+	double start_ms = Timer_ms();
+	struct THierarchy* front = ExtractionService_front(service);
+	uint32_t leaf_count;
+	if (service->worker_count)
+	{
+		// A failed region leaves the front as it was, so taking the edit back leaves the field and the meshes agreeing
+		if (_ExtractionService_extract_region(service, brush->box_min, brush->box_max))
+		{
+			printf("Edit dropped.\n");
+			EditLayer_pop(&service->edits);
+			return 1;
+		}
+		leaf_count = service->leaf_count;
+	}
+	else
+		leaf_count = THierarchy_extract_region(front, brush->box_min, brush->box_max);
+	front->last_extract_time = (uint32_t)(Timer_ms() - start_ms);
+	if (leaf_count)
+		printf("Edit re-extracted %u leaves (%u ms).\n", leaf_count, front->last_extract_time);
+	return 0;
+}
+
+// THierarchy_extract_region over the workers, leaving how many leaves it re-extracted in leaf_count; only called
+// while they're idle. Every new mesh gets its arena range before any old one is given back, so a leaf that fails to
+// polygonize or find room fails the whole region and leaves the front as it was.
+int _ExtractionService_extract_region(struct ExtractionService* service, vec3 box_min, vec3 box_max)
+{
+	struct THierarchy* front = ExtractionService_front(service);
+	service->leaf_count = 0;
+	for (struct TetrahedronNode* t = front->first_leaf; t; t = t->next)
+	{
+		if (!_THierarchy_touches_box(t, box_min, box_max))
+			continue;
+
+		if (service->leaf_count == service->leaf_size)
+		{
+			uint32_t size = service->leaf_size ? service->leaf_size * 2 : 256;
+			struct TetrahedronNode** leaves = realloc(service->leaves, size * sizeof(struct TetrahedronNode*));
+			if (!leaves)
+			{
+				printf("Failed to grow edit leaf list.\n");
+				service->leaf_count = 0;
+				return 1;
+			}
+			service->leaves = leaves;
+			service->leaf_size = size;
+		}
+		service->leaves[service->leaf_count++] = t;
+	}
+
+	if (service->region_size < service->leaf_count)
+	{
+		free(service->region_leaves);
+		service->region_size = service->leaf_size;
+		service->region_leaves = malloc(service->region_size * sizeof(struct ExtractionRegionLeaf));
+		if (!service->region_leaves)
+		{
+			printf("Failed to alloc edit meshes.\n");
+			service->region_size = 0;
+			service->leaf_count = 0;
+			return 1;
+		}
+	}
+	if (!service->leaf_count)
+		return 0;
+
+	// Polygonizing overwrites the leaves' counts
+	for (uint32_t i = 0; i < service->leaf_count; i++)
+	{
+		service->region_leaves[i].v_count = service->leaves[i]->v_count;
+		service->region_leaves[i].p_count = service->leaves[i]->p_count;
+	}
+
+	// The workers take their parameters from the job's target
+	service->job.target = service->front;
+	Atomic_store(&service->editing, 1);
+	Atomic_store(&service->next_leaf, 0);
+	Semaphore_post(&service->work_ready, service->worker_count);
+	_ExtractionService_polygonize_region(service);
+	for (int i = 0; i < service->worker_count; i++)
+		Semaphore_wait(&service->work_done);
+	Atomic_store(&service->editing, 0);
+
+	uint32_t reserved = 0;
+	for (; reserved < service->leaf_count; reserved++)
+	{
+		struct ExtractionRegionLeaf* leaf = &service->region_leaves[reserved];
+		if (leaf->failed || LeafMesh_alloc(&leaf->mesh, &front->arena, &leaf->alloc))
+			break;
+	}
+	int failed = reserved < service->leaf_count;
+	if (failed)
+		printf("Failed to re-extract edited leaf.\n");
+
+	for (uint32_t i = 0; i < service->leaf_count; i++)
+	{
+		struct TetrahedronNode* t = service->leaves[i];
+		struct ExtractionRegionLeaf* leaf = &service->region_leaves[i];
+		if (failed)
+		{
+			if (i < reserved)
+				MeshArena_free(&front->arena, &leaf->alloc);
+			t->v_count = leaf->v_count;
+			t->p_count = leaf->p_count;
+		}
+		else
+		{
+			TetrahedronNode_replace_mesh(t, &front->arena, &leaf->mesh, &leaf->alloc);
+			front->v_count += t->v_count - leaf->v_count;
+			front->p_count += t->p_count - leaf->p_count;
+		}
+		LeafMesh_destroy(&leaf->mesh);
+	}
+	return failed;
+}
+
+void _ExtractionService_polygonize_region(struct ExtractionService* service)
+{
+	struct THierarchy* front = &service->hierarchies[service->job.target];
+	for (;;)
+	{
+		int32_t i = Atomic_add(&service->next_leaf, 1) - 1;
+		if (i >= (int32_t)service->leaf_count)
+			break;
+		struct ExtractionRegionLeaf* leaf = &service->region_leaves[i];
+		leaf->failed = TetrahedronNode_polygonize(service->leaves[i], &leaf->mesh, front->pem, front->snap_threshold, front->osn, front->sub_resolution);
+	}
+}
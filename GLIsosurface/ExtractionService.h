@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+
+#include "THierarchy.h"
+#include "EditLayer.h"
+#include "Threading.h"
+#include "LockFreeQueue.h"
+#include "UploadQueue.h"
+
+// Refines and extracts a THierarchy in the background while the previous one keeps rendering.
+// Two hierarchies are kept: the front one is drawn, the back one is rebuilt by a coordinator thread which refines the
+// tree and hands its leaves to a pool of workers. Finished leaf meshes come back through a lock-free queue and are
+// staged in an UploadQueue which the render thread flushes within a per-frame byte budget. Once every leaf of a request has been uploaded the
+// two hierarchies are swapped, so a partially extracted region is never shown. A job that runs out of memory is dropped and
+// the old front stays.
+// Edits re-extract just the front leaves they touch, spread over the idle workers with the render thread taking a share,
+// and are uploaded before the next frame is drawn; one that can't be re-extracted is taken back out of the layer. The
+// first one puts the edit layer over the current sampler. While a job is in flight the workers are busy sampling, so
+// edits wait and are applied to the new front once it's swapped in.
+
+#define EXTRACTION_QUEUE_SIZE 8192
+
+enum ExtractionState
+{
+	EXTRACTION_IDLE = 0,
+	EXTRACTION_RUNNING,
+};
+
+struct ExtractionJob
+{
+	vec3 focus_point;
+	int pem;
+	float snap_threshold;
+	int max_depth;
+	int sub_resolution;
+	int target;
+};
+
+// A front leaf being re-extracted for an edit: its new mesh, the range reserved for it, and the counts to put back if
+// the edit fails
+struct ExtractionRegionLeaf
+{
+	struct LeafMesh mesh;
+	struct MeshAllocation alloc;
+	int failed;
+	uint32_t v_count;
+	uint32_t p_count;
+};
+
+struct ExtractionService
+{
+	int worker_count;
+	int front;
+	int has_pending;
+
+	volatile int32_t running;
+	volatile int32_t cancel;
+	volatile int32_t state;
+	volatile int32_t next_leaf;
+	volatile int32_t region_complete;
+	// Set when a leaf of the job couldn't be extracted, the job then finishes without being swapped in
+	volatile int32_t failed;
+	// Set while the workers are re-extracting edited front leaves into region_leaves rather than running a job
+	volatile int32_t editing;
+
+	struct THierarchy hierarchies[2];
+	struct ExtractionJob job;
+	struct ExtractionJob pending;
+
+	struct TetrahedronNode** leaves;
+	uint32_t leaf_count;
+	uint32_t leaf_size;
+	uint32_t uploaded_count;
+	double job_start_ms;
+
+	struct EditLayer edits;
+	struct ExtractionRegionLeaf* region_leaves;
+	uint32_t region_size;
+	struct EditBrush* pending_edits;
+	uint32_t pending_edit_count;
+	uint32_t pending_edit_size;
+
+	struct LockFreeQueue meshes;
+	struct UploadQueue uploads;
+	struct Thread coordinator;
+	struct Thread workers[THREADS_MAX];
+	struct Semaphore job_ready;
+	struct Semaphore work_ready;
+	struct Semaphore work_done;
+};
+
+int ExtractionService_init(struct ExtractionService* service, int t_resolution, int worker_count);
+void ExtractionService_destroy(struct ExtractionService* service);
+struct THierarchy* ExtractionService_front(struct ExtractionService* service);
+int ExtractionService_busy(struct ExtractionService* service);
+void ExtractionService_request(struct ExtractionService* service, vec3 focus_point);
+int ExtractionService_update(struct ExtractionService* service);
+int ExtractionService_edit(struct ExtractionService* service, struct EditBrush* brush);
+
+void _ExtractionService_dispatch(struct ExtractionService* service, struct ExtractionJob* job);
+int _ExtractionService_coordinator(void* arg);
+int _ExtractionService_worker(void* arg);
+int _ExtractionService_apply_edit(struct ExtractionService* service, struct EditBrush* brush);
+int _ExtractionService_extract_region(struct ExtractionService* service, vec3 box_min, vec3 box_max);
+void _ExtractionService_polygonize_region(struct ExtractionService* service);
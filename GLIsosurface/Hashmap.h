@@ -11,6 +11,15 @@
 #include <stdbool.h>
 #include <string.h>
 
+// Instrumentation hooks, called with the map on every key comparison and every table growth.
+// Redefine them before DECLARE_HASHMAP to count lookups; by default they compile to nothing.
+#ifndef HASHMAP_ON_PROBE
+#define HASHMAP_ON_PROBE(map)
+#endif
+#ifndef HASHMAP_ON_REHASH
+#define HASHMAP_ON_REHASH(map)
+#endif
+
 typedef enum {
 	HMDR_FAIL = 0, // returns old entry in parameter entry, lets NAME##Put()
 				   // "fail", i.e. return HMPR_FAILED
@@ -261,6 +270,7 @@ bool NAME##EnsureSize(NAME *map,                                               \
         return false;                                                          \
     }                                                                          \
     memset(&newEntries[0], 0, sizeof(NAME##Bucket) * newSize);                 \
+    HASHMAP_ON_REHASH(map);                                                    \
     map->entries = newEntries;                                                 \
     map->nth_prime = nth_prime;                                                \
     /* TODO: a failed _##NAME##PutReal(...) would corrupt the map! */          \
@@ -285,6 +295,7 @@ bool NAME##Find(const NAME *map,                                               \
     NAME##Bucket *bucket = &map->entries[((size_t)(GET_HASH((*entry)))) %      \
                                          _##NAME##Primes[map->nth_prime]];     \
     for(size_t h = 0; h < bucket->size; ++h) {                                 \
+        HASHMAP_ON_PROBE(map);                                                 \
         if((CMP((&bucket->entries[h]), (*entry))) == 0) {                      \
             *entry = &bucket->entries[h];                                      \
             return true;                                                       \
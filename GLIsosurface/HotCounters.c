@@ -0,0 +1,45 @@
+#include "HotCounters.h"
+
+void HotCounters_zero(struct HotCounters* c)
+{
+	c->label_samples = 0;
+	c->gradient_samples = 0;
+	c->edge_crossings = 0;
+	c->snapped_vertices = 0;
+	c->output_reallocs = 0;
+	c->hash_probes = 0;
+	c->hash_rehashes = 0;
+	c->pool_blocks = 0;
+	c->pruned_chunks = 0;
+	c->pruned_splits = 0;
+}
+
+void HotCounters_add(struct HotCounters* dest, struct HotCounters* src)
+{
+	dest->label_samples += src->label_samples;
+	dest->gradient_samples += src->gradient_samples;
+	dest->edge_crossings += src->edge_crossings;
+	dest->snapped_vertices += src->snapped_vertices;
+	dest->output_reallocs += src->output_reallocs;
+	dest->hash_probes += src->hash_probes;
+	dest->hash_rehashes += src->hash_rehashes;
+	dest->pool_blocks += src->pool_blocks;
+	dest->pruned_chunks += src->pruned_chunks;
+	dest->pruned_splits += src->pruned_splits;
+}
+
+void HotCounters_print(struct HotCounters* c)
+{
+	printf("Samples: %llu label, %llu gradient\n", (unsigned long long)c->label_samples, (unsigned long long)c->gradient_samples);
+	printf("Edge crossings: %llu, snapped: %llu, output reallocs: %llu\n", (unsigned long long)c->edge_crossings, (unsigned long long)c->snapped_vertices, (unsigned long long)c->output_reallocs);
+	printf("Hash probes: %llu, rehashes: %llu, pool blocks: %llu\n", (unsigned long long)c->hash_probes, (unsigned long long)c->hash_rehashes, (unsigned long long)c->pool_blocks);
+	printf("Pruned: %llu chunks, %llu splits\n", (unsigned long long)c->pruned_chunks, (unsigned long long)c->pruned_splits);
+}
+
+void HotCounters_write_json(FILE* out, struct HotCounters* c)
+{
+	fprintf(out, "\"counters\": { \"label_samples\": %llu, \"gradient_samples\": %llu, \"edge_crossings\": %llu, \"snapped_vertices\": %llu, \"output_reallocs\": %llu, \"hash_probes\": %llu, \"hash_rehashes\": %llu, \"pool_blocks\": %llu, \"pruned_chunks\": %llu, \"pruned_splits\": %llu }",
+		(unsigned long long)c->label_samples, (unsigned long long)c->gradient_samples, (unsigned long long)c->edge_crossings, (unsigned long long)c->snapped_vertices,
+		(unsigned long long)c->output_reallocs, (unsigned long long)c->hash_probes, (unsigned long long)c->hash_rehashes, (unsigned long long)c->pool_blocks,
+		(unsigned long long)c->pruned_chunks, (unsigned long long)c->pruned_splits);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "Options.h"
+
+// Event counts from the extraction hot paths, compiled in with HOT_PATH_COUNTERS.
+// Chunks count their own sampling and output growth, the diamond storage counts dictionary and pool traffic, and
+// leaves and hierarchies sum them the same way they sum UMC_Timings. With the switch off HOT_COUNT only evaluates n,
+// so locals kept just for counting don't warn as unused.
+
+#if HOT_PATH_COUNTERS
+#define HOT_COUNT(counter, n) ((counter) += (n))
+#else
+#define HOT_COUNT(counter, n) ((void)(n))
+#endif
+
+struct HotCounters
+{
+	// Sampler calls where they're made, so heightfield chunks count one per grid column and four per gradient
+	uint64_t label_samples;
+	uint64_t gradient_samples;
+	uint64_t edge_crossings;
+	uint64_t snapped_vertices;
+	uint64_t output_reallocs;
+	uint64_t hash_probes;
+	uint64_t hash_rehashes;
+	uint64_t pool_blocks;
+	uint64_t pruned_chunks;
+	uint64_t pruned_splits;
+};
+
+void HotCounters_zero(struct HotCounters* c);
+void HotCounters_add(struct HotCounters* dest, struct HotCounters* src);
+void HotCounters_print(struct HotCounters* c);
+void HotCounters_write_json(FILE* out, struct HotCounters* c);
@@ -0,0 +1,203 @@
+#include "LargeChunk.h"
+
+#include <assert.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Block corners in the order UMC_Chunk_run expects them
+static const uint32_t large_chunk_corners[8][3] =
+{
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 },
+	{ 0, 1, 0 }, { 1, 1, 0 }, { 1, 1, 1 }, { 0, 1, 1 },
+};
+
+int LargeChunk_init(struct LargeChunk* dest, uint32_t dim, int use_pem, float threshold)
+{
+	assert(dest);
+	memset(dest, 0, sizeof(struct LargeChunk));
+	if (!dim)
+	{
+		printf("Large chunks need at least one cell.\n");
+		return 1;
+	}
+
+	dest->blocks = (dim + LARGE_CHUNK_MAX_BLOCK - 1) / LARGE_CHUNK_MAX_BLOCK;
+	dest->block_dim = (dim + dest->blocks - 1) / dest->blocks;
+	dest->dim = dest->blocks * dest->block_dim;
+	dest->pem = use_pem;
+	dest->snap_threshold = threshold;
+	UMC_Timings_zero(&dest->timings);
+	HotCounters_zero(&dest->counters);
+	return 0;
+}
+
+void LargeChunk_destroy(struct LargeChunk* chunk)
+{
+	assert(chunk);
+	_LargeChunk_clear(chunk);
+	free(chunk->submeshes);
+	chunk->submeshes = 0;
+	chunk->submesh_size = 0;
+}
+
+int LargeChunk_run(struct LargeChunk* chunk, vec3* corner_verts, int silent, struct osn_context* osn)
+{
+	assert(chunk);
+	_LargeChunk_clear(chunk);
+	UMC_Timings_zero(&chunk->timings);
+	HotCounters_zero(&chunk->counters);
+
+	if (!silent)
+		printf("Running MC on large chunk.\n--dim: %u\n--blocks: %u^3 of %u\n--pem: %s\n", chunk->dim, chunk->blocks, chunk->block_dim, chunk->pem ? "true" : "false");
+
+	// The whole lattice is only a map for the block corners, it never allocates grids
+	struct UMC_Chunk whole;
+	UMC_Chunk_init(&whole, chunk->dim, 1, 0, 0);
+	_UMC_Chunk_set_lattice(&whole, corner_verts);
+
+	// Blocks share one set of output buffers and copy out what they emitted
+	uint32_t vn_size = 4096, vn_next = 0, i_size = 4096, i_next = 0;
+	vec3* vertices = malloc(vn_size * sizeof(vec3));
+	vec3* normals = malloc(vn_size * sizeof(vec3));
+	uint32_t* indexes = malloc(i_size * sizeof(uint32_t));
+	if (!vertices || !normals || !indexes)
+	{
+		printf("Failed to alloc large chunk output.\n");
+		free(vertices);
+		free(normals);
+		free(indexes);
+		return 1;
+	}
+
+	struct UMC_Chunk block;
+	UMC_Chunk_init(&block, chunk->block_dim, 1, chunk->pem, chunk->snap_threshold);
+	block.timer = chunk->timer;
+	block.v_out = &vertices;
+	block.n_out = &normals;
+	block.vn_size = &vn_size;
+	block.vn_next = &vn_next;
+	block.i_out = &indexes;
+	block.i_size = &i_size;
+	block.i_next = &i_next;
+
+	int result = 0;
+	vec3 corners[8];
+	for (uint32_t x = 0; x < chunk->blocks && !result; x++)
+	{
+		for (uint32_t y = 0; y < chunk->blocks && !result; y++)
+		{
+			for (uint32_t z = 0; z < chunk->blocks && !result; z++)
+			{
+				_LargeChunk_block_corners(&whole, x, y, z, chunk->block_dim, corners);
+				vn_next = 0;
+				i_next = 0;
+				UMC_Chunk_run(&block, corners, 1, osn);
+				UMC_Timings_add(&chunk->timings, &block.timings);
+				HotCounters_add(&chunk->counters, &block.counters);
+
+				// Pruned blocks never size their grids, ones that did and have none couldn't allocate them
+				if (!block.grid_signs && block.lattice_count)
+				{
+					result = 1;
+					break;
+				}
+				if (!vn_next)
+					continue;
+				if (_LargeChunk_add_submesh(chunk, x, y, z, vertices, normals, vn_next, indexes, i_next))
+				{
+					result = 1;
+					break;
+				}
+				chunk->v_count += block.v_count;
+				chunk->p_count += block.p_count;
+				chunk->snapped_count += block.snapped_count;
+			}
+		}
+	}
+
+	if (!silent && !result)
+		printf("Complete in %.2f ms. %llu verts, %llu prims (%llu snapped) in %u submeshes.\n\n", UMC_Timings_total(&chunk->timings),
+			(unsigned long long)chunk->v_count, (unsigned long long)chunk->p_count / 3, (unsigned long long)chunk->snapped_count, chunk->submesh_count);
+
+	UMC_Chunk_destroy(&block);
+	UMC_Chunk_destroy(&whole);
+	free(vertices);
+	free(normals);
+	free(indexes);
+	if (result)
+		_LargeChunk_clear(chunk);
+	return result;
+}
+
+void _LargeChunk_clear(struct LargeChunk* chunk)
+{
+	for (uint32_t i = 0; i < chunk->submesh_count; i++)
+	{
+		free(chunk->submeshes[i].vertices);
+		free(chunk->submeshes[i].normals);
+		free(chunk->submeshes[i].indexes);
+	}
+	chunk->submesh_count = 0;
+	chunk->v_count = 0;
+	chunk->p_count = 0;
+	chunk->snapped_count = 0;
+}
+
+void _LargeChunk_block_corners(struct UMC_Chunk* whole, uint32_t x, uint32_t y, uint32_t z, uint32_t block_dim, vec3* out)
+{
+	// Corners are points of the whole lattice, so neighbouring blocks agree on the corners they share. Evaluated the
+	// way _UMC_Chunk_lattice_point does, which is inlined into the chunk kernels.
+	vec3* l = whole->lattice;
+	for (int i = 0; i < 8; i++)
+	{
+		const uint32_t* c = large_chunk_corners[i];
+		float fx = (float)((x + c[0]) * block_dim), fy = (float)((y + c[1]) * block_dim), fz = (float)((z + c[2]) * block_dim);
+		for (int j = 0; j < 3; j++)
+		{
+			float origin = l[0][j] + fx * l[1][j] + fy * (l[2][j] + fx * l[4][j]);
+			float step = l[3][j] + fx * l[5][j] + fy * (l[6][j] + fx * l[7][j]);
+			out[i][j] = step * fz + origin;
+		}
+	}
+}
+
+int _LargeChunk_add_submesh(struct LargeChunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3* vertices, vec3* normals, uint32_t v_count, uint32_t* indexes, uint32_t i_count)
+{
+	if (chunk->submesh_count == chunk->submesh_size)
+	{
+		uint32_t size = chunk->submesh_size ? chunk->submesh_size * 2 : 16;
+		struct Submesh* submeshes = realloc(chunk->submeshes, size * sizeof(struct Submesh));
+		if (!submeshes)
+		{
+			printf("Failed to grow large chunk submeshes.\n");
+			return 1;
+		}
+		chunk->submeshes = submeshes;
+		chunk->submesh_size = size;
+	}
+
+	// The shared buffers only grow, so each submesh gets an exact-size copy
+	struct Submesh* submesh = chunk->submeshes + chunk->submesh_count;
+	submesh->block[0] = x;
+	submesh->block[1] = y;
+	submesh->block[2] = z;
+	submesh->v_count = v_count;
+	submesh->i_count = i_count;
+	submesh->vertices = malloc(v_count * sizeof(vec3));
+	submesh->normals = malloc(v_count * sizeof(vec3));
+	submesh->indexes = malloc((i_count ? i_count : 1) * sizeof(uint32_t));
+	if (!submesh->vertices || !submesh->normals || !submesh->indexes)
+	{
+		printf("Failed to alloc large chunk submesh.\n");
+		free(submesh->vertices);
+		free(submesh->normals);
+		free(submesh->indexes);
+		return 1;
+	}
+	memcpy(submesh->vertices, vertices, v_count * sizeof(vec3));
+	memcpy(submesh->normals, normals, v_count * sizeof(vec3));
+	memcpy(submesh->indexes, indexes, i_count * sizeof(uint32_t));
+	chunk->submesh_count++;
+	return 0;
+}
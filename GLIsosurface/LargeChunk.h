@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+
+#include "UniformMarchingCubes.h"
+
+// One lattice meshed as a set of submeshes, for dims a single chunk can't hold: its grids cost about 160 bytes per
+// lattice point and its output indexes are 32-bit.
+// The lattice is cut into cubic blocks of at most LARGE_CHUNK_MAX_BLOCK cells per axis, rounding dim up to a whole
+// number of blocks. Blocks run one at a time through a reused UMC_Chunk whose corners come from the whole lattice's
+// map, so memory stays at one block's grids. Every block that emits anything keeps its output as a submesh with its own
+// vertices and 32-bit indexes. Neighbouring blocks share their boundary points and both emit the vertices on them;
+// with pem, points on block faces aren't snapped, as on any chunk's border.
+
+// A block's grids stay under 3 GB and its vertices well under 2^32
+#define LARGE_CHUNK_MAX_BLOCK 255
+
+struct Submesh
+{
+	uint32_t block[3];
+	vec3* vertices;
+	vec3* normals;
+	uint32_t* indexes;
+	uint32_t v_count;
+	uint32_t i_count;
+};
+
+struct LargeChunk
+{
+	// Cells per axis, a whole number of blocks
+	uint32_t dim;
+	uint32_t blocks;
+	uint32_t block_dim;
+	int pem;
+	float snap_threshold;
+	float timer;
+
+	struct Submesh* submeshes;
+	uint32_t submesh_count;
+	uint32_t submesh_size;
+	uint64_t v_count;
+	uint64_t p_count;
+	uint64_t snapped_count;
+
+	struct UMC_Timings timings;
+	struct HotCounters counters;
+};
+
+int LargeChunk_init(struct LargeChunk* dest, uint32_t dim, int use_pem, float threshold);
+void LargeChunk_destroy(struct LargeChunk* chunk);
+int LargeChunk_run(struct LargeChunk* chunk, vec3* corner_verts, int silent, struct osn_context* osn);
+void _LargeChunk_clear(struct LargeChunk* chunk);
+void _LargeChunk_block_corners(struct UMC_Chunk* whole, uint32_t x, uint32_t y, uint32_t z, uint32_t block_dim, vec3* out);
+int _LargeChunk_add_submesh(struct LargeChunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3* vertices, vec3* normals, uint32_t v_count, uint32_t* indexes, uint32_t i_count);
@@ -0,0 +1,89 @@
+#include "LockFreeQueue.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+int LockFreeQueue_init(struct LockFreeQueue* q, uint32_t capacity)
+{
+	assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+	q->cells = malloc(capacity * sizeof(struct LockFreeQueueCell));
+	if (!q->cells)
+		return 1;
+	for (uint32_t i = 0; i < capacity; i++)
+	{
+		q->cells[i].sequence = (int32_t)i;
+		q->cells[i].data = 0;
+	}
+	q->mask = capacity - 1;
+	q->enqueue_pos = 0;
+	q->dequeue_pos = 0;
+	return 0;
+}
+
+void LockFreeQueue_destroy(struct LockFreeQueue* q)
+{
+	free(q->cells);
+	q->cells = 0;
+	q->mask = 0;
+}
+
+int LockFreeQueue_push(struct LockFreeQueue* q, void* data)
+{
+	struct LockFreeQueueCell* cell;
+	int32_t pos = Atomic_load(&q->enqueue_pos);
+	for (;;)
+	{
+		cell = q->cells + ((uint32_t)pos & q->mask);
+		int32_t seq = Atomic_load(&cell->sequence);
+		int32_t dif = (int32_t)((uint32_t)seq - (uint32_t)pos);
+		if (dif == 0)
+		{
+			int32_t prev = Atomic_cas(&q->enqueue_pos, pos, (int32_t)((uint32_t)pos + 1));
+			if (prev == pos)
+				break;
+			pos = prev;
+		}
+		else if (dif < 0)
+			return 1; // Full
+		else
+			pos = Atomic_load(&q->enqueue_pos);
+	}
+
+	cell->data = data;
+	Atomic_store(&cell->sequence, (int32_t)((uint32_t)pos + 1));
+	return 0;
+}
+
+int LockFreeQueue_pop(struct LockFreeQueue* q, void** out)
+{
+	struct LockFreeQueueCell* cell;
+	int32_t pos = Atomic_load(&q->dequeue_pos);
+	for (;;)
+	{
+		cell = q->cells + ((uint32_t)pos & q->mask);
+		int32_t seq = Atomic_load(&cell->sequence);
+		int32_t dif = (int32_t)((uint32_t)seq - ((uint32_t)pos + 1));
+		if (dif == 0)
+		{
+			int32_t prev = Atomic_cas(&q->dequeue_pos, pos, (int32_t)((uint32_t)pos + 1));
+			if (prev == pos)
+				break;
+			pos = prev;
+		}
+		else if (dif < 0)
+			return 1; // Empty
+		else
+			pos = Atomic_load(&q->dequeue_pos);
+	}
+
+	*out = cell->data;
+	Atomic_store(&cell->sequence, (int32_t)((uint32_t)pos + q->mask + 1));
+	return 0;
+}
+
+uint32_t LockFreeQueue_size(struct LockFreeQueue* q)
+{
+	// Only a snapshot; both ends may be moving
+	int32_t size = (int32_t)((uint32_t)Atomic_load(&q->enqueue_pos) - (uint32_t)Atomic_load(&q->dequeue_pos));
+	return size > 0 ? (uint32_t)size : 0;
+}
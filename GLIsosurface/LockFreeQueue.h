@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include "Threading.h"
+
+// Bounded multi-producer/multi-consumer queue of pointers (Vyukov's sequence-numbered ring).
+// Capacity must be a power of two. Neither side ever blocks: push fails when full and pop fails when empty.
+
+struct LockFreeQueueCell
+{
+	volatile int32_t sequence;
+	void* data;
+};
+
+struct LockFreeQueue
+{
+	struct LockFreeQueueCell* cells;
+	uint32_t mask;
+	char pad0[64];
+	volatile int32_t enqueue_pos;
+	char pad1[64];
+	volatile int32_t dequeue_pos;
+	char pad2[64];
+};
+
+int LockFreeQueue_init(struct LockFreeQueue* q, uint32_t capacity);
+void LockFreeQueue_destroy(struct LockFreeQueue* q);
+int LockFreeQueue_push(struct LockFreeQueue* q, void* data);
+int LockFreeQueue_pop(struct LockFreeQueue* q, void** out);
+uint32_t LockFreeQueue_size(struct LockFreeQueue* q);
@@ -0,0 +1,491 @@
+#include "MeshArena.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Options.h"
+
+int MeshRangeAllocator_init(struct MeshRangeAllocator* a, uint32_t capacity)
+{
+	a->capacity = capacity;
+	a->free_size = 64;
+	a->free_list = malloc(a->free_size * sizeof(struct MeshRange));
+	if (!a->free_list)
+	{
+		a->free_size = 0;
+		return 1;
+	}
+	MeshRangeAllocator_reset(a);
+	return 0;
+}
+
+void MeshRangeAllocator_destroy(struct MeshRangeAllocator* a)
+{
+	free(a->free_list);
+	a->free_list = 0;
+	a->free_count = 0;
+	a->free_size = 0;
+	a->capacity = 0;
+	a->used = 0;
+}
+
+void MeshRangeAllocator_reset(struct MeshRangeAllocator* a)
+{
+	a->used = 0;
+	a->free_count = 1;
+	a->free_list[0].offset = 0;
+	a->free_list[0].count = a->capacity;
+}
+
+int MeshRangeAllocator_alloc(struct MeshRangeAllocator* a, uint32_t count, uint32_t* out_offset)
+{
+	if (count == 0)
+	{
+		*out_offset = 0;
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < a->free_count; i++)
+	{
+		struct MeshRange* r = a->free_list + i;
+		if (r->count < count)
+			continue;
+
+		*out_offset = r->offset;
+		a->used += count;
+		if (r->count == count)
+		{
+			memmove(r, r + 1, (a->free_count - i - 1) * sizeof(struct MeshRange));
+			a->free_count--;
+		}
+		else
+		{
+			r->offset += count;
+			r->count -= count;
+		}
+		return 0;
+	}
+
+	return 1;
+}
+
+int MeshRangeAllocator_free(struct MeshRangeAllocator* a, uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+		return 0;
+	assert(offset + count <= a->capacity);
+
+	// Find the first free range past the one being released
+	uint32_t i = 0;
+	while (i < a->free_count && a->free_list[i].offset < offset)
+		i++;
+
+	int merge_prev = i > 0 && a->free_list[i - 1].offset + a->free_list[i - 1].count == offset;
+	int merge_next = i < a->free_count && offset + count == a->free_list[i].offset;
+	assert(i == 0 || a->free_list[i - 1].offset + a->free_list[i - 1].count <= offset);
+	assert(i == a->free_count || offset + count <= a->free_list[i].offset);
+
+	a->used -= count;
+	if (merge_prev && merge_next)
+	{
+		a->free_list[i - 1].count += count + a->free_list[i].count;
+		memmove(a->free_list + i, a->free_list + i + 1, (a->free_count - i - 1) * sizeof(struct MeshRange));
+		a->free_count--;
+	}
+	else if (merge_prev)
+	{
+		a->free_list[i - 1].count += count;
+	}
+	else if (merge_next)
+	{
+		a->free_list[i].offset = offset;
+		a->free_list[i].count += count;
+	}
+	else
+	{
+		if (a->free_count == a->free_size)
+		{
+			struct MeshRange* new_list = realloc(a->free_list, a->free_size * 2 * sizeof(struct MeshRange));
+			if (!new_list)
+			{
+				a->used += count;
+				return 1;
+			}
+			a->free_list = new_list;
+			a->free_size *= 2;
+		}
+		memmove(a->free_list + i + 1, a->free_list + i, (a->free_count - i) * sizeof(struct MeshRange));
+		a->free_list[i].offset = offset;
+		a->free_list[i].count = count;
+		a->free_count++;
+	}
+
+	return 0;
+}
+
+int MeshDrawList_init(struct MeshDrawList* list, uint32_t size)
+{
+	list->count = 0;
+	list->size = size;
+	list->counts = malloc(size * sizeof(GLsizei));
+	list->offsets = malloc(size * sizeof(void*));
+	list->base_vertices = malloc(size * sizeof(GLint));
+	list->commands = malloc(size * sizeof(struct MeshDrawCommand));
+	list->commands_uploaded = 0;
+	if (!list->counts || !list->offsets || !list->base_vertices || !list->commands)
+	{
+		MeshDrawList_destroy(list);
+		return 1;
+	}
+	return 0;
+}
+
+void MeshDrawList_destroy(struct MeshDrawList* list)
+{
+	free(list->counts);
+	free(list->offsets);
+	free(list->base_vertices);
+	free(list->commands);
+	list->counts = 0;
+	list->offsets = 0;
+	list->base_vertices = 0;
+	list->commands = 0;
+	list->count = 0;
+	list->size = 0;
+}
+
+int MeshDrawList_add(struct MeshDrawList* list, struct MeshAllocation* alloc, int index_size)
+{
+	if (list->count == list->size)
+	{
+		uint32_t new_size = list->size ? list->size * 2 : 256;
+		GLsizei* counts = realloc(list->counts, new_size * sizeof(GLsizei));
+		if (counts)
+			list->counts = counts;
+		const void** offsets = realloc(list->offsets, new_size * sizeof(void*));
+		if (offsets)
+			list->offsets = offsets;
+		GLint* base_vertices = realloc(list->base_vertices, new_size * sizeof(GLint));
+		if (base_vertices)
+			list->base_vertices = base_vertices;
+		struct MeshDrawCommand* commands = realloc(list->commands, new_size * sizeof(struct MeshDrawCommand));
+		if (commands)
+			list->commands = commands;
+
+		// The arrays that did grow are still valid at the old size, which only moves once all of them have
+		if (!counts || !offsets || !base_vertices || !commands)
+			return 1;
+		list->size = new_size;
+	}
+
+	// Contiguous ranges could be merged here, but base vertices differ per leaf so there's rarely anything to gain
+	list->counts[list->count] = (GLsizei)alloc->i_count;
+	list->offsets[list->count] = (const void*)((uintptr_t)alloc->i_offset * index_size);
+	list->base_vertices[list->count] = (GLint)alloc->v_offset;
+
+	struct MeshDrawCommand* command = list->commands + list->count;
+	command->count = alloc->i_count;
+	command->instance_count = 1;
+	command->first_index = alloc->i_offset;
+	command->base_vertex = (GLint)alloc->v_offset;
+	command->base_instance = alloc->slot;
+	list->count++;
+	list->commands_uploaded = 0;
+	return 0;
+}
+
+void MeshAllocation_init(struct MeshAllocation* alloc)
+{
+	alloc->page = -1;
+	alloc->v_offset = 0;
+	alloc->v_count = 0;
+	alloc->i_offset = 0;
+	alloc->i_count = 0;
+	alloc->slot = 0;
+}
+
+int MeshArena_init(struct MeshArena* arena, uint32_t page_vertices, uint32_t page_indexes, int gl_enabled)
+{
+	arena->gl_enabled = gl_enabled;
+	arena->compact = COMPACT_VERTICES;
+	arena->page_count = 0;
+	arena->page_vertices = page_vertices;
+	arena->page_indexes = page_indexes;
+	arena->draw_calls = 0;
+	return _MeshArena_add_page(arena, arena->compact ? 2 : 4);
+}
+
+void MeshArena_destroy(struct MeshArena* arena)
+{
+	for (int i = 0; i < arena->page_count; i++)
+	{
+		struct MeshArenaPage* page = arena->pages + i;
+		MeshRangeAllocator_destroy(&page->vertices);
+		MeshRangeAllocator_destroy(&page->indexes);
+		MeshRangeAllocator_destroy(&page->slots);
+		MeshDrawList_destroy(&page->draws);
+		if (page->gl_init)
+		{
+			GLuint buffers[] = { page->v_vbo, page->n_vbo, page->ibo, page->bounds_vbo, page->dibo };
+			glDeleteVertexArrays(1, &page->vao);
+			glDeleteBuffers(5, buffers);
+		}
+	}
+	arena->page_count = 0;
+}
+
+void MeshArena_reset(struct MeshArena* arena)
+{
+	for (int i = 0; i < arena->page_count; i++)
+	{
+		MeshRangeAllocator_reset(&arena->pages[i].vertices);
+		MeshRangeAllocator_reset(&arena->pages[i].indexes);
+		MeshRangeAllocator_reset(&arena->pages[i].slots);
+		arena->pages[i].draws.count = 0;
+	}
+}
+
+int MeshArena_alloc(struct MeshArena* arena, uint32_t v_count, uint32_t i_count, int index_size, struct MeshAllocation* out)
+{
+	MeshAllocation_init(out);
+	if (v_count > arena->page_vertices || i_count > arena->page_indexes)
+	{
+		printf("Mesh too large for arena page (%u verts, %u indexes).\n", v_count, i_count);
+		return 1;
+	}
+
+	for (int i = 0; i <= arena->page_count; i++)
+	{
+		if (i == arena->page_count && _MeshArena_add_page(arena, index_size))
+			return 1;
+
+		struct MeshArenaPage* page = arena->pages + i;
+		if (page->index_size != index_size)
+			continue;
+		if (MeshRangeAllocator_alloc(&page->vertices, v_count, &out->v_offset))
+			continue;
+		if (MeshRangeAllocator_alloc(&page->indexes, i_count, &out->i_offset))
+		{
+			MeshRangeAllocator_free(&page->vertices, out->v_offset, v_count);
+			continue;
+		}
+		if (arena->compact && MeshRangeAllocator_alloc(&page->slots, 1, &out->slot))
+		{
+			MeshRangeAllocator_free(&page->vertices, out->v_offset, v_count);
+			MeshRangeAllocator_free(&page->indexes, out->i_offset, i_count);
+			continue;
+		}
+
+		out->page = i;
+		out->v_count = v_count;
+		out->i_count = i_count;
+		return 0;
+	}
+
+	return 1;
+}
+
+void MeshArena_free(struct MeshArena* arena, struct MeshAllocation* alloc)
+{
+	if (alloc->page < 0)
+		return;
+
+	struct MeshArenaPage* page = arena->pages + alloc->page;
+	MeshRangeAllocator_free(&page->vertices, alloc->v_offset, alloc->v_count);
+	MeshRangeAllocator_free(&page->indexes, alloc->i_offset, alloc->i_count);
+	if (arena->compact)
+		MeshRangeAllocator_free(&page->slots, alloc->slot, 1);
+	MeshAllocation_init(alloc);
+}
+
+void MeshArena_upload(struct MeshArena* arena, struct MeshAllocation* alloc, vec3* vertices, vec3* normals, uint32_t* indexes)
+{
+	if (!arena->gl_enabled || alloc->page < 0)
+		return;
+
+	struct MeshArenaPage* page = arena->pages + alloc->page;
+	glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, alloc->v_offset * sizeof(vec3), alloc->v_count * sizeof(vec3), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, page->n_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, alloc->v_offset * sizeof(vec3), alloc->v_count * sizeof(vec3), normals);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, alloc->i_offset * sizeof(uint32_t), alloc->i_count * sizeof(uint32_t), indexes);
+}
+
+void MeshArena_upload_compact(struct MeshArena* arena, struct MeshAllocation* alloc, struct CompactVertex* vertices, void* indexes, struct CompactBounds* bounds)
+{
+	if (!arena->gl_enabled || alloc->page < 0)
+		return;
+
+	struct MeshArenaPage* page = arena->pages + alloc->page;
+	glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, alloc->v_offset * sizeof(struct CompactVertex), alloc->v_count * sizeof(struct CompactVertex), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, page->bounds_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, alloc->slot * sizeof(struct CompactBounds), sizeof(struct CompactBounds), bounds);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, alloc->i_offset * page->index_size, alloc->i_count * page->index_size, indexes);
+}
+
+void MeshArena_usage(struct MeshArena* arena, uint32_t* vertex_bytes, uint32_t* index_bytes)
+{
+	uint32_t stride = arena->compact ? sizeof(struct CompactVertex) : sizeof(vec3) * 2;
+	*vertex_bytes = 0;
+	*index_bytes = 0;
+	for (int i = 0; i < arena->page_count; i++)
+	{
+		struct MeshArenaPage* page = arena->pages + i;
+		*vertex_bytes += page->vertices.used * stride;
+		*index_bytes += page->indexes.used * page->index_size;
+		if (arena->compact)
+			*vertex_bytes += page->slots.used * sizeof(struct CompactBounds);
+	}
+}
+
+void MeshArena_begin_draws(struct MeshArena* arena)
+{
+	for (int i = 0; i < arena->page_count; i++)
+		arena->pages[i].draws.count = 0;
+}
+
+int MeshArena_add_draw(struct MeshArena* arena, struct MeshAllocation* alloc)
+{
+	if (alloc->page < 0 || alloc->i_count == 0)
+		return 0;
+	return MeshDrawList_add(&arena->pages[alloc->page].draws, alloc, arena->pages[alloc->page].index_size);
+}
+
+void MeshArena_draw(struct MeshArena* arena)
+{
+	arena->draw_calls = 0;
+	if (!arena->gl_enabled)
+		return;
+
+	for (int i = 0; i < arena->page_count; i++)
+	{
+		struct MeshArenaPage* page = arena->pages + i;
+		if (!page->draws.count)
+			continue;
+
+		GLenum index_type = page->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		glBindVertexArray(page->vao);
+		if (arena->compact)
+		{
+			// Commands only change when the draw list does, not per pass
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, page->dibo);
+			if (!page->draws.commands_uploaded)
+			{
+				glBufferData(GL_DRAW_INDIRECT_BUFFER, page->draws.count * sizeof(struct MeshDrawCommand), page->draws.commands, GL_STREAM_DRAW);
+				page->draws.commands_uploaded = 1;
+			}
+			glMultiDrawElementsIndirect(GL_TRIANGLES, index_type, NULL, page->draws.count, 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		else
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, page->draws.counts, index_type, page->draws.offsets, page->draws.count, page->draws.base_vertices);
+		arena->draw_calls++;
+	}
+	glBindVertexArray(0);
+}
+
+int _MeshArena_add_page(struct MeshArena* arena, int index_size)
+{
+	if (arena->page_count == MESH_ARENA_MAX_PAGES)
+	{
+		printf("Mesh arena is out of pages.\n");
+		return 1;
+	}
+
+	struct MeshArenaPage* page = arena->pages + arena->page_count;
+	page->gl_init = 0;
+	page->index_size = index_size;
+	page->n_vbo = 0;
+	page->bounds_vbo = 0;
+	page->dibo = 0;
+	if (MeshRangeAllocator_init(&page->vertices, arena->page_vertices))
+		return 1;
+	if (MeshRangeAllocator_init(&page->indexes, arena->page_indexes))
+	{
+		MeshRangeAllocator_destroy(&page->vertices);
+		return 1;
+	}
+	if (MeshRangeAllocator_init(&page->slots, arena->compact ? MESH_ARENA_PAGE_DRAWS : 1))
+	{
+		MeshRangeAllocator_destroy(&page->vertices);
+		MeshRangeAllocator_destroy(&page->indexes);
+		return 1;
+	}
+	if (MeshDrawList_init(&page->draws, 1024))
+	{
+		MeshRangeAllocator_destroy(&page->vertices);
+		MeshRangeAllocator_destroy(&page->indexes);
+		MeshRangeAllocator_destroy(&page->slots);
+		return 1;
+	}
+
+	if (arena->gl_enabled && arena->compact)
+	{
+		// Storage is allocated once per page; leaves only ever write into it with glBufferSubData
+		glGenBuffers(1, &page->v_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+		glBufferData(GL_ARRAY_BUFFER, arena->page_vertices * sizeof(struct CompactVertex), NULL, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &page->bounds_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, page->bounds_vbo);
+		glBufferData(GL_ARRAY_BUFFER, MESH_ARENA_PAGE_DRAWS * sizeof(struct CompactBounds), NULL, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &page->ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, arena->page_indexes * index_size, NULL, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &page->dibo);
+
+		glGenVertexArrays(1, &page->vao);
+		glBindVertexArray(page->vao);
+		glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(struct CompactVertex), (void*)0);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(struct CompactVertex), (void*)offsetof(struct CompactVertex, normal));
+		// One bounds entry per draw, picked by the command's base instance
+		glBindBuffer(GL_ARRAY_BUFFER, page->bounds_vbo);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(struct CompactBounds), (void*)offsetof(struct CompactBounds, origin));
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(struct CompactBounds), (void*)offsetof(struct CompactBounds, extent));
+		glVertexAttribDivisor(2, 1);
+		glVertexAttribDivisor(3, 1);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+		for (GLuint a = 0; a < 4; a++)
+			glEnableVertexAttribArray(a);
+		glBindVertexArray(0);
+		page->gl_init = 1;
+	}
+	else if (arena->gl_enabled)
+	{
+		// Storage is allocated once per page; leaves only ever write into it with glBufferSubData
+		glGenBuffers(1, &page->v_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+		glBufferData(GL_ARRAY_BUFFER, arena->page_vertices * sizeof(vec3), NULL, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &page->n_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, page->n_vbo);
+		glBufferData(GL_ARRAY_BUFFER, arena->page_vertices * sizeof(vec3), NULL, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &page->ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, arena->page_indexes * index_size, NULL, GL_DYNAMIC_DRAW);
+
+		glGenVertexArrays(1, &page->vao);
+		glBindVertexArray(page->vao);
+		glBindBuffer(GL_ARRAY_BUFFER, page->v_vbo);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+		glBindBuffer(GL_ARRAY_BUFFER, page->n_vbo);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glBindVertexArray(0);
+		page->gl_init = 1;
+	}
+
+	arena->page_count++;
+	return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <gl/glew.h>
+#define GLFW_DLL
+#include <GLFW/glfw3.h>
+#include <cglm\cglm.h>
+#include <stdint.h>
+#include "CompactVertex.h"
+
+// Leaf meshes are suballocated out of a handful of large shared buffers instead of owning their own VAO and VBOs.
+// Each page holds one VAO, a position VBO, a normal VBO and an index buffer. Indexes stay local to their mesh and
+// are rebased at draw time through the base vertex, so the whole page can be drawn with a single multi-draw call.
+// The range allocators and the draw lists are plain CPU structures, so they work without a GL context when
+// gl_enabled is off.
+// Compact arenas store interleaved CompactVertex data with mostly 16-bit indexes. Each leaf also takes a slot in
+// the page's bounds buffer, and pages are drawn with a multi-draw-indirect whose base instance selects the slot.
+
+#define MESH_ARENA_MAX_PAGES 16
+#define MESH_ARENA_PAGE_VERTICES (1 << 20)
+#define MESH_ARENA_PAGE_INDEXES (1 << 22)
+#define MESH_ARENA_PAGE_DRAWS (1 << 16)
+
+struct MeshRange
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+// First-fit allocator over [0, capacity). The free list is kept sorted by offset so neighbours can be coalesced.
+struct MeshRangeAllocator
+{
+	uint32_t capacity;
+	uint32_t used;
+	uint32_t free_count;
+	uint32_t free_size;
+	struct MeshRange* free_list;
+};
+
+struct MeshAllocation
+{
+	int page;
+	uint32_t v_offset;
+	uint32_t v_count;
+	uint32_t i_offset;
+	uint32_t i_count;
+	uint32_t slot;
+};
+
+// Same layout as the GL indirect elements command
+struct MeshDrawCommand
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+struct MeshDrawList
+{
+	uint32_t count;
+	uint32_t size;
+	GLsizei* counts;
+	const void** offsets;
+	GLint* base_vertices;
+	struct MeshDrawCommand* commands;
+	int commands_uploaded;
+};
+
+struct MeshArenaPage
+{
+	int gl_init : 1;
+	int index_size;
+	struct MeshRangeAllocator vertices;
+	struct MeshRangeAllocator indexes;
+	struct MeshRangeAllocator slots;
+	struct MeshDrawList draws;
+
+	GLuint vao;
+	GLuint v_vbo;
+	GLuint n_vbo;
+	GLuint ibo;
+	GLuint bounds_vbo;
+	GLuint dibo;
+};
+
+struct MeshArena
+{
+	int gl_enabled : 1;
+	int compact : 1;
+	int page_count;
+	uint32_t page_vertices;
+	uint32_t page_indexes;
+	uint32_t draw_calls;
+	struct MeshArenaPage pages[MESH_ARENA_MAX_PAGES];
+};
+
+int MeshRangeAllocator_init(struct MeshRangeAllocator* a, uint32_t capacity);
+void MeshRangeAllocator_destroy(struct MeshRangeAllocator* a);
+void MeshRangeAllocator_reset(struct MeshRangeAllocator* a);
+int MeshRangeAllocator_alloc(struct MeshRangeAllocator* a, uint32_t count, uint32_t* out_offset);
+int MeshRangeAllocator_free(struct MeshRangeAllocator* a, uint32_t offset, uint32_t count);
+
+int MeshDrawList_init(struct MeshDrawList* list, uint32_t size);
+void MeshDrawList_destroy(struct MeshDrawList* list);
+int MeshDrawList_add(struct MeshDrawList* list, struct MeshAllocation* alloc, int index_size);
+
+void MeshAllocation_init(struct MeshAllocation* alloc);
+
+int MeshArena_init(struct MeshArena* arena, uint32_t page_vertices, uint32_t page_indexes, int gl_enabled);
+void MeshArena_destroy(struct MeshArena* arena);
+void MeshArena_reset(struct MeshArena* arena);
+int MeshArena_alloc(struct MeshArena* arena, uint32_t v_count, uint32_t i_count, int index_size, struct MeshAllocation* out);
+void MeshArena_free(struct MeshArena* arena, struct MeshAllocation* alloc);
+void MeshArena_upload(struct MeshArena* arena, struct MeshAllocation* alloc, vec3* vertices, vec3* normals, uint32_t* indexes);
+void MeshArena_upload_compact(struct MeshArena* arena, struct MeshAllocation* alloc, struct CompactVertex* vertices, void* indexes, struct CompactBounds* bounds);
+void MeshArena_usage(struct MeshArena* arena, uint32_t* vertex_bytes, uint32_t* index_bytes);
+void MeshArena_begin_draws(struct MeshArena* arena);
+int MeshArena_add_draw(struct MeshArena* arena, struct MeshAllocation* alloc);
+void MeshArena_draw(struct MeshArena* arena);
+
+int _MeshArena_add_page(struct MeshArena* arena, int index_size);
@@ -32,11 +32,25 @@
 #define NORM_CONSTANT_3D (103.0)
 #define NORM_CONSTANT_4D (30.0)
 
+#define STRETCH_CONSTANT_2DF (-0.211324865f)
+#define SQUISH_CONSTANT_2DF  (0.366025404f)
+#define STRETCH_CONSTANT_3DF (-1.0f / 6.0f)
+#define SQUISH_CONSTANT_3DF  (1.0f / 3.0f)
+#define NORM_CONSTANT_2DF (47.0f)
+#define NORM_CONSTANT_3DF (103.0f)
+
 #define DEFAULT_SEED (0LL)
 
 struct osn_context {
 	int16_t *perm;
 	int16_t *permGradIndex3D;
+
+	/*
+	* Byte copies of the tables for the float API, repeated twice so a hash step is
+	* perm8[perm8[x & 0xFF] + (y & 0xFF)] without masking the sum.
+	*/
+	uint8_t perm8[512];
+	uint8_t permGradIndex3D8[512];
 };
 
 #define ARRAYSIZE(x) (sizeof((x)) / sizeof((x)[0]))
@@ -94,6 +108,25 @@ static const signed char gradients4D[] = {
 	-3, -1, -1, -1,     -1, -3, -1, -1,     -1, -1, -3, -1,     -1, -1, -1, -3,
 };
 
+/* The 2D and 3D gradients as floats, so the float API never converts per lookup. */
+static const float gradients2DF[] = {
+	5,  2,    2,  5,
+	-5,  2,   -2,  5,
+	5, -2,    2, -5,
+	-5, -2,   -2, -5,
+};
+
+static const float gradients3DF[] = {
+	-11,  4,  4,     -4,  11,  4,    -4,  4,  11,
+	11,  4,  4,      4,  11,  4,     4,  4,  11,
+	-11, -4,  4,     -4, -11,  4,    -4, -4,  11,
+	11, -4,  4,      4, -11,  4,     4, -4,  11,
+	-11,  4, -4,     -4,  11, -4,    -4,  4, -11,
+	11,  4, -4,      4,  11, -4,     4,  4, -11,
+	-11, -4, -4,     -4, -11, -4,    -4, -4, -11,
+	11, -4, -4,      4, -11, -4,     4, -4, -11,
+};
+
 static double extrapolate2(struct osn_context *ctx, int xsb, int ysb, double dx, double dy)
 {
 	int16_t *perm = ctx->perm;
@@ -127,6 +160,63 @@ static INLINE int fastFloor(double x) {
 	return x < xi ? xi - 1 : xi;
 }
 
+static INLINE float extrapolate2f(struct osn_context *ctx, int xsb, int ysb, float dx, float dy)
+{
+	const uint8_t *perm = ctx->perm8;
+	int index = perm[perm[xsb & 0xFF] + (ysb & 0xFF)] & 0x0E;
+	return gradients2DF[index] * dx
+		+ gradients2DF[index + 1] * dy;
+}
+
+static INLINE float extrapolate3f(struct osn_context *ctx, int xsb, int ysb, int zsb, float dx, float dy, float dz)
+{
+	const uint8_t *perm = ctx->perm8;
+	int index = ctx->permGradIndex3D8[perm[perm[xsb & 0xFF] + (ysb & 0xFF)] + (zsb & 0xFF)];
+	return gradients3DF[index] * dx
+		+ gradients3DF[index + 1] * dy
+		+ gradients3DF[index + 2] * dz;
+}
+
+/*
+* Lattice offsets that decorrelate the channels of the multi-channel API. Hashing a shifted
+* lattice is the same noise translated far away, so channel 0 matches open_simplex_noise3f.
+*/
+static const uint8_t channelOffsets3D[OSN_MAX_CHANNELS][3] = {
+	{ 0, 0, 0 },
+	{ 97, 59, 173 },
+	{ 43, 191, 11 },
+	{ 211, 137, 79 },
+};
+
+static INLINE void accumulate3f(struct osn_context *ctx, int channels, float *out, float weight, int xsb, int ysb, int zsb, float dx, float dy, float dz)
+{
+	const uint8_t *perm = ctx->perm8;
+	int c;
+
+	for (c = 0; c < channels; c++) {
+		const uint8_t *offset = channelOffsets3D[c];
+		int index = ctx->permGradIndex3D8[perm[perm[(xsb + offset[0]) & 0xFF] + ((ysb + offset[1]) & 0xFF)] + ((zsb + offset[2]) & 0xFF)];
+		out[c] += weight * (gradients3DF[index] * dx
+			+ gradients3DF[index + 1] * dy
+			+ gradients3DF[index + 2] * dz);
+	}
+}
+
+static INLINE int fastFloorf(float x) {
+	int xi = (int)x;
+	return x < xi ? xi - 1 : xi;
+}
+
+static void fill_byte_tables(struct osn_context *ctx)
+{
+	int i;
+
+	for (i = 0; i < 512; i++) {
+		ctx->perm8[i] = (uint8_t)ctx->perm[i & 0xFF];
+		ctx->permGradIndex3D8[i] = (uint8_t)ctx->permGradIndex3D[i & 0xFF];
+	}
+}
+
 static int allocate_perm(struct osn_context *ctx, int nperm, int ngrad)
 {
 	if (ctx->perm)
@@ -157,6 +247,7 @@ int open_simplex_noise_init_perm(struct osn_context *ctx, int16_t p[], int nelem
 		/* Since 3D has 24 gradients, simple bitmask won't work, so precompute modulo array. */
 		ctx->permGradIndex3D[i] = (int16_t)((ctx->perm[i] % (ARRAYSIZE(gradients3D) / 3)) * 3);
 	}
+	fill_byte_tables(ctx);
 	return 0;
 }
 
@@ -203,6 +294,7 @@ int open_simplex_noise(int64_t seed, struct osn_context **ctx)
 		permGradIndex3D[i] = (short)((perm[i] % (ARRAYSIZE(gradients3D) / 3)) * 3);
 		source[r] = source[i];
 	}
+	fill_byte_tables(*ctx);
 	return 0;
 }
 
@@ -2430,3 +2522,1538 @@ double open_simplex_noise3_oct(struct osn_context* ctx, double x, double y, doub
 
 	return noise;
 }
+
+float open_simplex_noise2f(struct osn_context *ctx, float x, float y)
+{
+
+	/* Place input coordinates onto grid. */
+	float stretchOffset = (x + y) * STRETCH_CONSTANT_2DF;
+	float xs = x + stretchOffset;
+	float ys = y + stretchOffset;
+
+	/* Floor to get grid coordinates of rhombus (stretched square) super-cell origin. */
+	int xsb = fastFloorf(xs);
+	int ysb = fastFloorf(ys);
+
+	/* Compute grid coordinates relative to rhombus origin. */
+	float xins = xs - xsb;
+	float yins = ys - ysb;
+
+	/* Sum those together to get a value that determines which region we're in. */
+	float inSum = xins + yins;
+
+	/* Positions relative to origin point, from the fractional part only so large coordinates keep their precision. */
+	float dx0 = xins + inSum * SQUISH_CONSTANT_2DF;
+	float dy0 = yins + inSum * SQUISH_CONSTANT_2DF;
+
+	/* We'll be defining these inside the next block and using them afterwards. */
+	float dx_ext, dy_ext;
+	int xsv_ext, ysv_ext;
+
+	float dx1;
+	float dy1;
+	float attn1;
+	float dx2;
+	float dy2;
+	float attn2;
+	float zins;
+	float attn0;
+	float attn_ext;
+
+	float value = 0;
+
+	/* Contribution (1,0) */
+	dx1 = dx0 - 1 - SQUISH_CONSTANT_2DF;
+	dy1 = dy0 - 0 - SQUISH_CONSTANT_2DF;
+	attn1 = 2 - dx1 * dx1 - dy1 * dy1;
+	if (attn1 > 0) {
+		attn1 *= attn1;
+		value += attn1 * attn1 * extrapolate2f(ctx, xsb + 1, ysb + 0, dx1, dy1);
+	}
+
+	/* Contribution (0,1) */
+	dx2 = dx0 - 0 - SQUISH_CONSTANT_2DF;
+	dy2 = dy0 - 1 - SQUISH_CONSTANT_2DF;
+	attn2 = 2 - dx2 * dx2 - dy2 * dy2;
+	if (attn2 > 0) {
+		attn2 *= attn2;
+		value += attn2 * attn2 * extrapolate2f(ctx, xsb + 0, ysb + 1, dx2, dy2);
+	}
+
+	if (inSum <= 1) { /* We're inside the triangle (2-Simplex) at (0,0) */
+		zins = 1 - inSum;
+		if (zins > xins || zins > yins) { /* (0,0) is one of the closest two triangular vertices */
+			if (xins > yins) {
+				xsv_ext = xsb + 1;
+				ysv_ext = ysb - 1;
+				dx_ext = dx0 - 1;
+				dy_ext = dy0 + 1;
+			}
+			else {
+				xsv_ext = xsb - 1;
+				ysv_ext = ysb + 1;
+				dx_ext = dx0 + 1;
+				dy_ext = dy0 - 1;
+			}
+		}
+		else { /* (1,0) and (0,1) are the closest two vertices. */
+			xsv_ext = xsb + 1;
+			ysv_ext = ysb + 1;
+			dx_ext = dx0 - 1 - 2 * SQUISH_CONSTANT_2DF;
+			dy_ext = dy0 - 1 - 2 * SQUISH_CONSTANT_2DF;
+		}
+	}
+	else { /* We're inside the triangle (2-Simplex) at (1,1) */
+		zins = 2 - inSum;
+		if (zins < xins || zins < yins) { /* (0,0) is one of the closest two triangular vertices */
+			if (xins > yins) {
+				xsv_ext = xsb + 2;
+				ysv_ext = ysb + 0;
+				dx_ext = dx0 - 2 - 2 * SQUISH_CONSTANT_2DF;
+				dy_ext = dy0 + 0 - 2 * SQUISH_CONSTANT_2DF;
+			}
+			else {
+				xsv_ext = xsb + 0;
+				ysv_ext = ysb + 2;
+				dx_ext = dx0 + 0 - 2 * SQUISH_CONSTANT_2DF;
+				dy_ext = dy0 - 2 - 2 * SQUISH_CONSTANT_2DF;
+			}
+		}
+		else { /* (1,0) and (0,1) are the closest two vertices. */
+			dx_ext = dx0;
+			dy_ext = dy0;
+			xsv_ext = xsb;
+			ysv_ext = ysb;
+		}
+		xsb += 1;
+		ysb += 1;
+		dx0 = dx0 - 1 - 2 * SQUISH_CONSTANT_2DF;
+		dy0 = dy0 - 1 - 2 * SQUISH_CONSTANT_2DF;
+	}
+
+	/* Contribution (0,0) or (1,1) */
+	attn0 = 2 - dx0 * dx0 - dy0 * dy0;
+	if (attn0 > 0) {
+		attn0 *= attn0;
+		value += attn0 * attn0 * extrapolate2f(ctx, xsb, ysb, dx0, dy0);
+	}
+
+	/* Extra Vertex */
+	attn_ext = 2 - dx_ext * dx_ext - dy_ext * dy_ext;
+	if (attn_ext > 0) {
+		attn_ext *= attn_ext;
+		value += attn_ext * attn_ext * extrapolate2f(ctx, xsv_ext, ysv_ext, dx_ext, dy_ext);
+	}
+
+	return value / NORM_CONSTANT_2DF;
+}
+
+/*
+* 3D OpenSimplex (Simplectic) Noise in single precision.
+*/
+float open_simplex_noise3f(struct osn_context *ctx, float x, float y, float z)
+{
+
+	/* Place input coordinates on simplectic honeycomb. */
+	float stretchOffset = (x + y + z) * STRETCH_CONSTANT_3DF;
+	float xs = x + stretchOffset;
+	float ys = y + stretchOffset;
+	float zs = z + stretchOffset;
+
+	/* Floor to get simplectic honeycomb coordinates of rhombohedron (stretched cube) super-cell origin. */
+	int xsb = fastFloorf(xs);
+	int ysb = fastFloorf(ys);
+	int zsb = fastFloorf(zs);
+
+	/* Compute simplectic honeycomb coordinates relative to rhombohedral origin. */
+	float xins = xs - xsb;
+	float yins = ys - ysb;
+	float zins = zs - zsb;
+
+	/* Sum those together to get a value that determines which region we're in. */
+	float inSum = xins + yins + zins;
+
+	/* Positions relative to origin point, from the fractional part only so large coordinates keep their precision. */
+	float dx0 = xins + inSum * SQUISH_CONSTANT_3DF;
+	float dy0 = yins + inSum * SQUISH_CONSTANT_3DF;
+	float dz0 = zins + inSum * SQUISH_CONSTANT_3DF;
+
+	/* We'll be defining these inside the next block and using them afterwards. */
+	float dx_ext0, dy_ext0, dz_ext0;
+	float dx_ext1, dy_ext1, dz_ext1;
+	int xsv_ext0, ysv_ext0, zsv_ext0;
+	int xsv_ext1, ysv_ext1, zsv_ext1;
+
+	float wins;
+	int8_t c, c1, c2;
+	int8_t aPoint, bPoint;
+	float aScore, bScore;
+	int aIsFurtherSide;
+	int bIsFurtherSide;
+	float p1, p2, p3;
+	float score;
+	float attn0, attn1, attn2, attn3, attn4, attn5, attn6;
+	float dx1, dy1, dz1;
+	float dx2, dy2, dz2;
+	float dx3, dy3, dz3;
+	float dx4, dy4, dz4;
+	float dx5, dy5, dz5;
+	float dx6, dy6, dz6;
+	float attn_ext0, attn_ext1;
+
+	float value = 0;
+	if (inSum <= 1) { /* We're inside the tetrahedron (3-Simplex) at (0,0,0) */
+
+					  /* Determine which two of (0,0,1), (0,1,0), (1,0,0) are closest. */
+		aPoint = 0x01;
+		aScore = xins;
+		bPoint = 0x02;
+		bScore = yins;
+		if (aScore >= bScore && zins > bScore) {
+			bScore = zins;
+			bPoint = 0x04;
+		}
+		else if (aScore < bScore && zins > aScore) {
+			aScore = zins;
+			aPoint = 0x04;
+		}
+
+		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
+		This depends on the closest two tetrahedral vertices, including (0,0,0) */
+		wins = 1 - inSum;
+		if (wins > aScore || wins > bScore) { /* (0,0,0) is one of the closest two tetrahedral vertices. */
+			c = (bScore > aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
+
+			if ((c & 0x01) == 0) {
+				xsv_ext0 = xsb - 1;
+				xsv_ext1 = xsb;
+				dx_ext0 = dx0 + 1;
+				dx_ext1 = dx0;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb + 1;
+				dx_ext0 = dx_ext1 = dx0 - 1;
+			}
+
+			if ((c & 0x02) == 0) {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy_ext1 = dy0;
+				if ((c & 0x01) == 0) {
+					ysv_ext1 -= 1;
+					dy_ext1 += 1;
+				}
+				else {
+					ysv_ext0 -= 1;
+					dy_ext0 += 1;
+				}
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy_ext1 = dy0 - 1;
+			}
+
+			if ((c & 0x04) == 0) {
+				zsv_ext0 = zsb;
+				zsv_ext1 = zsb - 1;
+				dz_ext0 = dz0;
+				dz_ext1 = dz0 + 1;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb + 1;
+				dz_ext0 = dz_ext1 = dz0 - 1;
+			}
+		}
+		else { /* (0,0,0) is not one of the closest two tetrahedral vertices. */
+			c = (int8_t)(aPoint | bPoint); /* Our two extra vertices are determined by the closest two. */
+
+			if ((c & 0x01) == 0) {
+				xsv_ext0 = xsb;
+				xsv_ext1 = xsb - 1;
+				dx_ext0 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb + 1;
+				dx_ext0 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) == 0) {
+				ysv_ext0 = ysb;
+				ysv_ext1 = ysb - 1;
+				dy_ext0 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) == 0) {
+				zsv_ext0 = zsb;
+				zsv_ext1 = zsb - 1;
+				dz_ext0 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb + 1;
+				dz_ext0 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+		}
+
+		/* Contribution (0,0,0) */
+		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
+		if (attn0 > 0) {
+			attn0 *= attn0;
+			value += attn0 * attn0 * extrapolate3f(ctx, xsb + 0, ysb + 0, zsb + 0, dx0, dy0, dz0);
+		}
+
+		/* Contribution (1,0,0) */
+		dx1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+		dy1 = dy0 - 0 - SQUISH_CONSTANT_3DF;
+		dz1 = dz0 - 0 - SQUISH_CONSTANT_3DF;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			value += attn1 * attn1 * extrapolate3f(ctx, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
+		}
+
+		/* Contribution (0,1,0) */
+		dx2 = dx0 - 0 - SQUISH_CONSTANT_3DF;
+		dy2 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+		dz2 = dz1;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			value += attn2 * attn2 * extrapolate3f(ctx, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,0,1) */
+		dx3 = dx2;
+		dy3 = dy1;
+		dz3 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			value += attn3 * attn3 * extrapolate3f(ctx, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
+		}
+	}
+	else if (inSum >= 2) { /* We're inside the tetrahedron (3-Simplex) at (1,1,1) */
+
+						   /* Determine which two tetrahedral vertices are the closest, out of (1,1,0), (1,0,1), (0,1,1) but not (1,1,1). */
+		aPoint = 0x06;
+		aScore = xins;
+		bPoint = 0x05;
+		bScore = yins;
+		if (aScore <= bScore && zins < bScore) {
+			bScore = zins;
+			bPoint = 0x03;
+		}
+		else if (aScore > bScore && zins < aScore) {
+			aScore = zins;
+			aPoint = 0x03;
+		}
+
+		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
+		This depends on the closest two tetrahedral vertices, including (1,1,1) */
+		wins = 3 - inSum;
+		if (wins < aScore || wins < bScore) { /* (1,1,1) is one of the closest two tetrahedral vertices. */
+			c = (bScore < aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
+
+			if ((c & 0x01) != 0) {
+				xsv_ext0 = xsb + 2;
+				xsv_ext1 = xsb + 1;
+				dx_ext0 = dx0 - 2 - 3 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb;
+				dx_ext0 = dx_ext1 = dx0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) != 0) {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy_ext1 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				if ((c & 0x01) != 0) {
+					ysv_ext1 += 1;
+					dy_ext1 -= 1;
+				}
+				else {
+					ysv_ext0 += 1;
+					dy_ext0 -= 1;
+				}
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy_ext1 = dy0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) != 0) {
+				zsv_ext0 = zsb + 1;
+				zsv_ext1 = zsb + 2;
+				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 - 3 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb;
+				dz_ext0 = dz_ext1 = dz0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+		}
+		else { /* (1,1,1) is not one of the closest two tetrahedral vertices. */
+			c = (int8_t)(aPoint & bPoint); /* Our two extra vertices are determined by the closest two. */
+
+			if ((c & 0x01) != 0) {
+				xsv_ext0 = xsb + 1;
+				xsv_ext1 = xsb + 2;
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb;
+				dx_ext0 = dx0 - SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) != 0) {
+				ysv_ext0 = ysb + 1;
+				ysv_ext1 = ysb + 2;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy0 - SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) != 0) {
+				zsv_ext0 = zsb + 1;
+				zsv_ext1 = zsb + 2;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb;
+				dz_ext0 = dz0 - SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+		}
+
+		/* Contribution (1,1,0) */
+		dx3 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dy3 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dz3 = dz0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			value += attn3 * attn3 * extrapolate3f(ctx, xsb + 1, ysb + 1, zsb + 0, dx3, dy3, dz3);
+		}
+
+		/* Contribution (1,0,1) */
+		dx2 = dx3;
+		dy2 = dy0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dz2 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			value += attn2 * attn2 * extrapolate3f(ctx, xsb + 1, ysb + 0, zsb + 1, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,1,1) */
+		dx1 = dx0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dy1 = dy3;
+		dz1 = dz2;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			value += attn1 * attn1 * extrapolate3f(ctx, xsb + 0, ysb + 1, zsb + 1, dx1, dy1, dz1);
+		}
+
+		/* Contribution (1,1,1) */
+		dx0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		dy0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		dz0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
+		if (attn0 > 0) {
+			attn0 *= attn0;
+			value += attn0 * attn0 * extrapolate3f(ctx, xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
+		}
+	}
+	else { /* We're inside the octahedron (Rectified 3-Simplex) in between.
+		   Decide between point (0,0,1) and (1,1,0) as closest */
+		p1 = xins + yins;
+		if (p1 > 1) {
+			aScore = p1 - 1;
+			aPoint = 0x03;
+			aIsFurtherSide = 1;
+		}
+		else {
+			aScore = 1 - p1;
+			aPoint = 0x04;
+			aIsFurtherSide = 0;
+		}
+
+		/* Decide between point (0,1,0) and (1,0,1) as closest */
+		p2 = xins + zins;
+		if (p2 > 1) {
+			bScore = p2 - 1;
+			bPoint = 0x05;
+			bIsFurtherSide = 1;
+		}
+		else {
+			bScore = 1 - p2;
+			bPoint = 0x02;
+			bIsFurtherSide = 0;
+		}
+
+		/* The closest out of the two (1,0,0) and (0,1,1) will replace the furthest out of the two decided above, if closer. */
+		p3 = yins + zins;
+		if (p3 > 1) {
+			score = p3 - 1;
+			if (aScore <= bScore && aScore < score) {
+				aScore = score;
+				aPoint = 0x06;
+				aIsFurtherSide = 1;
+			}
+			else if (aScore > bScore && bScore < score) {
+				bScore = score;
+				bPoint = 0x06;
+				bIsFurtherSide = 1;
+			}
+		}
+		else {
+			score = 1 - p3;
+			if (aScore <= bScore && aScore < score) {
+				aScore = score;
+				aPoint = 0x01;
+				aIsFurtherSide = 0;
+			}
+			else if (aScore > bScore && bScore < score) {
+				bScore = score;
+				bPoint = 0x01;
+				bIsFurtherSide = 0;
+			}
+		}
+
+		/* Where each of the two closest points are determines how the extra two vertices are calculated. */
+		if (aIsFurtherSide == bIsFurtherSide) {
+			if (aIsFurtherSide) { /* Both closest points on (1,1,1) side */
+
+								  /* One of the two extra points is (1,1,1) */
+				dx_ext0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb + 1;
+
+				/* Other extra point is based on the shared axis. */
+				c = (int8_t)(aPoint & bPoint);
+				if ((c & 0x01) != 0) {
+					dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 2;
+					ysv_ext1 = ysb;
+					zsv_ext1 = zsb;
+				}
+				else if ((c & 0x02) != 0) {
+					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb;
+					ysv_ext1 = ysb + 2;
+					zsv_ext1 = zsb;
+				}
+				else {
+					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb;
+					ysv_ext1 = ysb;
+					zsv_ext1 = zsb + 2;
+				}
+			}
+			else { /* Both closest points on (0,0,0) side */
+
+				   /* One of the two extra points is (0,0,0) */
+				dx_ext0 = dx0;
+				dy_ext0 = dy0;
+				dz_ext0 = dz0;
+				xsv_ext0 = xsb;
+				ysv_ext0 = ysb;
+				zsv_ext0 = zsb;
+
+				/* Other extra point is based on the omitted axis. */
+				c = (int8_t)(aPoint | bPoint);
+				if ((c & 0x01) == 0) {
+					dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb - 1;
+					ysv_ext1 = ysb + 1;
+					zsv_ext1 = zsb + 1;
+				}
+				else if ((c & 0x02) == 0) {
+					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 1;
+					ysv_ext1 = ysb - 1;
+					zsv_ext1 = zsb + 1;
+				}
+				else {
+					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 1;
+					ysv_ext1 = ysb + 1;
+					zsv_ext1 = zsb - 1;
+				}
+			}
+		}
+		else { /* One point on (0,0,0) side, one point on (1,1,1) side */
+			if (aIsFurtherSide) {
+				c1 = aPoint;
+				c2 = bPoint;
+			}
+			else {
+				c1 = bPoint;
+				c2 = aPoint;
+			}
+
+			/* One contribution is a permutation of (1,1,-1) */
+			if ((c1 & 0x01) == 0) {
+				dx_ext0 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb - 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb + 1;
+			}
+			else if ((c1 & 0x02) == 0) {
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb - 1;
+				zsv_ext0 = zsb + 1;
+			}
+			else {
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb - 1;
+			}
+
+			/* One contribution is a permutation of (0,0,2) */
+			dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+			dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+			dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+			xsv_ext1 = xsb;
+			ysv_ext1 = ysb;
+			zsv_ext1 = zsb;
+			if ((c2 & 0x01) != 0) {
+				dx_ext1 -= 2;
+				xsv_ext1 += 2;
+			}
+			else if ((c2 & 0x02) != 0) {
+				dy_ext1 -= 2;
+				ysv_ext1 += 2;
+			}
+			else {
+				dz_ext1 -= 2;
+				zsv_ext1 += 2;
+			}
+		}
+
+		/* Contribution (1,0,0) */
+		dx1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+		dy1 = dy0 - 0 - SQUISH_CONSTANT_3DF;
+		dz1 = dz0 - 0 - SQUISH_CONSTANT_3DF;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			value += attn1 * attn1 * extrapolate3f(ctx, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
+		}
+
+		/* Contribution (0,1,0) */
+		dx2 = dx0 - 0 - SQUISH_CONSTANT_3DF;
+		dy2 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+		dz2 = dz1;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			value += attn2 * attn2 * extrapolate3f(ctx, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,0,1) */
+		dx3 = dx2;
+		dy3 = dy1;
+		dz3 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			value += attn3 * attn3 * extrapolate3f(ctx, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
+		}
+
+		/* Contribution (1,1,0) */
+		dx4 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dy4 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dz4 = dz0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4;
+		if (attn4 > 0) {
+			attn4 *= attn4;
+			value += attn4 * attn4 * extrapolate3f(ctx, xsb + 1, ysb + 1, zsb + 0, dx4, dy4, dz4);
+		}
+
+		/* Contribution (1,0,1) */
+		dx5 = dx4;
+		dy5 = dy0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dz5 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		attn5 = 2 - dx5 * dx5 - dy5 * dy5 - dz5 * dz5;
+		if (attn5 > 0) {
+			attn5 *= attn5;
+			value += attn5 * attn5 * extrapolate3f(ctx, xsb + 1, ysb + 0, zsb + 1, dx5, dy5, dz5);
+		}
+
+		/* Contribution (0,1,1) */
+		dx6 = dx0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dy6 = dy4;
+		dz6 = dz5;
+		attn6 = 2 - dx6 * dx6 - dy6 * dy6 - dz6 * dz6;
+		if (attn6 > 0) {
+			attn6 *= attn6;
+			value += attn6 * attn6 * extrapolate3f(ctx, xsb + 0, ysb + 1, zsb + 1, dx6, dy6, dz6);
+		}
+	}
+
+	/* First extra vertex */
+	attn_ext0 = 2 - dx_ext0 * dx_ext0 - dy_ext0 * dy_ext0 - dz_ext0 * dz_ext0;
+	if (attn_ext0 > 0)
+	{
+		attn_ext0 *= attn_ext0;
+		value += attn_ext0 * attn_ext0 * extrapolate3f(ctx, xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
+	}
+
+	/* Second extra vertex */
+	attn_ext1 = 2 - dx_ext1 * dx_ext1 - dy_ext1 * dy_ext1 - dz_ext1 * dz_ext1;
+	if (attn_ext1 > 0)
+	{
+		attn_ext1 *= attn_ext1;
+		value += attn_ext1 * attn_ext1 * extrapolate3f(ctx, xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
+	}
+
+	return value / NORM_CONSTANT_3DF;
+}
+
+float open_simplex_noise2f_oct(struct osn_context *ctx, float x, float y, int octaves, float pers)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float noise = 0;
+	float freq = 1.0f;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		noise += open_simplex_noise2f(ctx, x * freq, y * freq) * amp;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	noise /= max_amp;
+
+	return noise;
+}
+
+float open_simplex_noise3f_oct(struct osn_context* ctx, float x, float y, float z, int octaves, float pers)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float noise = 0;
+	float freq = 1.0f;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		noise += open_simplex_noise3f(ctx, x * freq, y * freq, z * freq) * amp;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	noise /= max_amp;
+
+	return noise;
+}
+
+/*
+* 3D OpenSimplex (Simplectic) Noise for several channels at once. The lattice, region and
+* attenuation work is shared, only the gradient lookups are repeated per channel.
+*/
+void open_simplex_noise3f_multi(struct osn_context *ctx, float x, float y, float z, int channels, float *out)
+{
+
+	/* Place input coordinates on simplectic honeycomb. */
+	float stretchOffset = (x + y + z) * STRETCH_CONSTANT_3DF;
+	float xs = x + stretchOffset;
+	float ys = y + stretchOffset;
+	float zs = z + stretchOffset;
+
+	/* Floor to get simplectic honeycomb coordinates of rhombohedron (stretched cube) super-cell origin. */
+	int xsb = fastFloorf(xs);
+	int ysb = fastFloorf(ys);
+	int zsb = fastFloorf(zs);
+
+	/* Compute simplectic honeycomb coordinates relative to rhombohedral origin. */
+	float xins = xs - xsb;
+	float yins = ys - ysb;
+	float zins = zs - zsb;
+
+	/* Sum those together to get a value that determines which region we're in. */
+	float inSum = xins + yins + zins;
+
+	/* Positions relative to origin point, from the fractional part only so large coordinates keep their precision. */
+	float dx0 = xins + inSum * SQUISH_CONSTANT_3DF;
+	float dy0 = yins + inSum * SQUISH_CONSTANT_3DF;
+	float dz0 = zins + inSum * SQUISH_CONSTANT_3DF;
+
+	/* We'll be defining these inside the next block and using them afterwards. */
+	float dx_ext0, dy_ext0, dz_ext0;
+	float dx_ext1, dy_ext1, dz_ext1;
+	int xsv_ext0, ysv_ext0, zsv_ext0;
+	int xsv_ext1, ysv_ext1, zsv_ext1;
+
+	float wins;
+	int8_t c, c1, c2;
+	int8_t aPoint, bPoint;
+	float aScore, bScore;
+	int aIsFurtherSide;
+	int bIsFurtherSide;
+	float p1, p2, p3;
+	float score;
+	float attn0, attn1, attn2, attn3, attn4, attn5, attn6;
+	float dx1, dy1, dz1;
+	float dx2, dy2, dz2;
+	float dx3, dy3, dz3;
+	float dx4, dy4, dz4;
+	float dx5, dy5, dz5;
+	float dx6, dy6, dz6;
+	float attn_ext0, attn_ext1;
+
+	int channel;
+
+	for (channel = 0; channel < channels; channel++)
+		out[channel] = 0;
+	if (inSum <= 1) { /* We're inside the tetrahedron (3-Simplex) at (0,0,0) */
+
+					  /* Determine which two of (0,0,1), (0,1,0), (1,0,0) are closest. */
+		aPoint = 0x01;
+		aScore = xins;
+		bPoint = 0x02;
+		bScore = yins;
+		if (aScore >= bScore && zins > bScore) {
+			bScore = zins;
+			bPoint = 0x04;
+		}
+		else if (aScore < bScore && zins > aScore) {
+			aScore = zins;
+			aPoint = 0x04;
+		}
+
+		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
+		This depends on the closest two tetrahedral vertices, including (0,0,0) */
+		wins = 1 - inSum;
+		if (wins > aScore || wins > bScore) { /* (0,0,0) is one of the closest two tetrahedral vertices. */
+			c = (bScore > aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
+
+			if ((c & 0x01) == 0) {
+				xsv_ext0 = xsb - 1;
+				xsv_ext1 = xsb;
+				dx_ext0 = dx0 + 1;
+				dx_ext1 = dx0;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb + 1;
+				dx_ext0 = dx_ext1 = dx0 - 1;
+			}
+
+			if ((c & 0x02) == 0) {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy_ext1 = dy0;
+				if ((c & 0x01) == 0) {
+					ysv_ext1 -= 1;
+					dy_ext1 += 1;
+				}
+				else {
+					ysv_ext0 -= 1;
+					dy_ext0 += 1;
+				}
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy_ext1 = dy0 - 1;
+			}
+
+			if ((c & 0x04) == 0) {
+				zsv_ext0 = zsb;
+				zsv_ext1 = zsb - 1;
+				dz_ext0 = dz0;
+				dz_ext1 = dz0 + 1;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb + 1;
+				dz_ext0 = dz_ext1 = dz0 - 1;
+			}
+		}
+		else { /* (0,0,0) is not one of the closest two tetrahedral vertices. */
+			c = (int8_t)(aPoint | bPoint); /* Our two extra vertices are determined by the closest two. */
+
+			if ((c & 0x01) == 0) {
+				xsv_ext0 = xsb;
+				xsv_ext1 = xsb - 1;
+				dx_ext0 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb + 1;
+				dx_ext0 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) == 0) {
+				ysv_ext0 = ysb;
+				ysv_ext1 = ysb - 1;
+				dy_ext0 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) == 0) {
+				zsv_ext0 = zsb;
+				zsv_ext1 = zsb - 1;
+				dz_ext0 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb + 1;
+				dz_ext0 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+			}
+		}
+
+		/* Contribution (0,0,0) */
+		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
+		if (attn0 > 0) {
+			attn0 *= attn0;
+			accumulate3f(ctx, channels, out, attn0 * attn0, xsb + 0, ysb + 0, zsb + 0, dx0, dy0, dz0);
+		}
+
+		/* Contribution (1,0,0) */
+		dx1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+		dy1 = dy0 - 0 - SQUISH_CONSTANT_3DF;
+		dz1 = dz0 - 0 - SQUISH_CONSTANT_3DF;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			accumulate3f(ctx, channels, out, attn1 * attn1, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
+		}
+
+		/* Contribution (0,1,0) */
+		dx2 = dx0 - 0 - SQUISH_CONSTANT_3DF;
+		dy2 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+		dz2 = dz1;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			accumulate3f(ctx, channels, out, attn2 * attn2, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,0,1) */
+		dx3 = dx2;
+		dy3 = dy1;
+		dz3 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			accumulate3f(ctx, channels, out, attn3 * attn3, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
+		}
+	}
+	else if (inSum >= 2) { /* We're inside the tetrahedron (3-Simplex) at (1,1,1) */
+
+						   /* Determine which two tetrahedral vertices are the closest, out of (1,1,0), (1,0,1), (0,1,1) but not (1,1,1). */
+		aPoint = 0x06;
+		aScore = xins;
+		bPoint = 0x05;
+		bScore = yins;
+		if (aScore <= bScore && zins < bScore) {
+			bScore = zins;
+			bPoint = 0x03;
+		}
+		else if (aScore > bScore && zins < aScore) {
+			aScore = zins;
+			aPoint = 0x03;
+		}
+
+		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
+		This depends on the closest two tetrahedral vertices, including (1,1,1) */
+		wins = 3 - inSum;
+		if (wins < aScore || wins < bScore) { /* (1,1,1) is one of the closest two tetrahedral vertices. */
+			c = (bScore < aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
+
+			if ((c & 0x01) != 0) {
+				xsv_ext0 = xsb + 2;
+				xsv_ext1 = xsb + 1;
+				dx_ext0 = dx0 - 2 - 3 * SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb;
+				dx_ext0 = dx_ext1 = dx0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) != 0) {
+				ysv_ext0 = ysv_ext1 = ysb + 1;
+				dy_ext0 = dy_ext1 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				if ((c & 0x01) != 0) {
+					ysv_ext1 += 1;
+					dy_ext1 -= 1;
+				}
+				else {
+					ysv_ext0 += 1;
+					dy_ext0 -= 1;
+				}
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy_ext1 = dy0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) != 0) {
+				zsv_ext0 = zsb + 1;
+				zsv_ext1 = zsb + 2;
+				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 - 3 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb;
+				dz_ext0 = dz_ext1 = dz0 - 3 * SQUISH_CONSTANT_3DF;
+			}
+		}
+		else { /* (1,1,1) is not one of the closest two tetrahedral vertices. */
+			c = (int8_t)(aPoint & bPoint); /* Our two extra vertices are determined by the closest two. */
+
+			if ((c & 0x01) != 0) {
+				xsv_ext0 = xsb + 1;
+				xsv_ext1 = xsb + 2;
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				xsv_ext0 = xsv_ext1 = xsb;
+				dx_ext0 = dx0 - SQUISH_CONSTANT_3DF;
+				dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x02) != 0) {
+				ysv_ext0 = ysb + 1;
+				ysv_ext1 = ysb + 2;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				ysv_ext0 = ysv_ext1 = ysb;
+				dy_ext0 = dy0 - SQUISH_CONSTANT_3DF;
+				dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+
+			if ((c & 0x04) != 0) {
+				zsv_ext0 = zsb + 1;
+				zsv_ext1 = zsb + 2;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+			}
+			else {
+				zsv_ext0 = zsv_ext1 = zsb;
+				dz_ext0 = dz0 - SQUISH_CONSTANT_3DF;
+				dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+			}
+		}
+
+		/* Contribution (1,1,0) */
+		dx3 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dy3 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dz3 = dz0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			accumulate3f(ctx, channels, out, attn3 * attn3, xsb + 1, ysb + 1, zsb + 0, dx3, dy3, dz3);
+		}
+
+		/* Contribution (1,0,1) */
+		dx2 = dx3;
+		dy2 = dy0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dz2 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			accumulate3f(ctx, channels, out, attn2 * attn2, xsb + 1, ysb + 0, zsb + 1, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,1,1) */
+		dx1 = dx0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dy1 = dy3;
+		dz1 = dz2;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			accumulate3f(ctx, channels, out, attn1 * attn1, xsb + 0, ysb + 1, zsb + 1, dx1, dy1, dz1);
+		}
+
+		/* Contribution (1,1,1) */
+		dx0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		dy0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		dz0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
+		if (attn0 > 0) {
+			attn0 *= attn0;
+			accumulate3f(ctx, channels, out, attn0 * attn0, xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
+		}
+	}
+	else { /* We're inside the octahedron (Rectified 3-Simplex) in between.
+		   Decide between point (0,0,1) and (1,1,0) as closest */
+		p1 = xins + yins;
+		if (p1 > 1) {
+			aScore = p1 - 1;
+			aPoint = 0x03;
+			aIsFurtherSide = 1;
+		}
+		else {
+			aScore = 1 - p1;
+			aPoint = 0x04;
+			aIsFurtherSide = 0;
+		}
+
+		/* Decide between point (0,1,0) and (1,0,1) as closest */
+		p2 = xins + zins;
+		if (p2 > 1) {
+			bScore = p2 - 1;
+			bPoint = 0x05;
+			bIsFurtherSide = 1;
+		}
+		else {
+			bScore = 1 - p2;
+			bPoint = 0x02;
+			bIsFurtherSide = 0;
+		}
+
+		/* The closest out of the two (1,0,0) and (0,1,1) will replace the furthest out of the two decided above, if closer. */
+		p3 = yins + zins;
+		if (p3 > 1) {
+			score = p3 - 1;
+			if (aScore <= bScore && aScore < score) {
+				aScore = score;
+				aPoint = 0x06;
+				aIsFurtherSide = 1;
+			}
+			else if (aScore > bScore && bScore < score) {
+				bScore = score;
+				bPoint = 0x06;
+				bIsFurtherSide = 1;
+			}
+		}
+		else {
+			score = 1 - p3;
+			if (aScore <= bScore && aScore < score) {
+				aScore = score;
+				aPoint = 0x01;
+				aIsFurtherSide = 0;
+			}
+			else if (aScore > bScore && bScore < score) {
+				bScore = score;
+				bPoint = 0x01;
+				bIsFurtherSide = 0;
+			}
+		}
+
+		/* Where each of the two closest points are determines how the extra two vertices are calculated. */
+		if (aIsFurtherSide == bIsFurtherSide) {
+			if (aIsFurtherSide) { /* Both closest points on (1,1,1) side */
+
+								  /* One of the two extra points is (1,1,1) */
+				dx_ext0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb + 1;
+
+				/* Other extra point is based on the shared axis. */
+				c = (int8_t)(aPoint & bPoint);
+				if ((c & 0x01) != 0) {
+					dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 2;
+					ysv_ext1 = ysb;
+					zsv_ext1 = zsb;
+				}
+				else if ((c & 0x02) != 0) {
+					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb;
+					ysv_ext1 = ysb + 2;
+					zsv_ext1 = zsb;
+				}
+				else {
+					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb;
+					ysv_ext1 = ysb;
+					zsv_ext1 = zsb + 2;
+				}
+			}
+			else { /* Both closest points on (0,0,0) side */
+
+				   /* One of the two extra points is (0,0,0) */
+				dx_ext0 = dx0;
+				dy_ext0 = dy0;
+				dz_ext0 = dz0;
+				xsv_ext0 = xsb;
+				ysv_ext0 = ysb;
+				zsv_ext0 = zsb;
+
+				/* Other extra point is based on the omitted axis. */
+				c = (int8_t)(aPoint | bPoint);
+				if ((c & 0x01) == 0) {
+					dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb - 1;
+					ysv_ext1 = ysb + 1;
+					zsv_ext1 = zsb + 1;
+				}
+				else if ((c & 0x02) == 0) {
+					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 1;
+					ysv_ext1 = ysb - 1;
+					zsv_ext1 = zsb + 1;
+				}
+				else {
+					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+					dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+					xsv_ext1 = xsb + 1;
+					ysv_ext1 = ysb + 1;
+					zsv_ext1 = zsb - 1;
+				}
+			}
+		}
+		else { /* One point on (0,0,0) side, one point on (1,1,1) side */
+			if (aIsFurtherSide) {
+				c1 = aPoint;
+				c2 = bPoint;
+			}
+			else {
+				c1 = bPoint;
+				c2 = aPoint;
+			}
+
+			/* One contribution is a permutation of (1,1,-1) */
+			if ((c1 & 0x01) == 0) {
+				dx_ext0 = dx0 + 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb - 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb + 1;
+			}
+			else if ((c1 & 0x02) == 0) {
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 + 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb - 1;
+				zsv_ext0 = zsb + 1;
+			}
+			else {
+				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+				dz_ext0 = dz0 + 1 - SQUISH_CONSTANT_3DF;
+				xsv_ext0 = xsb + 1;
+				ysv_ext0 = ysb + 1;
+				zsv_ext0 = zsb - 1;
+			}
+
+			/* One contribution is a permutation of (0,0,2) */
+			dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3DF;
+			dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3DF;
+			dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3DF;
+			xsv_ext1 = xsb;
+			ysv_ext1 = ysb;
+			zsv_ext1 = zsb;
+			if ((c2 & 0x01) != 0) {
+				dx_ext1 -= 2;
+				xsv_ext1 += 2;
+			}
+			else if ((c2 & 0x02) != 0) {
+				dy_ext1 -= 2;
+				ysv_ext1 += 2;
+			}
+			else {
+				dz_ext1 -= 2;
+				zsv_ext1 += 2;
+			}
+		}
+
+		/* Contribution (1,0,0) */
+		dx1 = dx0 - 1 - SQUISH_CONSTANT_3DF;
+		dy1 = dy0 - 0 - SQUISH_CONSTANT_3DF;
+		dz1 = dz0 - 0 - SQUISH_CONSTANT_3DF;
+		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
+		if (attn1 > 0) {
+			attn1 *= attn1;
+			accumulate3f(ctx, channels, out, attn1 * attn1, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
+		}
+
+		/* Contribution (0,1,0) */
+		dx2 = dx0 - 0 - SQUISH_CONSTANT_3DF;
+		dy2 = dy0 - 1 - SQUISH_CONSTANT_3DF;
+		dz2 = dz1;
+		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
+		if (attn2 > 0) {
+			attn2 *= attn2;
+			accumulate3f(ctx, channels, out, attn2 * attn2, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
+		}
+
+		/* Contribution (0,0,1) */
+		dx3 = dx2;
+		dy3 = dy1;
+		dz3 = dz0 - 1 - SQUISH_CONSTANT_3DF;
+		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
+		if (attn3 > 0) {
+			attn3 *= attn3;
+			accumulate3f(ctx, channels, out, attn3 * attn3, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
+		}
+
+		/* Contribution (1,1,0) */
+		dx4 = dx0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dy4 = dy0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		dz4 = dz0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4;
+		if (attn4 > 0) {
+			attn4 *= attn4;
+			accumulate3f(ctx, channels, out, attn4 * attn4, xsb + 1, ysb + 1, zsb + 0, dx4, dy4, dz4);
+		}
+
+		/* Contribution (1,0,1) */
+		dx5 = dx4;
+		dy5 = dy0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dz5 = dz0 - 1 - 2 * SQUISH_CONSTANT_3DF;
+		attn5 = 2 - dx5 * dx5 - dy5 * dy5 - dz5 * dz5;
+		if (attn5 > 0) {
+			attn5 *= attn5;
+			accumulate3f(ctx, channels, out, attn5 * attn5, xsb + 1, ysb + 0, zsb + 1, dx5, dy5, dz5);
+		}
+
+		/* Contribution (0,1,1) */
+		dx6 = dx0 - 0 - 2 * SQUISH_CONSTANT_3DF;
+		dy6 = dy4;
+		dz6 = dz5;
+		attn6 = 2 - dx6 * dx6 - dy6 * dy6 - dz6 * dz6;
+		if (attn6 > 0) {
+			attn6 *= attn6;
+			accumulate3f(ctx, channels, out, attn6 * attn6, xsb + 0, ysb + 1, zsb + 1, dx6, dy6, dz6);
+		}
+	}
+
+	/* First extra vertex */
+	attn_ext0 = 2 - dx_ext0 * dx_ext0 - dy_ext0 * dy_ext0 - dz_ext0 * dz_ext0;
+	if (attn_ext0 > 0)
+	{
+		attn_ext0 *= attn_ext0;
+		accumulate3f(ctx, channels, out, attn_ext0 * attn_ext0, xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
+	}
+
+	/* Second extra vertex */
+	attn_ext1 = 2 - dx_ext1 * dx_ext1 - dy_ext1 * dy_ext1 - dz_ext1 * dz_ext1;
+	if (attn_ext1 > 0)
+	{
+		attn_ext1 *= attn_ext1;
+		accumulate3f(ctx, channels, out, attn_ext1 * attn_ext1, xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
+	}
+
+	for (channel = 0; channel < channels; channel++)
+		out[channel] /= NORM_CONSTANT_3DF;
+}
+
+void open_simplex_noise3f_multi_oct(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, int channels, float *out)
+{
+	float octave[OSN_MAX_CHANNELS];
+	float max_amp = 0;
+	float amp = 1;
+	float freq = 1.0f;
+
+	for (int c = 0; c < channels; c++)
+		out[c] = 0;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		open_simplex_noise3f_multi(ctx, x * freq, y * freq, z * freq, channels, octave);
+		for (int c = 0; c < channels; c++)
+			out[c] += octave[c] * amp;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	for (int c = 0; c < channels; c++)
+		out[c] /= max_amp;
+}
+
+/*
+* Octave sums that stop before the first octave above max_frequency, since finer octaves would
+* only alias at the caller's sample spacing. The sum is still normalized by the full octave count,
+* so truncated and full evaluations agree on the low frequencies.
+*/
+float open_simplex_noise2f_oct_lod(struct osn_context *ctx, float x, float y, int octaves, float pers, float max_frequency)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float noise = 0;
+	float freq = 1.0f;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		if (i == 0 || freq <= max_frequency)
+			noise += open_simplex_noise2f(ctx, x * freq, y * freq) * amp;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	noise /= max_amp;
+
+	return noise;
+}
+
+float open_simplex_noise3f_oct_lod(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, float max_frequency)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float noise = 0;
+	float freq = 1.0f;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		if (i == 0 || freq <= max_frequency)
+			noise += open_simplex_noise3f(ctx, x * freq, y * freq, z * freq) * amp;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	noise /= max_amp;
+
+	return noise;
+}
+
+void open_simplex_noise3f_multi_oct_lod(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, float max_frequency, int channels, float *out)
+{
+	float octave[OSN_MAX_CHANNELS];
+	float max_amp = 0;
+	float amp = 1;
+	float freq = 1.0f;
+
+	for (int c = 0; c < channels; c++)
+		out[c] = 0;
+
+	for (int i = 0; i < octaves; i++)
+	{
+		if (i == 0 || freq <= max_frequency)
+		{
+			open_simplex_noise3f_multi(ctx, x * freq, y * freq, z * freq, channels, octave);
+			for (int c = 0; c < channels; c++)
+				out[c] += octave[c] * amp;
+		}
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	for (int c = 0; c < channels; c++)
+		out[c] /= max_amp;
+}
+
+/*
+* Interval estimates for the octave sums. Each octave is sampled once at the center and widened by how far it can
+* drift over the radius at its frequency, capped at the amplitude bound. Octaves the _lod sums may skip also allow 0.
+*/
+static void octave_bounds(float center, float radius, float amp, int may_skip, float *lo, float *hi)
+{
+	float drift = OSN_LIPSCHITZ_BOUND * radius + OSN_BOUND_EPSILON;
+	float octave_lo = center - drift < -OSN_AMPLITUDE_BOUND ? -OSN_AMPLITUDE_BOUND : center - drift;
+	float octave_hi = center + drift > OSN_AMPLITUDE_BOUND ? OSN_AMPLITUDE_BOUND : center + drift;
+	if (may_skip)
+	{
+		octave_lo = octave_lo > 0 ? 0 : octave_lo;
+		octave_hi = octave_hi < 0 ? 0 : octave_hi;
+	}
+	*lo += octave_lo * amp;
+	*hi += octave_hi * amp;
+}
+
+void open_simplex_noise2f_oct_bounds(struct osn_context *ctx, float x, float y, float radius, int octaves, float pers, float max_frequency, float *lo, float *hi)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float freq = 1.0f;
+
+	*lo = 0;
+	*hi = 0;
+	for (int i = 0; i < octaves; i++)
+	{
+		/* Wide enough that the octave can take any value, so skip the sample */
+		float center = OSN_LIPSCHITZ_BOUND * radius * freq >= 2.0f * OSN_AMPLITUDE_BOUND ? 0 : open_simplex_noise2f(ctx, x * freq, y * freq);
+		octave_bounds(center, radius * freq, amp, i > 0 && freq > max_frequency, lo, hi);
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	*lo /= max_amp;
+	*hi /= max_amp;
+}
+
+void open_simplex_noise3f_oct_bounds(struct osn_context *ctx, float x, float y, float z, float radius, int octaves, float pers, float max_frequency, float *lo, float *hi)
+{
+	float max_amp = 0;
+	float amp = 1;
+	float freq = 1.0f;
+
+	*lo = 0;
+	*hi = 0;
+	for (int i = 0; i < octaves; i++)
+	{
+		float center = OSN_LIPSCHITZ_BOUND * radius * freq >= 2.0f * OSN_AMPLITUDE_BOUND ? 0 : open_simplex_noise3f(ctx, x * freq, y * freq, z * freq);
+		octave_bounds(center, radius * freq, amp, i > 0 && freq > max_frequency, lo, hi);
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+
+	*lo /= max_amp;
+	*hi /= max_amp;
+}
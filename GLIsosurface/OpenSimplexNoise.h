@@ -31,6 +31,17 @@
 #define INLINE
 #endif
 
+#define OSN_MAX_CHANNELS 4
+
+/*
+* Bounds used by the interval estimates below: no normalized 2D/3D value exceeds OSN_AMPLITUDE_BOUND in magnitude,
+* and none changes faster than OSN_LIPSCHITZ_BOUND per unit distance. Measured maxima are about 0.87/0.98 and 2.35/2.55.
+*/
+#define OSN_AMPLITUDE_BOUND 1.0f
+#define OSN_LIPSCHITZ_BOUND 3.0f
+/* Slack for the float center samples standing in for the double evaluation. */
+#define OSN_BOUND_EPSILON 1e-3f
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -47,6 +58,31 @@ extern "C" {
 	double open_simplex_noise2_oct(struct osn_context *ctx, double x, double y, int octaves, float pers);
 	double open_simplex_noise3_oct(struct osn_context *ctx, double x, double y, double z, int octaves, float pers);
 
+	/* Single precision 2D/3D noise, matching the double versions to within float rounding. */
+	float open_simplex_noise2f(struct osn_context *ctx, float x, float y);
+	float open_simplex_noise3f(struct osn_context *ctx, float x, float y, float z);
+	float open_simplex_noise2f_oct(struct osn_context *ctx, float x, float y, int octaves, float pers);
+	float open_simplex_noise3f_oct(struct osn_context *ctx, float x, float y, float z, int octaves, float pers);
+
+	/*
+	* Up to OSN_MAX_CHANNELS decorrelated 3D noise values at one point, written to out.
+	* Much cheaper than separate calls at offset points since the lattice setup is shared.
+	*/
+	void open_simplex_noise3f_multi(struct osn_context *ctx, float x, float y, float z, int channels, float *out);
+	void open_simplex_noise3f_multi_oct(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, int channels, float *out);
+
+	/* Octave sums that skip every octave above max_frequency, normalized as if all octaves ran. */
+	float open_simplex_noise2f_oct_lod(struct osn_context *ctx, float x, float y, int octaves, float pers, float max_frequency);
+	float open_simplex_noise3f_oct_lod(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, float max_frequency);
+	void open_simplex_noise3f_multi_oct_lod(struct osn_context *ctx, float x, float y, float z, int octaves, float pers, float max_frequency, int channels, float *out);
+
+	/*
+	* Conservative [lo, hi] of the octave sums over every point within radius of (x, y[, z]), in noise coordinates.
+	* Holds for the full, _lod and double sums alike, since octaves above max_frequency may count as skipped.
+	*/
+	void open_simplex_noise2f_oct_bounds(struct osn_context *ctx, float x, float y, float radius, int octaves, float pers, float max_frequency, float *lo, float *hi);
+	void open_simplex_noise3f_oct_bounds(struct osn_context *ctx, float x, float y, float z, float radius, int octaves, float pers, float max_frequency, float *lo, float *hi);
+
 #ifdef __cplusplus
 }
 #endif
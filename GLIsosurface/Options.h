@@ -7,3 +7,18 @@
 #define DEFAULT_FOCUS_POS { 0, 115.2f, 0 }
 #define DEFAULT_SUB_RESOLUTION 3
 #define SMOOTH_NORMALS 0
+#define ASYNC_EXTRACTION 1
+#define UPLOAD_BUDGET_BYTES (4 << 20)
+#define COMPACT_VERTICES 0
+#define VERTEX_CACHE_OPTIMIZE 1
+#define HOT_PATH_COUNTERS 0
+#define TRACE_EVENTS 0
+#define FLOAT_NOISE 1
+#define OCTAVE_TRUNCATION 1
+#define OCTAVE_NYQUIST_LIMIT 0.5f
+#define HEIGHTFIELD_COLUMNS 1
+#define BATCH_SAMPLING 1
+#define BOUNDS_PRUNING 1
+#define TILED_LAYOUT_MIN_DIM 511
+#define PARALLEL_CHUNK_MIN_DIM 127
+#define CHUNK_THREADS 0
@@ -1,8 +1,198 @@
 #include "Sampler.h"
 
+#include <float.h>
 #include <math.h>
 
 const float Sampler_world_size = 256;
+struct BrickVolume* Sampler_volume = 0;
+struct SamplerProgram* Sampler_graph = 0;
+struct EditLayer* Sampler_edits = 0;
+
+// Samplers that are exactly y - height(x, z), paired with their height functions
+static const struct
+{
+	const void* sampler;
+	HeightfieldFn height;
+} Sampler_heightfields[] =
+{
+	{ (const void*)&SurfaceFn_2d_terrain, &SurfaceH_2d_terrain },
+};
+
+HeightfieldFn Sampler_heightfield(const void* sampler)
+{
+	for (int i = 0; i < sizeof(Sampler_heightfields) / sizeof(Sampler_heightfields[0]); i++)
+	{
+		if (Sampler_heightfields[i].sampler == sampler)
+			return Sampler_heightfields[i].height;
+	}
+	return 0;
+}
+
+// Samplers with a batch form, paired with it
+static const struct
+{
+	const void* sampler;
+	SamplerBatchFn batch;
+} Sampler_batches[] =
+{
+	{ (const void*)&SurfaceFn_graph, &SurfaceBatch_graph },
+	{ (const void*)&SurfaceFn_volume, &SurfaceBatch_volume },
+};
+
+SamplerBatchFn Sampler_batch(const void* sampler)
+{
+	for (int i = 0; i < sizeof(Sampler_batches) / sizeof(Sampler_batches[0]); i++)
+	{
+		if (Sampler_batches[i].sampler == sampler)
+			return Sampler_batches[i].batch;
+	}
+	return 0;
+}
+
+// Samplers with interval bounds, paired with them; the Klein bottle and volumes have none and are never pruned
+static const struct
+{
+	const void* sampler;
+	SamplerBoundsFn bounds;
+} Sampler_bounds_table[] =
+{
+	{ (const void*)&SurfaceFn_sphere, &SurfaceB_sphere },
+	{ (const void*)&SurfaceFn_sphere_sliced, &SurfaceB_sphere_sliced },
+	{ (const void*)&SurfaceD_sphere, &SurfaceB_sphere_d },
+	{ (const void*)&SurfaceD_torus_z, &SurfaceB_torus_z },
+	{ (const void*)&SurfaceD_plane, &SurfaceB_plane },
+	{ (const void*)&SurfaceFn_2d_terrain, &SurfaceB_2d_terrain },
+	{ (const void*)&SurfaceFn_3d_terrain, &SurfaceB_3d_terrain },
+	{ (const void*)&SurfaceFn_sphere_r, &SurfaceB_sphere_r },
+	{ (const void*)&SurfaceFn_torus_r, &SurfaceB_torus_r },
+	{ (const void*)&SurfaceFn_windy, &SurfaceB_windy },
+	{ (const void*)&SurfaceFn_graph, &SurfaceB_graph },
+	{ (const void*)&SurfaceFn_edited, &SurfaceB_edited },
+};
+
+SamplerBoundsFn Sampler_bounds(const void* sampler)
+{
+	for (int i = 0; i < sizeof(Sampler_bounds_table) / sizeof(Sampler_bounds_table[0]); i++)
+	{
+		if (Sampler_bounds_table[i].sampler == sampler)
+			return Sampler_bounds_table[i].bounds;
+	}
+	return 0;
+}
+
+// Samplers that know how fast they move with w, paired with that bound; animating any other one resamples everything
+static const struct
+{
+	const void* sampler;
+	SamplerDriftFn drift;
+} Sampler_drifts[] =
+{
+	{ (const void*)&SurfaceFn_sphere, &SurfaceT_sphere },
+	{ (const void*)&SurfaceFn_sphere_sliced, &SurfaceT_static },
+	{ (const void*)&SurfaceD_sphere, &SurfaceT_static },
+	{ (const void*)&SurfaceD_torus_z, &SurfaceT_static },
+	{ (const void*)&SurfaceD_plane, &SurfaceT_static },
+	{ (const void*)&SurfaceFn_Klein_bottle, &SurfaceT_static },
+	{ (const void*)&SurfaceFn_2d_terrain, &SurfaceT_2d_terrain },
+	{ (const void*)&SurfaceFn_3d_terrain, &SurfaceT_3d_terrain },
+	{ (const void*)&SurfaceFn_sphere_r, &SurfaceT_sphere_r },
+	{ (const void*)&SurfaceFn_torus_r, &SurfaceT_torus_r },
+	{ (const void*)&SurfaceFn_windy, &SurfaceT_static },
+	{ (const void*)&SurfaceFn_volume, &SurfaceT_static },
+	{ (const void*)&SurfaceFn_graph, &SurfaceT_static },
+	{ (const void*)&SurfaceFn_edited, &SurfaceT_edited },
+};
+
+SamplerDriftFn Sampler_drift(const void* sampler)
+{
+	for (int i = 0; i < sizeof(Sampler_drifts) / sizeof(Sampler_drifts[0]); i++)
+	{
+		if (Sampler_drifts[i].sampler == sampler)
+			return Sampler_drifts[i].drift;
+	}
+	return 0;
+}
+
+// 0 only when the sampler provably stays on one side of isolevel over the whole box
+int Sampler_may_cross(const void* sampler, vec3 box_min, vec3 box_max, float w, float footprint, float isolevel, struct osn_context* osn)
+{
+	SamplerBoundsFn bounds_fn = Sampler_bounds(sampler);
+	if (!bounds_fn)
+		return 1;
+
+	float lo, hi;
+	bounds_fn(box_min, box_max, w, footprint, osn, &lo, &hi);
+	return lo <= isolevel && hi >= isolevel;
+}
+
+// Nearest and farthest |v| for v in [lo, hi]
+void _Sampler_axis_range(float lo, float hi, float* nearest, float* farthest)
+{
+	float a = fabsf(lo), b = fabsf(hi);
+	*nearest = lo <= 0 && hi >= 0 ? 0 : min(a, b);
+	*farthest = max(a, b);
+}
+
+// Nearest and farthest distance from the origin over the box, using the axes whose bits are set
+void _Sampler_distance_range(vec3 box_min, vec3 box_max, int axes, float* nearest, float* farthest)
+{
+	float n2 = 0, f2 = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		if (!(axes & (1 << i)))
+			continue;
+		float n, f;
+		_Sampler_axis_range(box_min[i], box_max[i], &n, &f);
+		n2 += n * n;
+		f2 += f * f;
+	}
+	*nearest = sqrtf(n2);
+	*farthest = sqrtf(f2);
+}
+
+// Center of the box, returning the radius of the ball around it that holds the box
+float _Sampler_box_ball(vec3 box_min, vec3 box_max, vec3 center)
+{
+	vec3 half;
+	for (int i = 0; i < 3; i++)
+	{
+		center[i] = (box_min[i] + box_max[i]) * 0.5f;
+		half[i] = box_max[i] - center[i];
+	}
+	return glm_vec_norm(half);
+}
+
+// Highest octave frequency worth evaluating for noise at the given scale, sampled every footprint units
+float Sampler_max_frequency(float scale, float footprint)
+{
+	if (!OCTAVE_TRUNCATION || footprint <= 0)
+		return 3.4e37f;
+	return OCTAVE_NYQUIST_LIMIT / (scale * footprint);
+}
+
+// Fastest a normalized octave sum can change per unit of its coordinates; truncated sums only drop octaves
+float Sampler_octave_rate(int octaves, float pers)
+{
+	float amp = 1, freq = 1, max_amp = 0, rate = 0;
+	for (int i = 0; i < octaves; i++)
+	{
+		rate += amp * freq;
+		max_amp += amp;
+		amp *= pers;
+		freq *= 2.0f;
+	}
+	return OSN_LIPSCHITZ_BOUND * rate / max_amp;
+}
+
+// Offsets a point by three decorrelated octave noise channels sampled at it, scaled by amount
+void Sampler_domain_warp3(struct osn_context* osn, float x, float y, float z, int octaves, float pers, float max_frequency, float amount, vec3 out)
+{
+	float warp[3];
+	open_simplex_noise3f_multi_oct_lod(osn, x, y, z, octaves, pers, max_frequency, 3, warp);
+	out[0] = warp[0] * amount;
+	out[1] = warp[1] * amount;
+	out[2] = warp[2] * amount;
+}
 
 __forceinline void Sampler_get_intersection(vec3 v0, vec3 v1, float s0, float s1, float isolevel, vec3 out)
 {
@@ -15,14 +205,14 @@ __forceinline void Sampler_get_intersection(vec3 v0, vec3 v1, float s0, float s1
 	glm_vec_add(delta_v, v0, out);
 }
 
-__forceinline float SurfaceFn_sphere(float x, float y, float z, float w, struct osn_context* osn_context)
+__forceinline float SurfaceFn_sphere(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	x += w;
 	const float r = Sampler_world_size * 0.45f;
 	return x * x + y * y + z * z - r * r;
 }
 
-float SurfaceFn_sphere_sliced(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceFn_sphere_sliced(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float r1 = Sampler_world_size * 0.45f;
 	const float r2 = Sampler_world_size * 0.25f;
@@ -31,14 +221,14 @@ float SurfaceFn_sphere_sliced(float x, float y, float z, float w, struct osn_con
 	return max(f1, -f2);
 }
 
-__forceinline float SurfaceD_sphere(float x, float y, float z, float w, struct osn_context* osn_context)
+__forceinline float SurfaceD_sphere(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float r = Sampler_world_size * 0.45f;
 	return sqrtf(x * x + y * y + z * z) - r;
 }
 
 
-__forceinline float SurfaceD_torus_z(float x, float y, float z, float w, struct osn_context* osn_context)
+__forceinline float SurfaceD_torus_z(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float r1 = (float)Sampler_world_size / 4.0f;
 	const float r2 = (float)Sampler_world_size / 10.0f;
@@ -47,12 +237,12 @@ __forceinline float SurfaceD_torus_z(float x, float y, float z, float w, struct
 	return len - r2;
 }
 
-float SurfaceD_plane(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceD_plane(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	return -z + 0.01f;
 }
 
-float SurfaceFn_Klein_bottle(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceFn_Klein_bottle(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float m = 8.0f / Sampler_world_size;
 	x *= m;
@@ -65,37 +255,42 @@ float SurfaceFn_Klein_bottle(float x, float y, float z, float w, struct osn_cont
 	return a * b + c;
 }
 
-float SurfaceFn_2d_terrain(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceH_2d_terrain(float x, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float scale = 0.005f;
-	return y - open_simplex_noise2_oct(osn_context, x * scale + w, z * scale, 8, 0.5f) * 0.2f * Sampler_world_size;
+	return SAMPLER_NOISE2_OCT_LOD(TERRAIN_2D_FLOAT_NOISE, osn_context, x * scale + w, z * scale, 8, 0.5f, Sampler_max_frequency(scale, footprint)) * 0.2f * Sampler_world_size;
 }
 
-float SurfaceFn_3d_terrain(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceFn_2d_terrain(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
+{
+	return y - SurfaceH_2d_terrain(x, z, w, footprint, osn_context);
+}
+
+float SurfaceFn_3d_terrain(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float scale = 0.01f;
-	return y - open_simplex_noise3_oct(osn_context, x * scale + w, y * scale, z * scale, 2, 0.5f) * 0.6f * Sampler_world_size;
+	return y - SAMPLER_NOISE3_OCT_LOD(TERRAIN_3D_FLOAT_NOISE, osn_context, x * scale + w, y * scale, z * scale, 2, 0.5f, Sampler_max_frequency(scale, footprint)) * 0.6f * Sampler_world_size;
 }
 
-float SurfaceFn_sphere_r(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceFn_sphere_r(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float scale = 0.15f;
 	float r = Sampler_world_size * 0.8f;
-	r += open_simplex_noise3(osn_context, x * scale + w, y * scale, z * scale) * Sampler_world_size * 4.0f;
+	r += SAMPLER_NOISE3(SPHERE_R_FLOAT_NOISE, osn_context, x * scale + w, y * scale, z * scale) * Sampler_world_size * 4.0f;
 	return x * x + y * y + z * z - r;
 }
 
-float SurfaceFn_torus_r(float x, float y, float z, float w, struct osn_context* osn_context)
+float SurfaceFn_torus_r(float x, float y, float z, float w, float footprint, struct osn_context* osn_context)
 {
 	const float scale = 0.15f;
-	const float r1 = (float)Sampler_world_size / 4.0f + open_simplex_noise3(osn_context, x * scale + w, y * scale, z * scale) * 4.0f;
+	const float r1 = (float)Sampler_world_size / 4.0f + SAMPLER_NOISE3(TORUS_R_FLOAT_NOISE, osn_context, x * scale + w, y * scale, z * scale) * 4.0f;
 	const float r2 = (float)Sampler_world_size / 10.0f;
 	float q_x = fabsf(sqrtf(x * x + y * y)) - r1;
 	float len = sqrtf(q_x * q_x + z * z);
 	return len - r2;
 }
 
-float SurfaceFn_windy(float x, float y, float z, float w, struct osn_context* osn)
+float SurfaceFn_windy(float x, float y, float z, float w, float footprint, struct osn_context* osn)
 {
 	float g_scale = 0.005f;
 	float ym = 2.0f;
@@ -103,11 +298,295 @@ float SurfaceFn_windy(float x, float y, float z, float w, struct osn_context* os
 	const float wind_percent = 7.8f;
 	float height = 128;
 
-	float wind_x = open_simplex_noise3_oct(osn, x * wind_scale + 1.186f, y * wind_scale + 1.186f, z * wind_scale + 1.186f, 4, 0.5f) * wind_percent;
-	float wind_y = open_simplex_noise3_oct(osn, x * wind_scale + 0.842f, y * wind_scale + 0.842f, z * wind_scale + 0.842f, 4, 0.5f) * wind_percent;
-	float wind_z = open_simplex_noise3_oct(osn, x * wind_scale + 0.357f, y * wind_scale + 0.357f, z * wind_scale + 0.357f, 4, 0.5f) * wind_percent;
+	vec3 wind;
+	if (WINDY_FUSED_WARP)
+		Sampler_domain_warp3(osn, x * wind_scale + 1.186f, y * wind_scale + 1.186f, z * wind_scale + 1.186f, 4, 0.5f, Sampler_max_frequency(wind_scale, footprint), wind_percent, wind);
+	else
+	{
+		wind[0] = SAMPLER_NOISE3_OCT(WINDY_FLOAT_NOISE, osn, x * wind_scale + 1.186f, y * wind_scale + 1.186f, z * wind_scale + 1.186f, 4, 0.5f) * wind_percent;
+		wind[1] = SAMPLER_NOISE3_OCT(WINDY_FLOAT_NOISE, osn, x * wind_scale + 0.842f, y * wind_scale + 0.842f, z * wind_scale + 0.842f, 4, 0.5f) * wind_percent;
+		wind[2] = SAMPLER_NOISE3_OCT(WINDY_FLOAT_NOISE, osn, x * wind_scale + 0.357f, y * wind_scale + 0.357f, z * wind_scale + 0.357f, 4, 0.5f) * wind_percent;
+	}
 
-	float n = open_simplex_noise3_oct(osn, x * g_scale + wind_x, y * g_scale + wind_y, z * g_scale + wind_z, 4, 0.5f) * height;
+	float n = SAMPLER_NOISE3_OCT_LOD(WINDY_FLOAT_NOISE, osn, x * g_scale + wind[0], y * g_scale + wind[1], z * g_scale + wind[2], 4, 0.5f, Sampler_max_frequency(g_scale, footprint)) * height;
 
 	return y * ym - n - 0.01f;
-}
\ No newline at end of file
+}
+
+// Samples above the volume's isolevel are inside, as with densities from scans
+float SurfaceFn_volume(float x, float y, float z, float w, float footprint, struct osn_context* osn)
+{
+	struct BrickVolume* volume = Sampler_volume;
+	if (!volume)
+		return 1.0f;
+
+	float scale;
+	vec3 offset;
+	_Sampler_volume_map(volume, &scale, offset);
+	float value = BrickVolume_sample(volume, x * scale + offset[0], y * scale + offset[1], z * scale + offset[2]);
+	return volume->header.isolevel - value;
+}
+
+// Sampler world to volume sample coordinates, centred so the longest side spans the world
+void _Sampler_volume_map(struct BrickVolume* volume, float* scale, vec3 offset)
+{
+	uint32_t* dims = volume->header.dims;
+	float longest = (float)max(dims[0], max(dims[1], dims[2])) - 1.0f;
+	*scale = longest / Sampler_world_size;
+	for (int i = 0; i < 3; i++)
+		offset[i] = (float)(dims[i] - 1) * 0.5f;
+}
+
+float SurfaceFn_graph(float x, float y, float z, float w, float footprint, struct osn_context* osn)
+{
+	float out = 1.0f;
+	if (Sampler_graph)
+		SamplerProgram_run(Sampler_graph, &x, &y, &z, &out, 1, footprint, osn);
+	return out;
+}
+
+float SurfaceFn_edited(float x, float y, float z, float w, float footprint, struct osn_context* osn)
+{
+	if (!Sampler_edits)
+		return 1.0f;
+	return EditLayer_sample(Sampler_edits, x, y, z, w, footprint, osn);
+}
+
+// Samplers that ignore w never move
+float SurfaceT_static(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	return 0;
+}
+
+float SurfaceT_sphere(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	// (x + a)^2 - (x + b)^2 = (a - b)(2x + a + b), plus rounding on the squares the values are made of
+	const float r = Sampler_world_size * 0.45f;
+	if (w0 == w1)
+		return 0;
+	float x_n, x_f, d_n, d_f;
+	float w_f = max(fabsf(w0), fabsf(w1));
+	_Sampler_axis_range(box_min[0], box_max[0], &x_n, &x_f);
+	_Sampler_distance_range(box_min, box_max, 7, &d_n, &d_f);
+	float reach = d_f + w_f;
+	return (w1 - w0) * 2.0f * (x_f + w_f) + (reach * reach + r * r) * SAMPLER_BOUNDS_SLACK * 4.0f;
+}
+
+// The noise samplers shift their first noise coordinate by w, so they move no faster than their noise does along it.
+// The slack covers the float noise rounding differently at the two shifted coordinates.
+float SurfaceT_2d_terrain(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	if (w0 == w1)
+		return 0;
+	return ((w1 - w0) * Sampler_octave_rate(8, 0.5f) + OSN_BOUND_EPSILON) * 0.2f * Sampler_world_size;
+}
+
+float SurfaceT_3d_terrain(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	if (w0 == w1)
+		return 0;
+	return ((w1 - w0) * Sampler_octave_rate(2, 0.5f) + OSN_BOUND_EPSILON) * 0.6f * Sampler_world_size;
+}
+
+float SurfaceT_sphere_r(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	if (w0 == w1)
+		return 0;
+	return ((w1 - w0) * OSN_LIPSCHITZ_BOUND + OSN_BOUND_EPSILON) * Sampler_world_size * 4.0f;
+}
+
+float SurfaceT_torus_r(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	// The distance to the ring moves no further than the ring radius does
+	if (w0 == w1)
+		return 0;
+	return ((w1 - w0) * OSN_LIPSCHITZ_BOUND + OSN_BOUND_EPSILON) * 4.0f;
+}
+
+float SurfaceT_edited(vec3 box_min, vec3 box_max, float w0, float w1)
+{
+	if (!Sampler_edits)
+		return 0;
+	return EditLayer_drift(Sampler_edits, box_min, box_max, w0, w1);
+}
+
+void SurfaceBatch_graph(const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float w, float footprint, struct osn_context* osn)
+{
+	if (!Sampler_graph)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = 1.0f;
+		return;
+	}
+	SamplerProgram_run(Sampler_graph, xs, ys, zs, out, count, footprint, osn);
+}
+
+void SurfaceBatch_volume(const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float w, float footprint, struct osn_context* osn)
+{
+	struct BrickVolume* volume = Sampler_volume;
+	if (!volume)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = 1.0f;
+		return;
+	}
+
+	float scale;
+	vec3 offset;
+	_Sampler_volume_map(volume, &scale, offset);
+	vec3 points[SAMPLER_BLOCK];
+	for (uint32_t i0 = 0; i0 < count; i0 += SAMPLER_BLOCK)
+	{
+		uint32_t n = count - i0 < SAMPLER_BLOCK ? count - i0 : SAMPLER_BLOCK;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			points[i][0] = xs[i0 + i] * scale + offset[0];
+			points[i][1] = ys[i0 + i] * scale + offset[1];
+			points[i][2] = zs[i0 + i] * scale + offset[2];
+		}
+		BrickVolume_sample_batch(volume, points, out + i0, n);
+		for (uint32_t i = 0; i < n; i++)
+			out[i0 + i] = volume->header.isolevel - out[i0 + i];
+	}
+}
+
+void SurfaceB_sphere(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float r = Sampler_world_size * 0.45f;
+	vec3 shifted_min = { box_min[0] + w, box_min[1], box_min[2] };
+	vec3 shifted_max = { box_max[0] + w, box_max[1], box_max[2] };
+	float n, f;
+	_Sampler_distance_range(shifted_min, shifted_max, 7, &n, &f);
+	float slack = SAMPLER_BOUNDS_SLACK * (f * f + r * r);
+	*lo = n * n - r * r - slack;
+	*hi = f * f - r * r + slack;
+}
+
+void SurfaceB_sphere_sliced(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float r1 = Sampler_world_size * 0.45f;
+	const float r2 = Sampler_world_size * 0.25f;
+	float n, f;
+	_Sampler_distance_range(box_min, box_max, 7, &n, &f);
+	float slack = SAMPLER_BOUNDS_SLACK * (f * f + r1 * r1);
+	*lo = max(n * n - r1 * r1, r2 * r2 - f * f) - slack;
+	*hi = max(f * f - r1 * r1, r2 * r2 - n * n) + slack;
+}
+
+void SurfaceB_sphere_d(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float r = Sampler_world_size * 0.45f;
+	float n, f;
+	_Sampler_distance_range(box_min, box_max, 7, &n, &f);
+	*lo = n - r;
+	*hi = f - r;
+}
+
+void SurfaceB_torus_z(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float r1 = (float)Sampler_world_size / 4.0f;
+	const float r2 = (float)Sampler_world_size / 10.0f;
+	float ring_n, ring_f, q_n, q_f, z_n, z_f;
+	_Sampler_distance_range(box_min, box_max, 3, &ring_n, &ring_f);
+	_Sampler_axis_range(ring_n - r1, ring_f - r1, &q_n, &q_f);
+	_Sampler_axis_range(box_min[2], box_max[2], &z_n, &z_f);
+	*lo = sqrtf(q_n * q_n + z_n * z_n) - r2;
+	*hi = sqrtf(q_f * q_f + z_f * z_f) - r2;
+}
+
+void SurfaceB_plane(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	*lo = -box_max[2] + 0.01f;
+	*hi = -box_min[2] + 0.01f;
+}
+
+void SurfaceB_2d_terrain(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float scale = 0.005f;
+	const float amplitude = 0.2f * Sampler_world_size;
+	float cx = (box_min[0] + box_max[0]) * 0.5f, cz = (box_min[2] + box_max[2]) * 0.5f;
+	float hx = (box_max[0] - box_min[0]) * 0.5f, hz = (box_max[2] - box_min[2]) * 0.5f;
+	float n_lo, n_hi;
+	open_simplex_noise2f_oct_bounds(osn, cx * scale + w, cz * scale, sqrtf(hx * hx + hz * hz) * scale, 8, 0.5f, Sampler_max_frequency(scale, footprint), &n_lo, &n_hi);
+	*lo = box_min[1] - n_hi * amplitude;
+	*hi = box_max[1] - n_lo * amplitude;
+}
+
+void SurfaceB_3d_terrain(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float scale = 0.01f;
+	const float amplitude = 0.6f * Sampler_world_size;
+	vec3 c;
+	float r = _Sampler_box_ball(box_min, box_max, c);
+	float n_lo, n_hi;
+	open_simplex_noise3f_oct_bounds(osn, c[0] * scale + w, c[1] * scale, c[2] * scale, r * scale, 2, 0.5f, Sampler_max_frequency(scale, footprint), &n_lo, &n_hi);
+	*lo = box_min[1] - n_hi * amplitude;
+	*hi = box_max[1] - n_lo * amplitude;
+}
+
+void SurfaceB_sphere_r(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float scale = 0.15f;
+	vec3 c;
+	float r = _Sampler_box_ball(box_min, box_max, c);
+	float n_lo, n_hi, n, f;
+	open_simplex_noise3f_oct_bounds(osn, c[0] * scale + w, c[1] * scale, c[2] * scale, r * scale, 1, 0.5f, 0, &n_lo, &n_hi);
+	_Sampler_distance_range(box_min, box_max, 7, &n, &f);
+	float slack = SAMPLER_BOUNDS_SLACK * (f * f + Sampler_world_size * 4.8f);
+	*lo = n * n - (Sampler_world_size * 0.8f + n_hi * Sampler_world_size * 4.0f) - slack;
+	*hi = f * f - (Sampler_world_size * 0.8f + n_lo * Sampler_world_size * 4.0f) + slack;
+}
+
+void SurfaceB_torus_r(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	const float scale = 0.15f;
+	const float r2 = (float)Sampler_world_size / 10.0f;
+	vec3 c;
+	float r = _Sampler_box_ball(box_min, box_max, c);
+	float n_lo, n_hi, ring_n, ring_f, q_n, q_f, z_n, z_f;
+	open_simplex_noise3f_oct_bounds(osn, c[0] * scale + w, c[1] * scale, c[2] * scale, r * scale, 1, 0.5f, 0, &n_lo, &n_hi);
+	_Sampler_distance_range(box_min, box_max, 3, &ring_n, &ring_f);
+	_Sampler_axis_range(ring_n - ((float)Sampler_world_size / 4.0f + n_hi * 4.0f), ring_f - ((float)Sampler_world_size / 4.0f + n_lo * 4.0f), &q_n, &q_f);
+	_Sampler_axis_range(box_min[2], box_max[2], &z_n, &z_f);
+	*lo = sqrtf(q_n * q_n + z_n * z_n) - r2;
+	*hi = sqrtf(q_f * q_f + z_f * z_f) - r2;
+}
+
+void SurfaceB_windy(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	float g_scale = 0.005f;
+	float ym = 2.0f;
+	const float wind_percent = 7.8f;
+	float height = 128;
+
+	// The warp can move each coordinate by up to wind_percent, so it widens the noise-space ball by that diagonal
+	vec3 c;
+	float r = _Sampler_box_ball(box_min, box_max, c);
+	float radius = r * g_scale + wind_percent * OSN_AMPLITUDE_BOUND * 1.7320508f;
+	float n_lo, n_hi;
+	open_simplex_noise3f_oct_bounds(osn, c[0] * g_scale, c[1] * g_scale, c[2] * g_scale, radius, 4, 0.5f, Sampler_max_frequency(g_scale, footprint), &n_lo, &n_hi);
+	*lo = box_min[1] * ym - n_hi * height - 0.01f;
+	*hi = box_max[1] * ym - n_lo * height - 0.01f;
+}
+
+void SurfaceB_graph(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	if (!Sampler_graph)
+	{
+		*lo = 1.0f;
+		*hi = 1.0f;
+		return;
+	}
+	SamplerProgram_bounds(Sampler_graph, box_min, box_max, footprint, osn, lo, hi);
+}
+
+void SurfaceB_edited(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	if (!Sampler_edits)
+	{
+		*lo = 1.0f;
+		*hi = 1.0f;
+		return;
+	}
+	EditLayer_bounds(Sampler_edits, box_min, box_max, w, footprint, osn, lo, hi);
+}
@@ -1,21 +1,104 @@
 #pragma once
 
 #include <cglm\cglm.h>
+#include "BrickVolume.h"
+#include "EditLayer.h"
 #include "OpenSimplexNoise.h"
+#include "Options.h"
+#include "SamplerGraph.h"
 
 // Provides a bunch of different functions representing difference surfaces.
 // Fn means it provides a raw scalar.
 // D means it provides an actual distance distance value.
+// B gives a conservative [lo, hi] of the matching sampler over an axis-aligned box.
+// T bounds how far the matching sampler can move over a box while w changes, for animated fields.
+
+// Noise precision per sampler: 1 uses the float OpenSimplex path, 0 the double reference.
+#define TERRAIN_2D_FLOAT_NOISE FLOAT_NOISE
+#define TERRAIN_3D_FLOAT_NOISE FLOAT_NOISE
+#define SPHERE_R_FLOAT_NOISE FLOAT_NOISE
+#define TORUS_R_FLOAT_NOISE FLOAT_NOISE
+#define WINDY_FLOAT_NOISE FLOAT_NOISE
+
+// Evaluate the windy warp channels in one fused multi-channel call, needs the float path
+#define WINDY_FUSED_WARP WINDY_FLOAT_NOISE
+
+// Octave sums limited to what the sample footprint can resolve; the double reference always runs every octave
+#define SAMPLER_NOISE2_OCT_LOD(use_float, ctx, x, y, octaves, pers, max_frequency) ((use_float) ? open_simplex_noise2f_oct_lod(ctx, x, y, octaves, pers, max_frequency) : (float)open_simplex_noise2_oct(ctx, x, y, octaves, pers))
+#define SAMPLER_NOISE3_OCT_LOD(use_float, ctx, x, y, z, octaves, pers, max_frequency) ((use_float) ? open_simplex_noise3f_oct_lod(ctx, x, y, z, octaves, pers, max_frequency) : (float)open_simplex_noise3_oct(ctx, x, y, z, octaves, pers))
+
+#define SAMPLER_NOISE3(use_float, ctx, x, y, z) ((use_float) ? open_simplex_noise3f(ctx, x, y, z) : (float)open_simplex_noise3(ctx, x, y, z))
+// Heightfield samplers are y - height(x, z); SurfaceH_ functions give the height alone so the extractor can cache it per column
+typedef float(*HeightfieldFn)(float x, float z, float w, float footprint, struct osn_context* osn);
+
+#define SAMPLER_NOISE2_OCT(use_float, ctx, x, y, octaves, pers) ((use_float) ? open_simplex_noise2f_oct(ctx, x, y, octaves, pers) : (float)open_simplex_noise2_oct(ctx, x, y, octaves, pers))
+#define SAMPLER_NOISE3_OCT(use_float, ctx, x, y, z, octaves, pers) ((use_float) ? open_simplex_noise3f_oct(ctx, x, y, z, octaves, pers) : (float)open_simplex_noise3_oct(ctx, x, y, z, octaves, pers))
+
+// Samplers that can evaluate many points per call; xs/ys/zs/out hold count points each
+typedef void(*SamplerBatchFn)(const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float w, float footprint, struct osn_context* osn);
+
+// Bounds over box_min..box_max; footprint is the spacing the sampler will be evaluated at, for octave truncation
+typedef void(*SamplerBoundsFn)(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+// How far any value in the box can change between two w in [w0, w1], FLT_MAX when the sampler can't tell
+typedef float(*SamplerDriftFn)(vec3 box_min, vec3 box_max, float w0, float w1);
+// Footprint for bounds that have to hold at whatever spacing the region is later sampled
+#define SAMPLER_ANY_FOOTPRINT 3.4e37f
+// Relative widening for bounds on squared distances, which round noticeably in float at world scale
+#define SAMPLER_BOUNDS_SLACK 1e-6f
+
+HeightfieldFn Sampler_heightfield(const void* sampler);
+SamplerBatchFn Sampler_batch(const void* sampler);
+SamplerBoundsFn Sampler_bounds(const void* sampler);
+SamplerDriftFn Sampler_drift(const void* sampler);
+int Sampler_may_cross(const void* sampler, vec3 box_min, vec3 box_max, float w, float footprint, float isolevel, struct osn_context* osn);
+void _Sampler_axis_range(float lo, float hi, float* nearest, float* farthest);
+void _Sampler_distance_range(vec3 box_min, vec3 box_max, int axes, float* nearest, float* farthest);
+float _Sampler_box_ball(vec3 box_min, vec3 box_max, vec3 center);
+void _Sampler_volume_map(struct BrickVolume* volume, float* scale, vec3 offset);
+float Sampler_max_frequency(float scale, float footprint);
+float Sampler_octave_rate(int octaves, float pers);
+void Sampler_domain_warp3(struct osn_context* osn, float x, float y, float z, int octaves, float pers, float max_frequency, float amount, vec3 out);
+// The volume SurfaceFn_volume meshes, scaled so its longest side spans the sampler world
+extern struct BrickVolume* Sampler_volume;
+// The compiled graph SurfaceFn_graph evaluates, in world coordinates
+extern struct SamplerProgram* Sampler_graph;
+// The edits SurfaceFn_edited composes on top of their base sampler
+extern struct EditLayer* Sampler_edits;
 
 extern __forceinline void Sampler_get_intersection(vec3 v0, vec3 v1, float s0, float s1, float isolevel, vec3 out);
-extern __forceinline float SurfaceFn_sphere(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_sphere_sliced(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceD_sphere(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceD_torus_z(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceD_plane(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_Klein_bottle(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_2d_terrain(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_3d_terrain(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_sphere_r(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_torus_r(float x, float y, float z, float w, struct osn_context* osn_context);
-extern __forceinline float SurfaceFn_windy(float x, float y, float z, float w, struct osn_context* osn);
+extern __forceinline float SurfaceFn_sphere(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_sphere_sliced(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceD_sphere(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceD_torus_z(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceD_plane(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_Klein_bottle(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+float SurfaceH_2d_terrain(float x, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_2d_terrain(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_3d_terrain(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_sphere_r(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_torus_r(float x, float y, float z, float w, float footprint, struct osn_context* osn_context);
+extern __forceinline float SurfaceFn_windy(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+float SurfaceFn_volume(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+float SurfaceFn_graph(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+float SurfaceFn_edited(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+void SurfaceB_sphere(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_sphere_sliced(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_sphere_d(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_torus_z(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_plane(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_2d_terrain(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_3d_terrain(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_sphere_r(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_torus_r(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_windy(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_graph(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+void SurfaceB_edited(vec3 box_min, vec3 box_max, float w, float footprint, struct osn_context* osn, float* lo, float* hi);
+float SurfaceT_static(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_sphere(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_2d_terrain(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_3d_terrain(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_sphere_r(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_torus_r(vec3 box_min, vec3 box_max, float w0, float w1);
+float SurfaceT_edited(vec3 box_min, vec3 box_max, float w0, float w1);
+void SurfaceBatch_graph(const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float w, float footprint, struct osn_context* osn);
+void SurfaceBatch_volume(const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float w, float footprint, struct osn_context* osn);
@@ -0,0 +1,563 @@
+#include "SamplerGraph.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Sampler.h"
+
+int SamplerGraph_init(struct SamplerGraph* graph)
+{
+	graph->count = 0;
+	graph->size = 64;
+	graph->root = -1;
+	graph->nodes = malloc(graph->size * sizeof(struct SamplerNode));
+	if (!graph->nodes)
+	{
+		printf("Failed to alloc sampler graph.\n");
+		graph->size = 0;
+		return 1;
+	}
+
+	// Nodes 0-2 are always the sample position
+	SamplerGraph_add(graph, SG_X, -1, -1, -1, 0, 0, 0);
+	SamplerGraph_add(graph, SG_Y, -1, -1, -1, 0, 0, 0);
+	SamplerGraph_add(graph, SG_Z, -1, -1, -1, 0, 0, 0);
+	return 0;
+}
+
+void SamplerGraph_destroy(struct SamplerGraph* graph)
+{
+	free(graph->nodes);
+	graph->nodes = 0;
+	graph->count = 0;
+	graph->size = 0;
+	graph->root = -1;
+}
+
+int32_t SamplerGraph_add(struct SamplerGraph* graph, enum SamplerOp op, int32_t a, int32_t b, int32_t c, float k0, float k1, float k2)
+{
+	if (graph->count == graph->size)
+	{
+		uint32_t new_size = graph->size ? graph->size * 2 : 64;
+		struct SamplerNode* new_nodes = realloc(graph->nodes, new_size * sizeof(struct SamplerNode));
+		if (!new_nodes)
+		{
+			printf("Failed to grow sampler graph.\n");
+			return -1;
+		}
+		graph->nodes = new_nodes;
+		graph->size = new_size;
+	}
+
+	struct SamplerNode* node = graph->nodes + graph->count;
+	node->op = (uint8_t)op;
+	node->a = a;
+	node->b = b;
+	node->c = c;
+	node->k[0] = k0;
+	node->k[1] = k1;
+	node->k[2] = k2;
+	graph->root = (int32_t)graph->count;
+	return (int32_t)graph->count++;
+}
+
+int32_t SamplerGraph_const(struct SamplerGraph* graph, float value)
+{
+	return SamplerGraph_add(graph, SG_CONST, -1, -1, -1, value, 0, 0);
+}
+
+int32_t SamplerGraph_sphere(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t r)
+{
+	int32_t length = SamplerGraph_add(graph, SG_LENGTH3, px, py, pz, 0, 0, 0);
+	return SamplerGraph_add(graph, SG_SUB, length, r, -1, 0, 0, 0);
+}
+
+int32_t SamplerGraph_box(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t hx, int32_t hy, int32_t hz)
+{
+	// length(max(q, 0)) + min(max(q.x, q.y, q.z), 0) with q = |p| - h
+	int32_t p[3] = { px, py, pz }, h[3] = { hx, hy, hz }, q[3], outside[3];
+	int32_t zero = SamplerGraph_const(graph, 0);
+	for (int i = 0; i < 3; i++)
+	{
+		int32_t abs_p = SamplerGraph_add(graph, SG_ABS, p[i], -1, -1, 0, 0, 0);
+		q[i] = SamplerGraph_add(graph, SG_SUB, abs_p, h[i], -1, 0, 0, 0);
+		outside[i] = SamplerGraph_add(graph, SG_MAX, q[i], zero, -1, 0, 0, 0);
+	}
+	int32_t outside_length = SamplerGraph_add(graph, SG_LENGTH3, outside[0], outside[1], outside[2], 0, 0, 0);
+	int32_t largest = SamplerGraph_add(graph, SG_MAX, q[1], q[2], -1, 0, 0, 0);
+	largest = SamplerGraph_add(graph, SG_MAX, q[0], largest, -1, 0, 0, 0);
+	int32_t inside = SamplerGraph_add(graph, SG_MIN, largest, zero, -1, 0, 0, 0);
+	return SamplerGraph_add(graph, SG_ADD, outside_length, inside, -1, 0, 0, 0);
+}
+
+int32_t SamplerGraph_torus(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t r1, int32_t r2)
+{
+	int32_t ring = SamplerGraph_add(graph, SG_LENGTH2, px, pz, -1, 0, 0, 0);
+	int32_t q = SamplerGraph_add(graph, SG_SUB, ring, r1, -1, 0, 0, 0);
+	int32_t length = SamplerGraph_add(graph, SG_LENGTH2, q, py, -1, 0, 0, 0);
+	return SamplerGraph_add(graph, SG_SUB, length, r2, -1, 0, 0, 0);
+}
+
+int SamplerGraph_load(struct SamplerGraph* graph, const char* path)
+{
+	FILE* in = fopen(path, "r");
+	if (!in)
+	{
+		printf("Failed to open sampler graph %s.\n", path);
+		return 1;
+	}
+
+	static char names[SAMPLER_GRAPH_MAX_NAMES][32];
+	int32_t name_nodes[SAMPLER_GRAPH_MAX_NAMES];
+	uint32_t name_count = 3;
+	strcpy(names[0], "x");
+	strcpy(names[1], "y");
+	strcpy(names[2], "z");
+	for (int i = 0; i < 3; i++)
+		name_nodes[i] = i;
+
+	char line[256];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), in))
+	{
+		line_number++;
+		if (_SamplerGraph_parse_line(graph, line, names, name_nodes, &name_count))
+		{
+			printf("%s:%i: invalid sampler graph line.\n", path, line_number);
+			fclose(in);
+			return 1;
+		}
+	}
+	fclose(in);
+
+	if (graph->root < 3)
+	{
+		printf("Sampler graph %s defines no surface.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+int SamplerGraph_compile(struct SamplerGraph* graph, struct SamplerProgram* program)
+{
+	program->code = 0;
+	program->count = 0;
+	program->register_count = 3;
+	program->result = 0;
+	if (graph->root < 0)
+		return 1;
+
+	// Walk back from the root to find live nodes and where each is last read
+	uint32_t count = graph->count;
+	int32_t* last_use = malloc(count * sizeof(int32_t));
+	uint8_t* registers = malloc(count);
+	program->code = malloc(count * sizeof(struct SamplerInstruction));
+	if (!last_use || !registers || !program->code)
+	{
+		printf("Failed to alloc sampler program.\n");
+		free(last_use);
+		free(registers);
+		SamplerProgram_destroy(program);
+		return 1;
+	}
+	for (uint32_t i = 0; i < count; i++)
+		last_use[i] = -1;
+	last_use[graph->root] = (int32_t)count;
+	for (int32_t i = graph->root; i >= 0; i--)
+	{
+		struct SamplerNode* node = graph->nodes + i;
+		if (last_use[i] < 0)
+			continue;
+		int32_t operands[3] = { node->a, node->b, node->c };
+		for (int o = 0; o < 3; o++)
+		{
+			if (operands[o] >= 0 && last_use[operands[o]] < i)
+				last_use[operands[o]] = i;
+		}
+	}
+
+	// Registers 0-2 hold the position for the whole block; the rest are reused as soon as their value is dead
+	uint8_t free_registers[SAMPLER_GRAPH_MAX_REGISTERS];
+	int free_count = 0;
+	for (int r = SAMPLER_GRAPH_MAX_REGISTERS - 1; r >= 3; r--)
+		free_registers[free_count++] = (uint8_t)r;
+	registers[0] = 0;
+	registers[1] = 1;
+	registers[2] = 2;
+
+	for (int32_t i = 3; i <= graph->root; i++)
+	{
+		struct SamplerNode* node = graph->nodes + i;
+		if (last_use[i] < 0)
+			continue;
+
+		// Operands are read lane by lane before the result is written, so a dying operand's register can take it
+		int32_t operands[3] = { node->a, node->b, node->c };
+		for (int o = 0; o < 3; o++)
+		{
+			int32_t n = operands[o];
+			int repeated = (o > 0 && operands[0] == n) || (o > 1 && operands[1] == n);
+			if (n >= 3 && last_use[n] == i && !repeated)
+				free_registers[free_count++] = registers[n];
+		}
+		if (!free_count)
+		{
+			printf("Sampler graph needs more than %i registers.\n", SAMPLER_GRAPH_MAX_REGISTERS);
+			free(last_use);
+			free(registers);
+			SamplerProgram_destroy(program);
+			return 1;
+		}
+		registers[i] = free_registers[--free_count];
+		if ((uint32_t)registers[i] + 1 > program->register_count)
+			program->register_count = registers[i] + 1;
+
+		struct SamplerInstruction* instruction = program->code + program->count++;
+		instruction->op = node->op;
+		instruction->dest = registers[i];
+		instruction->a = node->a >= 0 ? registers[node->a] : 0;
+		instruction->b = node->b >= 0 ? registers[node->b] : 0;
+		instruction->c = node->c >= 0 ? registers[node->c] : 0;
+		memcpy(instruction->k, node->k, sizeof(node->k));
+	}
+
+	program->result = registers[graph->root];
+	free(last_use);
+	free(registers);
+	return 0;
+}
+
+void SamplerProgram_destroy(struct SamplerProgram* program)
+{
+	free(program->code);
+	program->code = 0;
+	program->count = 0;
+}
+
+void SamplerProgram_run(struct SamplerProgram* program, const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float footprint, struct osn_context* osn)
+{
+	for (uint32_t i = 0; i < count; i += SAMPLER_BLOCK)
+	{
+		uint32_t n = count - i < SAMPLER_BLOCK ? count - i : SAMPLER_BLOCK;
+		_SamplerProgram_run_block(program, xs + i, ys + i, zs + i, out + i, n, footprint, osn);
+	}
+}
+
+// Interval arithmetic over the same registers; every op widens rather than risk excluding a reachable value
+void SamplerProgram_bounds(struct SamplerProgram* program, const float* box_min, const float* box_max, float footprint, struct osn_context* osn, float* lo, float* hi)
+{
+	float l[SAMPLER_GRAPH_MAX_REGISTERS], h[SAMPLER_GRAPH_MAX_REGISTERS];
+	for (int i = 0; i < 3; i++)
+	{
+		l[i] = box_min[i];
+		h[i] = box_max[i];
+	}
+
+	for (uint32_t i = 0; i < program->count; i++)
+	{
+		struct SamplerInstruction* in = program->code + i;
+		float al = l[in->a], ah = h[in->a], bl = l[in->b], bh = h[in->b], cl = l[in->c], ch = h[in->c];
+		float dl, dh;
+
+		switch (in->op)
+		{
+		case SG_CONST:
+			dl = dh = in->k[0];
+			break;
+		case SG_ADD:
+			dl = al + bl;
+			dh = ah + bh;
+			break;
+		case SG_SUB:
+			dl = al - bh;
+			dh = ah - bl;
+			break;
+		case SG_MUL:
+		{
+			float p0 = al * bl, p1 = al * bh, p2 = ah * bl, p3 = ah * bh;
+			dl = fminf(fminf(p0, p1), fminf(p2, p3));
+			dh = fmaxf(fmaxf(p0, p1), fmaxf(p2, p3));
+			break;
+		}
+		case SG_DIV:
+			if (bl <= 0 && bh >= 0)
+			{
+				dl = -INFINITY;
+				dh = INFINITY;
+			}
+			else
+			{
+				float p0 = al / bl, p1 = al / bh, p2 = ah / bl, p3 = ah / bh;
+				dl = fminf(fminf(p0, p1), fminf(p2, p3));
+				dh = fmaxf(fmaxf(p0, p1), fmaxf(p2, p3));
+			}
+			break;
+		case SG_MIN:
+			dl = fminf(al, bl);
+			dh = fminf(ah, bh);
+			break;
+		case SG_MAX:
+			dl = fmaxf(al, bl);
+			dh = fmaxf(ah, bh);
+			break;
+		case SG_NEG:
+			dl = -ah;
+			dh = -al;
+			break;
+		case SG_ABS:
+			dl = al <= 0 && ah >= 0 ? 0 : fminf(fabsf(al), fabsf(ah));
+			dh = fmaxf(fabsf(al), fabsf(ah));
+			break;
+		case SG_SMIN:
+		{
+			// The polynomial blend stays within k/4 below the hard minimum
+			float k = in->k[0] > 0 ? in->k[0] : 1e-6f;
+			dl = fminf(al, bl) - k * 0.25f;
+			dh = fminf(ah, bh);
+			break;
+		}
+		case SG_SMAX:
+		{
+			float k = in->k[0] > 0 ? in->k[0] : 1e-6f;
+			dl = fmaxf(al, bl);
+			dh = fmaxf(ah, bh) + k * 0.25f;
+			break;
+		}
+		case SG_LENGTH2:
+		case SG_LENGTH3:
+		{
+			float near2 = 0, far2 = 0;
+			float ranges[3][2] = { { al, ah }, { bl, bh }, { cl, ch } };
+			for (int o = 0; o < (in->op == SG_LENGTH2 ? 2 : 3); o++)
+			{
+				float rl = ranges[o][0], rh = ranges[o][1];
+				float n = rl <= 0 && rh >= 0 ? 0 : fminf(fabsf(rl), fabsf(rh));
+				float f = fmaxf(fabsf(rl), fabsf(rh));
+				near2 += n * n;
+				far2 += f * f;
+			}
+			dl = sqrtf(near2);
+			dh = sqrtf(far2);
+			break;
+		}
+		case SG_NOISE2:
+		{
+			float scale = in->k[0];
+			float rx = (ah - al) * 0.5f, ry = (bh - bl) * 0.5f;
+			open_simplex_noise2f_oct_bounds(osn, (al + ah) * 0.5f * scale, (bl + bh) * 0.5f * scale, sqrtf(rx * rx + ry * ry) * fabsf(scale), (int)in->k[1], in->k[2], Sampler_max_frequency(scale, footprint), &dl, &dh);
+			break;
+		}
+		case SG_NOISE3:
+		{
+			float scale = in->k[0];
+			float rx = (ah - al) * 0.5f, ry = (bh - bl) * 0.5f, rz = (ch - cl) * 0.5f;
+			open_simplex_noise3f_oct_bounds(osn, (al + ah) * 0.5f * scale, (bl + bh) * 0.5f * scale, (cl + ch) * 0.5f * scale, sqrtf(rx * rx + ry * ry + rz * rz) * fabsf(scale), (int)in->k[1], in->k[2], Sampler_max_frequency(scale, footprint), &dl, &dh);
+			break;
+		}
+		default:
+			dl = -INFINITY;
+			dh = INFINITY;
+			break;
+		}
+
+		l[in->dest] = dl;
+		h[in->dest] = dh;
+	}
+
+	*lo = l[program->result];
+	*hi = h[program->result];
+}
+
+int _SamplerGraph_parse_line(struct SamplerGraph* graph, char* line, char names[][32], int32_t* name_nodes, uint32_t* name_count)
+{
+	static const struct
+	{
+		const char* name;
+		enum SamplerOp op;
+		int operands;
+		int constants;
+	} ops[] =
+	{
+		{ "add", SG_ADD, 2, 0 }, { "sub", SG_SUB, 2, 0 }, { "mul", SG_MUL, 2, 0 }, { "div", SG_DIV, 2, 0 },
+		{ "min", SG_MIN, 2, 0 }, { "max", SG_MAX, 2, 0 }, { "neg", SG_NEG, 1, 0 }, { "abs", SG_ABS, 1, 0 },
+		{ "smin", SG_SMIN, 2, 1 }, { "smax", SG_SMAX, 2, 1 }, { "length2", SG_LENGTH2, 2, 0 }, { "length3", SG_LENGTH3, 3, 0 },
+		{ "noise2", SG_NOISE2, 2, 3 }, { "noise3", SG_NOISE3, 3, 3 },
+	};
+
+	char* tokens[10];
+	int token_count = 0;
+	for (char* t = strtok(line, " \t\r\n"); t && token_count < 10; t = strtok(0, " \t\r\n"))
+		tokens[token_count++] = t;
+	if (!token_count || tokens[0][0] == '#')
+		return 0;
+	if (token_count < 3 || strcmp(tokens[1], "=") || strlen(tokens[0]) >= 32 || *name_count >= SAMPLER_GRAPH_MAX_NAMES)
+		return 1;
+
+	const char* op = tokens[2];
+	char** args = tokens + 3;
+	int arg_count = token_count - 3;
+	int32_t operands[6];
+	int32_t node = -1;
+
+	if (!strcmp(op, "sphere") || !strcmp(op, "box") || !strcmp(op, "torus"))
+	{
+		int expected = !strcmp(op, "sphere") ? 4 : (!strcmp(op, "box") ? 6 : 5);
+		if (arg_count != expected)
+			return 1;
+		for (int i = 0; i < arg_count; i++)
+		{
+			if ((operands[i] = _SamplerGraph_operand(graph, args[i], names, name_nodes, *name_count)) < 0)
+				return 1;
+		}
+		if (expected == 4)
+			node = SamplerGraph_sphere(graph, operands[0], operands[1], operands[2], operands[3]);
+		else if (expected == 6)
+			node = SamplerGraph_box(graph, operands[0], operands[1], operands[2], operands[3], operands[4], operands[5]);
+		else
+			node = SamplerGraph_torus(graph, operands[0], operands[1], operands[2], operands[3], operands[4]);
+	}
+	else
+	{
+		int i = 0;
+		while (i < sizeof(ops) / sizeof(ops[0]) && strcmp(ops[i].name, op))
+			i++;
+		if (i == sizeof(ops) / sizeof(ops[0]) || arg_count != ops[i].operands + ops[i].constants)
+			return 1;
+
+		int32_t o[3] = { -1, -1, -1 };
+		float k[3] = { 0, 0, 0 };
+		for (int a = 0; a < ops[i].operands; a++)
+		{
+			if ((o[a] = _SamplerGraph_operand(graph, args[a], names, name_nodes, *name_count)) < 0)
+				return 1;
+		}
+		for (int a = 0; a < ops[i].constants; a++)
+		{
+			char* end;
+			k[a] = strtof(args[ops[i].operands + a], &end);
+			if (*end)
+				return 1;
+		}
+		node = SamplerGraph_add(graph, ops[i].op, o[0], o[1], o[2], k[0], k[1], k[2]);
+	}
+	if (node < 0)
+		return 1;
+
+	strcpy(names[*name_count], tokens[0]);
+	name_nodes[(*name_count)++] = node;
+	return 0;
+}
+
+int32_t _SamplerGraph_operand(struct SamplerGraph* graph, const char* token, char names[][32], int32_t* name_nodes, uint32_t name_count)
+{
+	char* end;
+	float value = strtof(token, &end);
+	if (!*end)
+		return SamplerGraph_const(graph, value);
+
+	// Latest definition wins, so names can be rebound
+	for (int32_t i = (int32_t)name_count - 1; i >= 0; i--)
+	{
+		if (!strcmp(names[i], token))
+			return name_nodes[i];
+	}
+	return -1;
+}
+
+void _SamplerProgram_run_block(struct SamplerProgram* program, const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float footprint, struct osn_context* osn)
+{
+	float registers[SAMPLER_GRAPH_MAX_REGISTERS][SAMPLER_BLOCK];
+	memcpy(registers[0], xs, count * sizeof(float));
+	memcpy(registers[1], ys, count * sizeof(float));
+	memcpy(registers[2], zs, count * sizeof(float));
+
+	for (uint32_t i = 0; i < program->count; i++)
+	{
+		struct SamplerInstruction* in = program->code + i;
+		float* d = registers[in->dest];
+		float* a = registers[in->a];
+		float* b = registers[in->b];
+		float* c = registers[in->c];
+		uint32_t lane;
+
+		switch (in->op)
+		{
+		case SG_CONST:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = in->k[0];
+			break;
+		case SG_ADD:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] + b[lane];
+			break;
+		case SG_SUB:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] - b[lane];
+			break;
+		case SG_MUL:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] * b[lane];
+			break;
+		case SG_DIV:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] / b[lane];
+			break;
+		case SG_MIN:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] < b[lane] ? a[lane] : b[lane];
+			break;
+		case SG_MAX:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = a[lane] > b[lane] ? a[lane] : b[lane];
+			break;
+		case SG_NEG:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = -a[lane];
+			break;
+		case SG_ABS:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = fabsf(a[lane]);
+			break;
+		case SG_SMIN:
+		case SG_SMAX:
+		{
+			// Polynomial smooth minimum; smooth max is the mirrored smooth min
+			float sign = in->op == SG_SMIN ? 1.0f : -1.0f;
+			float k = in->k[0] > 0 ? in->k[0] : 1e-6f;
+			for (lane = 0; lane < count; lane++)
+			{
+				float va = a[lane] * sign, vb = b[lane] * sign;
+				float h = 0.5f + 0.5f * (vb - va) / k;
+				h = h < 0 ? 0 : (h > 1 ? 1 : h);
+				d[lane] = (vb + (va - vb) * h - k * h * (1.0f - h)) * sign;
+			}
+			break;
+		}
+		case SG_LENGTH2:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = sqrtf(a[lane] * a[lane] + b[lane] * b[lane]);
+			break;
+		case SG_LENGTH3:
+			for (lane = 0; lane < count; lane++)
+				d[lane] = sqrtf(a[lane] * a[lane] + b[lane] * b[lane] + c[lane] * c[lane]);
+			break;
+		case SG_NOISE2:
+		{
+			float scale = in->k[0], max_frequency = Sampler_max_frequency(scale, footprint);
+			for (lane = 0; lane < count; lane++)
+				d[lane] = open_simplex_noise2f_oct_lod(osn, a[lane] * scale, b[lane] * scale, (int)in->k[1], in->k[2], max_frequency);
+			break;
+		}
+		case SG_NOISE3:
+		{
+			float scale = in->k[0], max_frequency = Sampler_max_frequency(scale, footprint);
+			for (lane = 0; lane < count; lane++)
+				d[lane] = open_simplex_noise3f_oct_lod(osn, a[lane] * scale, b[lane] * scale, c[lane] * scale, (int)in->k[1], in->k[2], max_frequency);
+			break;
+		}
+		}
+	}
+
+	memcpy(out, registers[program->result], count * sizeof(float));
+}
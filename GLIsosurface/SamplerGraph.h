@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include "OpenSimplexNoise.h"
+
+// Surfaces built at runtime from a graph of SDF primitives, noise, blends and arithmetic, loaded from a text file.
+// A graph is compiled to a flat register program that is interpreted over blocks of SAMPLER_BLOCK points stored as
+// separate x/y/z arrays, so the per-instruction dispatch is paid once per block rather than once per sample.
+//
+// Each line of a graph file is "name = op arg...", where args are earlier names, x, y, z or numbers; the last line
+// is the surface. Numbers after the coordinate arguments of noise2/noise3 are scale, octaves and persistence.
+//
+//   # sampler graph v1
+//   wx = noise3 x y z 0.002 4 0.5
+//   px = add x wx
+//   ball = sphere px y z 100
+//   hole = torus x y z 64 24
+//   ground = sub y -60
+//   body = smin ball ground 12
+//   surface = smax body hole 4
+//
+// The same program can be run on intervals instead of points, giving conservative bounds over a box.
+//
+// Ops: add sub mul div min max neg abs smin smax (a b k) length2 length3 noise2 (px pz ...) noise3 (px py pz ...)
+// and the primitives sphere (px py pz r), box (px py pz hx hy hz) and torus (px py pz r1 r2, around the y axis).
+
+#define SAMPLER_BLOCK 64
+#define SAMPLER_GRAPH_MAX_REGISTERS 64
+#define SAMPLER_GRAPH_MAX_NAMES 256
+
+enum SamplerOp
+{
+	SG_X,
+	SG_Y,
+	SG_Z,
+	SG_CONST,
+	SG_ADD,
+	SG_SUB,
+	SG_MUL,
+	SG_DIV,
+	SG_MIN,
+	SG_MAX,
+	SG_NEG,
+	SG_ABS,
+	SG_SMIN,
+	SG_SMAX,
+	SG_LENGTH2,
+	SG_LENGTH3,
+	SG_NOISE2,
+	SG_NOISE3,
+};
+
+// Operands are node indexes while building and register indexes once compiled
+struct SamplerNode
+{
+	uint8_t op;
+	int32_t a, b, c;
+	float k[3];
+};
+
+struct SamplerGraph
+{
+	struct SamplerNode* nodes;
+	uint32_t count;
+	uint32_t size;
+	int32_t root;
+};
+
+struct SamplerInstruction
+{
+	uint8_t op;
+	uint8_t dest;
+	uint8_t a, b, c;
+	float k[3];
+};
+
+struct SamplerProgram
+{
+	struct SamplerInstruction* code;
+	uint32_t count;
+	uint32_t register_count;
+	uint8_t result;
+};
+
+int SamplerGraph_init(struct SamplerGraph* graph);
+void SamplerGraph_destroy(struct SamplerGraph* graph);
+int32_t SamplerGraph_add(struct SamplerGraph* graph, enum SamplerOp op, int32_t a, int32_t b, int32_t c, float k0, float k1, float k2);
+int32_t SamplerGraph_const(struct SamplerGraph* graph, float value);
+int32_t SamplerGraph_sphere(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t r);
+int32_t SamplerGraph_box(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t hx, int32_t hy, int32_t hz);
+int32_t SamplerGraph_torus(struct SamplerGraph* graph, int32_t px, int32_t py, int32_t pz, int32_t r1, int32_t r2);
+int SamplerGraph_load(struct SamplerGraph* graph, const char* path);
+int SamplerGraph_compile(struct SamplerGraph* graph, struct SamplerProgram* program);
+
+void SamplerProgram_destroy(struct SamplerProgram* program);
+void SamplerProgram_run(struct SamplerProgram* program, const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float footprint, struct osn_context* osn);
+void SamplerProgram_bounds(struct SamplerProgram* program, const float* box_min, const float* box_max, float footprint, struct osn_context* osn, float* lo, float* hi);
+
+int _SamplerGraph_parse_line(struct SamplerGraph* graph, char* line, char names[][32], int32_t* name_nodes, uint32_t* name_count);
+int32_t _SamplerGraph_operand(struct SamplerGraph* graph, const char* token, char names[][32], int32_t* name_nodes, uint32_t name_count);
+void _SamplerProgram_run_block(struct SamplerProgram* program, const float* xs, const float* ys, const float* zs, float* out, uint32_t count, float footprint, struct osn_context* osn);
@@ -1,9 +1,21 @@
 #include "THierarchy.h"
 #include "TetrahedronTable.h"
 #include "Options.h"
+#include "Timer.h"
+#include "Trace.h"
 #include "OpenSimplexNoise.h"
+#include "Sampler.h"
+#include "Util.h"
+#include <stddef.h>
 #include <time.h>
 
+// The dictionary only ever lives inside a TDiamondStorage, so its hooks can find the storage's counters
+#define TVEC3DICTIONARY_STORAGE(map) ((struct TDiamondStorage*)((char*)(map) - offsetof(struct TDiamondStorage, diamonds)))
+#undef HASHMAP_ON_PROBE
+#define HASHMAP_ON_PROBE(map) HOT_COUNT(TVEC3DICTIONARY_STORAGE(map)->counters.hash_probes, 1)
+#undef HASHMAP_ON_REHASH
+#define HASHMAP_ON_REHASH(map) HOT_COUNT(TVEC3DICTIONARY_STORAGE(map)->counters.hash_rehashes, 1)
+
 #define TVEC3DICTIONARYENTRY_CMP(left, right) left->hash == right->hash ? vec3_compare(left->key, right->key) : 1
 #define TVEC3DICTIONARYENTRY_HASH(entry) entry->hash
 DECLARE_HASHMAP(TVec3Dictionary, TVEC3DICTIONARYENTRY_CMP, TVEC3DICTIONARYENTRY_HASH, free, realloc)
@@ -18,6 +30,7 @@ void TDiamondStorage_init(struct TDiamondStorage* dest)
 {
 	TVec3DictionaryNew(&dest->diamonds);
 	poolInitialize(&dest->t_pool, sizeof(struct TetrahedronNode), 2048);
+	HotCounters_zero(&dest->counters);
 }
 
 void TDiamondStorage_destroy(struct TDiamondStorage* dest)
@@ -88,6 +101,13 @@ void _TDiamondStorage_update_lookup(struct TDiamondStorage* storage, struct TVec
 }
 
 void THierarchy_init(struct THierarchy* dest, int t_resolution)
+{
+	THierarchy_init_empty(dest, t_resolution, 1);
+	THierarchy_refine(dest);
+	THierarchy_extract_all_leaves(dest);
+}
+
+void THierarchy_init_empty(struct THierarchy* dest, int t_resolution, int gl_enabled)
 {
 	dest->pem = !USE_REGULAR_MC;
 	dest->snap_threshold = SNAP_THRESHOLD;
@@ -99,9 +119,18 @@ void THierarchy_init(struct THierarchy* dest, int t_resolution)
 	dest->leaf_count = 0;
 	dest->first_leaf = 0;
 	dest->last_leaf = 0;
+	dest->v_count = 0;
+	dest->p_count = 0;
+	dest->cache_misses_before = 0;
+	dest->cache_misses_after = 0;
+	dest->last_upload_ms = 0;
+	UMC_Timings_zero(&dest->timings);
+	HotCounters_zero(&dest->counters);
+	dest->last_extract_time = 0;
 	dest->outline_vbo = 0;
 	dest->outline_ibo = 0;
 	dest->outline_vao = 0;
+	dest->outline_p_count = 0;
 	dest->outline_created = 0;
 
 	dest->splits.queue = malloc(sizeof(struct TetrahedronNode*) * 256);
@@ -111,6 +140,8 @@ void THierarchy_init(struct THierarchy* dest, int t_resolution)
 		printf("Failed to alloc THierarchy split queue.n");
 
 	TDiamondStorage_init(&dest->diamonds);
+	if (MeshArena_init(&dest->arena, MESH_ARENA_PAGE_VERTICES, MESH_ARENA_PAGE_INDEXES, gl_enabled))
+		printf("Failed to init THierarchy mesh arena.\n");
 
 	open_simplex_noise(77374, &dest->osn);
 
@@ -124,9 +155,6 @@ void THierarchy_init(struct THierarchy* dest, int t_resolution)
 
 	vec3 focus = DEFAULT_FOCUS_POS;
 	vec3_copy(focus, dest->focus_point);
-	THierarchy_split_first(dest, dest->focus_point);
-	_THierarchy_update_leaves(dest);
-	THierarchy_extract_all_leaves(dest);
 }
 
 void THierarchy_destroy(struct THierarchy* dest)
@@ -136,12 +164,13 @@ void THierarchy_destroy(struct THierarchy* dest)
 
 	while (next_node)
 	{
-		TetrahedronNode_destroy(next_node);
+		TetrahedronNode_destroy(next_node, &dest->arena);
 		next_node = next_node->next;
 	}
 
 	free(dest->splits.queue);
 	TDiamondStorage_destroy(&dest->diamonds);
+	MeshArena_destroy(&dest->arena);
 	if (dest->outline_created)
 	{
 		glDeleteVertexArrays(1, &dest->outline_vao);
@@ -246,17 +275,19 @@ void THierarchy_create_outline(struct THierarchy* dest)
 
 void THierarchy_split_first(struct THierarchy* dest, vec3 view_pos)
 {
+	TRACE_BEGIN("THierarchy_split_first");
 	dest->splits.next = 0;
 	for (int i = 0; i < 6; i++)
 	{
 		_THierarchy_enqueue_split(dest, &dest->top_level[i]);
 		THierarchy_check_split(dest, &dest->top_level[i], view_pos);
 	}
+	TRACE_END("THierarchy_split_first");
 }
 
 void THierarchy_check_split(struct THierarchy* dest, struct TetrahedronNode* t, vec3 view_pos)
 {
-	if (_THierarchy_needs_split(t, view_pos, dest->t_resolution, dest->max_depth))
+	if (_THierarchy_needs_split(t, view_pos, dest->t_resolution, dest->max_depth) && _THierarchy_may_contain_surface(dest, t))
 	{
 		struct TVec3DictionaryEntry entry;
 		entry.hash = vec3_hash(t->refinement_key);
@@ -271,6 +302,7 @@ void THierarchy_check_split(struct THierarchy* dest, struct TetrahedronNode* t,
 
 void THierarchy_split_diamond(struct THierarchy* dest, struct TVec3DictionaryEntry* diamond)
 {
+	TRACE_BEGIN("THierarchy_split_diamond");
 	int id = diamond->value.id;
 	for (int i = 0; i < diamond->value.t_count; i++)
 	{
@@ -297,24 +329,27 @@ void THierarchy_split_diamond(struct THierarchy* dest, struct TVec3DictionaryEnt
 
 		_TDiamondStorage_update_lookup(&dest->diamonds, diamond);
 	}
+	TRACE_END("THierarchy_split_diamond");
 }
 
 void THierarchy_extract_tree(struct THierarchy* dest)
+{
+	MeshArena_reset(&dest->arena);
+	THierarchy_refine(dest);
+	THierarchy_extract_all_leaves(dest);
+
+	THierarchy_create_outline(dest);
+}
+
+void THierarchy_reset_tree(struct THierarchy* dest)
 {
 	dest->first_leaf = 0;
+	dest->last_leaf = 0;
 	dest->last_extract_time = 0;
 	dest->leaf_count = 0;
 
-	uint32_t safety_counter = 0;
-	struct TetrahedronNode* next_node = dest->first_leaf;
-
-	while (safety_counter++ < 50000 && next_node)
-	{
-		TetrahedronNode_destroy(next_node);
-		next_node = next_node->next;
-	}
-	TVec3DictionaryDestroy(&dest->diamonds);
-
+	// Every node below the top level lives in the pool, so dropping the pool drops the whole tree
+	TDiamondStorage_destroy(&dest->diamonds);
 	TDiamondStorage_init(&dest->diamonds);
 
 	vec3 start;
@@ -324,39 +359,62 @@ void THierarchy_extract_tree(struct THierarchy* dest)
 		TetrahedronNode_init_top_level(&dest->top_level[i], i, dest->size, start);
 		TDiamondStorage_add_tetrahedron(&dest->diamonds, &dest->top_level[i]);
 	}
+}
 
+void THierarchy_refine(struct THierarchy* dest)
+{
+	THierarchy_reset_tree(dest);
 	THierarchy_split_first(dest, dest->focus_point);
 	_THierarchy_update_leaves(dest);
-	THierarchy_extract_all_leaves(dest);
 
-	THierarchy_create_outline(dest);
+	// The storage is rebuilt every refine and the pool never frees a block early, so its block index is the allocation count
+	if (HOT_PATH_COUNTERS)
+		dest->diamonds.counters.pool_blocks = (uint64_t)(dest->diamonds.t_pool.block + 1);
 }
 
 void THierarchy_extract_all_leaves(struct THierarchy* dest)
 {
 	printf("Extracting mesh on %i leaves...", dest->leaf_count);
-	clock_t start_clock = clock();
+	double start_ms = Timer_ms();
+	double upload_ms = 0;
 
 	uint32_t safety_counter = 0;
 	uint32_t leaf_counter = 0;
 	uint32_t v_count = 0, p_count = 0;
+	uint32_t misses_before = 0, misses_after = 0;
+	struct UMC_Timings timings;
+	UMC_Timings_zero(&timings);
+	struct HotCounters counters = dest->diamonds.counters;
 	struct TetrahedronNode* next_node = dest->first_leaf;
 
 	while (safety_counter++ < 50000 && next_node)
 	{
 		leaf_counter++;
-		TetrahedronNode_extract(next_node, &v_count, &p_count, dest->pem, dest->snap_threshold, dest->osn, dest->sub_resolution);
+		struct LeafMesh mesh;
+		TetrahedronNode_polygonize(next_node, &mesh, dest->pem, dest->snap_threshold, dest->osn, dest->sub_resolution);
+		double upload_start_ms = Timer_ms();
+		TetrahedronNode_upload(next_node, &dest->arena, &mesh);
+		upload_ms += Timer_ms() - upload_start_ms;
+		LeafMesh_destroy(&mesh);
+		UMC_Timings_add(&timings, &next_node->timings);
+		HotCounters_add(&counters, &next_node->counters);
 		v_count += next_node->v_count;
 		p_count += next_node->p_count;
+		misses_before += next_node->cache_misses_before;
+		misses_after += next_node->cache_misses_after;
 		next_node = next_node->next;
 	}
 
-	double delta = clock() - start_clock;
-	dest->last_extract_time = (int)(delta / (double)CLOCKS_PER_SEC * 1000.0);
+	dest->last_extract_time = (uint32_t)(Timer_ms() - start_ms);
 
 	if (safety_counter < 50000)
 	{
-		printf("done (%i ms)\n%i verts, %i prims.\n\n", dest->last_extract_time, v_count, p_count / 3);
+		printf("done (%i ms)\n%i verts, %i prims.\n", dest->last_extract_time, v_count, p_count / 3);
+		if (VERTEX_CACHE_OPTIMIZE && p_count)
+			printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", misses_before * 3.0f / p_count, misses_after * 3.0f / p_count, misses_before / (float)v_count, misses_after / (float)v_count);
+		if (HOT_PATH_COUNTERS)
+			HotCounters_print(&counters);
+		printf("\n");
 		assert(leaf_counter == dest->leaf_count);
 	}
 	else
@@ -364,6 +422,34 @@ void THierarchy_extract_all_leaves(struct THierarchy* dest)
 
 	dest->v_count = v_count;
 	dest->p_count = p_count;
+	dest->cache_misses_before = misses_before;
+	dest->cache_misses_after = misses_after;
+	dest->last_upload_ms = (float)upload_ms;
+	dest->timings = timings;
+	dest->counters = counters;
+}
+
+// Re-extracts only the leaves whose tetrahedra touch the box, for when the field changed inside it and nowhere else.
+// The tree isn't refined, so surface added where the tree was pruned shows at that leaf's coarser level until the next
+// refine. Returns how many leaves were re-extracted.
+uint32_t THierarchy_extract_region(struct THierarchy* dest, vec3 box_min, vec3 box_max)
+{
+	TRACE_BEGIN("THierarchy_extract_region");
+	uint32_t leaf_counter = 0;
+	for (struct TetrahedronNode* t = dest->first_leaf; t; t = t->next)
+	{
+		if (!_THierarchy_touches_box(t, box_min, box_max))
+			continue;
+
+		leaf_counter++;
+		dest->v_count -= t->v_count;
+		dest->p_count -= t->p_count;
+		TetrahedronNode_extract(t, &dest->arena, dest->pem, dest->snap_threshold, dest->osn, dest->sub_resolution);
+		dest->v_count += t->v_count;
+		dest->p_count += t->p_count;
+	}
+	TRACE_END("THierarchy_extract_region");
+	return leaf_counter;
 }
 
 int _THierarchy_enqueue_split(struct THierarchy* dest, struct TetrahedronNode* t)
@@ -398,8 +484,61 @@ int _THierarchy_needs_split(struct TetrahedronNode* t, vec3 v, int tetra_resolut
 	return 0;
 }
 
+// Children only ever cover their parent, so a tetrahedron whose bounds exclude the surface never needs refining
+int _THierarchy_may_contain_surface(struct THierarchy* dest, struct TetrahedronNode* t)
+{
+	if (!BOUNDS_PRUNING)
+		return 1;
+
+	vec3 box_min, box_max;
+	vec3_bounds(t->vertices, 4, box_min, box_max);
+	if (Sampler_may_cross(sampler_fn, box_min, box_max, 0, SAMPLER_ANY_FOOTPRINT, 0.0f, dest->osn))
+		return 1;
+	HOT_COUNT(dest->diamonds.counters.pruned_splits, 1);
+	return 0;
+}
+
+// Conservative: the box is only ruled out when it misses the tetrahedron's bounds or lies past one of its faces
+int _THierarchy_touches_box(struct TetrahedronNode* t, vec3 box_min, vec3 box_max)
+{
+	vec3 t_min, t_max;
+	vec3_bounds(t->vertices, 4, t_min, t_max);
+	for (int i = 0; i < 3; i++)
+	{
+		if (box_min[i] > t_max[i] || box_max[i] < t_min[i])
+			return 0;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		// The face opposite vertex i, its normal pointing away from it
+		float* a = t->vertices[(i + 1) & 3];
+		float* b = t->vertices[(i + 2) & 3];
+		float* c = t->vertices[(i + 3) & 3];
+		vec3 ab, ac, n;
+		glm_vec_sub(b, a, ab);
+		glm_vec_sub(c, a, ac);
+		glm_vec_cross(ab, ac, n);
+		float offset = glm_vec_dot(n, a);
+		if (glm_vec_dot(n, t->vertices[i]) > offset)
+		{
+			vec3_negate(n);
+			offset = -offset;
+		}
+
+		// The box corner furthest back along the normal
+		float nearest = 0;
+		for (int axis = 0; axis < 3; axis++)
+			nearest += n[axis] * (n[axis] > 0 ? box_min[axis] : box_max[axis]);
+		if (nearest > offset)
+			return 0;
+	}
+	return 1;
+}
+
 void _THierarchy_update_leaves(struct THierarchy* dest)
 {
+	TRACE_BEGIN("_THierarchy_update_leaves");
 	uint32_t splits_count = dest->splits.next;
 	for (uint32_t i = 0; i < splits_count; i++)
 	{
@@ -428,4 +567,5 @@ void _THierarchy_update_leaves(struct THierarchy* dest)
 	dest->splits.next = 0;
 
 	printf("Updated leaves (%i).\n", dest->leaf_count);
+	TRACE_END("_THierarchy_update_leaves");
 }
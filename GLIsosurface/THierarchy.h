@@ -29,6 +29,7 @@ struct TDiamondStorage
 {
 	TVec3Dictionary diamonds;
 	pool t_pool;
+	struct HotCounters counters;
 };
 
 struct SplitCheckQueue
@@ -51,11 +52,17 @@ struct THierarchy
 	vec3 focus_point;
 	uint32_t v_count;
 	uint32_t p_count;
+	uint32_t cache_misses_before;
+	uint32_t cache_misses_after;
 	uint32_t last_extract_time;
+	float last_upload_ms;
+	struct UMC_Timings timings;
+	struct HotCounters counters;
 	struct TetrahedronNode top_level[6];
 	struct TetrahedronNode* first_leaf;
 	struct TetrahedronNode* last_leaf;
 	struct TDiamondStorage diamonds;
+	struct MeshArena arena;
 
 	struct SplitCheckQueue splits;
 
@@ -78,14 +85,20 @@ int TDiamondStorage_add_tetrahedron(struct TDiamondStorage* storage, struct Tetr
 void _TDiamondStorage_update_lookup(struct TDiamondStorage* storage, struct TVec3DictionaryEntry* entry);
 
 void THierarchy_init(struct THierarchy* dest, int t_resolution);
+void THierarchy_init_empty(struct THierarchy* dest, int t_resolution, int gl_enabled);
 void THierarchy_destroy(struct THierarchy* dest);
 void THierarchy_create_outline(struct THierarchy* dest);
 void THierarchy_split_first(struct THierarchy* dest, vec3 view_pos);
 void THierarchy_check_split(struct THierarchy* dest, struct TetrahedronNode* t, vec3 view_pos);
 void THierarchy_split_diamond(struct THierarchy* dest, struct TVec3DictionaryEntry* diamond);
 void THierarchy_extract_tree(struct THierarchy* dest);
+void THierarchy_reset_tree(struct THierarchy* dest);
+void THierarchy_refine(struct THierarchy* dest);
 void THierarchy_extract_all_leaves(struct THierarchy* dest);
+uint32_t THierarchy_extract_region(struct THierarchy* dest, vec3 box_min, vec3 box_max);
 
 int _THierarchy_enqueue_split(struct THierarchy* dest, struct TetrahedronNode* t);
 int _THierarchy_needs_split(struct TetrahedronNode* t, vec3 v, int tetra_resolution, int max_depth);
+int _THierarchy_may_contain_surface(struct THierarchy* dest, struct TetrahedronNode* t);
+int _THierarchy_touches_box(struct TetrahedronNode* t, vec3 box_min, vec3 box_max);
 void _THierarchy_update_leaves(struct THierarchy* dest);
\ No newline at end of file
@@ -7,13 +7,14 @@
 #include "MCTable.h"
 #include "THierarchy.h"
 #include "MemoryPool.h"
+#include "VertexCache.h"
+#include "Trace.h"
 
 void TetrahedronNode_init_top_level(struct TetrahedronNode* out, int branch, int size, vec3 start)
 {
 	out->child_index = 0;
 	out->stored_as_leaf = 0;
 	out->hex_init = 0;
-	out->gl_init = 0;
 
 	out->prev = 0;
 	out->next = 0;
@@ -26,16 +27,11 @@ void TetrahedronNode_init_top_level(struct TetrahedronNode* out, int branch, int
 	out->children[1] = 0;
 	//out->refinement_diamond = 0;
 
-	out->vao = 0;
-	out->v_vbo = 0;
-	out->n_vbo = 0;
-	out->ibo = 0;
+	MeshAllocation_init(&out->mesh);
 
 	out->v_count = 0;
 	out->p_count = 0;
 	out->snapped_count = 0;
-	out->vbo_size = 0;
-	out->ibo_size = 0;
 
 	float fsize = (float)size;
 	vec3 middle_total;
@@ -79,7 +75,6 @@ void TetrahedronNode_init_child(struct TetrahedronNode* out, struct TetrahedronN
 	out->child_index = child_index;
 	out->stored_as_leaf = 0;
 	out->hex_init = 0;
-	out->gl_init = 0;
 
 	out->prev = 0;
 	out->next = 0;
@@ -92,16 +87,11 @@ void TetrahedronNode_init_child(struct TetrahedronNode* out, struct TetrahedronN
 	out->children[1] = 0;
 	//out->refinement_diamond = 0;
 
-	out->vao = 0;
-	out->v_vbo = 0;
-	out->n_vbo = 0;
-	out->ibo = 0;
+	MeshAllocation_init(&out->mesh);
 
 	out->v_count = 0;
 	out->p_count = 0;
 	out->snapped_count = 0;
-	out->vbo_size = 0;
-	out->ibo_size = 0;
 
 	vec3 middle_total;
 	vec3_set(middle_total, 0, 0, 0);
@@ -139,7 +129,7 @@ void TetrahedronNode_init_child(struct TetrahedronNode* out, struct TetrahedronN
 	vec3_midpoint(out->refinement_key, out->vertices[v0], out->vertices[v1]);
 }
 
-void TetrahedronNode_destroy(struct TetrahedronNode* t)
+void TetrahedronNode_destroy(struct TetrahedronNode* t, struct MeshArena* arena)
 {
 	if (t->hex_init)
 	{
@@ -148,11 +138,7 @@ void TetrahedronNode_destroy(struct TetrahedronNode* t)
 			Hexahedron_destroy(&t->hexahedra[i]);
 		}
 	}
-	if (t->gl_init)
-	{
-		glDeleteVertexArrays(1, &t->vao);
-		glDeleteBuffers(3, &t->v_vbo);
-	}
+	MeshArena_free(arena, &t->mesh);
 }
 
 int TetrahedronNode_split(struct TetrahedronNode* t, struct TDiamondStorage* storage)
@@ -182,6 +168,8 @@ int TetrahedronNode_split(struct TetrahedronNode* t, struct TDiamondStorage* sto
 		TDiamondStorage_add_tetrahedron(storage, t->children[0]);
 		TDiamondStorage_add_tetrahedron(storage, t->children[1]);
 	}
+
+	return 0;
 }
 
 int TetrahedronNode_add_outline(struct TetrahedronNode* out, vec3** out_verts, uint32_t** out_inds, uint32_t* v_next, uint32_t* v_size, uint32_t* i_next, uint32_t* i_size)
@@ -223,8 +211,21 @@ int TetrahedronNode_is_leaf(struct TetrahedronNode* t)
 	return t->children[0] == 0 && t->children[1] == 0;
 }
 
-uint32_t TetrahedronNode_extract(struct TetrahedronNode* t, uint32_t* v_count, uint32_t* p_count, int pem, float threshold, struct osn_context* osn, int sub_resolution)
+int TetrahedronNode_extract(struct TetrahedronNode* t, struct MeshArena* arena, int pem, float threshold, struct osn_context* osn, int sub_resolution)
+{
+	TRACE_BEGIN("TetrahedronNode_extract");
+	struct LeafMesh mesh;
+	int return_code = TetrahedronNode_polygonize(t, &mesh, pem, threshold, osn, sub_resolution);
+	if (!return_code)
+		return_code = TetrahedronNode_upload(t, arena, &mesh);
+	LeafMesh_destroy(&mesh);
+	TRACE_END("TetrahedronNode_extract");
+	return return_code;
+}
+
+int TetrahedronNode_polygonize(struct TetrahedronNode* t, struct LeafMesh* out, int pem, float threshold, struct osn_context* osn, int sub_resolution)
 {
+	TRACE_BEGIN("TetrahedronNode_polygonize");
 	int return_code = 0;
 	vec3* out_vertices = malloc(4096 * sizeof(vec3));
 	vec3* out_normals = malloc(4096 * sizeof(vec3));
@@ -235,6 +236,20 @@ uint32_t TetrahedronNode_extract(struct TetrahedronNode* t, uint32_t* v_count, u
 	uint32_t next_index = 0;
 	uint32_t out_i_size = 4096;
 
+	out->node = t;
+	out->vertices = 0;
+	out->normals = 0;
+	out->indexes = 0;
+	out->packed = 0;
+	out->short_indexes = 0;
+	out->index_size = sizeof(uint32_t);
+	out->v_count = 0;
+	out->i_count = 0;
+	t->cache_misses_before = 0;
+	t->cache_misses_after = 0;
+	UMC_Timings_zero(&t->timings);
+	HotCounters_zero(&t->counters);
+
 	if (!out_vertices || !out_normals || !out_indexes)
 	{
 		return_code = 1;
@@ -266,87 +281,37 @@ uint32_t TetrahedronNode_extract(struct TetrahedronNode* t, uint32_t* v_count, u
 	Hexahedron_run(&t->hexahedra[2], &out_vertices, &out_normals, &out_v_size, &next_vertex, &out_indexes, &out_i_size, &next_index, osn);
 	Hexahedron_run(&t->hexahedra[3], &out_vertices, &out_normals, &out_v_size, &next_vertex, &out_indexes, &out_i_size, &next_index, osn);
 
+	for (int i = 0; i < 4; i++)
+	{
+		UMC_Timings_add(&t->timings, &t->hexahedra[i].chunk.timings);
+		HotCounters_add(&t->counters, &t->hexahedra[i].chunk.counters);
+	}
+
 	t->v_count = t->hexahedra[0].chunk.v_count + t->hexahedra[1].chunk.v_count + t->hexahedra[2].chunk.v_count + t->hexahedra[3].chunk.v_count;
 	t->p_count = t->hexahedra[0].chunk.p_count + t->hexahedra[1].chunk.p_count + t->hexahedra[2].chunk.p_count + t->hexahedra[3].chunk.p_count;
 
 	if (!t->v_count)
 		goto Cleanup;
 
-	if (!t->gl_init)
-	{
-		// Vertex buffers
-		t->vbo_size = out_v_size;
-		glGenBuffers(1, &t->v_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, t->v_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
-
-		glGenBuffers(1, &t->n_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, t->n_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
-
-		// Index buffers
-		t->ibo_size = out_i_size;
-		glGenBuffers(1, &t->ibo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * next_index, out_indexes, GL_STATIC_DRAW);
-	}
-	else
-	{
-		// Vertex buffers
-		if (out_v_size <= t->vbo_size)
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, t->v_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
+	// Ownership of the buffers moves to the mesh
+	out->vertices = out_vertices;
+	out->normals = out_normals;
+	out->indexes = out_indexes;
+	out->v_count = next_vertex;
+	out->i_count = next_index;
+	out_vertices = 0;
+	out_normals = 0;
+	out_indexes = 0;
 
-			glBindBuffer(GL_ARRAY_BUFFER, t->n_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
-		}
-		else
-		{
-			glDeleteBuffers(2, &t->v_vbo);
-			t->vbo_size = out_v_size;
-
-			glGenBuffers(1, &t->v_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, t->v_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
-
-			glGenBuffers(1, &t->n_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, t->n_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
-		}
-
-		// Index buffer
-		if (out_i_size <= t->ibo_size)
-		{
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * next_index, out_indexes, GL_STATIC_DRAW);
-		}
-		else
-		{
-			glDeleteBuffers(1, &t->ibo);
-			t->ibo_size = out_i_size;
+	if (VERTEX_CACHE_OPTIMIZE && LeafMesh_optimize(out))
+		printf("Failed to optimize leaf mesh, keeping scan order.\n");
 
-			glGenBuffers(1, &t->ibo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * next_index, out_indexes, GL_STATIC_DRAW);
-		}
+	if (COMPACT_VERTICES && LeafMesh_compact(out))
+	{
+		LeafMesh_destroy(out);
+		return_code = 1;
 	}
 
-	if(!t->gl_init)
-		glGenVertexArrays(1, &t->vao);
-
-	glBindVertexArray(t->vao);
-	glBindBuffer(GL_ARRAY_BUFFER, t->v_vbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glBindBuffer(GL_ARRAY_BUFFER, t->n_vbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glBindVertexArray(0);
-
-	t->gl_init = 1;
-
 Cleanup:
 	free(out_vertices);
 	free(out_normals);
@@ -361,5 +326,125 @@ Cleanup:
 		}
 	}
 
+	TRACE_END("TetrahedronNode_polygonize");
 	return return_code;
 }
+
+int TetrahedronNode_upload(struct TetrahedronNode* t, struct MeshArena* arena, struct LeafMesh* mesh)
+{
+	// The old range is only given back once the new one is taken, so a failed upload leaves the last mesh in place
+	struct MeshAllocation alloc;
+	if (LeafMesh_alloc(mesh, arena, &alloc))
+		return 1;
+	TetrahedronNode_replace_mesh(t, arena, mesh, &alloc);
+	return 0;
+}
+
+// Gives the leaf's old range back and uploads the mesh into alloc, taken for it with LeafMesh_alloc
+void TetrahedronNode_replace_mesh(struct TetrahedronNode* t, struct MeshArena* arena, struct LeafMesh* mesh, struct MeshAllocation* alloc)
+{
+	MeshArena_free(arena, &t->mesh);
+	t->mesh = *alloc;
+	if (!mesh->v_count)
+		return;
+
+	TRACE_BEGIN("TetrahedronNode_upload");
+	if (mesh->packed)
+		MeshArena_upload_compact(arena, &t->mesh, mesh->packed, mesh->index_size == 2 ? (void*)mesh->short_indexes : (void*)mesh->indexes, &mesh->bounds);
+	else
+		MeshArena_upload(arena, &t->mesh, mesh->vertices, mesh->normals, mesh->indexes);
+	TRACE_END("TetrahedronNode_upload");
+}
+
+// Each leaf gets a fresh range in the shared arena, so a re-extract never reallocates GL storage. An empty mesh gets
+// an empty allocation.
+int LeafMesh_alloc(struct LeafMesh* mesh, struct MeshArena* arena, struct MeshAllocation* out)
+{
+	MeshAllocation_init(out);
+	if (!mesh->v_count)
+		return 0;
+
+	if (!arena->compact != !mesh->packed)
+	{
+		printf("Leaf mesh format doesn't match the arena.\n");
+		return 1;
+	}
+	return MeshArena_alloc(arena, mesh->v_count, mesh->i_count, mesh->index_size, out);
+}
+
+int LeafMesh_optimize(struct LeafMesh* mesh)
+{
+	// The chunks emit triangles in lattice scan order, which reuses vertices poorly
+	struct TetrahedronNode* t = mesh->node;
+	if (!mesh->v_count || mesh->packed)
+		return 0;
+
+	uint32_t misses_before = VertexCache_simulate(mesh->indexes, mesh->i_count, mesh->v_count, VERTEX_CACHE_SIZE);
+	int return_code = VertexCache_optimize(mesh->indexes, mesh->i_count, mesh->v_count, VERTEX_CACHE_SIZE);
+	if (!return_code)
+		return_code = VertexCache_reorder_vertices(mesh->indexes, mesh->i_count, mesh->vertices, mesh->normals, &mesh->v_count);
+	t->v_count = mesh->v_count;
+
+	// A failed pass still leaves a valid mesh, just one whose misses aren't worth reporting
+	if (return_code)
+	{
+		t->cache_misses_before = 0;
+		t->cache_misses_after = 0;
+		return return_code;
+	}
+	t->cache_misses_before = misses_before;
+	t->cache_misses_after = VertexCache_simulate(mesh->indexes, mesh->i_count, mesh->v_count, VERTEX_CACHE_SIZE);
+	return 0;
+}
+
+int LeafMesh_compact(struct LeafMesh* mesh)
+{
+	if (!mesh->v_count || mesh->packed)
+		return 0;
+
+	mesh->packed = malloc(mesh->v_count * sizeof(struct CompactVertex));
+	if (!mesh->packed)
+		return 1;
+	CompactVertex_pack(mesh->packed, mesh->vertices, mesh->normals, mesh->v_count, &mesh->bounds);
+	free(mesh->vertices);
+	free(mesh->normals);
+	mesh->vertices = 0;
+	mesh->normals = 0;
+
+	// Indexes are local to the leaf, so nearly every leaf fits in 16 bits
+	if (mesh->v_count <= 65536)
+	{
+		mesh->short_indexes = malloc(mesh->i_count * sizeof(uint16_t));
+		if (!mesh->short_indexes)
+			return 0; // Still valid, just with 32-bit indexes
+		for (uint32_t i = 0; i < mesh->i_count; i++)
+			mesh->short_indexes[i] = (uint16_t)mesh->indexes[i];
+		free(mesh->indexes);
+		mesh->indexes = 0;
+		mesh->index_size = sizeof(uint16_t);
+	}
+
+	return 0;
+}
+
+uint32_t LeafMesh_bytes(struct LeafMesh* mesh)
+{
+	uint32_t vertex_size = mesh->packed ? sizeof(struct CompactVertex) : sizeof(vec3) * 2;
+	return mesh->v_count * vertex_size + mesh->i_count * mesh->index_size;
+}
+
+void LeafMesh_destroy(struct LeafMesh* mesh)
+{
+	free(mesh->vertices);
+	free(mesh->normals);
+	free(mesh->indexes);
+	free(mesh->packed);
+	free(mesh->short_indexes);
+	mesh->vertices = 0;
+	mesh->normals = 0;
+	mesh->indexes = 0;
+	mesh->packed = 0;
+	mesh->short_indexes = 0;
+	mesh->v_count = 0;
+	mesh->i_count = 0;
+}
@@ -6,13 +6,15 @@
 #include <cglm\cglm.h>
 #include <stdint.h>
 #include "Hexahedron.h"
+#include "MeshArena.h"
+
+struct TDiamondStorage;
 
 struct TetrahedronNode
 {
 	int child_index : 1;
 	int stored_as_leaf : 1;
 	int hex_init : 1;
-	int gl_init : 1;
 	struct TetrahedronNode* next;
 	struct TetrahedronNode* prev;
 	int level;
@@ -28,23 +30,47 @@ struct TetrahedronNode
 	float radius;
 	struct Hexahedron hexahedra[4];
 
-	GLuint vao;
-	GLuint v_vbo;
-	GLuint n_vbo;
-	GLuint ibo;
+	struct MeshAllocation mesh;
 
 	uint32_t dim;
 	uint32_t v_count;
 	uint32_t p_count;
 	uint32_t snapped_count;
-	uint32_t vbo_size;
-	uint32_t ibo_size;
+	uint32_t cache_misses_before;
+	uint32_t cache_misses_after;
+	struct UMC_Timings timings;
+	struct HotCounters counters;
+};
+
+// CPU-side output of a single leaf, produced off the render thread and uploaded later.
+// Once compacted the float arrays are replaced by packed vertices, and by 16-bit indexes when they fit.
+struct LeafMesh
+{
+	struct TetrahedronNode* node;
+	vec3* vertices;
+	vec3* normals;
+	uint32_t* indexes;
+	struct CompactVertex* packed;
+	uint16_t* short_indexes;
+	struct CompactBounds bounds;
+	int index_size;
+	uint32_t v_count;
+	uint32_t i_count;
 };
 
 void TetrahedronNode_init_top_level(struct TetrahedronNode* out, int branch, int size, vec3 start);
 void TetrahedronNode_init_child(struct TetrahedronNode* out, struct TetrahedronNode* parent, int child_index, vec3 mv, int* vs);
-void TetrahedronNode_destroy(struct TetrahedronNode* t);
+void TetrahedronNode_destroy(struct TetrahedronNode* t, struct MeshArena* arena);
 int TetrahedronNode_split(struct TetrahedronNode* t, struct TDiamondStorage* storage);
 int TetrahedronNode_add_outline(struct TetrahedronNode* out, vec3** out_verts, uint32_t** out_inds, uint32_t* v_next, uint32_t* v_size, uint32_t* i_next, uint32_t* i_size);
 int TetrahedronNode_is_leaf(struct TetrahedronNode* t);
-int TetrahedronNode_extract(struct TetrahedronNode* t, uint32_t* v_count, uint32_t* p_count, int pem, float threshold, struct osn_context* osn, int sub_resolution);
\ No newline at end of file
+int TetrahedronNode_extract(struct TetrahedronNode* t, struct MeshArena* arena, int pem, float threshold, struct osn_context* osn, int sub_resolution);
+int TetrahedronNode_polygonize(struct TetrahedronNode* t, struct LeafMesh* out, int pem, float threshold, struct osn_context* osn, int sub_resolution);
+int TetrahedronNode_upload(struct TetrahedronNode* t, struct MeshArena* arena, struct LeafMesh* mesh);
+void TetrahedronNode_replace_mesh(struct TetrahedronNode* t, struct MeshArena* arena, struct LeafMesh* mesh, struct MeshAllocation* alloc);
+
+int LeafMesh_alloc(struct LeafMesh* mesh, struct MeshArena* arena, struct MeshAllocation* out);
+int LeafMesh_optimize(struct LeafMesh* mesh);
+int LeafMesh_compact(struct LeafMesh* mesh);
+uint32_t LeafMesh_bytes(struct LeafMesh* mesh);
+void LeafMesh_destroy(struct LeafMesh* mesh);
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "Threading.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI _Thread_entry(LPVOID param)
+{
+	struct Thread* t = (struct Thread*)param;
+	t->result = t->fn(t->arg);
+	return 0;
+}
+#else
+static void* _Thread_entry(void* param)
+{
+	struct Thread* t = (struct Thread*)param;
+	t->result = t->fn(t->arg);
+	return 0;
+}
+#endif
+
+int Thread_start(struct Thread* t, thread_fn fn, void* arg)
+{
+	t->fn = fn;
+	t->arg = arg;
+	t->result = 0;
+#ifdef _WIN32
+	t->handle = CreateThread(NULL, 0, _Thread_entry, t, 0, NULL);
+	return t->handle == NULL;
+#else
+	return pthread_create(&t->handle, NULL, _Thread_entry, t) != 0;
+#endif
+}
+
+int Thread_join(struct Thread* t)
+{
+#ifdef _WIN32
+	WaitForSingleObject(t->handle, INFINITE);
+	CloseHandle(t->handle);
+	t->handle = NULL;
+#else
+	pthread_join(t->handle, NULL);
+#endif
+	return t->result;
+}
+
+void Thread_yield()
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+int Thread_hardware_concurrency()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+#endif
+}
+
+int Semaphore_init(struct Semaphore* s, int initial)
+{
+#ifdef _WIN32
+	s->handle = CreateSemaphore(NULL, initial, 0x7FFFFFFF, NULL);
+	return s->handle == NULL;
+#else
+	return sem_init(&s->handle, 0, initial) != 0;
+#endif
+}
+
+void Semaphore_destroy(struct Semaphore* s)
+{
+#ifdef _WIN32
+	CloseHandle(s->handle);
+	s->handle = NULL;
+#else
+	sem_destroy(&s->handle);
+#endif
+}
+
+void Semaphore_post(struct Semaphore* s, int count)
+{
+#ifdef _WIN32
+	ReleaseSemaphore(s->handle, count, NULL);
+#else
+	for (int i = 0; i < count; i++)
+		sem_post(&s->handle);
+#endif
+}
+
+void Semaphore_wait(struct Semaphore* s)
+{
+#ifdef _WIN32
+	WaitForSingleObject(s->handle, INFINITE);
+#else
+	while (sem_wait(&s->handle) != 0)
+		;
+#endif
+}
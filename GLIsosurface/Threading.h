@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+// Minimal threading layer so extraction can run off the render thread.
+// Win32 is the primary target, pthreads are used everywhere else.
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define THREADS_MAX 64
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+typedef int(*thread_fn)(void* arg);
+
+struct Thread
+{
+#ifdef _WIN32
+	void* handle;
+#else
+	pthread_t handle;
+#endif
+	thread_fn fn;
+	void* arg;
+	int result;
+};
+
+struct Semaphore
+{
+#ifdef _WIN32
+	void* handle;
+#else
+	sem_t handle;
+#endif
+};
+
+int Thread_start(struct Thread* t, thread_fn fn, void* arg);
+int Thread_join(struct Thread* t);
+void Thread_yield();
+int Thread_hardware_concurrency();
+
+int Semaphore_init(struct Semaphore* s, int initial);
+void Semaphore_destroy(struct Semaphore* s);
+void Semaphore_post(struct Semaphore* s, int count);
+void Semaphore_wait(struct Semaphore* s);
+
+// 32-bit atomics. Loads acquire, stores release, read-modify-writes are full barriers.
+#ifdef _MSC_VER
+__forceinline int32_t Atomic_load(volatile int32_t* p)
+{
+	int32_t v = *p;
+	_ReadWriteBarrier();
+	return v;
+}
+
+__forceinline void Atomic_store(volatile int32_t* p, int32_t v)
+{
+	_ReadWriteBarrier();
+	*p = v;
+}
+
+__forceinline int32_t Atomic_add(volatile int32_t* p, int32_t v)
+{
+	return _InterlockedExchangeAdd((volatile long*)p, v) + v;
+}
+
+__forceinline int32_t Atomic_cas(volatile int32_t* p, int32_t expected, int32_t desired)
+{
+	return _InterlockedCompareExchange((volatile long*)p, desired, expected);
+}
+#else
+__forceinline int32_t Atomic_load(volatile int32_t* p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+__forceinline void Atomic_store(volatile int32_t* p, int32_t v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+__forceinline int32_t Atomic_add(volatile int32_t* p, int32_t v)
+{
+	return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+}
+
+__forceinline int32_t Atomic_cas(volatile int32_t* p, int32_t expected, int32_t desired)
+{
+	__atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return expected;
+}
+#endif
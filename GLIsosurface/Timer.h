@@ -0,0 +1,5 @@
+#pragma once
+
+// Monotonic wall-clock time in milliseconds. clock() measures CPU time on most platforms, which is useless once work
+// is spread across threads, so anything that reports timings should go through this.
+double Timer_ms();
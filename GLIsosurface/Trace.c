@@ -0,0 +1,132 @@
+#include "Trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Timer.h"
+
+static struct TraceRing* trace_rings[TRACE_THREADS_MAX];
+static volatile int32_t trace_ring_count = 0;
+static THREAD_LOCAL struct TraceRing* trace_ring = 0;
+
+void Trace_event(const char* name, char phase)
+{
+	struct TraceRing* ring = _Trace_ring();
+	if (!ring)
+		return;
+
+	uint32_t i = (uint32_t)ring->next;
+	struct TraceEvent* e = ring->events + (i & (TRACE_RING_EVENTS - 1));
+	e->name = name;
+	e->phase = phase;
+	e->ts_ms = Timer_ms();
+	Atomic_store(&ring->next, (int32_t)(i + 1));
+}
+
+void Trace_thread_name(const char* name)
+{
+	// Naming a thread allocates its ring, which is wasted when nothing records into it
+	if (!TRACE_EVENTS)
+		return;
+
+	struct TraceRing* ring = _Trace_ring();
+	if (!ring)
+		return;
+	strncpy(ring->name, name, sizeof(ring->name) - 1);
+	ring->name[sizeof(ring->name) - 1] = 0;
+}
+
+void Trace_release_thread()
+{
+	if (!trace_ring)
+		return;
+	Atomic_store(&trace_ring->released, 1);
+	trace_ring = 0;
+}
+
+int Trace_dump(const char* path)
+{
+	FILE* out = fopen(path, "w");
+	struct TraceEvent* scratch = malloc(TRACE_RING_EVENTS * sizeof(struct TraceEvent));
+	if (!out || !scratch)
+	{
+		printf("Failed to dump trace to %s.\n", path);
+		if (out)
+			fclose(out);
+		free(scratch);
+		return 1;
+	}
+
+	int first = 1;
+	int32_t ring_count = Atomic_load(&trace_ring_count);
+	if (ring_count > TRACE_THREADS_MAX)
+		ring_count = TRACE_THREADS_MAX;
+
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int r = 0; r < ring_count; r++)
+	{
+		struct TraceRing* ring = trace_rings[r];
+		if (!ring)
+			continue;
+
+		// Other threads keep recording, so copy first and then drop whatever they overwrote during the copy
+		uint32_t end = (uint32_t)Atomic_load(&ring->next);
+		uint32_t start = end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0;
+		for (uint32_t i = start; i < end; i++)
+			scratch[i & (TRACE_RING_EVENTS - 1)] = ring->events[i & (TRACE_RING_EVENTS - 1)];
+		uint32_t now = (uint32_t)Atomic_load(&ring->next);
+		if (now + 1 > start + TRACE_RING_EVENTS)
+			start = now + 1 - TRACE_RING_EVENTS;
+
+		fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", first ? "" : ",", ring->thread_id, ring->name);
+		first = 0;
+		for (uint32_t i = start; i < end; i++)
+		{
+			struct TraceEvent* e = scratch + (i & (TRACE_RING_EVENTS - 1));
+			fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%i}", e->name, e->phase, e->ts_ms * 1000.0, ring->thread_id);
+		}
+	}
+	fprintf(out, "\n]}\n");
+
+	fclose(out);
+	free(scratch);
+	printf("Trace written to %s.\n", path);
+	return 0;
+}
+
+struct TraceRing* _Trace_ring()
+{
+	if (trace_ring)
+		return trace_ring;
+
+	int32_t ring_count = Atomic_load(&trace_ring_count);
+	for (int32_t r = 0; r < ring_count && r < TRACE_THREADS_MAX; r++)
+	{
+		struct TraceRing* ring = trace_rings[r];
+		if (ring && Atomic_load(&ring->released) && Atomic_cas(&ring->released, 1, 0) == 1)
+		{
+			sprintf(ring->name, "Thread %i", ring->thread_id);
+			trace_ring = ring;
+			return ring;
+		}
+	}
+
+	if (ring_count >= TRACE_THREADS_MAX)
+		return 0;
+	int32_t slot = Atomic_add(&trace_ring_count, 1) - 1;
+	if (slot >= TRACE_THREADS_MAX)
+		return 0;
+
+	struct TraceRing* ring = malloc(sizeof(struct TraceRing));
+	if (!ring)
+		return 0;
+	ring->thread_id = slot;
+	sprintf(ring->name, "Thread %i", slot);
+	ring->next = 0;
+	ring->released = 0;
+
+	// Rings live until the process exits, a dump may run at any time
+	trace_ring = ring;
+	trace_rings[slot] = ring;
+	return ring;
+}
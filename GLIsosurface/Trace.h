@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include "Options.h"
+#include "Threading.h"
+
+// Begin/end timeline events, dumped as Chrome trace JSON (load it in chrome://tracing or ui.perfetto.dev).
+// Compiled in with TRACE_EVENTS. Every thread records into its own ring, so an event is a timestamp and a few stores
+// with no locking; once a ring is full the oldest events are overwritten. Event names are stored by pointer and must
+// be string literals. Rings of threads that called Trace_release_thread are reused, keeping their old events until
+// they're overwritten.
+
+#define TRACE_RING_EVENTS (1 << 16)
+#define TRACE_THREADS_MAX (THREADS_MAX + 2)
+
+#if TRACE_EVENTS
+#define TRACE_BEGIN(name) Trace_event(name, 'B')
+#define TRACE_END(name) Trace_event(name, 'E')
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#endif
+
+struct TraceEvent
+{
+	const char* name;
+	double ts_ms;
+	char phase;
+};
+
+struct TraceRing
+{
+	int thread_id;
+	char name[32];
+	volatile int32_t next;
+	// Set once the thread that recorded into it has exited, the next new thread takes it over
+	volatile int32_t released;
+	struct TraceEvent events[TRACE_RING_EVENTS];
+};
+
+void Trace_event(const char* name, char phase);
+void Trace_thread_name(const char* name);
+// Hands the calling thread's ring to the next thread that records, for threads that exit before the process does
+void Trace_release_thread();
+int Trace_dump(const char* path);
+
+struct TraceRing* _Trace_ring();
@@ -1,16 +1,21 @@
 #include "UniformMarchingCubes.h"
 
 #include <assert.h>
+#include <float.h>
 #include <memory.h>
 #include <time.h>
 #include "Sampler.h"
 #include "Util.h"
 #include "MCTable.h"
-#include "MortonCoding.h"
 #include "DebugHeader.h"
 #include "Options.h"
+#include "Timer.h"
+#include "Trace.h"
 
-#define INDEX3D(x,y,z,d) ((x) * (d) * (d) + (y) * (d) + (z))
+// Lattice indexes are 64-bit: (dim + 1)^3 * 3 edges passes 2^32 around dim 1100
+#define INDEX3D(x,y,z,d) ((uint64_t)(x) * (d) * (d) + (uint64_t)(y) * (d) + (z))
+// Index of a grid point's column in the height cache, for columns running along the given grid axis
+#define COLUMN2D(x,y,z,axis,d) ((axis) == 0 ? (y) * (d) + (z) : (axis) == 1 ? (x) * (d) + (z) : (x) * (d) + (y))
 #define ISOLEVEL 0.0f
 #define EDGE_X 0
 #define EDGE_Y 1
@@ -19,8 +24,19 @@
 // SnapMC tables aren't properly always oriented, so we can compare against the gradient normals to determine if flipping is necessary
 #define DYNAMIC_FACE_REPORTING 0
 
-#define USE_MORTON_CODING 0
-#define ENCODE3D(x,y,z,dp1) (USE_MORTON_CODING ? GetMortonCode((x),(y),(z)) : INDEX3D(x,y,z,dp1))
+// Morton code of a point inside its brick, z in the lowest bit like INDEX3D
+#if defined(__BMI2__) || defined(__AVX2__)
+#include <immintrin.h>
+#define TILE_MORTON(x,y,z) (_pdep_u32((x), 0x124) | _pdep_u32((y), 0x92) | _pdep_u32((z), 0x49))
+#else
+static const uint32_t UMC_tile_morton[UMC_TILE] = { 0x00, 0x01, 0x08, 0x09, 0x40, 0x41, 0x48, 0x49 };
+#define TILE_MORTON(x,y,z) ((UMC_tile_morton[x] << 2) | (UMC_tile_morton[y] << 1) | UMC_tile_morton[z])
+#endif
+#define TILED3D(x,y,z,t) (((((uint64_t)((x) >> UMC_TILE_BITS) * (t) + ((y) >> UMC_TILE_BITS)) * (t) + ((z) >> UMC_TILE_BITS)) << (UMC_TILE_BITS * 3)) | \
+	TILE_MORTON((x) & (UMC_TILE - 1), (y) & (UMC_TILE - 1), (z) & (UMC_TILE - 1)))
+// Point and sign lattice indexes in the chunk's layout, expecting tiled, tiles and sign_tiles in scope
+#define GRID3D(x,y,z,dp1) (tiled ? TILED3D(x,y,z,tiles) : INDEX3D(x,y,z,dp1))
+#define ENCODE3D(x,y,z,dp1_h) (tiled ? TILED3D(x,y,z,sign_tiles) : INDEX3D(x,y,z,dp1_h))
 
 #define MC_POLYGONIZE_L(xoff, yoff, zoff, m) \
 	if (grid_signs[ENCODE3D((x + xoff) >> 1, (y + yoff) >> 1, (z + zoff) >> 1, dimp1_h)] & (1 << ((((z + zoff) & 1) * 1) + (((y + yoff) & 1) * 2) + (((x + xoff) & 1) * 4)))) \
@@ -31,25 +47,63 @@
 	v = (grid_signs[ENCODE3D((x + xoff) >> 1, (y + yoff) >> 1, (z + zoff) >> 1, dimp1_h)] >> lsh) & 3; \
 	mask += v * m; \
 	if (v == 1) \
-		cell.iso_verts[idx] = &grid_verts[INDEX3D(x + xoff, y + yoff, z + zoff, dim + 1)].index;
+		cell.iso_verts[idx] = &grid_indexes[GRID3D(x + xoff, y + yoff, z + zoff, dim + 1)];
 
+// One statement, it's used under unbraced ifs
 #define ADD_OUTPUT_INDEX(index3d) \
-if (next_index == out_ind_size) \
+do \
 { \
-	out_ind_size *= 2; \
-	out_indexes = realloc(out_indexes, out_ind_size * sizeof(uint32_t)); \
-} \
-out_indexes[next_index++] = index3d;
+	if (slab->c_next == slab->c_size) \
+	{ \
+		HOT_COUNT(slab->counters.output_reallocs, 1); \
+		slab->c_size *= 2; \
+		slab->candidates = realloc(slab->candidates, slab->c_size * sizeof(uint64_t)); \
+	} \
+	slab->candidates[slab->c_next++] = index3d; \
+} while (0)
+
+// Where a parallel slab stored a local vertex index: an edge's, a lattice point's, or a point on the next slab's
+// first plane, which the slab doesn't own
+#define SLOT_EDGE(v, axis) (((v) << 3) | (axis))
+#define SLOT_POINT(v) (((v) << 3) | 3)
+#define SLOT_NEXT(v) (((v) << 3) | 4)
+// An on-surface point on a slab's first plane, whose vertex the previous slab emits
+#define INDEX_PREVIOUS_SLAB ((uint32_t)-3)
+// Snap ranks of points that aren't candidates, and of candidates already decided
+#define RANK_UNSET UINT32_MAX
+#define RANK_DECIDED (UINT32_MAX - 1)
+
+#define RECORD_EMITTED(slot) \
+if (slab->emitted) \
+{ \
+	if (slab->e_size < *out_size) \
+	{ \
+		slab->e_size = *out_size; \
+		slab->emitted = realloc(slab->emitted, slab->e_size * sizeof(uint64_t)); \
+	} \
+	while (recorded < *next_vertex) \
+		slab->emitted[recorded++] = (slot); \
+}
+
+// An undecided neighbour ranked before the point has to decide first if either of them could snap to their edge
+#define SNAPMC_WAITS_ON(e_point, i, nx, ny, nz) \
+e = &edges[(e_point) * 3 + (i)]; \
+if (e->crossed && e->length > 0.0f && ranks[GRID3D(nx, ny, nz, dim + 1)] < rank) \
+{ \
+	_UMC_Chunk_lattice_point(chunk, nx, ny, nz, neighbour); \
+	if (vec3_distance(e->iso_vertex.position, position) / e->length < chunk->snap_threshold || \
+		vec3_distance(e->iso_vertex.position, neighbour) / e->length < chunk->snap_threshold) \
+		return 0; \
+}
 
 #define SNAPMC_EDGE_CHECK(x, y, z, i) \
-e = &edges[INDEX3D(x, y, z, dim + 1) * 3 + i]; \
-if (e->grid_v0 != e->grid_v1 && e->length > 0.0f && !e->snapped) \
+e = &edges[GRID3D(x, y, z, dim + 1) * 3 + i]; \
+if (e->crossed && e->length > 0.0f && !e->snapped) \
 { \
-	assert(e->grid_v0 == v_index || e->grid_v1 == v_index); \
 	assert(e->length > 0.0f); \
 	if (e->length > max_length) \
 		max_length = e->length; \
-	distance = vec3_distance(e->iso_vertex.position, v->position) / e->length; \
+	distance = vec3_distance(e->iso_vertex.position, position) / e->length; \
 	if (distance < min_distance) \
 	{ \
 		min_distance = distance; \
@@ -59,17 +113,82 @@ if (e->grid_v0 != e->grid_v1 && e->length > 0.0f && !e->snapped) \
 
 typedef uint32_t COORD_TYPE;
 
-const float(*sampler_fn)(float x, float y, float z, float w, struct osn_context* osn) = &SurfaceFn_windy;
+const float(*sampler_fn)(float x, float y, float z, float w, float footprint, struct osn_context* osn) = &SurfaceFn_windy;
+
+// Every chunk mode gets its own copy of the label, edge and polygonize loops. The bodies are __forceinline kernels
+// taking the mode as constant arguments, so each copy below has its mode tests folded away and is picked once per
+// chunk from these tables instead of being re-tested per grid point.
+#define UMC_LABEL_GRID_SPECIALIZATION(pem, tiled, source) \
+	static void _UMC_Chunk_label_grid_##pem##tiled##source(struct UMC_Chunk* chunk, uint32_t x_begin, uint32_t x_end, const float* heights, int column_axis, const float* values, struct HotCounters* counters, struct osn_context* osn) \
+	{ _UMC_Chunk_label_grid_kernel(chunk, x_begin, x_end, heights, column_axis, values, counters, osn, pem, tiled, source); }
+#define UMC_MODE_SPECIALIZATIONS(pem, tiled) \
+	UMC_LABEL_GRID_SPECIALIZATION(pem, tiled, 0) UMC_LABEL_GRID_SPECIALIZATION(pem, tiled, 1) UMC_LABEL_GRID_SPECIALIZATION(pem, tiled, 2) \
+	static void _UMC_Chunk_label_edges_##pem##tiled(struct UMC_Chunk* chunk, struct UMC_Slab* slab, struct osn_context* osn) \
+	{ _UMC_Chunk_label_edges_kernel(chunk, slab, osn, pem, tiled); } \
+	static void _UMC_Chunk_polygonize_##pem##tiled(struct UMC_Chunk* chunk, struct UMC_Slab* slab, vec3* positions, struct osn_context* osn) \
+	{ _UMC_Chunk_polygonize_kernel(chunk, slab, positions, osn, pem, tiled); }
+
+UMC_MODE_SPECIALIZATIONS(0, 0)
+UMC_MODE_SPECIALIZATIONS(0, 1)
+UMC_MODE_SPECIALIZATIONS(1, 0)
+UMC_MODE_SPECIALIZATIONS(1, 1)
+
+static const UMC_LabelGridKernel UMC_label_grid_kernels[2][2][3] =
+{
+	{ { _UMC_Chunk_label_grid_000, _UMC_Chunk_label_grid_001, _UMC_Chunk_label_grid_002 }, { _UMC_Chunk_label_grid_010, _UMC_Chunk_label_grid_011, _UMC_Chunk_label_grid_012 } },
+	{ { _UMC_Chunk_label_grid_100, _UMC_Chunk_label_grid_101, _UMC_Chunk_label_grid_102 }, { _UMC_Chunk_label_grid_110, _UMC_Chunk_label_grid_111, _UMC_Chunk_label_grid_112 } },
+};
+static const UMC_LabelEdgesKernel UMC_label_edges_kernels[2][2] = { { _UMC_Chunk_label_edges_00, _UMC_Chunk_label_edges_01 }, { _UMC_Chunk_label_edges_10, _UMC_Chunk_label_edges_11 } };
+static const UMC_PolygonizeKernel UMC_polygonize_kernels[2][2] = { { _UMC_Chunk_polygonize_00, _UMC_Chunk_polygonize_01 }, { _UMC_Chunk_polygonize_10, _UMC_Chunk_polygonize_11 } };
+
+void UMC_Timings_zero(struct UMC_Timings* t)
+{
+	t->reset_ms = 0;
+	t->label_grid_ms = 0;
+	t->label_edges_ms = 0;
+	t->snap_ms = 0;
+	t->polygonize_ms = 0;
+	t->samples = 0;
+}
+
+void UMC_Timings_add(struct UMC_Timings* dest, struct UMC_Timings* src)
+{
+	dest->reset_ms += src->reset_ms;
+	dest->label_grid_ms += src->label_grid_ms;
+	dest->label_edges_ms += src->label_edges_ms;
+	dest->snap_ms += src->snap_ms;
+	dest->polygonize_ms += src->polygonize_ms;
+	dest->samples += src->samples;
+}
+
+float UMC_Timings_total(struct UMC_Timings* t)
+{
+	return t->reset_ms + t->label_grid_ms + t->label_edges_ms + t->snap_ms + t->polygonize_ms;
+}
+
+uint32_t _UMC_count_doublings(uint32_t before, uint32_t after)
+{
+	uint32_t count = 0;
+	while (before && before < after)
+	{
+		before *= 2;
+		count++;
+	}
+	return count;
+}
 
 void UMC_Chunk_init(struct UMC_Chunk* dest, uint32_t dim, int index_primitives, int use_pem, float threshold)
 {
 	assert(dim != 0);
 
 	dest->timer = 0;
+	dest->footprint = 0;
 	dest->indexed_primitives = index_primitives;
 	dest->pem = use_pem;
 	dest->snap_threshold = threshold;
 	dest->initialized = 0;
+	dest->animated = 0;
+	memset(&dest->frame, 0, sizeof(struct UMC_Frame));
 
 	dest->vao = 0;
 	dest->v_vbo = 0;
@@ -81,13 +200,31 @@ void UMC_Chunk_init(struct UMC_Chunk* dest, uint32_t dim, int index_primitives,
 	dest->p_count = 0;
 	dest->snapped_count = 0;
 
-	dest->grid_verts = 0;
+	// Bricks only pay off on big chunks, below that their index arithmetic costs more than the locality saves
+	dest->layout = dim >= TILED_LAYOUT_MIN_DIM ? UMC_LAYOUT_TILED : UMC_LAYOUT_LINEAR;
+	dest->tiles = 0;
+	dest->sign_tiles = 0;
+	dest->lattice_count = 0;
+	dest->sign_count = 0;
+
+	// Below the threshold a chunk is too quick for threads to pay off, hierarchy chunks always are
+	dest->threads = 1;
+	if (dim >= PARALLEL_CHUNK_MIN_DIM)
+		UMC_Chunk_set_threads(dest, CHUNK_THREADS ? CHUNK_THREADS : Thread_hardware_concurrency());
+	dest->slabs = 0;
+	dest->slab_count = 0;
+	dest->slab_size = 0;
+	dest->pool = 0;
+	dest->snap_ranks = 0;
+
+	dest->grid_values = 0;
+	dest->grid_indexes = 0;
 	dest->edges = 0;
 
 	dest->grid_signs = 0;
-	dest->grid_verts = 0;
 	dest->edges = 0;
 	dest->edge_v_indexes = 0;
+	dest->column_heights = 0;
 
 	dest->v_out = 0;
 	dest->n_out = 0;
@@ -96,15 +233,18 @@ void UMC_Chunk_init(struct UMC_Chunk* dest, uint32_t dim, int index_primitives,
 	dest->i_out = 0;
 	dest->i_size = 0;
 	dest->i_next = 0;
+	UMC_Timings_zero(&dest->timings);
+	HotCounters_zero(&dest->counters);
 }
 
 void UMC_Chunk_destroy(struct UMC_Chunk* chunk)
 {
 	assert(chunk);
-	free(chunk->grid_signs);
-	free(chunk->grid_verts);
-	free(chunk->edges);
-	free(chunk->edge_v_indexes);
+	_UMC_Chunk_free_grids(chunk);
+	_UMC_Chunk_free_slabs(chunk);
+	_UMC_Chunk_stop_pool(chunk);
+	_UMC_Chunk_free_frame(chunk);
+	free(chunk->column_heights);
 	if (chunk->initialized)
 	{
 		//glDeleteVertexArrays(1, &chunk->vao);
@@ -112,10 +252,12 @@ void UMC_Chunk_destroy(struct UMC_Chunk* chunk)
 	}
 
 	chunk->timer = 0;
+	chunk->footprint = 0;
 	chunk->indexed_primitives = 0;
 	chunk->pem = 0;
 	chunk->snap_threshold = 0;
 	chunk->initialized = 0;
+	chunk->animated = 0;
 
 	chunk->vao = 0;
 	chunk->v_vbo = 0;
@@ -127,66 +269,507 @@ void UMC_Chunk_destroy(struct UMC_Chunk* chunk)
 	chunk->p_count = 0;
 	chunk->snapped_count = 0;
 
-	chunk->grid_verts = 0;
-	chunk->edges = 0;
+	chunk->column_heights = 0;
+}
+
+void UMC_Chunk_set_layout(struct UMC_Chunk* chunk, enum UMC_Layout layout)
+{
+	// Grids in the old layout are dropped, the next run allocates them in the new one
+	if (chunk->layout != layout)
+		_UMC_Chunk_free_grids(chunk);
+	chunk->layout = layout;
+}
+
+void UMC_Chunk_set_threads(struct UMC_Chunk* chunk, uint32_t threads)
+{
+	threads = threads < 1 ? 1 : (threads > THREADS_MAX ? THREADS_MAX : threads);
+	if (threads != chunk->threads)
+		_UMC_Chunk_stop_pool(chunk);
+	chunk->threads = threads;
+}
+
+// Animated chunks expect their output to stay where the last run left it, at the end of the buffers. Each run keeps
+// the lattice, and the next one only redoes what its change in timer can reach; one that has to start over rewrites
+// the same output.
+void UMC_Chunk_set_animated(struct UMC_Chunk* chunk, int animated)
+{
+	if (!animated)
+		_UMC_Chunk_free_frame(chunk);
+	chunk->animated = animated ? 1 : 0;
+}
+
+uint64_t _UMC_layout_count(uint32_t n, enum UMC_Layout layout)
+{
+	if (layout == UMC_LAYOUT_LINEAR)
+		return (uint64_t)n * n * n;
+	// Partial bricks on the far faces are padded out to whole ones
+	uint64_t tiles = (n + UMC_TILE - 1) >> UMC_TILE_BITS;
+	return tiles * tiles * tiles << (UMC_TILE_BITS * 3);
+}
+
+void _UMC_Chunk_free_grids(struct UMC_Chunk* chunk)
+{
+	free(chunk->grid_signs);
+	free(chunk->grid_values);
+	free(chunk->grid_indexes);
+	free(chunk->edges);
+	free(chunk->edge_v_indexes);
+	free(chunk->snap_ranks);
 
 	chunk->grid_signs = 0;
-	chunk->grid_verts = 0;
+	chunk->grid_values = 0;
+	chunk->grid_indexes = 0;
 	chunk->edges = 0;
 	chunk->edge_v_indexes = 0;
+	chunk->snap_ranks = 0;
+	chunk->frame.valid = 0;
+}
+
+int _UMC_Chunk_alloc_grids(struct UMC_Chunk* chunk)
+{
+	uint32_t dimp1 = chunk->dim + 1;
+	// Rounded up, so even dims get the sign cells their last point row falls into
+	uint32_t dimp1_h = (dimp1 + 1) / 2;
+
+	chunk->tiles = (dimp1 + UMC_TILE - 1) >> UMC_TILE_BITS;
+	chunk->sign_tiles = (dimp1_h + UMC_TILE - 1) >> UMC_TILE_BITS;
+	chunk->lattice_count = _UMC_layout_count(dimp1, chunk->layout);
+	chunk->sign_count = _UMC_layout_count(dimp1_h, chunk->layout);
+
+	chunk->grid_signs = malloc((size_t)chunk->sign_count * sizeof(uint16_t));
+	chunk->grid_values = malloc((size_t)chunk->lattice_count * sizeof(float));
+	chunk->edges = malloc((size_t)chunk->lattice_count * 3 * sizeof(struct UMC_Edge));
+	chunk->edge_v_indexes = malloc((size_t)chunk->lattice_count * 3 * sizeof(uint32_t));
+	if (!chunk->column_heights)
+		chunk->column_heights = malloc(dimp1 * dimp1 * sizeof(float));
+	if (!chunk->grid_signs || !chunk->grid_values || !chunk->edges || !chunk->edge_v_indexes || !chunk->column_heights)
+	{
+		printf("Failed to alloc chunk grids for dim %u.\n", chunk->dim);
+		_UMC_Chunk_free_grids(chunk);
+		return 1;
+	}
+
+	memset(chunk->grid_signs, 0, (size_t)chunk->sign_count * sizeof(uint16_t));
+	memset(chunk->edges, 0, (size_t)chunk->lattice_count * 3 * sizeof(struct UMC_Edge));
+	memset(chunk->edge_v_indexes, 0, (size_t)chunk->lattice_count * 3 * sizeof(uint32_t));
+	return 0;
+}
+
+void _UMC_Chunk_reset_grids(struct UMC_Chunk* chunk, struct osn_context* osn)
+{
+	if (chunk->slab_count)
+	{
+		struct UMC_SlabRun run = { 0 };
+		run.chunk = chunk;
+		run.osn = osn;
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_RESET);
+		return;
+	}
+
+	memset(chunk->grid_signs, 0, (size_t)chunk->sign_count * sizeof(uint16_t));
+	memset(chunk->edges, 0, (size_t)chunk->lattice_count * 3 * sizeof(struct UMC_Edge));
+	memset(chunk->edge_v_indexes, 0, (size_t)chunk->lattice_count * 3 * sizeof(uint32_t));
+}
+
+void _UMC_Chunk_plan_slabs(struct UMC_Chunk* chunk)
+{
+	// Slabs start on even planes, so no two write the same sign cells
+	uint32_t pairs = (chunk->dim + 2) / 2;
+	uint32_t count = chunk->threads > 1 ? chunk->threads * UMC_SLABS_PER_THREAD : 0;
+	if (count > pairs)
+		count = pairs;
+	if (count < 2)
+		count = 0;
+
+	// Slab buffers are kept between runs, like the grids
+	if (count > chunk->slab_size)
+	{
+		struct UMC_Slab* slabs = realloc(chunk->slabs, count * sizeof(struct UMC_Slab));
+		if (!slabs)
+		{
+			printf("Failed to alloc chunk slabs, running serially.\n");
+			chunk->slab_count = 0;
+			return;
+		}
+		memset(slabs + chunk->slab_size, 0, (count - chunk->slab_size) * sizeof(struct UMC_Slab));
+		chunk->slabs = slabs;
+		chunk->slab_size = count;
+	}
+	chunk->slab_count = count;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		chunk->slabs[i].x_begin = 2 * (uint32_t)((uint64_t)i * pairs / count);
+		chunk->slabs[i].x_end = i + 1 < count ? 2 * (uint32_t)((uint64_t)(i + 1) * pairs / count) : chunk->dim + 1;
+	}
+}
+
+void _UMC_Chunk_free_slabs(struct UMC_Chunk* chunk)
+{
+	for (uint32_t i = 0; i < chunk->slab_size; i++)
+	{
+		free(chunk->slabs[i].vertices);
+		free(chunk->slabs[i].normals);
+		free(chunk->slabs[i].indexes);
+		free(chunk->slabs[i].candidates);
+		free(chunk->slabs[i].emitted);
+		free(chunk->slabs[i].snap_points);
+		free(chunk->slabs[i].spill);
+	}
+	free(chunk->slabs);
+	chunk->slabs = 0;
+	chunk->slab_count = 0;
+	chunk->slab_size = 0;
+}
+
+void _UMC_Chunk_run_slabs(struct UMC_SlabRun* run, enum UMC_SlabStage stage)
+{
+	struct UMC_SlabPool* pool = _UMC_Chunk_pool(run->chunk);
+	uint32_t workers = pool ? pool->count : 0;
+	run->stage = stage;
+	run->next_slab = 0;
+
+	// The calling thread takes slabs too, so without workers the stage just runs serially
+	if (workers)
+	{
+		pool->run = run;
+		Semaphore_post(&pool->work_ready, workers);
+	}
+	_UMC_Chunk_slab_worker(run);
+	for (uint32_t i = 0; i < workers; i++)
+		Semaphore_wait(&pool->work_done);
+}
+
+struct UMC_SlabPool* _UMC_Chunk_pool(struct UMC_Chunk* chunk)
+{
+	if (chunk->pool || chunk->threads < 2)
+		return chunk->pool;
+
+	struct UMC_SlabPool* pool = malloc(sizeof(struct UMC_SlabPool));
+	if (!pool)
+		return 0;
+	pool->count = 0;
+	pool->run = 0;
+	pool->running = 1;
+	Semaphore_init(&pool->work_ready, 0);
+	Semaphore_init(&pool->work_done, 0);
+
+	// A thread that fails to start just leaves more slabs for the others
+	for (uint32_t i = 1; i < chunk->threads; i++)
+	{
+		if (Thread_start(pool->threads + pool->count, _UMC_SlabPool_worker, pool))
+			break;
+		pool->count++;
+	}
+	chunk->pool = pool;
+	return pool;
+}
+
+void _UMC_Chunk_stop_pool(struct UMC_Chunk* chunk)
+{
+	struct UMC_SlabPool* pool = chunk->pool;
+	if (!pool)
+		return;
+
+	Atomic_store(&pool->running, 0);
+	Semaphore_post(&pool->work_ready, pool->count);
+	for (uint32_t i = 0; i < pool->count; i++)
+		Thread_join(pool->threads + i);
+	Semaphore_destroy(&pool->work_ready);
+	Semaphore_destroy(&pool->work_done);
+	free(pool);
+	chunk->pool = 0;
+}
+
+int _UMC_SlabPool_worker(void* arg)
+{
+	struct UMC_SlabPool* pool = (struct UMC_SlabPool*)arg;
+	Trace_thread_name("Slab worker");
+	for (;;)
+	{
+		Semaphore_wait(&pool->work_ready);
+		if (!Atomic_load(&pool->running))
+			break;
+		_UMC_Chunk_slab_worker(pool->run);
+		Semaphore_post(&pool->work_done, 1);
+	}
+
+	// Pools come and go with their chunks, so their threads hand back what they allocated per thread
+	BrickVolume_release_thread();
+	Trace_release_thread();
+	return 0;
+}
+
+int _UMC_Chunk_slab_worker(void* arg)
+{
+	struct UMC_SlabRun* run = (struct UMC_SlabRun*)arg;
+	int32_t index;
+	while ((index = Atomic_add(&run->next_slab, 1) - 1) < (int32_t)run->chunk->slab_count)
+		_UMC_Chunk_slab_stage(run, (uint32_t)index);
+	return 0;
+}
+
+void _UMC_Chunk_slab_stage(struct UMC_SlabRun* run, uint32_t index)
+{
+	struct UMC_Chunk* chunk = run->chunk;
+	struct UMC_Slab* slab = chunk->slabs + index;
+	int pem = chunk->pem ? 1 : 0;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
+	uint32_t dim = chunk->dim + 1;
+	uint64_t begin, end;
+
+	switch (run->stage)
+	{
+	case UMC_STAGE_RESET:
+		// Whole grids are cleared, so each slab takes an even share whatever the layout
+		_UMC_share(chunk->sign_count, index, chunk->slab_count, &begin, &end);
+		memset(chunk->grid_signs + begin, 0, (size_t)(end - begin) * sizeof(uint16_t));
+		_UMC_share(chunk->lattice_count * 3, index, chunk->slab_count, &begin, &end);
+		memset(chunk->edges + begin, 0, (size_t)(end - begin) * sizeof(struct UMC_Edge));
+		memset(chunk->edge_v_indexes + begin, 0, (size_t)(end - begin) * sizeof(uint32_t));
+		break;
+
+	case UMC_STAGE_LABEL_GRID:
+	{
+		HotCounters_zero(&slab->counters);
+		if (pem)
+		{
+			_UMC_share(chunk->lattice_count, index, chunk->slab_count, &begin, &end);
+			memset(chunk->grid_indexes + begin, 0xFF, (size_t)(end - begin) * sizeof(uint32_t));
+		}
+		const float* values = 0;
+		if (run->batch_fn)
+		{
+			values = chunk->grid_values;
+			_UMC_Chunk_batch_sample(chunk, run->batch_fn, slab->x_begin, slab->x_end, &slab->counters, run->osn);
+		}
+		int source = run->heights ? UMC_SOURCE_HEIGHTS : (values ? UMC_SOURCE_BATCH : UMC_SOURCE_SAMPLER);
+		UMC_label_grid_kernels[pem][tiled][source](chunk, slab->x_begin, slab->x_end, run->heights, run->column_axis, values, &slab->counters, run->osn);
+		break;
+	}
+
+	case UMC_STAGE_LABEL_EDGES:
+		if (!slab->vertices)
+		{
+			slab->v_size = 4096;
+			slab->vertices = malloc(slab->v_size * sizeof(vec3));
+			slab->normals = malloc(slab->v_size * sizeof(vec3));
+			slab->e_size = 4096;
+			slab->emitted = malloc(slab->e_size * sizeof(uint64_t));
+		}
+		if (pem && !slab->candidates)
+		{
+			slab->c_size = 4096;
+			slab->candidates = malloc(slab->c_size * sizeof(uint64_t));
+		}
+		slab->v_next = 0;
+		slab->c_next = 0;
+		HotCounters_zero(&slab->counters);
+
+		// The previous slab emits the vertices of on-surface points on this slab's first plane. Those points aren't
+		// emitted again here unless a crossing marks them, just as the serial loop finds them already emitted.
+		if (pem && slab->x_begin > 0)
+		{
+			uint32_t x = slab->x_begin;
+			for (uint32_t y = 0; y < dim; y++)
+			{
+				for (uint32_t z = 0; z < dim; z++)
+				{
+					uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4)) * 2;
+					if (((chunk->grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, (dim + 1) / 2)] >> lsh) & 3) == 1)
+						chunk->grid_indexes[GRID3D(x, y, z, dim)] = INDEX_PREVIOUS_SLAB;
+				}
+			}
+		}
+		UMC_label_edges_kernels[pem][tiled](chunk, slab, run->osn);
+		break;
+
+	case UMC_STAGE_REBASE:
+		_UMC_Chunk_rebase_slab(chunk, index, run->candidates);
+		break;
+
+	case UMC_STAGE_POLYGONIZE:
+		if (!slab->indexes)
+		{
+			slab->i_size = 4096;
+			slab->indexes = malloc(slab->i_size * sizeof(uint32_t));
+		}
+		slab->i_next = 0;
+		UMC_polygonize_kernels[pem][tiled](chunk, slab, *chunk->v_out, run->osn);
+		break;
+
+	case UMC_STAGE_COPY_INDEXES:
+		memcpy(*chunk->i_out + slab->i_offset, slab->indexes, slab->i_next * sizeof(uint32_t));
+		break;
+
+	case UMC_STAGE_SNAP_CLEAR:
+	case UMC_STAGE_SNAP_RANK:
+	case UMC_STAGE_SNAP_SPILL:
+	case UMC_STAGE_SNAP_LIST:
+	case UMC_STAGE_SNAP_READY:
+	case UMC_STAGE_SNAP_DECIDE:
+		_UMC_Chunk_snap_slab(run, index);
+		break;
+	}
+}
+
+void _UMC_Chunk_borrow_output(struct UMC_Chunk* chunk, struct UMC_Slab* slab)
+{
+	memset(slab, 0, sizeof(struct UMC_Slab));
+	slab->x_end = chunk->dim + 1;
+	slab->vertices = *chunk->v_out;
+	slab->normals = *chunk->n_out;
+	slab->v_next = *chunk->vn_next;
+	slab->v_size = *chunk->vn_size;
+	slab->indexes = *chunk->i_out;
+	slab->i_next = *chunk->i_next;
+	slab->i_size = *chunk->i_size;
+	HotCounters_zero(&slab->counters);
+}
+
+void _UMC_Chunk_return_output(struct UMC_Chunk* chunk, struct UMC_Slab* slab)
+{
+	*chunk->v_out = slab->vertices;
+	*chunk->n_out = slab->normals;
+	*chunk->vn_next = slab->v_next;
+	*chunk->vn_size = slab->v_size;
+	*chunk->i_out = slab->indexes;
+	*chunk->i_next = slab->i_next;
+	*chunk->i_size = slab->i_size;
+	HotCounters_add(&chunk->counters, &slab->counters);
+}
+
+void _UMC_Chunk_rebase_slab(struct UMC_Chunk* chunk, uint32_t index, uint64_t* candidates)
+{
+	struct UMC_Slab* slab = chunk->slabs + index;
+	uint32_t* grid_indexes = chunk->grid_indexes;
+	uint32_t offset = slab->v_offset;
+
+	// A point can be emitted more than once, only its last index survived. Points on the next slab's first plane only
+	// take the index if that slab left them INDEX_PREVIOUS_SLAB, and then that slab never touches them here.
+	for (uint32_t i = 0; i < slab->v_next; i++)
+	{
+		uint64_t v = slab->emitted[i] >> 3;
+		uint32_t kind = (uint32_t)(slab->emitted[i] & 7);
+		if (kind == 3)
+		{
+			if (grid_indexes[v] == i)
+				grid_indexes[v] = i + offset;
+		}
+		else if (kind == 4)
+		{
+			if (grid_indexes[v] == INDEX_PREVIOUS_SLAB)
+				grid_indexes[v] = i + offset;
+		}
+		else
+		{
+			chunk->edges[v * 3 + kind].iso_vertex.index += offset;
+			chunk->edge_v_indexes[v * 3 + kind] += offset;
+		}
+	}
+
+	memcpy(*chunk->v_out + offset, slab->vertices, slab->v_next * sizeof(vec3));
+	memcpy(*chunk->n_out + offset, slab->normals, slab->v_next * sizeof(vec3));
+	if (candidates)
+		memcpy(candidates + slab->c_offset, slab->candidates, (size_t)slab->c_next * sizeof(uint64_t));
+}
+
+uint32_t _UMC_grown_size(uint32_t size, uint32_t needed)
+{
+	// Doubled like the kernels grow their own output
+	while (size < needed)
+		size *= 2;
+	return size;
+}
+
+void _UMC_share(uint64_t count, uint32_t index, uint32_t parts, uint64_t* begin, uint64_t* end)
+{
+	*begin = count * index / parts;
+	*end = count * (index + 1) / parts;
 }
 
 void UMC_Chunk_run(struct UMC_Chunk* chunk, vec3* corner_verts, int silent, struct osn_context* osn)
 {
 	assert(chunk);
-	double total_ms = 0;
-	double temp = 0;
+	struct UMC_Timings* timings = &chunk->timings;
+	double start_ms;
+	UMC_Timings_zero(timings);
+	HotCounters_zero(&chunk->counters);
 
 	if (!silent)
 		printf("Running MC on chunk.\n--dim: %i\n--indexed: %s\n--pem: %s\n", chunk->dim, BOOL_TO_STRING(chunk->indexed_primitives), BOOL_TO_STRING(chunk->pem));
 
-	if (!chunk->initialized)
+	// A chunk the sampler's bounds keep on one side of the isolevel has nothing to extract, so skip even the grids
+	chunk->footprint = corner_verts ? _UMC_Chunk_footprint(corner_verts, chunk->dim) : 1.0f;
+	_UMC_Chunk_set_lattice(chunk, corner_verts);
+	if (BOUNDS_PRUNING && !_UMC_Chunk_may_cross(chunk, corner_verts, osn))
 	{
-		uint32_t dimp1 = chunk->dim + 1;
-		uint32_t dimp1_h = dimp1 / 2;
-
-		chunk->grid_signs = malloc(dimp1_h * dimp1_h * dimp1_h * sizeof(uint16_t));
-		chunk->grid_verts = malloc(dimp1 * dimp1 * dimp1 * sizeof(struct UMC_Isovertex));
-		chunk->edges = malloc(dimp1 * dimp1 * dimp1 * 3 * sizeof(struct UMC_Edge));
-		chunk->edge_v_indexes = malloc(dimp1 * dimp1 * dimp1 * 3 * sizeof(uint32_t));
+		chunk->v_count = 0;
+		chunk->p_count = 0;
+		chunk->snapped_count = 0;
+		chunk->frame.valid = 0;
+		HOT_COUNT(chunk->counters.pruned_chunks, 1);
+		if (!silent)
+			printf("Sampler bounds exclude the surface. Early abandon.\n");
+		return;
+	}
 
-		memset(chunk->grid_signs, 0, dimp1_h * dimp1_h * dimp1_h * sizeof(uint16_t));
-		memset(chunk->edges, 0, dimp1 * dimp1 * dimp1 * 3 * sizeof(struct UMC_Edge));
-		memset(chunk->edge_v_indexes, 0, dimp1 * dimp1 * dimp1 * 3 * sizeof(uint32_t));
+	// A chunk that abandoned early never sets initialized, but its grids are already allocated
+	_UMC_Chunk_plan_slabs(chunk);
+	if (chunk->animated && _UMC_Chunk_animate(chunk, silent, osn))
+		return;
+	// Restarting over its own last output, an animated chunk rewrites it rather than appending after it
+	struct UMC_Frame* frame = &chunk->frame;
+	if (chunk->animated && frame->marks && *chunk->vn_next == frame->v_start + chunk->v_count && *chunk->i_next == frame->i_start + chunk->p_count)
+	{
+		*chunk->vn_next = frame->v_start;
+		*chunk->i_next = frame->i_start;
+	}
+	frame->valid = 0;
+	if (!chunk->grid_signs)
+	{
+		if (_UMC_Chunk_alloc_grids(chunk))
+		{
+			chunk->v_count = 0;
+			chunk->p_count = 0;
+			chunk->snapped_count = 0;
+			return;
+		}
 	}
 	else
 	{
 		if (!silent)
 			printf("-Reset chunk...");
-		clock_t start_clock = clock();
-		uint32_t dimp1 = chunk->dim + 1;
-		uint32_t dimp1_h = dimp1 / 2;
+		start_ms = Timer_ms();
 
-		memset(chunk->grid_signs, 0, dimp1_h * dimp1_h * dimp1_h * sizeof(uint16_t));
-		memset(chunk->edges, 0, dimp1 * dimp1 * dimp1 * 3 * sizeof(struct UMC_Edge));
-		memset(chunk->edge_v_indexes, 0, dimp1 * dimp1 * dimp1 * 3 * sizeof(uint32_t));
+		_UMC_Chunk_reset_grids(chunk, osn);
 
-		total_ms += clock() - start_clock;
+		timings->reset_ms = (float)(Timer_ms() - start_ms);
 		if (!silent)
-			printf("done (%i ms)\n", (int)(total_ms / (double)CLOCKS_PER_SEC * 1000.0));
+			printf("done (%.2f ms)\n", timings->reset_ms);
 	}
 
+	// An animated chunk that can't keep its frame just runs like any other
+	int keep_frame = chunk->animated && !_UMC_Chunk_alloc_frame(chunk);
+	chunk->frame.v_start = *chunk->vn_next;
+	chunk->frame.i_start = *chunk->i_next;
 
 	if (!silent)
 		printf("-Label grid...");
-	clock_t start_clock = clock();
+	start_ms = Timer_ms();
 	_UMC_Chunk_label_grid(chunk, corner_verts, osn);
-	temp = clock() - start_clock;
-	total_ms += temp;
+	timings->label_grid_ms = (float)(Timer_ms() - start_ms);
+	timings->samples = (uint64_t)(chunk->dim + 1) * (chunk->dim + 1) * (chunk->dim + 1);
 	if (!silent)
-		printf("done (%i ms)\n-Label edges...", (int)(temp / (double)CLOCKS_PER_SEC * 1000.0));
+		printf("done (%.2f ms)\n-Label edges...", timings->label_grid_ms);
 
-	start_clock = clock();
+	// The output buffers only ever double, so their growth gives the realloc count without touching the hot loops
+	uint32_t vn_size_before = *chunk->vn_size;
+	uint32_t i_size_before = *chunk->i_size;
+
+	start_ms = Timer_ms();
 	if (!_UMC_Chunk_label_edges(chunk, silent, osn))
 	{
 		if (!silent)
@@ -194,15 +777,23 @@ void UMC_Chunk_run(struct UMC_Chunk* chunk, vec3* corner_verts, int silent, stru
 	}
 	else
 	{
-		temp = clock() - start_clock;
-		total_ms += temp;
+		// Snapping runs inside edge labeling and times itself
+		timings->label_edges_ms = (float)(Timer_ms() - start_ms) - timings->snap_ms;
 		if (!silent)
-			printf("done (%i ms)\n-Polygonize...", (int)(temp / (double)CLOCKS_PER_SEC * 1000.0));
+			printf("done (%.2f ms, %.2f ms snapping)\n-Polygonize...", timings->label_edges_ms, timings->snap_ms);
 
-		start_clock = clock();
-		_UMC_Chunk_polygonize(chunk, *chunk->v_out, osn);
-		temp = clock() - start_clock;
-		total_ms += temp;
+		start_ms = Timer_ms();
+		if (keep_frame && !chunk->pem)
+			_UMC_Chunk_polygonize_rows(chunk, 0);
+		else
+			_UMC_Chunk_polygonize(chunk, *chunk->v_out, osn);
+		timings->polygonize_ms = (float)(Timer_ms() - start_ms);
+
+		if (HOT_PATH_COUNTERS)
+		{
+			chunk->counters.snapped_vertices = chunk->snapped_count;
+			chunk->counters.output_reallocs += _UMC_count_doublings(vn_size_before, *chunk->vn_size) + _UMC_count_doublings(i_size_before, *chunk->i_size);
+		}
 		/*if (!silent)
 			printf("done (%i ms)\n-Create VAO...", (int)(temp / (double)CLOCKS_PER_SEC * 1000.0));
 
@@ -212,125 +803,281 @@ void UMC_Chunk_run(struct UMC_Chunk* chunk, vec3* corner_verts, int silent, stru
 		total_ms += temp;*/
 
 		if (!silent)
-			printf("done (%i ms)\nComplete in %i ms. %i verts, %i prims (%i snapped).\n\n", (int)(temp / (double)CLOCKS_PER_SEC * 1000.0), (int)(total_ms / (double)CLOCKS_PER_SEC * 1000.0), chunk->v_count, chunk->p_count / 3, chunk->snapped_count);
+			printf("done (%.2f ms)\nComplete in %.2f ms. %i verts, %i prims (%i snapped).\n\n", timings->polygonize_ms, UMC_Timings_total(timings), chunk->v_count, chunk->p_count / 3, chunk->snapped_count);
 
 		chunk->initialized = 1;
+		if (keep_frame)
+			_UMC_Chunk_keep_frame(chunk);
 	}
 }
 
-void _UMC_Chunk_label_grid(struct UMC_Chunk* chunk, vec3* corner_verts, struct osn_context* osn)
+int _UMC_Chunk_may_cross(struct UMC_Chunk* chunk, vec3* corner_verts, struct osn_context* osn)
 {
-	assert(chunk);
-	assert(chunk->grid_verts);
-	assert(sampler_fn);
+	vec3 box_min, box_max;
+	if (corner_verts)
+		vec3_bounds(corner_verts, 8, box_min, box_max);
+	else
+	{
+		// Matches the grid positions label_grid uses without corners
+		float half = (float)((chunk->dim + 1) / 2);
+		vec3_set(box_min, -half, -half, -half);
+		vec3_set(box_max, (float)chunk->dim - half, (float)chunk->dim - half, (float)chunk->dim - half);
+	}
+	return Sampler_may_cross(sampler_fn, box_min, box_max, chunk->timer, chunk->footprint, ISOLEVEL, osn);
+}
 
-	int pem = chunk->pem;
-	uint32_t dim = chunk->dim + 1;
-	uint16_t* grid_signs = chunk->grid_signs;
-	struct UMC_Isovertex* grid_verts = chunk->grid_verts;
-	struct UMC_Isovertex* v;
-	float fx, fy, fz, s;
-	float w = chunk->timer;
+float _UMC_Chunk_footprint(vec3* corner_verts, uint32_t dim)
+{
+	// Longest of the 12 cube edges, so stretched hexahedra are judged by their coarsest direction
+	float longest = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float bottom = vec3_distance(corner_verts[i], corner_verts[(i + 1) & 3]);
+		float top = vec3_distance(corner_verts[i + 4], corner_verts[((i + 1) & 3) + 4]);
+		float side = vec3_distance(corner_verts[i], corner_verts[i + 4]);
+		longest = max(longest, max(bottom, max(top, side)));
+	}
+	return longest / (float)dim;
+}
 
+void _UMC_Chunk_set_lattice(struct UMC_Chunk* chunk, vec3* corner_verts)
+{
+	vec3* l = chunk->lattice;
 	if (!corner_verts)
 	{
-		for (uint32_t x = 0; x < dim; x++)
+		// Without corners the grid is centered on the origin with unit spacing
+		float offset = (float)((chunk->dim + 1) / 2);
+		for (int i = 0; i < 8; i++)
+			vec3_set(l[i], 0, 0, 0);
+		vec3_set(l[0], -offset, -offset, -offset);
+		l[1][0] = 1;
+		l[2][1] = 1;
+		l[3][2] = 1;
+		return;
+	}
+
+	// The trilinear blend of the corners expanded into polynomial terms, each scaled to whole grid steps
+	float f = 1.0f / (float)(chunk->dim);
+	vec3* c = corner_verts;
+	for (int i = 0; i < 3; i++)
+	{
+		l[0][i] = c[0][i];
+		l[1][i] = (c[1][i] - c[0][i]) * f;
+		l[2][i] = (c[4][i] - c[0][i]) * f;
+		l[3][i] = (c[3][i] - c[0][i]) * f;
+		l[4][i] = (c[5][i] - c[4][i] - c[1][i] + c[0][i]) * f * f;
+		l[5][i] = (c[2][i] - c[3][i] - c[1][i] + c[0][i]) * f * f;
+		l[6][i] = (c[7][i] - c[4][i] - c[3][i] + c[0][i]) * f * f;
+		l[7][i] = (c[6][i] - c[7][i] - c[5][i] + c[4][i] - c[2][i] + c[3][i] + c[1][i] - c[0][i]) * f * f * f;
+	}
+}
+
+__forceinline void _UMC_Chunk_lattice_row(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, vec3 origin, vec3 step)
+{
+	// Along z the map is linear, so a row is its first point plus a constant step
+	vec3* l = chunk->lattice;
+	float fx = (float)x, fy = (float)y;
+	for (int i = 0; i < 3; i++)
+	{
+		origin[i] = l[0][i] + fx * l[1][i] + fy * (l[2][i] + fx * l[4][i]);
+		step[i] = l[3][i] + fx * l[5][i] + fy * (l[6][i] + fx * l[7][i]);
+	}
+}
+
+__forceinline void _UMC_Chunk_lattice_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3 out)
+{
+	// Always origin + z * step, so a point recomputed later matches the one label_grid sampled to the bit
+	vec3 origin, step;
+	_UMC_Chunk_lattice_row(chunk, x, y, origin, step);
+	vec3_add_coeff(out, step, origin, (float)z);
+}
+
+int _UMC_Chunk_vertical_axis(vec3* corner_verts)
+{
+	// Corner pairs along each grid axis, in _UMC_Chunk_set_lattice's order
+	static const int pairs[3][4][2] =
+	{
+		{ { 0, 1 }, { 3, 2 }, { 4, 5 }, { 7, 6 } },
+		{ { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } },
+		{ { 0, 3 }, { 1, 2 }, { 4, 7 }, { 5, 6 } },
+	};
+
+	// If all four edges along an axis are vertical, so is every grid line along it
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int vertical = 1;
+		for (int i = 0; i < 4 && vertical; i++)
 		{
-			fx = (float)x - (float)(dim / 2);
-			for (uint32_t y = 0; y < dim; y++)
+			float* a = corner_verts[pairs[axis][i][0]];
+			float* b = corner_verts[pairs[axis][i][1]];
+			vertical = a[0] == b[0] && a[2] == b[2];
+		}
+		if (vertical)
+			return axis;
+	}
+	return -1;
+}
+
+void _UMC_Chunk_fill_columns(struct UMC_Chunk* chunk, int axis, HeightfieldFn height_fn, struct osn_context* osn)
+{
+	uint32_t dim = chunk->dim + 1;
+	vec3 p;
+	for (uint32_t i = 0; i < dim; i++)
+	{
+		for (uint32_t j = 0; j < dim; j++)
+		{
+			// The column's first grid point, any point on it has the same x and z
+			uint32_t g[3] = { i, i, i };
+			g[axis] = 0;
+			g[axis == 2 ? 1 : 2] = j;
+			_UMC_Chunk_lattice_point(chunk, g[0], g[1], g[2], p);
+			chunk->column_heights[i * dim + j] = height_fn(p[0], p[2], chunk->timer, chunk->footprint, osn);
+		}
+		HOT_COUNT(chunk->counters.label_samples, dim);
+	}
+}
+
+void _UMC_Chunk_batch_sample(struct UMC_Chunk* chunk, SamplerBatchFn batch_fn, uint32_t x_begin, uint32_t x_end, struct HotCounters* counters, struct osn_context* osn)
+{
+	uint32_t dim = chunk->dim + 1;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	float xs[SAMPLER_BLOCK], ys[SAMPLER_BLOCK], zs[SAMPLER_BLOCK], out[SAMPLER_BLOCK];
+	vec3 origin, step;
+	for (uint32_t x = x_begin; x < x_end; x++)
+	{
+		for (uint32_t y = 0; y < dim; y++)
+		{
+			_UMC_Chunk_lattice_row(chunk, x, y, origin, step);
+			// Each grid row goes to the sampler in runs of up to a block
+			for (uint32_t z0 = 0; z0 < dim; z0 += SAMPLER_BLOCK)
 			{
-				fy = (float)y - (float)(dim / 2);
-				for (uint32_t z = 0; z < dim; z++)
+				uint32_t count = dim - z0 < SAMPLER_BLOCK ? dim - z0 : SAMPLER_BLOCK;
+				for (uint32_t i = 0; i < count; i++)
 				{
-					fz = (float)z - (float)(dim / 2);
-					s = sampler_fn(fx, fy, fz, w, osn);
-					v = &grid_verts[INDEX3D(x, y, z, dim)];
-					v->value = s;
-					v->index = -1;
-					vec3_set(v->position, fx, fy, fz);
-					if (!pem)
-					{
-						if (s < ISOLEVEL)
-						{
-							uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4));
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-					}
-					else
-					{
-						uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4)) * 2;
-						assert(((grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] >> lsh) & 3) == 0);
-						if (s < ISOLEVEL) // 0
-						{
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] &= ~mask;
-						}
-						else if (s == ISOLEVEL) // 1
-						{
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-						else if (s > ISOLEVEL) // 2
-						{
-							uint32_t mask = 2 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-					}
+					float z = (float)(z0 + i);
+					xs[i] = step[0] * z + origin[0];
+					ys[i] = step[1] * z + origin[1];
+					zs[i] = step[2] * z + origin[2];
+				}
+				HOT_COUNT(counters->label_samples, count);
+				// Linear rows are contiguous, bricked ones are scattered from a block
+				if (!tiled)
+				{
+					batch_fn(xs, ys, zs, chunk->grid_values + INDEX3D(x, y, z0, dim), count, chunk->timer, chunk->footprint, osn);
+					continue;
 				}
+				batch_fn(xs, ys, zs, out, count, chunk->timer, chunk->footprint, osn);
+				for (uint32_t i = 0; i < count; i++)
+					chunk->grid_values[GRID3D(x, y, z0 + i, dim)] = out[i];
 			}
 		}
 	}
-	else
+}
+
+void _UMC_Chunk_label_grid(struct UMC_Chunk* chunk, vec3* corner_verts, struct osn_context* osn)
+{
+	assert(chunk);
+	assert(chunk->grid_values);
+	assert(sampler_fn);
+
+	uint32_t dim = chunk->dim + 1;
+
+	// Only pem chunks use lattice indexes, and snapping can be switched on after the chunk was first run. Every point
+	// starts without an output vertex, which keeps the index stores out of the label loop.
+	if (chunk->pem)
 	{
-		float f_delta = 1.0f / (float)(chunk->dim);
-		vec3 interpolated_point;
-		for (uint32_t x = 0; x < dim; x++)
+		if (!chunk->grid_indexes)
+			chunk->grid_indexes = malloc((size_t)chunk->lattice_count * sizeof(uint32_t));
+		if (!chunk->slab_count)
+			memset(chunk->grid_indexes, 0xFF, (size_t)chunk->lattice_count * sizeof(uint32_t));
+	}
+
+	// Heightfields only need one sample per vertical column of the grid
+	HeightfieldFn height_fn = HEIGHTFIELD_COLUMNS ? Sampler_heightfield(sampler_fn) : 0;
+	int column_axis = height_fn ? (corner_verts ? _UMC_Chunk_vertical_axis(corner_verts) : 1) : -1;
+	float* heights = 0;
+	if (column_axis >= 0)
+	{
+		heights = chunk->column_heights;
+		_UMC_Chunk_fill_columns(chunk, column_axis, height_fn, osn);
+	}
+
+	// Samplers with a batch form are evaluated for the whole grid up front, straight into the lattice values
+	SamplerBatchFn batch_fn = BATCH_SAMPLING && !heights ? Sampler_batch(sampler_fn) : 0;
+	if (chunk->slab_count)
+	{
+		struct UMC_SlabRun run = { 0 };
+		run.chunk = chunk;
+		run.osn = osn;
+		run.heights = heights;
+		run.column_axis = column_axis;
+		run.batch_fn = batch_fn;
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_LABEL_GRID);
+		for (uint32_t i = 0; i < chunk->slab_count; i++)
+			HotCounters_add(&chunk->counters, &chunk->slabs[i].counters);
+		return;
+	}
+
+	float* values = 0;
+	if (batch_fn)
+	{
+		values = chunk->grid_values;
+		_UMC_Chunk_batch_sample(chunk, batch_fn, 0, dim, &chunk->counters, osn);
+	}
+
+	int source = heights ? UMC_SOURCE_HEIGHTS : (values ? UMC_SOURCE_BATCH : UMC_SOURCE_SAMPLER);
+	UMC_label_grid_kernels[chunk->pem ? 1 : 0][chunk->layout == UMC_LAYOUT_TILED][source](chunk, 0, dim, heights, column_axis, values, &chunk->counters, osn);
+}
+
+__forceinline void _UMC_Chunk_label_grid_kernel(struct UMC_Chunk* chunk, uint32_t x_begin, uint32_t x_end, const float* heights, int column_axis, const float* values, struct HotCounters* counters, struct osn_context* osn, const int pem, const int tiled, const int source)
+{
+	uint32_t dim = chunk->dim + 1;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
+	uint16_t* grid_signs = chunk->grid_signs;
+	float* grid_values = chunk->grid_values;
+	const float(*fn)(float x, float y, float z, float w, float footprint, struct osn_context* osn) = sampler_fn;
+	float w = chunk->timer;
+	float footprint = chunk->footprint;
+	vec3 origin, step, p;
+
+	for (uint32_t x = x_begin; x < x_end; x++)
+	{
+		for (uint32_t y = 0; y < dim; y++)
 		{
-			fx = (float)x * f_delta;
-			for (uint32_t y = 0; y < dim; y++)
+			_UMC_Chunk_lattice_row(chunk, x, y, origin, step);
+			for (uint32_t z = 0; z < dim; z++)
 			{
-				fy = (float)y * f_delta;
-				for (uint32_t z = 0; z < dim; z++)
+				// Positions are only needed to sample, batch values already have them baked in
+				if (source != UMC_SOURCE_BATCH)
+					vec3_add_coeff(p, step, origin, (float)z);
+
+				float s;
+				if (source == UMC_SOURCE_HEIGHTS)
+					s = p[1] - heights[COLUMN2D(x, y, z, column_axis, dim)];
+				else if (source == UMC_SOURCE_BATCH)
+					s = values[GRID3D(x, y, z, dim)];
+				else
+					s = fn(p[0], p[1], p[2], w, footprint, osn);
+
+				if (source != UMC_SOURCE_BATCH)
+					grid_values[GRID3D(x, y, z, dim)] = s;
+
+				// Sign codes are or'ed in without branching: one bit set when inside, or 0/1/2 for below/on/above with pem
+				uint32_t lsh = ((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4);
+				uint16_t* signs = &grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, (dim + 1) / 2)];
+				if (pem)
 				{
-					fz = (float)z * f_delta;
-					_UMC_Chunk_trilerp(fx, fy, fz, corner_verts, interpolated_point);
-					s = sampler_fn(interpolated_point[0], interpolated_point[1], interpolated_point[2], w, osn);
-					v = &grid_verts[INDEX3D(x, y, z, dim)];
-					v->value = s;
-					v->index = -1;
-					vec3_set(v->position, interpolated_point[0], interpolated_point[1], interpolated_point[2]);
-					if (!pem)
-					{
-						if (s < ISOLEVEL)
-						{
-							uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4));
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-					}
-					else
-					{
-						uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4)) * 2;
-						assert(((grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] >> lsh) & 3) == 0);
-						if (s < ISOLEVEL) // 0
-						{
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] &= ~mask;
-						}
-						else if (s == ISOLEVEL) // 1
-						{
-							uint32_t mask = 1 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-						else if (s > ISOLEVEL) // 2
-						{
-							uint32_t mask = 2 << lsh;
-							grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim / 2)] |= mask;
-						}
-					}
+					assert(((*signs >> (lsh * 2)) & 3) == 0);
+					*signs |= (uint16_t)(((s >= ISOLEVEL) + (s > ISOLEVEL)) << (lsh * 2));
 				}
+				else
+					*signs |= (uint16_t)((s < ISOLEVEL) << lsh);
 			}
+			// Heights and batch values were counted where they were sampled
+			if (source == UMC_SOURCE_SAMPLER)
+				HOT_COUNT(counters->label_samples, dim);
 		}
 	}
 }
@@ -339,49 +1086,109 @@ int _UMC_Chunk_label_edges(struct UMC_Chunk* chunk, int silent, struct osn_conte
 {
 	assert(chunk);
 	assert(chunk->edges);
+	uint32_t start_index = *chunk->vn_next;
+	uint64_t* candidates;
+	uint64_t candidate_count = 0;
+	struct UMC_SlabRun run = { 0 };
+	run.chunk = chunk;
+	run.osn = osn;
+
+	if (!chunk->slab_count)
+	{
+		struct UMC_Slab slab;
+		_UMC_Chunk_borrow_output(chunk, &slab);
+		if (chunk->pem)
+		{
+			slab.c_size = 4096;
+			slab.candidates = malloc(slab.c_size * sizeof(uint64_t));
+		}
+		UMC_label_edges_kernels[chunk->pem ? 1 : 0][chunk->layout == UMC_LAYOUT_TILED](chunk, &slab, osn);
+		_UMC_Chunk_return_output(chunk, &slab);
+		candidates = slab.candidates;
+		candidate_count = slab.c_next;
+	}
+	else
+	{
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_LABEL_EDGES);
 
-	int pem = chunk->pem;
+		// Each slab's vertices and candidates go after those of the slabs before it, as the serial loop emits them
+		uint32_t next_vertex = start_index;
+		for (uint32_t i = 0; i < chunk->slab_count; i++)
+		{
+			struct UMC_Slab* slab = chunk->slabs + i;
+			slab->v_offset = next_vertex;
+			slab->c_offset = candidate_count;
+			next_vertex += slab->v_next;
+			candidate_count += slab->c_next;
+			HotCounters_add(&chunk->counters, &slab->counters);
+		}
+		uint32_t vn_size = _UMC_grown_size(*chunk->vn_size, next_vertex);
+		if (vn_size != *chunk->vn_size)
+		{
+			*chunk->v_out = realloc(*chunk->v_out, vn_size * sizeof(vec3));
+			*chunk->n_out = realloc(*chunk->n_out, vn_size * sizeof(vec3));
+			*chunk->vn_size = vn_size;
+		}
+		candidates = chunk->pem ? malloc((candidate_count ? candidate_count : 1) * sizeof(uint64_t)) : 0;
+		run.candidates = candidates;
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_REBASE);
+		*chunk->vn_next = next_vertex;
+	}
+
+	if (chunk->pem)
+	{
+		if (!silent)
+			printf("Snapping vertices...");
+		double snap_start_ms = Timer_ms();
+		if (!chunk->slab_count || _UMC_Chunk_snap_slabs(&run, candidate_count))
+			_UMC_Chunk_snap_verts(chunk, chunk->v_out, chunk->n_out, chunk->vn_next, chunk->vn_size, candidates, candidate_count, chunk->timer, osn);
+		chunk->timings.snap_ms = (float)(Timer_ms() - snap_start_ms);
+		free(candidates);
+	}
+
+	chunk->v_count = *chunk->vn_next - start_index;
+	return 1;
+}
+
+__forceinline void _UMC_Chunk_label_edges_kernel(struct UMC_Chunk* chunk, struct UMC_Slab* slab, struct osn_context* osn, const int pem, const int tiled)
+{
 	uint32_t dim = chunk->dim;
-	uint32_t dim_h = (chunk->dim + 1) / 2;
+	uint32_t dim_h = (chunk->dim + 2) / 2;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
 	uint16_t* grid_signs = chunk->grid_signs;
-	struct UMC_Isovertex* grid = chunk->grid_verts;
+	float* grid_values = chunk->grid_values;
+	uint32_t* grid_indexes = chunk->grid_indexes;
 	struct UMC_Edge* edges = chunk->edges;
 	struct UMC_Edge *e_x, *e_y, *e_z;
 	uint32_t* edge_v_indexes = chunk->edge_v_indexes;
 	uint32_t* edge_v;
+	vec3 origin, step, p0, p1;
 
-	//vec3* out_vertices = malloc(4096 * sizeof(vec3));
-	//vec3* out_normals = malloc(4096 * sizeof(vec3));
-	//uint32_t next_vertex = 0;
-	//uint32_t out_size = 4096;
-
-	uint32_t start_index = *chunk->vn_next;
-	vec3** out_vertices = chunk->v_out;
-	vec3** out_normals = chunk->n_out;
-	uint32_t* next_vertex = chunk->vn_next;
-	uint32_t* out_size = chunk->v_out;
-
-	uint32_t* out_indexes = 0;
-	uint32_t next_index = 0;
-	uint32_t out_ind_size = 4096;
-
-	if (pem)
-		out_indexes = malloc(4096 * sizeof(uint32_t));
+	vec3** out_vertices = &slab->vertices;
+	vec3** out_normals = &slab->normals;
+	uint32_t* next_vertex = &slab->v_next;
+	uint32_t* out_size = &slab->v_size;
+	uint32_t recorded = slab->v_next;
+	uint32_t x_end = slab->x_end;
 
 	float w = chunk->timer;
+	float footprint = chunk->footprint;
 
-	uint32_t v0;
+	uint64_t v0, v1;
 	int result_mask;
-	float distance;
 	uint32_t s0, s0_mask;
+	uint64_t gradient_samples = 0;
 
-	for (uint32_t x = 0; x < dim + 1; x++)
+	for (uint32_t x = slab->x_begin; x < x_end; x++)
 	{
 		for (uint32_t y = 0; y < dim + 1; y++)
 		{
+			// Crossings recompute their endpoints from the row rather than reading stored positions
+			_UMC_Chunk_lattice_row(chunk, x, y, origin, step);
 			for (uint32_t z = 0; z < dim + 1; z++)
 			{
-				v0 = INDEX3D(x, y, z, dim + 1);
+				v0 = GRID3D(x, y, z, dim + 1);
 				if (!pem)
 				{
 					s0_mask = 1 << (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4));
@@ -397,325 +1204,605 @@ int _UMC_Chunk_label_edges(struct UMC_Chunk* chunk, int silent, struct osn_conte
 
 				if (x < dim)
 				{
-					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, grid_signs, x, y, z, x + 1, y, z, s0, pem);
+					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, sign_tiles, grid_signs, x, y, z, x + 1, y, z, s0, pem, tiled);
 					if ((!pem && result_mask) || (pem && (result_mask & 4)))
 					{
+						HOT_COUNT(slab->counters.edge_crossings, 1);
 						e_x = edges + v0 * 3;
-						e_x->grid_v0 = v0;
-						e_x->grid_v1 = INDEX3D(x + 1, y, z, dim + 1);
+						v1 = GRID3D(x + 1, y, z, dim + 1);
 						edge_v = edge_v_indexes + v0 * 3;
-						_UMC_Chunk_calc_edge_isov(chunk, e_x, grid, edge_v, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						_UMC_Chunk_lattice_point(chunk, x + 1, y, z, p1);
+						gradient_samples += _UMC_Chunk_calc_edge_isov(chunk, e_x, grid_values[v0], grid_values[v1], p0, p1, edge_v, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_EDGE(v0, EDGE_X));
 
 						if (pem)
 						{
-							grid[e_x->grid_v0].index = -2;
-							grid[e_x->grid_v1].index = -2;
+							// The next slab owns its first plane's indexes and works out this mark itself
+							grid_indexes[v0] = UMC_INDEX_PENDING;
+							if (x + 1 < x_end)
+								grid_indexes[v1] = UMC_INDEX_PENDING;
 							if (x > 0)
-								ADD_OUTPUT_INDEX(e_x->grid_v0);
+								ADD_OUTPUT_INDEX(INDEX3D(x, y, z, dim + 1));
 							if (x < dim)
-								ADD_OUTPUT_INDEX(e_x->grid_v1);
+								ADD_OUTPUT_INDEX(INDEX3D(x + 1, y, z, dim + 1));
 						}
 					}
 					if (pem && (result_mask & 1))
 					{
-						_UMC_Chunk_set_isov(grid + v0, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v0, p0, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_POINT(v0));
 					}
 					if (pem && (result_mask & 2))
 					{
-						_UMC_Chunk_set_isov(grid + INDEX3D(x + 1, y, z, dim + 1), out_vertices, out_normals, next_vertex, out_size, w, osn);
+						_UMC_Chunk_lattice_point(chunk, x + 1, y, z, p1);
+						v1 = GRID3D(x + 1, y, z, dim + 1);
+						if (x + 1 < x_end)
+						{
+							gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v1, p1, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+							RECORD_EMITTED(SLOT_POINT(v1));
+						}
+						else
+						{
+							// First to reach a point on the next slab's first plane, so it always emits. The next slab
+							// only takes the index if none of its own crossings replaced it.
+							uint32_t index = UMC_INDEX_NONE;
+							gradient_samples += _UMC_Chunk_set_isov(&index, p1, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+							RECORD_EMITTED(SLOT_NEXT(v1));
+						}
 					}
 				}
 				if (y < dim)
 				{
-					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, grid_signs, x, y, z, x, y + 1, z, s0, pem);
+					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, sign_tiles, grid_signs, x, y, z, x, y + 1, z, s0, pem, tiled);
 					if ((!pem && result_mask) || (pem && (result_mask & 4)))
 					{
+						HOT_COUNT(slab->counters.edge_crossings, 1);
 						e_y = edges + v0 * 3 + 1;
-						e_y->grid_v0 = v0;
-						e_y->grid_v1 = INDEX3D(x, y + 1, z, dim + 1);
+						v1 = GRID3D(x, y + 1, z, dim + 1);
 						edge_v = edge_v_indexes + v0 * 3 + 1;
-						_UMC_Chunk_calc_edge_isov(chunk, e_y, grid, edge_v, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						_UMC_Chunk_lattice_point(chunk, x, y + 1, z, p1);
+						gradient_samples += _UMC_Chunk_calc_edge_isov(chunk, e_y, grid_values[v0], grid_values[v1], p0, p1, edge_v, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_EDGE(v0, EDGE_Y));
 
 						if (pem)
 						{
-							grid[e_y->grid_v0].index = -2;
-							grid[e_y->grid_v1].index = -2;
+							grid_indexes[v0] = UMC_INDEX_PENDING;
+							grid_indexes[v1] = UMC_INDEX_PENDING;
 							if (y > 0)
-								ADD_OUTPUT_INDEX(e_y->grid_v0);
+								ADD_OUTPUT_INDEX(INDEX3D(x, y, z, dim + 1));
 							if (y < dim)
-								ADD_OUTPUT_INDEX(e_y->grid_v1);
+								ADD_OUTPUT_INDEX(INDEX3D(x, y + 1, z, dim + 1));
 						}
 					}
 					if (pem && (result_mask & 1))
 					{
-						_UMC_Chunk_set_isov(grid + v0, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v0, p0, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_POINT(v0));
 					}
 					if (pem && (result_mask & 2))
 					{
-						_UMC_Chunk_set_isov(grid + INDEX3D(x, y + 1, z, dim + 1), out_vertices, out_normals, next_vertex, out_size, w, osn);
+						_UMC_Chunk_lattice_point(chunk, x, y + 1, z, p1);
+						v1 = GRID3D(x, y + 1, z, dim + 1);
+						gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v1, p1, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_POINT(v1));
 					}
 				}
 				if (z < dim)
 				{
-					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, grid_signs, x, y, z, x, y, z + 1, s0, pem);
+					result_mask = _UMC_Chunk_calc_edge_crossing(dim_h, sign_tiles, grid_signs, x, y, z, x, y, z + 1, s0, pem, tiled);
 					if ((!pem && result_mask) || (pem && (result_mask & 4)))
 					{
+						HOT_COUNT(slab->counters.edge_crossings, 1);
 						e_z = edges + v0 * 3 + 2;
-						e_z->grid_v0 = v0;
-						e_z->grid_v1 = INDEX3D(x, y, z + 1, dim + 1);
+						v1 = GRID3D(x, y, z + 1, dim + 1);
 						edge_v = edge_v_indexes + v0 * 3 + 2;
-						_UMC_Chunk_calc_edge_isov(chunk, e_z, grid, edge_v, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						vec3_add_coeff(p1, step, origin, (float)(z + 1));
+						gradient_samples += _UMC_Chunk_calc_edge_isov(chunk, e_z, grid_values[v0], grid_values[v1], p0, p1, edge_v, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_EDGE(v0, EDGE_Z));
 
 						if (pem)
 						{
-							grid[e_z->grid_v0].index = -2;
-							grid[e_z->grid_v1].index = -2;
+							grid_indexes[v0] = UMC_INDEX_PENDING;
+							grid_indexes[v1] = UMC_INDEX_PENDING;
 							if (z > 0)
-								ADD_OUTPUT_INDEX(e_z->grid_v0);
+								ADD_OUTPUT_INDEX(INDEX3D(x, y, z, dim + 1));
 							if (z < dim)
-								ADD_OUTPUT_INDEX(e_z->grid_v1);
+								ADD_OUTPUT_INDEX(INDEX3D(x, y, z + 1, dim + 1));
 						}
 					}
 					if (pem && (result_mask & 1))
 					{
-						_UMC_Chunk_set_isov(grid + v0, out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p0, step, origin, (float)z);
+						gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v0, p0, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_POINT(v0));
 					}
 					if (pem && (result_mask & 2))
 					{
-						_UMC_Chunk_set_isov(grid + INDEX3D(x, y, z + 1, dim + 1), out_vertices, out_normals, next_vertex, out_size, w, osn);
+						vec3_add_coeff(p1, step, origin, (float)(z + 1));
+						v1 = GRID3D(x, y, z + 1, dim + 1);
+						gradient_samples += _UMC_Chunk_set_isov(grid_indexes + v1, p1, out_vertices, out_normals, next_vertex, out_size, w, footprint, osn);
+						RECORD_EMITTED(SLOT_POINT(v1));
 					}
 				}
 			}
 		}
 	}
+	HOT_COUNT(slab->counters.gradient_samples, gradient_samples);
+}
+
+void _UMC_Chunk_snap_verts(struct UMC_Chunk* chunk, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, uint64_t* out_indexes, uint64_t out_index_size, float w, struct osn_context* osn)
+{
+	assert(chunk);
+	assert(chunk->grid_indexes);
+	assert(sampler_fn);
+
+	// Each point is decided where it first appears. Snapping only ever takes edges away from the points around it, so
+	// a point that didn't snap then never does, and one that did has no edges left.
+	uint32_t snapped_count = 0;
+	uint32_t x, y, z;
+	for (uint64_t idx = 0; idx < out_index_size; idx++)
+	{
+		if (_UMC_snap_coords(out_indexes[idx], chunk->dim, &x, &y, &z))
+			snapped_count += _UMC_Chunk_snap_point(chunk, x, y, z);
+	}
+
+	chunk->snapped_count = snapped_count;
+}
+
+// Snaps the candidates of a parallel run with exactly the serial loop's result, whatever the thread count. Points are
+// ranked by where they first appear in the candidates. Two points only affect each other through a crossed edge they
+// share and either of them could snap to, so a point is ready once every such neighbour ranked before it has decided,
+// and ready points can decide together. Rounds decide every ready point until too few are left or ready, then the
+// rest go in rank order. Each slab decides the points in its own x range, so sign cells and lattice indexes are only
+// ever written by one thread.
+int _UMC_Chunk_snap_slabs(struct UMC_SlabRun* run, uint64_t candidate_count)
+{
+	struct UMC_Chunk* chunk = run->chunk;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t dim = chunk->dim;
+	uint32_t x, y, z;
+
+	// Ranks are positions in the merged candidates, leaving the top two values as markers
+	if (candidate_count >= RANK_DECIDED)
+		return 1;
+	if (!chunk->snap_ranks)
+	{
+		chunk->snap_ranks = malloc((size_t)chunk->lattice_count * sizeof(uint32_t));
+		if (!chunk->snap_ranks)
+		{
+			printf("Failed to alloc snap ranks, snapping serially.\n");
+			return 1;
+		}
+	}
 
-	if (pem)
+	_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_CLEAR);
+	_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_RANK);
+	_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_SPILL);
+	_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_LIST);
+
+	uint64_t pending = 0;
+	for (uint32_t i = 0; i < chunk->slab_count; i++)
+		pending += chunk->slabs[i].s_next;
+	while (pending >= UMC_SNAP_SERIAL_TAIL)
 	{
-		if (!silent)
-			printf("Snapping vertices...");
-		_UMC_Chunk_snap_verts(chunk, out_vertices, out_normals, next_vertex, out_size, out_indexes, next_index, w, osn);
+		_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_READY);
+		uint64_t ready = 0;
+		for (uint32_t i = 0; i < chunk->slab_count; i++)
+			ready += chunk->slabs[i].s_ready;
+		// Long chains of dependent points would take a round per link
+		if (ready * 8 < pending)
+			break;
+		_UMC_Chunk_run_slabs(run, UMC_STAGE_SNAP_DECIDE);
+		pending -= ready;
 	}
 
-	/*if (!chunk->initialized)
+	uint32_t snapped_count = 0;
+	for (uint32_t i = 0; i < chunk->slab_count; i++)
+		snapped_count += chunk->slabs[i].snapped_count;
+	if (pending)
 	{
-		if (next_vertex == 0)
-			goto Cleanup;
-		chunk->vbo_size = out_size;
-		glGenBuffers(1, &chunk->v_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, chunk->v_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
+		uint32_t* ranks = malloc((size_t)pending * sizeof(uint32_t));
+		if (!ranks)
+		{
+			// Decided points come out the same when met again in candidate order
+			printf("Failed to alloc snap tail, finishing serially.\n");
+			_UMC_Chunk_snap_verts(chunk, 0, 0, 0, 0, run->candidates, candidate_count, chunk->timer, run->osn);
+			chunk->snapped_count += snapped_count;
+			return 0;
+		}
 
-		glGenBuffers(1, &chunk->n_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, chunk->n_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
+		uint64_t count = 0;
+		for (uint32_t i = 0; i < chunk->slab_count; i++)
+		{
+			struct UMC_Slab* slab = chunk->slabs + i;
+			for (uint64_t j = 0; j < slab->s_next; j++)
+			{
+				_UMC_snap_coords(slab->snap_points[j], dim, &x, &y, &z);
+				ranks[count++] = chunk->snap_ranks[GRID3D(x, y, z, dim + 1)];
+			}
+		}
+		qsort(ranks, (size_t)count, sizeof(uint32_t), _UMC_compare_ranks);
+		for (uint64_t i = 0; i < count; i++)
+		{
+			_UMC_snap_coords(run->candidates[ranks[i]], dim, &x, &y, &z);
+			snapped_count += _UMC_Chunk_snap_point(chunk, x, y, z);
+		}
+		free(ranks);
 	}
-	else
+
+	chunk->snapped_count = snapped_count;
+	return 0;
+}
+
+void _UMC_Chunk_snap_slab(struct UMC_SlabRun* run, uint32_t index)
+{
+	struct UMC_Chunk* chunk = run->chunk;
+	struct UMC_Slab* slab = chunk->slabs + index;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t dim = chunk->dim;
+	uint32_t* ranks = chunk->snap_ranks;
+	uint64_t begin, end;
+	uint32_t x, y, z;
+
+	switch (run->stage)
 	{
-		if (out_size <= chunk->vbo_size)
+	case UMC_STAGE_SNAP_CLEAR:
+		_UMC_share(chunk->lattice_count, index, chunk->slab_count, &begin, &end);
+		memset(ranks + begin, 0xFF, (size_t)(end - begin) * sizeof(uint32_t));
+		break;
+
+	case UMC_STAGE_SNAP_RANK:
+		// A slab's candidates come before the next slab's, so the points on that slab's first plane are ranked here
+		// once it has ranked its own
+		slab->spill_next = 0;
+		for (uint64_t i = 0; i < slab->c_next; i++)
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, chunk->v_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
+			uint64_t v = slab->candidates[i];
+			if (!_UMC_snap_coords(v, dim, &x, &y, &z))
+				continue;
+			if (x == slab->x_end)
+			{
+				_UMC_push(&slab->spill, &slab->spill_next, &slab->spill_size, v);
+				_UMC_push(&slab->spill, &slab->spill_next, &slab->spill_size, slab->c_offset + i);
+				continue;
+			}
+			uint64_t p = GRID3D(x, y, z, dim + 1);
+			if (ranks[p] == RANK_UNSET)
+				ranks[p] = (uint32_t)(slab->c_offset + i);
+		}
+		break;
 
-			glBindBuffer(GL_ARRAY_BUFFER, chunk->n_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
+	case UMC_STAGE_SNAP_SPILL:
+		for (uint64_t i = 0; i < slab->spill_next; i += 2)
+		{
+			_UMC_snap_coords(slab->spill[i], dim, &x, &y, &z);
+			uint64_t p = GRID3D(x, y, z, dim + 1);
+			if (ranks[p] > (uint32_t)slab->spill[i + 1])
+				ranks[p] = (uint32_t)slab->spill[i + 1];
 		}
-		else
+		break;
+
+	case UMC_STAGE_SNAP_LIST:
+		// Every point is listed once, by the slab holding it. Points too far from all their edges never snap, so they
+		// are decided straight away and nothing waits on them.
+		slab->s_next = 0;
+		slab->snapped_count = 0;
+		for (uint64_t i = 0; i < slab->c_next; i++)
 		{
-			glDeleteBuffers(2, &chunk->v_vbo);
-			chunk->vbo_size = out_size;
-
-			glGenBuffers(1, &chunk->v_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, chunk->v_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_vertices, GL_STATIC_DRAW);
+			uint64_t v = slab->candidates[i];
+			if (!_UMC_snap_coords(v, dim, &x, &y, &z) || x == slab->x_end)
+				continue;
+			uint64_t p = GRID3D(x, y, z, dim + 1);
+			if (ranks[p] != slab->c_offset + i)
+				continue;
+			if (_UMC_Chunk_snap_edge(chunk, x, y, z))
+				_UMC_push(&slab->snap_points, &slab->s_next, &slab->s_size, v);
+			else
+				ranks[p] = RANK_DECIDED;
+		}
+		if (index > 0)
+		{
+			struct UMC_Slab* previous = slab - 1;
+			for (uint64_t i = 0; i < previous->spill_next; i += 2)
+			{
+				_UMC_snap_coords(previous->spill[i], dim, &x, &y, &z);
+				uint64_t p = GRID3D(x, y, z, dim + 1);
+				if (ranks[p] != previous->spill[i + 1])
+					continue;
+				if (_UMC_Chunk_snap_edge(chunk, x, y, z))
+					_UMC_push(&slab->snap_points, &slab->s_next, &slab->s_size, previous->spill[i]);
+				else
+					ranks[p] = RANK_DECIDED;
+			}
+		}
+		break;
 
-			glGenBuffers(1, &chunk->n_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, chunk->n_vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * next_vertex, out_normals, GL_STATIC_DRAW);
+	case UMC_STAGE_SNAP_READY:
+		// Ready points are moved to the front, ranks don't change until every slab has looked
+		slab->s_ready = 0;
+		for (uint64_t i = 0; i < slab->s_next; i++)
+		{
+			uint64_t v = slab->snap_points[i];
+			_UMC_snap_coords(v, dim, &x, &y, &z);
+			if (!_UMC_Chunk_snap_ready(chunk, x, y, z))
+				continue;
+			slab->snap_points[i] = slab->snap_points[slab->s_ready];
+			slab->snap_points[slab->s_ready++] = v;
 		}
-	}*/
-Cleanup:
-	chunk->v_count = *next_vertex - start_index;
+		break;
 
-	//free(out_vertices);
-	//free(out_normals);
-	if (pem)
-		free(out_indexes);
+	case UMC_STAGE_SNAP_DECIDE:
+		for (uint64_t i = 0; i < slab->s_ready; i++)
+		{
+			_UMC_snap_coords(slab->snap_points[i], dim, &x, &y, &z);
+			slab->snapped_count += _UMC_Chunk_snap_point(chunk, x, y, z);
+			ranks[GRID3D(x, y, z, dim + 1)] = RANK_DECIDED;
+		}
+		memmove(slab->snap_points, slab->snap_points + slab->s_ready, (size_t)(slab->s_next - slab->s_ready) * sizeof(uint64_t));
+		slab->s_next -= slab->s_ready;
+		break;
 
-	return 1;
+	default:
+		break;
+	}
 }
 
-void _UMC_Chunk_snap_verts(struct UMC_Chunk* chunk, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, uint32_t* out_indexes, uint32_t out_index_size, float w, struct osn_context* osn)
+__forceinline struct UMC_Edge* _UMC_Chunk_snap_edge(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z)
 {
-	assert(chunk);
-	assert(chunk->grid_verts);
-	assert(sampler_fn);
+	uint32_t dim = chunk->dim;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	struct UMC_Edge* edges = chunk->edges;
+	vec3 position;
 
-	uint32_t snapped_count = 0;
-	int pem = chunk->pem;
+	float min_distance = 3.4e37f;
+	float distance;
+	float max_length = 0;
+	struct UMC_Edge* e;
+	struct UMC_Edge* min_edge;
+
+	_UMC_Chunk_lattice_point(chunk, x, y, z, position);
+	SNAPMC_EDGE_CHECK(x, y, z, 0);
+	SNAPMC_EDGE_CHECK(x, y, z, 1);
+	SNAPMC_EDGE_CHECK(x, y, z, 2);
+	SNAPMC_EDGE_CHECK(x - 1, y, z, 0);
+	SNAPMC_EDGE_CHECK(x, y - 1, z, 1);
+	SNAPMC_EDGE_CHECK(x, y, z - 1, 2);
+
+	return min_distance < chunk->snap_threshold ? min_edge : 0;
+}
+
+__forceinline int _UMC_Chunk_snap_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z)
+{
 	uint32_t dim = chunk->dim;
-	uint32_t dim_h = (chunk->dim + 1) / 2;
+	uint32_t dim_h = (chunk->dim + 2) / 2;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
 	uint16_t* grid_signs = chunk->grid_signs;
-	struct UMC_Isovertex* grid_verts = chunk->grid_verts;
 	struct UMC_Edge* edges = chunk->edges;
-	struct UMC_Isovertex* v;
-	float fx, fy, fz, s;
-	float snap_threshold = chunk->snap_threshold;
-
-	uint32_t v_index;
-	for (uint32_t idx = 0; idx < out_index_size; idx++)
-	{
-		v_index = out_indexes[idx];
-		v = grid_verts + v_index;
-		uint32_t x = v_index / (dim + 1) / (dim + 1);
-		if (x == 0 || x >= dim)
-			continue;
-		uint32_t y = v_index / (dim + 1) % (dim + 1);
-		if (y == 0 || y >= dim)
-			continue;
-		uint32_t z = v_index % (dim + 1);
-		if (z == 0 || z >= dim)
-			continue;
-
-		float min_distance = 3.4e37f;
-		float distance;
-		float max_length = 0;
-		struct UMC_Edge* e;
-		struct UMC_Edge* min_edge;
-
-		SNAPMC_EDGE_CHECK(x, y, z, 0);
-		SNAPMC_EDGE_CHECK(x, y, z, 1);
-		SNAPMC_EDGE_CHECK(x, y, z, 2);
-		SNAPMC_EDGE_CHECK(x - 1, y, z, 0);
-		SNAPMC_EDGE_CHECK(x, y - 1, z, 1);
-		SNAPMC_EDGE_CHECK(x, y, z - 1, 2);
-
-		if (min_distance < snap_threshold)
-		{
-			uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4)) * 2;
-			grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim_h)] &= ~(3 << lsh);
-			grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim_h)] |= (1 << lsh);
-			vec3_copy(min_edge->iso_vertex.position, v->position);
-			v->index = min_edge->iso_vertex.index;
-
-			edges[INDEX3D(x, y, z, dim + 1) * 3 + 0].snapped = 1;
-			edges[INDEX3D(x, y, z, dim + 1) * 3 + 1].snapped = 1;
-			edges[INDEX3D(x, y, z, dim + 1) * 3 + 2].snapped = 1;
-			edges[INDEX3D(x - 1, y, z, dim + 1) * 3 + 0].snapped = 1;
-			edges[INDEX3D(x, y - 1, z, dim + 1) * 3 + 1].snapped = 1;
-			edges[INDEX3D(x, y, z - 1, dim + 1) * 3 + 2].snapped = 1;
-
-			snapped_count++;
-		}
+	uint64_t v_index = GRID3D(x, y, z, dim + 1);
+
+	struct UMC_Edge* min_edge = _UMC_Chunk_snap_edge(chunk, x, y, z);
+	if (!min_edge)
+		return 0;
+
+	uint32_t lsh = (((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4)) * 2;
+	grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim_h)] &= ~(3 << lsh);
+	grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, dim_h)] |= (1 << lsh);
+	chunk->grid_indexes[v_index] = min_edge->iso_vertex.index;
+
+	edges[GRID3D(x, y, z, dim + 1) * 3 + 0].snapped = 1;
+	edges[GRID3D(x, y, z, dim + 1) * 3 + 1].snapped = 1;
+	edges[GRID3D(x, y, z, dim + 1) * 3 + 2].snapped = 1;
+	edges[GRID3D(x - 1, y, z, dim + 1) * 3 + 0].snapped = 1;
+	edges[GRID3D(x, y - 1, z, dim + 1) * 3 + 1].snapped = 1;
+	edges[GRID3D(x, y, z - 1, dim + 1) * 3 + 2].snapped = 1;
+	return 1;
+}
+
+int _UMC_Chunk_snap_ready(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t dim = chunk->dim;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	struct UMC_Edge* edges = chunk->edges;
+	uint32_t* ranks = chunk->snap_ranks;
+	uint64_t v = GRID3D(x, y, z, dim + 1);
+	uint32_t rank = ranks[v];
+	struct UMC_Edge* e;
+	vec3 position, neighbour;
+
+	_UMC_Chunk_lattice_point(chunk, x, y, z, position);
+
+	SNAPMC_WAITS_ON(v, 0, x + 1, y, z);
+	SNAPMC_WAITS_ON(v, 1, x, y + 1, z);
+	SNAPMC_WAITS_ON(v, 2, x, y, z + 1);
+	SNAPMC_WAITS_ON(GRID3D(x - 1, y, z, dim + 1), 0, x - 1, y, z);
+	SNAPMC_WAITS_ON(GRID3D(x, y - 1, z, dim + 1), 1, x, y - 1, z);
+	SNAPMC_WAITS_ON(GRID3D(x, y, z - 1, dim + 1), 2, x, y, z - 1);
+	return 1;
+}
+
+__forceinline int _UMC_snap_coords(uint64_t v, uint32_t dim, uint32_t* x, uint32_t* y, uint32_t* z)
+{
+	// Candidates are recorded as linear coordinates whatever the layout, and points on the chunk's border never snap
+	*x = (uint32_t)(v / (dim + 1) / (dim + 1));
+	if (*x == 0 || *x >= dim)
+		return 0;
+	*y = (uint32_t)(v / (dim + 1) % (dim + 1));
+	if (*y == 0 || *y >= dim)
+		return 0;
+	*z = (uint32_t)(v % (dim + 1));
+	if (*z == 0 || *z >= dim)
+		return 0;
+	return 1;
+}
+
+void _UMC_push(uint64_t** buffer, uint64_t* next, uint64_t* size, uint64_t value)
+{
+	if (*next == *size)
+	{
+		*size = *size ? *size * 2 : 4096;
+		*buffer = realloc(*buffer, (size_t)*size * sizeof(uint64_t));
 	}
+	(*buffer)[(*next)++] = value;
+}
 
-	chunk->snapped_count = snapped_count;
+int _UMC_compare_ranks(const void* a, const void* b)
+{
+	uint32_t ra = *(const uint32_t*)a, rb = *(const uint32_t*)b;
+	return (ra > rb) - (ra < rb);
 }
 
 void _UMC_Chunk_polygonize(struct UMC_Chunk* chunk, vec3* positions, struct osn_context* osn)
 {
 	assert(chunk);
-	int pem = chunk->pem;
+	uint32_t start_index = *chunk->i_next;
+
+	if (!chunk->slab_count)
+	{
+		struct UMC_Slab slab;
+		_UMC_Chunk_borrow_output(chunk, &slab);
+		UMC_polygonize_kernels[chunk->pem ? 1 : 0][chunk->layout == UMC_LAYOUT_TILED](chunk, &slab, positions, osn);
+		_UMC_Chunk_return_output(chunk, &slab);
+	}
+	else
+	{
+		struct UMC_SlabRun run = { 0 };
+		run.chunk = chunk;
+		run.osn = osn;
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_POLYGONIZE);
+
+		// Indexes are already global, so slabs only need their place in the output
+		uint32_t next_index = start_index;
+		for (uint32_t i = 0; i < chunk->slab_count; i++)
+		{
+			chunk->slabs[i].i_offset = next_index;
+			next_index += chunk->slabs[i].i_next;
+		}
+		uint32_t i_size = _UMC_grown_size(*chunk->i_size, next_index);
+		if (i_size != *chunk->i_size)
+		{
+			*chunk->i_out = realloc(*chunk->i_out, i_size * sizeof(uint32_t));
+			*chunk->i_size = i_size;
+		}
+		_UMC_Chunk_run_slabs(&run, UMC_STAGE_COPY_INDEXES);
+		*chunk->i_next = next_index;
+	}
+
+	chunk->p_count = *chunk->i_next - start_index;
+}
+
+__forceinline void _UMC_Chunk_polygonize_cell(struct UMC_Chunk* chunk, struct UMC_Slab* slab, uint32_t x, uint32_t y, uint32_t z, vec3* positions, struct osn_context* osn, const int pem, const int tiled)
+{
 	uint32_t dim = chunk->dim;
-	uint32_t dimp1_h = (chunk->dim + 1) / 2;
+	uint32_t dimp1_h = (chunk->dim + 2) / 2;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
 	uint16_t* grid_signs = chunk->grid_signs;
-	struct UMC_Isovertex* grid_verts = chunk->grid_verts;
-	struct UMC_Edge* edges = chunk->edges;
+	uint32_t* grid_indexes = chunk->grid_indexes;
 	uint32_t* edge_v_indexes = chunk->edge_v_indexes;
 	struct UMC_Cell cell;
-	uint32_t v0;
+	uint64_t v0;
 
-	//uint32_t* out_indexes = malloc(4096 * sizeof(uint32_t));
-	//uint32_t next_index = 0;
-	//uint32_t out_size = 4096;
-	uint32_t start_index = *chunk->i_next;
-	uint32_t** out_indexes = chunk->i_out;
-	uint32_t* next_index = chunk->i_next;
-	uint32_t out_size = chunk->i_size;
-	uint8_t temp_signs[8];
+	cell.mask = 0;
+	if (!pem)
+	{
+		uint32_t mask = 0;
+
+		MC_POLYGONIZE_L(0, 0, 0, 0);
+		MC_POLYGONIZE_L(1, 0, 0, 1);
+		MC_POLYGONIZE_L(1, 0, 1, 2);
+		MC_POLYGONIZE_L(0, 0, 1, 3);
+		MC_POLYGONIZE_L(0, 1, 0, 4);
+		MC_POLYGONIZE_L(1, 1, 0, 5);
+		MC_POLYGONIZE_L(1, 1, 1, 6);
+		MC_POLYGONIZE_L(0, 1, 1, 7);
+
+		if (mask == 0 || mask == 255)
+			return;
+		cell.mask = mask;
+	}
+	else
+	{
+		uint32_t v;
+		uint32_t mask = 0;
+		uint32_t lsh = 0;
+
+		SNAPMC_POLYGONIZE_L(0, 0, 0, 1, 0);
+		SNAPMC_POLYGONIZE_L(1, 0, 0, 3, 1);
+		SNAPMC_POLYGONIZE_L(0, 1, 0, 9, 2);
+		SNAPMC_POLYGONIZE_L(1, 1, 0, 27, 3);
+		SNAPMC_POLYGONIZE_L(0, 0, 1, 81, 4);
+		SNAPMC_POLYGONIZE_L(1, 0, 1, 243, 5);
+		SNAPMC_POLYGONIZE_L(0, 1, 1, 729, 6);
+		SNAPMC_POLYGONIZE_L(1, 1, 1, 2187, 7);
+
+		if (MCPEM_Table[mask][0] == 0)
+			return;
+		cell.mask = mask;
+	}
 
-	for (uint32_t x = 0; x < dim; x++)
+	v0 = GRID3D(x, y, z, dim + 1);
+	if (!pem)
+	{
+		// Follow common mc format
+		cell.iso_verts[0] = edge_v_indexes + v0 * 3 + EDGE_X;
+		cell.iso_verts[1] = edge_v_indexes + GRID3D(x + 1, y, z, dim + 1) * 3 + EDGE_Z;
+		cell.iso_verts[2] = edge_v_indexes + GRID3D(x, y, z + 1, dim + 1) * 3 + EDGE_X;
+		cell.iso_verts[3] = edge_v_indexes + v0 * 3 + EDGE_Z;
+
+		cell.iso_verts[4] = edge_v_indexes + GRID3D(x, y + 1, z, dim + 1) * 3 + EDGE_X;
+		cell.iso_verts[5] = edge_v_indexes + GRID3D(x + 1, y + 1, z, dim + 1) * 3 + EDGE_Z;
+		cell.iso_verts[6] = edge_v_indexes + GRID3D(x, y + 1, z + 1, dim + 1) * 3 + EDGE_X;
+		cell.iso_verts[7] = edge_v_indexes + GRID3D(x, y + 1, z, dim + 1) * 3 + EDGE_Z;
+
+		cell.iso_verts[8] = edge_v_indexes + v0 * 3 + EDGE_Y;
+		cell.iso_verts[9] = edge_v_indexes + GRID3D(x + 1, y, z, dim + 1) * 3 + EDGE_Y;
+		cell.iso_verts[10] = edge_v_indexes + GRID3D(x + 1, y, z + 1, dim + 1) * 3 + EDGE_Y;
+		cell.iso_verts[11] = edge_v_indexes + GRID3D(x, y, z + 1, dim + 1) * 3 + EDGE_Y;
+	}
+	else
+	{
+		cell.iso_verts[8 + 0] = edge_v_indexes + v0 * 3 + EDGE_X;
+		cell.iso_verts[8 + 1] = edge_v_indexes + v0 * 3 + EDGE_Y;
+		cell.iso_verts[8 + 2] = edge_v_indexes + GRID3D(x + 1, y, z, dim + 1) * 3 + EDGE_Y;
+		cell.iso_verts[8 + 3] = edge_v_indexes + GRID3D(x, y + 1, z, dim + 1) * 3 + EDGE_X;
+
+		cell.iso_verts[8 + 4] = edge_v_indexes + v0 * 3 + EDGE_Z;
+		cell.iso_verts[8 + 5] = edge_v_indexes + GRID3D(x + 1, y, z, dim + 1) * 3 + EDGE_Z;
+		cell.iso_verts[8 + 6] = edge_v_indexes + GRID3D(x, y + 1, z, dim + 1) * 3 + EDGE_Z;
+		cell.iso_verts[8 + 7] = edge_v_indexes + GRID3D(x + 1, y + 1, z, dim + 1) * 3 + EDGE_Z;
+
+		cell.iso_verts[8 + 8] = edge_v_indexes + GRID3D(x, y, z + 1, dim + 1) * 3 + EDGE_X;
+		cell.iso_verts[8 + 9] = edge_v_indexes + GRID3D(x, y, z + 1, dim + 1) * 3 + EDGE_Y;
+		cell.iso_verts[8 + 10] = edge_v_indexes + GRID3D(x + 1, y, z + 1, dim + 1) * 3 + EDGE_Y;
+		cell.iso_verts[8 + 11] = edge_v_indexes + GRID3D(x, y + 1, z + 1, dim + 1) * 3 + EDGE_X;
+	}
+
+	_UMC_Chunk_gen_tris(positions, osn, &cell, &slab->indexes, &slab->i_next, &slab->i_size, pem, chunk->footprint);
+}
+
+__forceinline void _UMC_Chunk_polygonize_kernel(struct UMC_Chunk* chunk, struct UMC_Slab* slab, vec3* positions, struct osn_context* osn, const int pem, const int tiled)
+{
+	uint32_t dim = chunk->dim;
+	// The last slab's range ends on the far plane of points, which starts no cells
+	uint32_t x_end = slab->x_end < dim ? slab->x_end : dim;
+
+	for (uint32_t x = slab->x_begin; x < x_end; x++)
 	{
 		for (uint32_t y = 0; y < dim; y++)
 		{
 			for (uint32_t z = 0; z < dim; z++)
-			{
-				cell.mask = 0;
-				if (!pem)
-				{
-					uint32_t mask = 0;
-
-					MC_POLYGONIZE_L(0, 0, 0, 0);
-					MC_POLYGONIZE_L(1, 0, 0, 1);
-					MC_POLYGONIZE_L(1, 0, 1, 2);
-					MC_POLYGONIZE_L(0, 0, 1, 3);
-					MC_POLYGONIZE_L(0, 1, 0, 4);
-					MC_POLYGONIZE_L(1, 1, 0, 5);
-					MC_POLYGONIZE_L(1, 1, 1, 6);
-					MC_POLYGONIZE_L(0, 1, 1, 7);
-
-					if (mask == 0 || mask == 255)
-						continue;
-					cell.mask = mask;
-				}
-				else
-				{
-					uint32_t v;
-					uint32_t mask = 0;
-					uint32_t lsh = 0;
-
-					SNAPMC_POLYGONIZE_L(0, 0, 0, 1, 0);
-					SNAPMC_POLYGONIZE_L(1, 0, 0, 3, 1);
-					SNAPMC_POLYGONIZE_L(0, 1, 0, 9, 2);
-					SNAPMC_POLYGONIZE_L(1, 1, 0, 27, 3);
-					SNAPMC_POLYGONIZE_L(0, 0, 1, 81, 4);
-					SNAPMC_POLYGONIZE_L(1, 0, 1, 243, 5);
-					SNAPMC_POLYGONIZE_L(0, 1, 1, 729, 6);
-					SNAPMC_POLYGONIZE_L(1, 1, 1, 2187, 7);
-
-					if (MCPEM_Table[mask][0] == 0)
-						continue;
-					cell.mask = mask;
-				}
-
-				v0 = INDEX3D(x, y, z, dim + 1);
-				if (!pem)
-				{
-					// Follow common mc format
-					cell.iso_verts[0] = edge_v_indexes + v0 * 3 + EDGE_X;
-					cell.iso_verts[1] = edge_v_indexes + INDEX3D(x + 1, y, z, dim + 1) * 3 + EDGE_Z;
-					cell.iso_verts[2] = edge_v_indexes + INDEX3D(x, y, z + 1, dim + 1) * 3 + EDGE_X;
-					cell.iso_verts[3] = edge_v_indexes + v0 * 3 + EDGE_Z;
-
-					cell.iso_verts[4] = edge_v_indexes + INDEX3D(x, y + 1, z, dim + 1) * 3 + EDGE_X;
-					cell.iso_verts[5] = edge_v_indexes + INDEX3D(x + 1, y + 1, z, dim + 1) * 3 + EDGE_Z;
-					cell.iso_verts[6] = edge_v_indexes + INDEX3D(x, y + 1, z + 1, dim + 1) * 3 + EDGE_X;
-					cell.iso_verts[7] = edge_v_indexes + INDEX3D(x, y + 1, z, dim + 1) * 3 + EDGE_Z;
-
-					cell.iso_verts[8] = edge_v_indexes + v0 * 3 + EDGE_Y;
-					cell.iso_verts[9] = edge_v_indexes + INDEX3D(x + 1, y, z, dim + 1) * 3 + EDGE_Y;
-					cell.iso_verts[10] = edge_v_indexes + INDEX3D(x + 1, y, z + 1, dim + 1) * 3 + EDGE_Y;
-					cell.iso_verts[11] = edge_v_indexes + INDEX3D(x, y, z + 1, dim + 1) * 3 + EDGE_Y;
-				}
-				else
-				{
-					cell.iso_verts[8 + 0] = edge_v_indexes + v0 * 3 + EDGE_X;
-					cell.iso_verts[8 + 1] = edge_v_indexes + v0 * 3 + EDGE_Y;
-					cell.iso_verts[8 + 2] = edge_v_indexes + INDEX3D(x + 1, y, z, dim + 1) * 3 + EDGE_Y;
-					cell.iso_verts[8 + 3] = edge_v_indexes + INDEX3D(x, y + 1, z, dim + 1) * 3 + EDGE_X;
-
-					cell.iso_verts[8 + 4] = edge_v_indexes + v0 * 3 + EDGE_Z;
-					cell.iso_verts[8 + 5] = edge_v_indexes + INDEX3D(x + 1, y, z, dim + 1) * 3 + EDGE_Z;
-					cell.iso_verts[8 + 6] = edge_v_indexes + INDEX3D(x, y + 1, z, dim + 1) * 3 + EDGE_Z;
-					cell.iso_verts[8 + 7] = edge_v_indexes + INDEX3D(x + 1, y + 1, z, dim + 1) * 3 + EDGE_Z;
-
-					cell.iso_verts[8 + 8] = edge_v_indexes + INDEX3D(x, y, z + 1, dim + 1) * 3 + EDGE_X;
-					cell.iso_verts[8 + 9] = edge_v_indexes + INDEX3D(x, y, z + 1, dim + 1) * 3 + EDGE_Y;
-					cell.iso_verts[8 + 10] = edge_v_indexes + INDEX3D(x + 1, y, z + 1, dim + 1) * 3 + EDGE_Y;
-					cell.iso_verts[8 + 11] = edge_v_indexes + INDEX3D(x, y + 1, z + 1, dim + 1) * 3 + EDGE_X;
-				}
-
-				_UMC_Chunk_gen_tris(positions, osn, &cell, out_indexes, next_index, out_size, pem);
-			}
+				_UMC_Chunk_polygonize_cell(chunk, slab, x, y, z, positions, osn, pem, tiled);
 		}
 	}
 
@@ -744,10 +1831,444 @@ void _UMC_Chunk_polygonize(struct UMC_Chunk* chunk, vec3* positions, struct osn_
 		}
 	}*/
 
-	chunk->p_count = *next_index - start_index;
 	//free(out_indexes);
 }
 
+// Polygonizes animated chunks a row of cells at a time, into the frame's scratch and then over the chunk's output.
+// Rows without a dirty flag copy their triangles from the last run, without flags every row is polygonized.
+void _UMC_Chunk_polygonize_rows(struct UMC_Chunk* chunk, const uint8_t* dirty_rows)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dim = chunk->dim;
+	uint32_t rows = dim * dim;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	struct UMC_Slab slab;
+	memset(&slab, 0, sizeof(struct UMC_Slab));
+	slab.indexes = frame->indexes;
+	slab.i_size = frame->i_size;
+
+	for (uint32_t row = 0; row < rows; row++)
+	{
+		uint32_t start = slab.i_next;
+		if (!dirty_rows || dirty_rows[row])
+		{
+			uint32_t x = row / dim, y = row % dim;
+			for (uint32_t z = 0; z < dim; z++)
+			{
+				if (tiled)
+					_UMC_Chunk_polygonize_cell(chunk, &slab, x, y, z, *chunk->v_out, 0, 0, 1);
+				else
+					_UMC_Chunk_polygonize_cell(chunk, &slab, x, y, z, *chunk->v_out, 0, 0, 0);
+			}
+		}
+		else
+		{
+			// The next row's old start is only overwritten once this row is done with it
+			uint32_t count = frame->row_starts[row + 1] - frame->row_starts[row];
+			if (slab.i_next + count > slab.i_size)
+			{
+				slab.i_size = _UMC_grown_size(slab.i_size, slab.i_next + count);
+				slab.indexes = realloc(slab.indexes, slab.i_size * sizeof(uint32_t));
+			}
+			memcpy(slab.indexes + slab.i_next, *chunk->i_out + frame->i_start + frame->row_starts[row], count * sizeof(uint32_t));
+			slab.i_next += count;
+		}
+		frame->row_starts[row] = start;
+	}
+	frame->row_starts[rows] = slab.i_next;
+	frame->indexes = slab.indexes;
+	frame->i_size = slab.i_size;
+
+	uint32_t i_end = frame->i_start + slab.i_next;
+	uint32_t i_size = _UMC_grown_size(*chunk->i_size, i_end);
+	if (i_size != *chunk->i_size)
+	{
+		*chunk->i_out = realloc(*chunk->i_out, i_size * sizeof(uint32_t));
+		*chunk->i_size = i_size;
+	}
+	memcpy(*chunk->i_out + frame->i_start, slab.indexes, slab.i_next * sizeof(uint32_t));
+	*chunk->i_next = i_end;
+	chunk->p_count = slab.i_next;
+}
+
+// Redoes only what the change in timer since the last run can reach. Returns 0 when the last run's frame can't be
+// used, and a full run has to take its place.
+int _UMC_Chunk_animate(struct UMC_Chunk* chunk, int silent, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	struct UMC_Timings* timings = &chunk->timings;
+	SamplerDriftFn drift_fn = Sampler_drift(sampler_fn);
+
+	// Anything that moved the lattice, changed what its values mean or appended output after the chunk's starts over
+	if (!frame->valid || !drift_fn || frame->sampler != (const void*)sampler_fn || frame->pem != chunk->pem ||
+		memcmp(frame->lattice, chunk->lattice, sizeof(chunk->lattice)) ||
+		*chunk->vn_next != frame->v_start + chunk->v_count || *chunk->i_next != frame->i_start + chunk->p_count)
+		return 0;
+
+	vec3 box_min, box_max;
+	_UMC_Chunk_box(chunk, box_min, box_max);
+	float w_min = min(frame->w_min, chunk->timer);
+	float w_max = max(frame->w_max, chunk->timer);
+	float drift = drift_fn(box_min, box_max, w_min, w_max);
+	if (drift >= FLT_MAX)
+		return 0;
+	frame->w_min = w_min;
+	frame->w_max = w_max;
+
+	if (!silent)
+		printf("Animating chunk.\n--w: %.4f (kept values from %.4f to %.4f)\n--drift: %.4f\n", chunk->timer, w_min, w_max, drift);
+	// Nothing the sampler does over the range changes a value, so neither does the mesh
+	if (drift == 0)
+	{
+		if (!silent)
+			printf("Field unchanged.\n\n");
+		return 1;
+	}
+
+	double start_ms = Timer_ms();
+	memset(frame->dirty_rows, 0, (size_t)chunk->dim * chunk->dim);
+	frame->p_next = 0;
+	frame->fl_next = 0;
+	uint64_t resampled = _UMC_Chunk_resample_band(chunk, drift, osn);
+	resampled += _UMC_Chunk_resample_crossings(chunk, osn);
+	timings->label_grid_ms = (float)(Timer_ms() - start_ms);
+	timings->samples = resampled;
+	HOT_COUNT(chunk->counters.label_samples, resampled);
+	if (!silent)
+		printf("-Resampled %llu points (%.2f ms)\n", (unsigned long long)resampled, timings->label_grid_ms);
+
+	start_ms = Timer_ms();
+	if (chunk->pem)
+	{
+		// Snapping depends on where every vertex lands, so pem chunks place and snap all of them again
+		memset(chunk->edges, 0, (size_t)chunk->lattice_count * 3 * sizeof(struct UMC_Edge));
+		memset(chunk->edge_v_indexes, 0, (size_t)chunk->lattice_count * 3 * sizeof(uint32_t));
+		memset(chunk->grid_indexes, 0xFF, (size_t)chunk->lattice_count * sizeof(uint32_t));
+		*chunk->vn_next = frame->v_start;
+		*chunk->i_next = frame->i_start;
+		_UMC_Chunk_label_edges(chunk, 1, osn);
+		timings->label_edges_ms = (float)(Timer_ms() - start_ms) - timings->snap_ms;
+
+		start_ms = Timer_ms();
+		_UMC_Chunk_polygonize(chunk, *chunk->v_out, osn);
+		timings->polygonize_ms = (float)(Timer_ms() - start_ms);
+		_UMC_Chunk_relabel_signs(chunk, osn);
+	}
+	else
+	{
+		_UMC_Chunk_update_edges(chunk, osn);
+		chunk->v_count = *chunk->vn_next - frame->v_start;
+		timings->label_edges_ms = (float)(Timer_ms() - start_ms);
+
+		start_ms = Timer_ms();
+		_UMC_Chunk_polygonize_rows(chunk, frame->dirty_rows);
+		timings->polygonize_ms = (float)(Timer_ms() - start_ms);
+	}
+
+	uint32_t dimp1 = chunk->dim + 1;
+	for (uint64_t i = 0; i < frame->p_next; i++)
+		frame->marks[frame->points[i]] = 0;
+	for (uint64_t i = 0; i < frame->s_next; i++)
+		frame->marks[frame->surface[i]] = 0;
+
+	// Once most of the lattice needs resampling, or most vertex slots are dead, a full run is the cheaper way on
+	if (resampled > (uint64_t)((double)dimp1 * dimp1 * dimp1 * UMC_ANIMATE_RESTART_SHARE) || frame->f_next * 2 > chunk->v_count)
+		frame->valid = 0;
+	if (!silent)
+		printf("Complete in %.2f ms. %i verts, %i prims (%i snapped).\n\n", UMC_Timings_total(timings), chunk->v_count, chunk->p_count / 3, chunk->snapped_count);
+	return 1;
+}
+
+int _UMC_Chunk_alloc_frame(struct UMC_Chunk* chunk)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	if (frame->marks)
+		return 0;
+
+	uint64_t points = (uint64_t)(chunk->dim + 1) * (chunk->dim + 1) * (chunk->dim + 1);
+	uint64_t rows = (uint64_t)chunk->dim * chunk->dim;
+	frame->marks = calloc((size_t)points, sizeof(uint8_t));
+	frame->dirty_rows = malloc((size_t)rows * sizeof(uint8_t));
+	frame->row_starts = malloc((size_t)(rows + 1) * sizeof(uint32_t));
+	frame->i_size = 4096;
+	frame->indexes = malloc(frame->i_size * sizeof(uint32_t));
+	if (!frame->marks || !frame->dirty_rows || !frame->row_starts || !frame->indexes)
+	{
+		printf("Failed to alloc animation frame for dim %u.\n", chunk->dim);
+		_UMC_Chunk_free_frame(chunk);
+		return 1;
+	}
+	return 0;
+}
+
+// A full run's values were all sampled at the current timer. Its signs are kept as sampled, before snapping, and the
+// ends of its crossed edges are listed for the next run.
+void _UMC_Chunk_keep_frame(struct UMC_Chunk* chunk)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dim = chunk->dim;
+	frame->valid = 1;
+	frame->pem = chunk->pem;
+	frame->sampler = (const void*)sampler_fn;
+	memcpy(frame->lattice, chunk->lattice, sizeof(chunk->lattice));
+	frame->w_min = chunk->timer;
+	frame->w_max = chunk->timer;
+	frame->f_next = 0;
+
+	if (chunk->pem)
+		_UMC_Chunk_relabel_signs(chunk, 0);
+	frame->s_next = 0;
+	for (uint32_t x = 0; x <= dim; x++)
+	{
+		for (uint32_t y = 0; y <= dim; y++)
+		{
+			for (uint32_t z = 0; z <= dim; z++)
+			{
+				if (_UMC_Chunk_on_crossing(chunk, x, y, z))
+					_UMC_push(&frame->surface, &frame->s_next, &frame->s_size, INDEX3D(x, y, z, dim + 1));
+			}
+		}
+	}
+}
+
+void _UMC_Chunk_free_frame(struct UMC_Chunk* chunk)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	free(frame->points);
+	free(frame->flipped);
+	free(frame->surface);
+	free(frame->next_surface);
+	free(frame->marks);
+	free(frame->dirty_rows);
+	free(frame->row_starts);
+	free(frame->free_vertices);
+	free(frame->indexes);
+	memset(frame, 0, sizeof(struct UMC_Frame));
+}
+
+void _UMC_Chunk_box(struct UMC_Chunk* chunk, vec3 box_min, vec3 box_max)
+{
+	// The lattice map is trilinear, so the grid's corners bound it
+	vec3 corners[8];
+	for (int i = 0; i < 8; i++)
+		_UMC_Chunk_lattice_point(chunk, (i & 1) ? chunk->dim : 0, (i & 2) ? chunk->dim : 0, (i & 4) ? chunk->dim : 0, corners[i]);
+	vec3_bounds(corners, 8, box_min, box_max);
+}
+
+// Only values within drift of the isolevel can have crossed it
+uint64_t _UMC_Chunk_resample_band(struct UMC_Chunk* chunk, float drift, struct osn_context* osn)
+{
+	uint32_t dim = chunk->dim + 1;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	float* grid_values = chunk->grid_values;
+	uint64_t count = 0;
+	vec3 origin, step, p;
+
+	for (uint32_t x = 0; x < dim; x++)
+	{
+		for (uint32_t y = 0; y < dim; y++)
+		{
+			_UMC_Chunk_lattice_row(chunk, x, y, origin, step);
+			for (uint32_t z = 0; z < dim; z++)
+			{
+				if (fabsf(grid_values[GRID3D(x, y, z, dim)] - ISOLEVEL) > drift)
+					continue;
+				vec3_add_coeff(p, step, origin, (float)z);
+				_UMC_Chunk_resample_point(chunk, x, y, z, p, osn);
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+// The rest kept their signs, but a crossed edge needs both its ends current to place its vertex. An edge crossed now
+// either was last run too, with both ends on the kept surface list, or has an end that flipped.
+uint64_t _UMC_Chunk_resample_crossings(struct UMC_Chunk* chunk, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dimp1 = chunk->dim + 1;
+	uint64_t count = 0;
+
+	frame->ns_next = 0;
+	for (uint64_t i = 0; i < frame->s_next; i++)
+		count += _UMC_Chunk_visit_surface(chunk, frame->surface[i], osn);
+	for (uint64_t i = 0; i < frame->fl_next; i++)
+	{
+		uint64_t v = frame->flipped[i];
+		uint32_t c[3] = { (uint32_t)(v / dimp1 / dimp1), (uint32_t)(v / dimp1 % dimp1), (uint32_t)(v % dimp1) };
+		count += _UMC_Chunk_visit_surface(chunk, v, osn);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			uint64_t stride = axis == 0 ? (uint64_t)dimp1 * dimp1 : (axis == 1 ? dimp1 : 1);
+			if (c[axis] > 0)
+				count += _UMC_Chunk_visit_surface(chunk, v - stride, osn);
+			if (c[axis] < chunk->dim)
+				count += _UMC_Chunk_visit_surface(chunk, v + stride, osn);
+		}
+	}
+
+	uint64_t* surface = frame->surface;
+	uint64_t s_size = frame->s_size;
+	frame->surface = frame->next_surface;
+	frame->s_next = frame->ns_next;
+	frame->s_size = frame->ns_size;
+	frame->next_surface = surface;
+	frame->ns_size = s_size;
+	return count;
+}
+
+// Lists a point that ends a crossed edge on the new surface, resampling it if it wasn't already. Returns 1 if it was.
+int _UMC_Chunk_visit_surface(struct UMC_Chunk* chunk, uint64_t v, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dimp1 = chunk->dim + 1;
+	if (frame->marks[v] & UMC_MARK_SURFACE)
+		return 0;
+
+	uint32_t x = (uint32_t)(v / dimp1 / dimp1), y = (uint32_t)(v / dimp1 % dimp1), z = (uint32_t)(v % dimp1);
+	if (!_UMC_Chunk_on_crossing(chunk, x, y, z))
+		return 0;
+	frame->marks[v] |= UMC_MARK_SURFACE;
+	_UMC_push(&frame->next_surface, &frame->ns_next, &frame->ns_size, v);
+	if (frame->marks[v] & UMC_MARK_FRESH)
+		return 0;
+
+	vec3 p;
+	_UMC_Chunk_lattice_point(chunk, x, y, z, p);
+	_UMC_Chunk_resample_point(chunk, x, y, z, p, osn);
+	return 1;
+}
+
+// Whether any lattice edge from the point has a different sign code at its other end
+int _UMC_Chunk_on_crossing(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t dim = chunk->dim;
+	uint32_t code = _UMC_Chunk_sign_code(chunk, x, y, z);
+	return (x > 0 && _UMC_Chunk_sign_code(chunk, x - 1, y, z) != code) || (x < dim && _UMC_Chunk_sign_code(chunk, x + 1, y, z) != code) ||
+		(y > 0 && _UMC_Chunk_sign_code(chunk, x, y - 1, z) != code) || (y < dim && _UMC_Chunk_sign_code(chunk, x, y + 1, z) != code) ||
+		(z > 0 && _UMC_Chunk_sign_code(chunk, x, y, z - 1) != code) || (z < dim && _UMC_Chunk_sign_code(chunk, x, y, z + 1) != code);
+}
+
+// Samples a lattice point again and marks it fresh, and the rows of the cells around it dirty if its sign changed
+void _UMC_Chunk_resample_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3 p, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dim = chunk->dim;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t sign_tiles = chunk->sign_tiles;
+
+	float s = sampler_fn(p[0], p[1], p[2], chunk->timer, chunk->footprint, osn);
+	chunk->grid_values[GRID3D(x, y, z, dim + 1)] = s;
+	uint64_t v = INDEX3D(x, y, z, dim + 1);
+	frame->marks[v] |= UMC_MARK_FRESH;
+	_UMC_push(&frame->points, &frame->p_next, &frame->p_size, v);
+
+	uint32_t code = chunk->pem ? (s >= ISOLEVEL) + (s > ISOLEVEL) : s < ISOLEVEL;
+	if (code == _UMC_Chunk_sign_code(chunk, x, y, z))
+		return;
+	_UMC_push(&frame->flipped, &frame->fl_next, &frame->fl_size, v);
+
+	uint32_t lsh = ((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4);
+	uint16_t* signs = &chunk->grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, (dim + 2) / 2)];
+	if (chunk->pem)
+		*signs = (uint16_t)((*signs & ~(3 << (lsh * 2))) | (code << (lsh * 2)));
+	else
+		*signs = (uint16_t)((*signs & ~(1 << lsh)) | (code << lsh));
+
+	for (uint32_t cx = x > 0 ? x - 1 : 0; cx <= x && cx < dim; cx++)
+	{
+		for (uint32_t cy = y > 0 ? y - 1 : 0; cy <= y && cy < dim; cy++)
+			frame->dirty_rows[cx * dim + cy] = 1;
+	}
+}
+
+// The bit label_grid sets when inside, or the 0/1/2 code for below/on/above with pem
+__forceinline uint32_t _UMC_Chunk_sign_code(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z)
+{
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t sign_tiles = chunk->sign_tiles;
+	uint32_t lsh = ((z & 1) * 1) + ((y & 1) * 2) + ((x & 1) * 4);
+	uint16_t signs = chunk->grid_signs[ENCODE3D(x >> 1, y >> 1, z >> 1, (chunk->dim + 2) / 2)];
+	return chunk->pem ? (signs >> (lsh * 2)) & 3 : (signs >> lsh) & 1;
+}
+
+// Signs straight from the kept values, the way label_grid set them before snapping moved any
+void _UMC_Chunk_relabel_signs(struct UMC_Chunk* chunk, struct osn_context* osn)
+{
+	memset(chunk->grid_signs, 0, (size_t)chunk->sign_count * sizeof(uint16_t));
+	UMC_label_grid_kernels[chunk->pem ? 1 : 0][chunk->layout == UMC_LAYOUT_TILED][UMC_SOURCE_BATCH](chunk, 0, chunk->dim + 1, 0, -1, chunk->grid_values, &chunk->counters, osn);
+}
+
+// Every edge that crosses now or did before has a resampled end: both ends if it crosses, else the one that flipped.
+// Each is visited once, from its first end unless only the second was resampled.
+void _UMC_Chunk_update_edges(struct UMC_Chunk* chunk, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dim = chunk->dim;
+	uint32_t dimp1 = dim + 1;
+
+	for (uint64_t i = 0; i < frame->p_next; i++)
+	{
+		uint64_t v = frame->points[i];
+		uint32_t c[3] = { (uint32_t)(v / dimp1 / dimp1), (uint32_t)(v / dimp1 % dimp1), (uint32_t)(v % dimp1) };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (c[axis] < dim)
+				_UMC_Chunk_update_edge(chunk, c[0], c[1], c[2], axis, osn);
+			if (c[axis] > 0)
+			{
+				uint32_t b[3] = { c[0], c[1], c[2] };
+				b[axis]--;
+				if (!(frame->marks[INDEX3D(b[0], b[1], b[2], dimp1)] & UMC_MARK_FRESH))
+					_UMC_Chunk_update_edge(chunk, b[0], b[1], b[2], axis, osn);
+			}
+		}
+	}
+}
+
+// Moves a crossed edge's vertex in place, gives a newly crossed edge a free or new slot and frees an uncrossed one's
+void _UMC_Chunk_update_edge(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, int axis, struct osn_context* osn)
+{
+	struct UMC_Frame* frame = &chunk->frame;
+	uint32_t dim = chunk->dim;
+	int tiled = chunk->layout == UMC_LAYOUT_TILED;
+	uint32_t tiles = chunk->tiles;
+	uint32_t e[3] = { x, y, z };
+	e[axis]++;
+
+	uint64_t v0 = GRID3D(x, y, z, dim + 1);
+	uint64_t v1 = GRID3D(e[0], e[1], e[2], dim + 1);
+	struct UMC_Edge* edge = chunk->edges + v0 * 3 + axis;
+	uint32_t* edge_v = chunk->edge_v_indexes + v0 * 3 + axis;
+	if (_UMC_Chunk_sign_code(chunk, x, y, z) == _UMC_Chunk_sign_code(chunk, e[0], e[1], e[2]))
+	{
+		if (edge->crossed)
+		{
+			_UMC_push(&frame->free_vertices, &frame->f_next, &frame->f_size, *edge_v);
+			edge->crossed = 0;
+		}
+		return;
+	}
+
+	uint32_t slot = *chunk->vn_next;
+	if (edge->crossed)
+		slot = *edge_v;
+	else if (frame->f_next)
+		slot = (uint32_t)frame->free_vertices[--frame->f_next];
+	uint32_t next = slot;
+
+	vec3 p0, p1;
+	_UMC_Chunk_lattice_point(chunk, x, y, z, p0);
+	_UMC_Chunk_lattice_point(chunk, e[0], e[1], e[2], p1);
+	uint32_t gradient_samples = _UMC_Chunk_calc_edge_isov(chunk, edge, chunk->grid_values[v0], chunk->grid_values[v1], p0, p1, edge_v, chunk->v_out, chunk->n_out, &next, chunk->vn_size, chunk->timer, chunk->footprint, osn);
+	HOT_COUNT(chunk->counters.gradient_samples, gradient_samples);
+	if (slot == *chunk->vn_next)
+		*chunk->vn_next = next;
+}
+
 void _UMC_Chunk_create_VAO(struct UMC_Chunk* chunk)
 {
 	if (!chunk->initialized)
@@ -765,7 +2286,7 @@ void _UMC_Chunk_create_VAO(struct UMC_Chunk* chunk)
 	glBindVertexArray(0);
 }
 
-__forceinline int _UMC_Chunk_calc_edge_crossing(uint32_t dimp1_h, uint16_t* grid_signs, uint32_t x0, uint32_t y0, uint32_t z0, uint32_t x1, uint32_t y1, uint32_t z1, uint32_t s0, int pem)
+__forceinline int _UMC_Chunk_calc_edge_crossing(uint32_t dimp1_h, uint32_t sign_tiles, uint16_t* grid_signs, uint32_t x0, uint32_t y0, uint32_t z0, uint32_t x1, uint32_t y1, uint32_t z1, uint32_t s0, int pem, int tiled)
 {
 
 	if (!pem)
@@ -805,11 +2326,8 @@ __forceinline int _UMC_Chunk_calc_edge_crossing(uint32_t dimp1_h, uint16_t* grid
 	}
 }
 
-__forceinline int _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_Edge* edge, struct UMC_Isovertex* grid, uint32_t* edge_v, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, struct osn_context* osn)
+__forceinline uint32_t _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_Edge* edge, float s0, float s1, vec3 p0, vec3 p1, uint32_t* edge_v, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, float footprint, struct osn_context* osn)
 {
-	struct UMC_Isovertex gv0, gv1;
-	gv0 = grid[edge->grid_v0];
-	gv1 = grid[edge->grid_v1];
 
 	// Old edge setting stuff, which ended up unnecessary
 	// edge->has_crossing = 1;
@@ -817,9 +2335,10 @@ __forceinline int _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_
 	// edge->grid_v1 = gv1;
 	*edge_v = *next_vertex;
 
-	edge->length = vec3_distance(gv0.position, gv1.position);
-	Sampler_get_intersection(gv0.position, gv1.position, gv0.value, gv1.value, ISOLEVEL, edge->iso_vertex.position);
-	_UMC_get_grad(edge->iso_vertex.position[0], edge->iso_vertex.position[1], edge->iso_vertex.position[2], w, edge->iso_vertex.normal, osn);
+	edge->crossed = 1;
+	edge->length = vec3_distance(p0, p1);
+	Sampler_get_intersection(p0, p1, s0, s1, ISOLEVEL, edge->iso_vertex.position);
+	uint32_t gradient_samples = _UMC_get_grad(edge->iso_vertex.position[0], edge->iso_vertex.position[1], edge->iso_vertex.position[2], w, footprint, edge->iso_vertex.normal, osn);
 	edge->iso_vertex.index = *next_vertex;
 	if (*next_vertex == *out_size)
 	{
@@ -831,9 +2350,10 @@ __forceinline int _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_
 	vec3_set((*out_vertices)[*next_vertex], edge->iso_vertex.position[0], edge->iso_vertex.position[1], edge->iso_vertex.position[2]);
 	vec3_set((*out_normals)[*next_vertex], edge->iso_vertex.normal[0], edge->iso_vertex.normal[1], edge->iso_vertex.normal[2]);
 	(*next_vertex)++;
+	return gradient_samples;
 }
 
-inline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct UMC_Cell* cell, uint32_t** out_indexes, uint32_t* next_index, uint32_t* out_size, int pem)
+__forceinline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct UMC_Cell* cell, uint32_t** out_indexes, uint32_t* next_index, uint32_t* out_size, int pem, float footprint)
 {
 	if (!pem)
 		assert(cell->mask > 0 && cell->mask < 255);
@@ -865,7 +2385,7 @@ inline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct
 		for (int i = 1; i < count * 3 + 1; i++)
 		{
 			int ind = MCPEM_Table[cell->mask][i];
-			assert(*cell->iso_verts[ind] != -1);
+			assert(*cell->iso_verts[ind] != UMC_INDEX_NONE);
 			(*out_indexes)[*next_index] = *cell->iso_verts[ind];
 			(*next_index)++;
 		}
@@ -892,9 +2412,9 @@ inline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct
 				vec3_add_coeff(middle, c, middle, 0.333333f);
 
 				vec3 grad[3];
-				_UMC_get_grad(a[0], a[1], a[2], 0, grad[0], osn);
-				_UMC_get_grad(b[0], b[1], b[2], 0, grad[1], osn);
-				_UMC_get_grad(c[0], c[1], c[2], 0, grad[2], osn);
+				_UMC_get_grad(a[0], a[1], a[2], 0, footprint, grad[0], osn);
+				_UMC_get_grad(b[0], b[1], b[2], 0, footprint, grad[1], osn);
+				_UMC_get_grad(c[0], c[1], c[2], 0, footprint, grad[2], osn);
 				vec3 norm = { 0, 0, 0 };
 				vec3_add_coeff(norm, grad[0], norm, 0.333333f);
 				vec3_add_coeff(norm, grad[1], norm, 0.333333f);
@@ -912,22 +2432,33 @@ inline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct
 	}
 }
 
-inline void _UMC_get_grad(float x, float y, float z, float w, vec3 out, struct osn_context* osn)
+inline uint32_t _UMC_get_grad(float x, float y, float z, float w, float footprint, vec3 out, struct osn_context* osn)
 {
 	const float h = 0.001f;
-	float dx = sampler_fn(x + h, y, z, w, osn) - sampler_fn(x - h, y, z, w, osn);
-	float dy = sampler_fn(x, y + h, z, w, osn) - sampler_fn(x, y - h, z, w, osn);
-	float dz = sampler_fn(x, y, z + h, w, osn) - sampler_fn(x, y, z - h, w, osn);
+	HeightfieldFn height_fn = HEIGHTFIELD_COLUMNS ? Sampler_heightfield(sampler_fn) : 0;
+	if (height_fn)
+	{
+		// y - height(x, z) changes by exactly 2h along y, only the horizontal slopes need samples
+		float hdx = height_fn(x + h, z, w, footprint, osn) - height_fn(x - h, z, w, footprint, osn);
+		float hdz = height_fn(x, z + h, w, footprint, osn) - height_fn(x, z - h, w, footprint, osn);
+		vec3_set(out, -hdx, 2.0f * h, -hdz);
+		return 4;
+	}
+	float dx = sampler_fn(x + h, y, z, w, footprint, osn) - sampler_fn(x - h, y, z, w, footprint, osn);
+	float dy = sampler_fn(x, y + h, z, w, footprint, osn) - sampler_fn(x, y - h, z, w, footprint, osn);
+	float dz = sampler_fn(x, y, z + h, w, footprint, osn) - sampler_fn(x, y, z - h, w, footprint, osn);
 	vec3_set(out, dx, dy, dz);
 	//glm_vec_normalize(out);
+	return 6;
 }
 
-void _UMC_Chunk_set_isov(struct UMC_Isovertex* isov, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, struct osn_context* osn)
+uint32_t _UMC_Chunk_set_isov(uint32_t* index, vec3 position, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, float footprint, struct osn_context* osn)
 {
-	if (isov->index != -1 && isov->index != -2)
-		return;
-	_UMC_get_grad(isov->position[0], isov->position[1], isov->position[2], w, isov->normal, osn);
-	isov->index = *next_vertex;
+	if (*index != UMC_INDEX_NONE && *index != UMC_INDEX_PENDING)
+		return 0;
+	vec3 normal;
+	uint32_t gradient_samples = _UMC_get_grad(position[0], position[1], position[2], w, footprint, normal, osn);
+	*index = *next_vertex;
 	if (*next_vertex == *out_size)
 	{
 		*out_size *= 2;
@@ -935,30 +2466,8 @@ void _UMC_Chunk_set_isov(struct UMC_Isovertex* isov, vec3** out_vertices, vec3**
 		*out_normals = realloc(*out_normals, *out_size * sizeof(vec3));
 	}
 
-	vec3_set((*out_vertices)[*next_vertex], isov->position[0], isov->position[1], isov->position[2]);
-	vec3_set((*out_normals)[*next_vertex], isov->normal[0], isov->normal[1], isov->normal[2]);
+	vec3_set((*out_vertices)[*next_vertex], position[0], position[1], position[2]);
+	vec3_set((*out_normals)[*next_vertex], normal[0], normal[1], normal[2]);
 	(*next_vertex)++;
-}
-
-void _UMC_Chunk_trilerp(float x, float y, float z, vec3* verts, vec3 out)
-{
-	float percents[8];
-	percents[0] = (1.0f - x) * (1.0f - y) * (1.0f - z);
-	percents[1] = (0.0f + x) * (1.0f - y) * (1.0f - z);
-	percents[2] = (0.0f + x) * (1.0f - y) * (0.0f + z);
-	percents[3] = (1.0f - x) * (1.0f - y) * (0.0f + z);
-	percents[4] = (1.0f - x) * (0.0f + y) * (1.0f - z);
-	percents[5] = (0.0f + x) * (0.0f + y) * (1.0f - z);
-	percents[6] = (0.0f + x) * (0.0f + y) * (0.0f + z);
-	percents[7] = (1.0f - x) * (0.0f + y) * (0.0f + z);
-
-	vec3_set(out, 0, 0, 0);
-	vec3_add_coeff(out, verts[0], out, percents[0]);
-	vec3_add_coeff(out, verts[1], out, percents[1]);
-	vec3_add_coeff(out, verts[2], out, percents[2]);
-	vec3_add_coeff(out, verts[3], out, percents[3]);
-	vec3_add_coeff(out, verts[4], out, percents[4]);
-	vec3_add_coeff(out, verts[5], out, percents[5]);
-	vec3_add_coeff(out, verts[6], out, percents[6]);
-	vec3_add_coeff(out, verts[7], out, percents[7]);
+	return gradient_samples;
 }
@@ -7,6 +7,9 @@
 #include <stdint.h>
 
 #include "OpenSimplexNoise.h"
+#include "HotCounters.h"
+#include "Sampler.h"
+#include "Threading.h"
 
 struct UMC_Isovertex
 {
@@ -16,13 +19,175 @@ struct UMC_Isovertex
 	vec3 normal;
 };
 
+// Wall-clock time spent in each stage of the last run, plus how many grid samples were taken
+struct UMC_Timings
+{
+	float reset_ms;
+	float label_grid_ms;
+	float label_edges_ms;
+	float snap_ms;
+	float polygonize_ms;
+	uint64_t samples;
+};
+
+// How the lattice arrays (samples, indexes, signs and edges) are ordered in memory
+enum UMC_Layout
+{
+	UMC_LAYOUT_LINEAR = 0,
+	// Bricks of UMC_TILE^3 points in x-major order, Morton order inside each brick, so lattice neighbours usually share
+	// a brick instead of being a whole grid plane apart
+	UMC_LAYOUT_TILED = 1,
+};
+
+#define UMC_TILE_BITS 3
+#define UMC_TILE (1 << UMC_TILE_BITS)
+// More slabs than threads, so a slab full of surface doesn't leave the other threads waiting
+#define UMC_SLABS_PER_THREAD 4
+// Parallel snapping finishes serially once fewer candidates than this are left undecided
+#define UMC_SNAP_SERIAL_TAIL 4096
+// An animated run that had to resample more of the lattice than this makes the next run start over from a full one,
+// so the spread of w the kept values were sampled at doesn't keep widening
+#define UMC_ANIMATE_RESTART_SHARE 0.25f
+// grid_indexes entries that aren't vertex indexes: no vertex yet, the 0xFF the arrays are cleared to, and a point on a
+// crossed edge whose vertex has to be emitted again
+#define UMC_INDEX_NONE ((uint32_t)-1)
+#define UMC_INDEX_PENDING ((uint32_t)-2)
+#define UMC_MARK_FRESH 1
+#define UMC_MARK_SURFACE 2
+
+// One x-range of the lattice for a pass of the kernels. A serial run is a single slab over the whole chunk borrowing
+// its output buffers. A parallel run gives each slab its own buffers and merges them in x order, so the output is
+// identical to the serial run's.
+struct UMC_Slab
+{
+	uint32_t x_begin;
+	uint32_t x_end;
+	vec3* vertices;
+	vec3* normals;
+	uint32_t v_next;
+	uint32_t v_size;
+	uint32_t* indexes;
+	uint32_t i_next;
+	uint32_t i_size;
+	// SnapMC candidates as linear lattice coordinates
+	uint64_t* candidates;
+	uint64_t c_next;
+	uint64_t c_size;
+	// Parallel slabs only: where each local vertex index was stored, to rebase it once the slab's offset is known
+	uint64_t* emitted;
+	uint32_t e_size;
+	uint32_t v_offset;
+	uint32_t i_offset;
+	uint64_t c_offset;
+	// Parallel snapping: the undecided candidate points this slab holds, the first s_ready of them ready this round,
+	// and its candidates on the next slab's first plane as (point, rank) pairs
+	uint64_t* snap_points;
+	uint64_t s_next;
+	uint64_t s_size;
+	uint64_t s_ready;
+	uint64_t* spill;
+	uint64_t spill_next;
+	uint64_t spill_size;
+	uint32_t snapped_count;
+	struct HotCounters counters;
+};
+
+enum UMC_SlabStage
+{
+	UMC_STAGE_RESET = 0,
+	UMC_STAGE_LABEL_GRID = 1,
+	UMC_STAGE_LABEL_EDGES = 2,
+	UMC_STAGE_REBASE = 3,
+	UMC_STAGE_POLYGONIZE = 4,
+	UMC_STAGE_COPY_INDEXES = 5,
+	UMC_STAGE_SNAP_CLEAR = 6,
+	UMC_STAGE_SNAP_RANK = 7,
+	UMC_STAGE_SNAP_SPILL = 8,
+	UMC_STAGE_SNAP_LIST = 9,
+	UMC_STAGE_SNAP_READY = 10,
+	UMC_STAGE_SNAP_DECIDE = 11,
+};
+
+// A stage handed out slab by slab to the chunk's threads
+struct UMC_SlabRun
+{
+	struct UMC_Chunk* chunk;
+	struct osn_context* osn;
+	enum UMC_SlabStage stage;
+	const float* heights;
+	int column_axis;
+	SamplerBatchFn batch_fn;
+	uint64_t* candidates;
+	volatile int32_t next_slab;
+};
+
+// The threads a chunk's slab stages run on besides the caller, started on its first parallel stage and kept until the
+// chunk is destroyed or its thread count changes, so stages don't pay for thread starts and per-thread sampler caches
+// stay warm between them
+struct UMC_SlabPool
+{
+	struct Thread threads[THREADS_MAX];
+	uint32_t count;
+	struct UMC_SlabRun* run;
+	volatile int32_t running;
+	struct Semaphore work_ready;
+	struct Semaphore work_done;
+};
+
+// What an animated chunk keeps of its last run. Lattice values were each sampled at some w in [w_min, w_max], so the
+// sampler's drift bound over that range and the new w says which of them could have changed sign. Only those, and
+// points on an edge with a sign change, are resampled. Without pem, vertices keep their slots while their edge stays
+// crossed and cell rows whose corners all kept their signs keep their triangles.
+struct UMC_Frame
+{
+	int valid : 1;
+	int pem : 1;
+	const void* sampler;
+	vec3 lattice[8];
+	float w_min;
+	float w_max;
+	uint32_t v_start;
+	uint32_t i_start;
+	// Points resampled this run and points whose sign flipped, as linear lattice coordinates
+	uint64_t* points;
+	uint64_t p_next;
+	uint64_t p_size;
+	uint64_t* flipped;
+	uint64_t fl_next;
+	uint64_t fl_size;
+	// Ends of the edges crossed after the last run, and the list the current one builds
+	uint64_t* surface;
+	uint64_t s_next;
+	uint64_t s_size;
+	uint64_t* next_surface;
+	uint64_t ns_next;
+	uint64_t ns_size;
+	// UMC_MARK_ bits per lattice point, in linear order
+	uint8_t* marks;
+	// Per row of cells (x * dim + y): whether a corner changed sign, and where its triangles start past i_start
+	uint8_t* dirty_rows;
+	uint32_t* row_starts;
+	// Vertex slots left by edges that stopped crossing, reused before the output grows
+	uint64_t* free_vertices;
+	uint64_t f_next;
+	uint64_t f_size;
+	uint32_t* indexes;
+	uint32_t i_size;
+};
+
 struct UMC_Chunk
 {
 	int indexed_primitives : 1;
 	int pem : 1;
 	int initialized : 1;
+	// Runs keep their lattice and only redo what the change in timer can reach, for fields animated through w
+	int animated : 1;
 	float timer;
+	// World-space spacing between grid samples, handed to samplers so they can skip unresolvable detail
+	float footprint;
 	float snap_threshold;
+	// Trilinear map from grid coordinates to world space: origin, then the x, y, z, xy, xz, yz and xyz terms per grid step
+	vec3 lattice[8];
 
 	GLuint vao;
 	GLuint v_vbo;
@@ -44,17 +209,40 @@ struct UMC_Chunk
 	uint32_t* i_size;
 	uint32_t* i_next;
 
+	enum UMC_Layout layout;
+	// Big chunks split each stage over x-slabs on this many threads, 1 runs serially
+	uint32_t threads;
+	struct UMC_Slab* slabs;
+	uint32_t slab_count;
+	uint32_t slab_size;
+	struct UMC_SlabPool* pool;
+	// Where each lattice point first appears among the SnapMC candidates, only allocated to snap in parallel
+	uint32_t* snap_ranks;
+	// Bricks per axis of the point lattice and of the half-resolution sign lattice, and their allocated lengths.
+	// Lattice positions are 64-bit so dims past 1024 don't overflow; output indexes stay 32-bit.
+	uint32_t tiles;
+	uint32_t sign_tiles;
+	uint64_t lattice_count;
+	uint64_t sign_count;
+
 	uint16_t* grid_signs;
-	struct UMC_Isovertex* grid_verts;
+	// The lattice as separate arrays: samples for labelling, and output indexes for snapping, which only pem chunks have.
+	// Positions come from the lattice map and normals are only made for emitted vertices.
+	float* grid_values;
+	uint32_t* grid_indexes;
 	struct UMC_Edge* edges;
 	uint32_t* edge_v_indexes;
+	float* column_heights;
+
+	struct UMC_Frame frame;
+	struct UMC_Timings timings;
+	struct HotCounters counters;
 };
 
 struct UMC_Edge
 {
 	int snapped : 1;
-	uint32_t grid_v0;
-	uint32_t grid_v1;
+	int crossed : 1;
 	float length;
 	struct UMC_Isovertex iso_vertex;
 };
@@ -65,17 +253,90 @@ struct UMC_Cell
 	uint32_t* iso_verts[20];
 };
 
+extern const float(*sampler_fn)(float x, float y, float z, float w, float footprint, struct osn_context* osn);
+
+// Where a label_grid kernel gets each grid point's value
+enum UMC_ValueSource
+{
+	UMC_SOURCE_SAMPLER = 0,
+	UMC_SOURCE_HEIGHTS = 1,
+	UMC_SOURCE_BATCH = 2,
+};
+
+typedef void(*UMC_LabelGridKernel)(struct UMC_Chunk* chunk, uint32_t x_begin, uint32_t x_end, const float* heights, int column_axis, const float* values, struct HotCounters* counters, struct osn_context* osn);
+typedef void(*UMC_LabelEdgesKernel)(struct UMC_Chunk* chunk, struct UMC_Slab* slab, struct osn_context* osn);
+typedef void(*UMC_PolygonizeKernel)(struct UMC_Chunk* chunk, struct UMC_Slab* slab, vec3* positions, struct osn_context* osn);
+
+void UMC_Timings_zero(struct UMC_Timings* t);
+void UMC_Timings_add(struct UMC_Timings* dest, struct UMC_Timings* src);
+float UMC_Timings_total(struct UMC_Timings* t);
+uint32_t _UMC_count_doublings(uint32_t before, uint32_t after);
+
 void UMC_Chunk_init(struct UMC_Chunk* dest, uint32_t dim, int index_vertices, int use_pem, float threshold);
 void UMC_Chunk_destroy(struct UMC_Chunk* chunk);
+void UMC_Chunk_set_layout(struct UMC_Chunk* chunk, enum UMC_Layout layout);
+void UMC_Chunk_set_threads(struct UMC_Chunk* chunk, uint32_t threads);
+void UMC_Chunk_set_animated(struct UMC_Chunk* chunk, int animated);
 void UMC_Chunk_run(struct UMC_Chunk* chunk, vec3* corner_verts, int silent, struct osn_context* osn);
+uint64_t _UMC_layout_count(uint32_t n, enum UMC_Layout layout);
+void _UMC_Chunk_free_grids(struct UMC_Chunk* chunk);
+int _UMC_Chunk_alloc_grids(struct UMC_Chunk* chunk);
+void _UMC_Chunk_reset_grids(struct UMC_Chunk* chunk, struct osn_context* osn);
+void _UMC_Chunk_plan_slabs(struct UMC_Chunk* chunk);
+void _UMC_Chunk_free_slabs(struct UMC_Chunk* chunk);
+void _UMC_Chunk_run_slabs(struct UMC_SlabRun* run, enum UMC_SlabStage stage);
+int _UMC_Chunk_slab_worker(void* arg);
+struct UMC_SlabPool* _UMC_Chunk_pool(struct UMC_Chunk* chunk);
+void _UMC_Chunk_stop_pool(struct UMC_Chunk* chunk);
+int _UMC_SlabPool_worker(void* arg);
+void _UMC_Chunk_slab_stage(struct UMC_SlabRun* run, uint32_t index);
+void _UMC_Chunk_borrow_output(struct UMC_Chunk* chunk, struct UMC_Slab* slab);
+void _UMC_Chunk_return_output(struct UMC_Chunk* chunk, struct UMC_Slab* slab);
+void _UMC_Chunk_rebase_slab(struct UMC_Chunk* chunk, uint32_t index, uint64_t* candidates);
+uint32_t _UMC_grown_size(uint32_t size, uint32_t needed);
+void _UMC_share(uint64_t count, uint32_t index, uint32_t parts, uint64_t* begin, uint64_t* end);
+int _UMC_Chunk_may_cross(struct UMC_Chunk* chunk, vec3* corner_verts, struct osn_context* osn);
+float _UMC_Chunk_footprint(vec3* corner_verts, uint32_t dim);
+void _UMC_Chunk_set_lattice(struct UMC_Chunk* chunk, vec3* corner_verts);
+extern __forceinline void _UMC_Chunk_lattice_row(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, vec3 origin, vec3 step);
+extern __forceinline void _UMC_Chunk_lattice_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3 out);
+int _UMC_Chunk_vertical_axis(vec3* corner_verts);
+void _UMC_Chunk_fill_columns(struct UMC_Chunk* chunk, int axis, HeightfieldFn height_fn, struct osn_context* osn);
+void _UMC_Chunk_batch_sample(struct UMC_Chunk* chunk, SamplerBatchFn batch_fn, uint32_t x_begin, uint32_t x_end, struct HotCounters* counters, struct osn_context* osn);
 void _UMC_Chunk_label_grid(struct UMC_Chunk* chunk, vec3* corner_verts, struct osn_context* osn);
+extern __forceinline void _UMC_Chunk_label_grid_kernel(struct UMC_Chunk* chunk, uint32_t x_begin, uint32_t x_end, const float* heights, int column_axis, const float* values, struct HotCounters* counters, struct osn_context* osn, const int pem, const int tiled, const int source);
 int _UMC_Chunk_label_edges(struct UMC_Chunk* chunk, int silent, struct osn_context* osn);
-void _UMC_Chunk_snap_verts(struct UMC_Chunk* chunk, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, uint32_t* out_indexes, uint32_t out_index_size, float w, struct osn_context* osn);
+extern __forceinline void _UMC_Chunk_label_edges_kernel(struct UMC_Chunk* chunk, struct UMC_Slab* slab, struct osn_context* osn, const int pem, const int tiled);
+void _UMC_Chunk_snap_verts(struct UMC_Chunk* chunk, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, uint64_t* out_indexes, uint64_t out_index_size, float w, struct osn_context* osn);
+int _UMC_Chunk_snap_slabs(struct UMC_SlabRun* run, uint64_t candidate_count);
+void _UMC_Chunk_snap_slab(struct UMC_SlabRun* run, uint32_t index);
+extern __forceinline struct UMC_Edge* _UMC_Chunk_snap_edge(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z);
+extern __forceinline int _UMC_Chunk_snap_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z);
+int _UMC_Chunk_snap_ready(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z);
+extern __forceinline int _UMC_snap_coords(uint64_t v, uint32_t dim, uint32_t* x, uint32_t* y, uint32_t* z);
+void _UMC_push(uint64_t** buffer, uint64_t* next, uint64_t* size, uint64_t value);
+int _UMC_compare_ranks(const void* a, const void* b);
 void _UMC_Chunk_polygonize(struct UMC_Chunk* chunk, vec3* positions, struct osn_context* osn);
+extern __forceinline void _UMC_Chunk_polygonize_kernel(struct UMC_Chunk* chunk, struct UMC_Slab* slab, vec3* positions, struct osn_context* osn, const int pem, const int tiled);
+extern __forceinline void _UMC_Chunk_polygonize_cell(struct UMC_Chunk* chunk, struct UMC_Slab* slab, uint32_t x, uint32_t y, uint32_t z, vec3* positions, struct osn_context* osn, const int pem, const int tiled);
+void _UMC_Chunk_polygonize_rows(struct UMC_Chunk* chunk, const uint8_t* dirty_rows);
+int _UMC_Chunk_animate(struct UMC_Chunk* chunk, int silent, struct osn_context* osn);
+int _UMC_Chunk_alloc_frame(struct UMC_Chunk* chunk);
+void _UMC_Chunk_keep_frame(struct UMC_Chunk* chunk);
+void _UMC_Chunk_free_frame(struct UMC_Chunk* chunk);
+void _UMC_Chunk_box(struct UMC_Chunk* chunk, vec3 box_min, vec3 box_max);
+uint64_t _UMC_Chunk_resample_band(struct UMC_Chunk* chunk, float drift, struct osn_context* osn);
+uint64_t _UMC_Chunk_resample_crossings(struct UMC_Chunk* chunk, struct osn_context* osn);
+int _UMC_Chunk_visit_surface(struct UMC_Chunk* chunk, uint64_t v, struct osn_context* osn);
+int _UMC_Chunk_on_crossing(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z);
+void _UMC_Chunk_resample_point(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, vec3 p, struct osn_context* osn);
+extern __forceinline uint32_t _UMC_Chunk_sign_code(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z);
+void _UMC_Chunk_update_edges(struct UMC_Chunk* chunk, struct osn_context* osn);
+void _UMC_Chunk_relabel_signs(struct UMC_Chunk* chunk, struct osn_context* osn);
+void _UMC_Chunk_update_edge(struct UMC_Chunk* chunk, uint32_t x, uint32_t y, uint32_t z, int axis, struct osn_context* osn);
 void _UMC_Chunk_create_VAO(struct UMC_Chunk* chunk);
-extern __forceinline int _UMC_Chunk_calc_edge_crossing(uint32_t dim, uint16_t* grid_signs, uint32_t x0, uint32_t y0, uint32_t z0, uint32_t x1, uint32_t y1, uint32_t z1, uint32_t s0, int pem);
-extern __forceinline int _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_Edge* edge, struct UMC_Isovertex* grid, uint32_t* edge_v, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, struct osn_context* osn);
-extern inline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct UMC_Cell* cell, uint32_t** out_indexes, uint32_t* next_index, uint32_t* outsize, int pem);
-extern inline void _UMC_get_grad(float x, float y, float z, float w, vec3 out, struct osn_context* osn);
-extern __forceinline void _UMC_Chunk_set_isov(struct UMC_Isovertex* isov, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, struct osn_context* osn);
-extern __forceinline void _UMC_Chunk_trilerp(float x, float y, float z, vec3* verts, vec3 out);
\ No newline at end of file
+extern __forceinline int _UMC_Chunk_calc_edge_crossing(uint32_t dim, uint32_t sign_tiles, uint16_t* grid_signs, uint32_t x0, uint32_t y0, uint32_t z0, uint32_t x1, uint32_t y1, uint32_t z1, uint32_t s0, int pem, int tiled);
+extern __forceinline uint32_t _UMC_Chunk_calc_edge_isov(struct UMC_Chunk* chunk, struct UMC_Edge* edge, float s0, float s1, vec3 p0, vec3 p1, uint32_t* edge_v, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, float footprint, struct osn_context* osn);
+extern __forceinline void _UMC_Chunk_gen_tris(vec3* positions, struct osn_context* osn, struct UMC_Cell* cell, uint32_t** out_indexes, uint32_t* next_index, uint32_t* outsize, int pem, float footprint);
+extern inline uint32_t _UMC_get_grad(float x, float y, float z, float w, float footprint, vec3 out, struct osn_context* osn);
+extern __forceinline uint32_t _UMC_Chunk_set_isov(uint32_t* index, vec3 position, vec3** out_vertices, vec3** out_normals, uint32_t* next_vertex, uint32_t* out_size, float w, float footprint, struct osn_context* osn);
\ No newline at end of file
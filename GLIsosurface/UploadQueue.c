@@ -0,0 +1,117 @@
+#include "UploadQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Timer.h"
+#include "Trace.h"
+
+int UploadQueue_init(struct UploadQueue* q, uint32_t budget_bytes)
+{
+	q->head = 0;
+	q->count = 0;
+	q->size = 1024;
+	q->budget_bytes = budget_bytes;
+	q->pending_bytes = 0;
+	q->failed_meshes = 0;
+	q->last_frame_bytes = 0;
+	q->last_frame_meshes = 0;
+	q->last_frame_ms = 0;
+	q->bandwidth = 0;
+	q->total_bytes = 0;
+	q->items = malloc(q->size * sizeof(struct LeafMesh*));
+	if (!q->items)
+	{
+		printf("Failed to alloc upload queue.\n");
+		q->size = 0;
+		return 1;
+	}
+	return 0;
+}
+
+void UploadQueue_destroy(struct UploadQueue* q)
+{
+	UploadQueue_clear(q);
+	free(q->items);
+	q->items = 0;
+	q->size = 0;
+}
+
+void UploadQueue_clear(struct UploadQueue* q)
+{
+	for (uint32_t i = 0; i < q->count; i++)
+	{
+		struct LeafMesh* mesh = q->items[(q->head + i) % q->size];
+		LeafMesh_destroy(mesh);
+		free(mesh);
+	}
+	q->head = 0;
+	q->count = 0;
+	q->pending_bytes = 0;
+	q->failed_meshes = 0;
+}
+
+int UploadQueue_push(struct UploadQueue* q, struct LeafMesh* mesh)
+{
+	if (q->count == q->size)
+	{
+		// Unwrap into a larger ring
+		uint32_t new_size = q->size ? q->size * 2 : 1024;
+		struct LeafMesh** new_items = malloc(new_size * sizeof(struct LeafMesh*));
+		if (!new_items)
+		{
+			printf("Failed to grow upload queue.\n");
+			return 1;
+		}
+		for (uint32_t i = 0; i < q->count; i++)
+			new_items[i] = q->items[(q->head + i) % q->size];
+		free(q->items);
+		q->items = new_items;
+		q->size = new_size;
+		q->head = 0;
+	}
+
+	q->items[(q->head + q->count) % q->size] = mesh;
+	q->count++;
+	q->pending_bytes += LeafMesh_bytes(mesh);
+	return 0;
+}
+
+uint32_t UploadQueue_flush(struct UploadQueue* q, struct MeshArena* arena)
+{
+	TRACE_BEGIN("UploadQueue_flush");
+	double start = Timer_ms();
+	uint32_t bytes = 0;
+	uint32_t meshes = 0;
+
+	while (q->count)
+	{
+		struct LeafMesh* mesh = q->items[q->head];
+		uint32_t mesh_bytes = LeafMesh_bytes(mesh);
+		if (meshes && bytes + mesh_bytes > q->budget_bytes)
+			break;
+
+		if (TetrahedronNode_upload(mesh->node, arena, mesh))
+			q->failed_meshes++;
+		LeafMesh_destroy(mesh);
+		free(mesh);
+
+		q->head = (q->head + 1) % q->size;
+		q->count--;
+		q->pending_bytes -= mesh_bytes;
+		bytes += mesh_bytes;
+		meshes++;
+	}
+
+	q->last_frame_bytes = bytes;
+	q->last_frame_meshes = meshes;
+	q->last_frame_ms = Timer_ms() - start;
+	q->total_bytes += bytes;
+	if (bytes && q->last_frame_ms > 0)
+	{
+		double mbps = (double)bytes / (1024.0 * 1024.0) / (q->last_frame_ms / 1000.0);
+		q->bandwidth = q->bandwidth > 0 ? q->bandwidth * 0.9 + mbps * 0.1 : mbps;
+	}
+	TRACE_END("UploadQueue_flush");
+
+	return meshes;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Tetrahedron.h"
+#include "MeshArena.h"
+
+// Render-thread staging queue between CPU-side leaf meshes and the mesh arena.
+// Meshes are queued as they arrive and flushed into the arena's preallocated storage with glBufferSubData, at most
+// budget_bytes per frame. At least one mesh goes out each flush so an oversized leaf can't stall the queue.
+// Meshes that fail to upload are dropped and counted in failed_meshes until the queue is next cleared.
+
+struct UploadQueue
+{
+	struct LeafMesh** items;
+	uint32_t head;
+	uint32_t count;
+	uint32_t size;
+	uint32_t budget_bytes;
+	uint64_t pending_bytes;
+	uint32_t failed_meshes;
+
+	uint32_t last_frame_bytes;
+	uint32_t last_frame_meshes;
+	double last_frame_ms;
+	double bandwidth; // MB/s, smoothed over recent flushes
+	uint64_t total_bytes;
+};
+
+int UploadQueue_init(struct UploadQueue* q, uint32_t budget_bytes);
+void UploadQueue_destroy(struct UploadQueue* q);
+void UploadQueue_clear(struct UploadQueue* q);
+int UploadQueue_push(struct UploadQueue* q, struct LeafMesh* mesh);
+uint32_t UploadQueue_flush(struct UploadQueue* q, struct MeshArena* arena);
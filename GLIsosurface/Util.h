@@ -57,6 +57,20 @@ inline void vec3_negate(vec3 dest)
 	dest[2] = -dest[2];
 }
 
+inline void vec3_bounds(vec3* points, int count, vec3 out_min, vec3 out_max)
+{
+	vec3_copy(points[0], out_min);
+	vec3_copy(points[0], out_max);
+	for (int i = 1; i < count; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			out_min[j] = points[i][j] < out_min[j] ? points[i][j] : out_min[j];
+			out_max[j] = points[i][j] > out_max[j] ? points[i][j] : out_max[j];
+		}
+	}
+}
+
 inline float vec3_distance(vec3 a, vec3 b)
 {
 	float x, y, z;
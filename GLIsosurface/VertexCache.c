@@ -0,0 +1,186 @@
+#include "VertexCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t VertexCache_simulate(uint32_t* indexes, uint32_t i_count, uint32_t v_count, int cache_size)
+{
+	// A vertex is cached if fewer than cache_size misses happened since it was last loaded
+	uint32_t* stamps = calloc(v_count, sizeof(uint32_t));
+	if (!stamps)
+		return 0;
+
+	uint32_t misses = 0;
+	uint32_t time = (uint32_t)cache_size + 1;
+	for (uint32_t i = 0; i < i_count; i++)
+	{
+		uint32_t v = indexes[i];
+		if (time - stamps[v] > (uint32_t)cache_size)
+		{
+			stamps[v] = time++;
+			misses++;
+		}
+	}
+
+	free(stamps);
+	return misses;
+}
+
+int VertexCache_optimize(uint32_t* indexes, uint32_t i_count, uint32_t v_count, int cache_size)
+{
+	uint32_t t_count = i_count / 3;
+	if (t_count < 2 || !v_count)
+		return 0;
+
+	int return_code = 0;
+	uint32_t* offsets = calloc(v_count + 1, sizeof(uint32_t));
+	uint32_t* live = calloc(v_count, sizeof(uint32_t));
+	uint32_t* stamps = calloc(v_count, sizeof(uint32_t));
+	uint32_t* adjacency = malloc(t_count * 3 * sizeof(uint32_t));
+	uint32_t* dead_ends = malloc(t_count * 3 * sizeof(uint32_t));
+	uint32_t* candidates = malloc(t_count * 3 * sizeof(uint32_t));
+	uint32_t* output = malloc(t_count * 3 * sizeof(uint32_t));
+	uint8_t* emitted = calloc(t_count, 1);
+	if (!offsets || !live || !stamps || !adjacency || !dead_ends || !candidates || !output || !emitted)
+	{
+		return_code = 1;
+		goto Cleanup;
+	}
+
+	// Vertex -> triangle adjacency, packed by vertex
+	for (uint32_t i = 0; i < t_count * 3; i++)
+		live[indexes[i]]++;
+	for (uint32_t v = 0; v < v_count; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	for (uint32_t i = 0; i < t_count * 3; i++)
+	{
+		uint32_t v = indexes[i];
+		adjacency[offsets[v + 1] - live[v]] = i / 3;
+		live[v]--;
+	}
+	for (uint32_t i = 0; i < t_count * 3; i++)
+		live[indexes[i]]++;
+
+	uint32_t out_next = 0;
+	uint32_t dead_end_count = 0;
+	uint32_t cursor = 0;
+	uint32_t time = (uint32_t)cache_size + 1;
+	int32_t fan = 0;
+
+	while (fan >= 0)
+	{
+		uint32_t candidate_count = 0;
+		for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++)
+		{
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = indexes[t * 3 + k];
+				output[out_next++] = v;
+				dead_ends[dead_end_count++] = v;
+				candidates[candidate_count++] = v;
+				live[v]--;
+				if (time - stamps[v] > (uint32_t)cache_size)
+					stamps[v] = time++;
+			}
+		}
+
+		fan = _VertexCache_next_vertex(candidates, candidate_count, live, stamps, time, cache_size, dead_ends, &dead_end_count, &cursor, v_count);
+	}
+
+	memcpy(indexes, output, t_count * 3 * sizeof(uint32_t));
+
+Cleanup:
+	free(offsets);
+	free(live);
+	free(stamps);
+	free(adjacency);
+	free(dead_ends);
+	free(candidates);
+	free(output);
+	free(emitted);
+	return return_code;
+}
+
+int32_t _VertexCache_next_vertex(uint32_t* candidates, uint32_t candidate_count, uint32_t* live, uint32_t* stamps, uint32_t time, int cache_size, uint32_t* dead_ends, uint32_t* dead_end_count, uint32_t* cursor, uint32_t v_count)
+{
+	// Prefer the candidate that will still be in the cache after its remaining triangles are emitted, oldest first
+	int32_t best = -1;
+	int64_t best_priority = -1;
+	for (uint32_t i = 0; i < candidate_count; i++)
+	{
+		uint32_t v = candidates[i];
+		if (!live[v])
+			continue;
+
+		int64_t priority = 0;
+		if ((int64_t)(time - stamps[v]) + 2 * (int64_t)live[v] <= cache_size)
+			priority = time - stamps[v];
+		if (priority > best_priority)
+		{
+			best_priority = priority;
+			best = (int32_t)v;
+		}
+	}
+	if (best >= 0)
+		return best;
+
+	// Dead end: back up through recently used vertices, then fall back to scanning in order
+	while (*dead_end_count)
+	{
+		uint32_t v = dead_ends[--(*dead_end_count)];
+		if (live[v])
+			return (int32_t)v;
+	}
+	while (*cursor < v_count)
+	{
+		if (live[*cursor])
+			return (int32_t)*cursor;
+		(*cursor)++;
+	}
+	return -1;
+}
+
+int VertexCache_reorder_vertices(uint32_t* indexes, uint32_t i_count, vec3* vertices, vec3* normals, uint32_t* v_count)
+{
+	uint32_t in_count = *v_count;
+	uint32_t* remap = malloc(in_count * sizeof(uint32_t));
+	vec3* scratch = malloc(in_count * sizeof(vec3));
+	if (!remap || !scratch)
+	{
+		free(remap);
+		free(scratch);
+		return 1;
+	}
+
+	memset(remap, 0xFF, in_count * sizeof(uint32_t));
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < i_count; i++)
+	{
+		if (remap[indexes[i]] == UINT32_MAX)
+			remap[indexes[i]] = next++;
+		indexes[i] = remap[indexes[i]];
+	}
+
+	for (uint32_t v = 0; v < in_count; v++)
+	{
+		if (remap[v] != UINT32_MAX)
+			glm_vec_copy(vertices[v], scratch[remap[v]]);
+	}
+	memcpy(vertices, scratch, next * sizeof(vec3));
+	for (uint32_t v = 0; v < in_count; v++)
+	{
+		if (remap[v] != UINT32_MAX)
+			glm_vec_copy(normals[v], scratch[remap[v]]);
+	}
+	memcpy(normals, scratch, next * sizeof(vec3));
+	*v_count = next;
+
+	free(remap);
+	free(scratch);
+	return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cglm\cglm.h>
+#include <stdint.h>
+
+// Post-transform vertex cache optimization for indexed triangle lists.
+// Triangles are reordered with Tipsify (Sander et al. 2007), then vertices are renumbered in first-use order so
+// vertex fetches walk memory forwards; unreferenced vertices are dropped. A FIFO cache simulator measures the result:
+// ACMR = cache misses per triangle, ATVR = cache misses per vertex (1.0 is the best possible).
+
+#define VERTEX_CACHE_SIZE 16
+
+uint32_t VertexCache_simulate(uint32_t* indexes, uint32_t i_count, uint32_t v_count, int cache_size);
+int VertexCache_optimize(uint32_t* indexes, uint32_t i_count, uint32_t v_count, int cache_size);
+int VertexCache_reorder_vertices(uint32_t* indexes, uint32_t i_count, vec3* vertices, vec3* normals, uint32_t* v_count);
+
+int32_t _VertexCache_next_vertex(uint32_t* candidates, uint32_t candidate_count, uint32_t* live, uint32_t* stamps, uint32_t time, int cache_size, uint32_t* dead_ends, uint32_t* dead_end_count, uint32_t* cursor, uint32_t v_count);